@@ -137,6 +137,10 @@ DiskOpen(CHAR* Path, OPENMODE OpenMode, ULONG* FileId)
         SectorCount = (ULONGLONG)Geometry.Cylinders * Geometry.Heads * Geometry.Sectors;
     }
 
+    /* Most boot files come from the boot drive, cache its reads */
+    if (DriveNumber == FrldrBootDrive && DriveNumber >= 0x80)
+        CacheInitializeDrive(DriveNumber);
+
     Context = FrLdrTempAlloc(sizeof(DISKCONTEXT), TAG_HW_DISK_CONTEXT);
     if (!Context)
         return ENOMEM;
@@ -170,6 +174,23 @@ DiskRead(ULONG FileId, VOID* Buffer, ULONG N, ULONG* Count)
     // In release builds assertions are disabled, however we also have sanity checks in DiskOpen()
     ASSERT(MaxSectors > 0);
 
+    /* Whole-sector reads from the cached drive go through the disk cache */
+    if (CacheManagerInitialized &&
+        Context->DriveNumber == CacheManagerDrive.DriveNumber &&
+        Context->SectorSize == CacheManagerDrive.BytesPerSector &&
+        (N % Context->SectorSize) == 0)
+    {
+        if (!CacheReadDiskSectors(Context->DriveNumber, SectorOffset, TotalSectors, Buffer))
+        {
+            *Count = 0;
+            return EIO;
+        }
+
+        *Count = N;
+        Context->SectorNumber += TotalSectors;
+        return ESUCCESS;
+    }
+
     ret = TRUE;
 
     while (TotalSectors)
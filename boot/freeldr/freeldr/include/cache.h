@@ -20,9 +20,11 @@
 
 #pragma once
 
-#define TAG_CACHE_DATA 'DcaC'
 #define TAG_CACHE_BLOCK 'BcaC'
 
+#define CACHE_HASH_SIZE         256     // Number of buckets in the block hash table
+#define CACHE_STREAMING_BLOCKS  4       // Reads spanning more blocks than this bypass the cache
+
 ///////////////////////////////////////////////////////////////////////////////////////
 //
 // This structure describes a cached block element. The disk is divided up into
@@ -34,7 +36,8 @@
 ///////////////////////////////////////////////////////////////////////////////////////
 typedef struct
 {
-    LIST_ENTRY    ListEntry;                    // Doubly linked list synchronization member
+    LIST_ENTRY    ListEntry;                    // LRU list entry, most recently used first
+    LIST_ENTRY    HashListEntry;                // Entry in the block hash table bucket
 
     ULONG            BlockNumber;                // Track index for CHS, 64k block index for LBA
     BOOLEAN        LockedInCache;                // Indicates that this block is locked in cache memory
@@ -57,7 +60,9 @@ typedef struct
     ULONG            BytesPerSector;
 
     ULONG            BlockSize;            // Block size (in sectors)
+    ULONG            MaxReadBlocks;            // Maximum number of blocks read at once
     LIST_ENTRY        CacheBlockHead;            // Contains CACHE_BLOCK structures
+    LIST_ENTRY        CacheBlockHash[CACHE_HASH_SIZE];    // CACHE_BLOCK structures hashed by block number
 
 } CACHE_DRIVE, *PCACHE_DRIVE;
 
@@ -80,7 +85,8 @@ extern    SIZE_T                CacheSizeCurrent;
 ///////////////////////////////////////////////////////////////////////////////////////
 PCACHE_BLOCK    CacheInternalGetBlockPointer(PCACHE_DRIVE CacheDrive, ULONG BlockNumber);                // Returns a pointer to a CACHE_BLOCK structure given a block number
 PCACHE_BLOCK    CacheInternalFindBlock(PCACHE_DRIVE CacheDrive, ULONG BlockNumber);                    // Searches the block list for a particular block
-PCACHE_BLOCK    CacheInternalAddBlockToCache(PCACHE_DRIVE CacheDrive, ULONG BlockNumber);                // Adds a block to the cache's block list
+PCACHE_BLOCK    CacheInternalAddBlockToCache(PCACHE_DRIVE CacheDrive, ULONG BlockNumber, PVOID BlockData);    // Adds a block already read from disk to the cache's block list
+BOOLEAN            CacheInternalReadSectors(PCACHE_DRIVE CacheDrive, ULONGLONG StartSector, ULONG SectorCount, PVOID Buffer);    // Reads sectors from disk without caching them
 BOOLEAN            CacheInternalFreeBlock(PCACHE_DRIVE CacheDrive);                                    // Removes a block from the cache's block list & frees the memory
 VOID            CacheInternalCheckCacheSizeLimits(PCACHE_DRIVE CacheDrive);                            // Checks the cache size limits to see if we can add a new block, if not calls CacheInternalFreeBlock()
 VOID            CacheInternalDumpBlockList(PCACHE_DRIVE CacheDrive);                                // Dumps the list of cached blocks to the debug output port
@@ -91,6 +91,7 @@
 #include <fs/iso.h>
 #include <fs/pxe.h>
 #include <fs/btrfs.h>
+#include <fs/bootpack.h>
 
 /* UI support */
 #include <ui/gui.h>
@@ -0,0 +1,11 @@
+/*
+ * PROJECT:     FreeLoader
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Boot pack support
+ */
+
+#pragma once
+
+BOOLEAN BootPackLoad(IN PCSTR BootPath);
+VOID BootPackUnload(VOID);
+const DEVVTBL* BootPackLookup(IN PCSTR Path, IN ULONG FileId);
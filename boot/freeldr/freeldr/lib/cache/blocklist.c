@@ -37,60 +37,62 @@ PCACHE_BLOCK CacheInternalGetBlockPointer(PCACHE_DRIVE CacheDrive, ULONG BlockNu
     {
         TRACE("Cache hit! BlockNumber: %d CacheBlock->BlockNumber: %d\n", BlockNumber, CacheBlock->BlockNumber);
 
+        // Optimize the block list so it has a LRU structure
+        CacheInternalOptimizeBlockList(CacheDrive, CacheBlock);
+
         return CacheBlock;
     }
 
     TRACE("Cache miss! BlockNumber: %d\n", BlockNumber);
 
-    CacheBlock = CacheInternalAddBlockToCache(CacheDrive, BlockNumber);
-
-    // Optimize the block list so it has a LRU structure
-    CacheInternalOptimizeBlockList(CacheDrive, CacheBlock);
+    if (!MachDiskReadLogicalSectors(CacheDrive->DriveNumber,
+                                    (ULONGLONG)BlockNumber * CacheDrive->BlockSize,
+                                    CacheDrive->BlockSize,
+                                    DiskReadBuffer))
+    {
+        return NULL;
+    }
 
-    return CacheBlock;
+    return CacheInternalAddBlockToCache(CacheDrive, BlockNumber, DiskReadBuffer);
 }
 
 PCACHE_BLOCK CacheInternalFindBlock(PCACHE_DRIVE CacheDrive, ULONG BlockNumber)
 {
-    PCACHE_BLOCK    CacheBlock = NULL;
+    PLIST_ENTRY        BucketHead;
+    PLIST_ENTRY        Entry;
+    PCACHE_BLOCK    CacheBlock;
 
     TRACE("CacheInternalFindBlock() BlockNumber = %d\n", BlockNumber);
 
     //
-    // Make sure the block list has entries before I start searching it.
+    // Only the blocks hashed to the same bucket need to be searched
     //
-    if (!IsListEmpty(&CacheDrive->CacheBlockHead))
+    BucketHead = &CacheDrive->CacheBlockHash[BlockNumber % CACHE_HASH_SIZE];
+    for (Entry = BucketHead->Flink; Entry != BucketHead; Entry = Entry->Flink)
     {
+        CacheBlock = CONTAINING_RECORD(Entry, CACHE_BLOCK, HashListEntry);
+
         //
-        // Search the list and find the BIOS drive number
+        // We found the block, so return it
         //
-        CacheBlock = CONTAINING_RECORD(CacheDrive->CacheBlockHead.Flink, CACHE_BLOCK, ListEntry);
-
-        while (&CacheBlock->ListEntry != &CacheDrive->CacheBlockHead)
+        if (CacheBlock->BlockNumber == BlockNumber)
         {
             //
-            // We found the block, so return it
+            // Increment the blocks access count
             //
-            if (CacheBlock->BlockNumber == BlockNumber)
-            {
-                //
-                // Increment the blocks access count
-                //
-                CacheBlock->AccessCount++;
+            CacheBlock->AccessCount++;
 
-                return CacheBlock;
-            }
-
-            CacheBlock = CONTAINING_RECORD(CacheBlock->ListEntry.Flink, CACHE_BLOCK, ListEntry);
+            return CacheBlock;
         }
     }
 
     return NULL;
 }
 
-PCACHE_BLOCK CacheInternalAddBlockToCache(PCACHE_DRIVE CacheDrive, ULONG BlockNumber)
+PCACHE_BLOCK CacheInternalAddBlockToCache(PCACHE_DRIVE CacheDrive, ULONG BlockNumber, PVOID BlockData)
 {
     PCACHE_BLOCK    CacheBlock = NULL;
+    ULONG            BlockSizeInBytes = CacheDrive->BlockSize * CacheDrive->BytesPerSector;
 
     TRACE("CacheInternalAddBlockToCache() BlockNumber = %d\n", BlockNumber);
 
@@ -99,46 +101,59 @@ PCACHE_BLOCK CacheInternalAddBlockToCache(PCACHE_DRIVE CacheDrive, ULONG BlockNu
 
     // We will need to add the block to the
     // drive's list of cached blocks. So allocate
-    // the block memory.
-    CacheBlock = FrLdrTempAlloc(sizeof(CACHE_BLOCK), TAG_CACHE_BLOCK);
+    // the block structure together with its data.
+    CacheBlock = FrLdrTempAlloc(sizeof(CACHE_BLOCK) + BlockSizeInBytes, TAG_CACHE_BLOCK);
     if (CacheBlock == NULL)
     {
         return NULL;
     }
 
-    // Now initialize the structure and
-    // allocate room for the block data
+    // Now initialize the structure and copy the block data
     RtlZeroMemory(CacheBlock, sizeof(CACHE_BLOCK));
     CacheBlock->BlockNumber = BlockNumber;
-    CacheBlock->BlockData = FrLdrTempAlloc(CacheDrive->BlockSize * CacheDrive->BytesPerSector,
-                                           TAG_CACHE_DATA);
-    if (CacheBlock->BlockData ==NULL)
-    {
-        FrLdrTempFree(CacheBlock, TAG_CACHE_BLOCK);
-        return NULL;
-    }
-
-    // Now try to read in the block
-    if (!MachDiskReadLogicalSectors(CacheDrive->DriveNumber, (BlockNumber * CacheDrive->BlockSize), CacheDrive->BlockSize, DiskReadBuffer))
-    {
-        FrLdrTempFree(CacheBlock->BlockData, TAG_CACHE_DATA);
-        FrLdrTempFree(CacheBlock, TAG_CACHE_BLOCK);
-        return NULL;
-    }
-    RtlCopyMemory(CacheBlock->BlockData, DiskReadBuffer, CacheDrive->BlockSize * CacheDrive->BytesPerSector);
+    CacheBlock->BlockData = (PVOID)(CacheBlock + 1);
+    RtlCopyMemory(CacheBlock->BlockData, BlockData, BlockSizeInBytes);
 
-    // Add it to our list of blocks managed by the cache
-    InsertTailList(&CacheDrive->CacheBlockHead, &CacheBlock->ListEntry);
+    // Add it to our list of blocks managed by the cache,
+    // as the most recently used one, and to its hash bucket
+    InsertHeadList(&CacheDrive->CacheBlockHead, &CacheBlock->ListEntry);
+    InsertHeadList(&CacheDrive->CacheBlockHash[BlockNumber % CACHE_HASH_SIZE], &CacheBlock->HashListEntry);
 
     // Update the cache data
     CacheBlockCount++;
-    CacheSizeCurrent = CacheBlockCount * (CacheDrive->BlockSize * CacheDrive->BytesPerSector);
+    CacheSizeCurrent = CacheBlockCount * BlockSizeInBytes;
 
     CacheInternalDumpBlockList(CacheDrive);
 
     return CacheBlock;
 }
 
+BOOLEAN CacheInternalReadSectors(PCACHE_DRIVE CacheDrive, ULONGLONG StartSector, ULONG SectorCount, PVOID Buffer)
+{
+    ULONG            MaxSectors = (ULONG)(DiskReadBufferSize / CacheDrive->BytesPerSector);
+    ULONG            ReadSectors;
+
+    TRACE("CacheInternalReadSectors() StartSector = %I64d SectorCount = %d\n", StartSector, SectorCount);
+
+    // Read as much as the disk read buffer can hold at once
+    while (SectorCount > 0)
+    {
+        ReadSectors = min(SectorCount, MaxSectors);
+
+        if (!MachDiskReadLogicalSectors(CacheDrive->DriveNumber, StartSector, ReadSectors, DiskReadBuffer))
+        {
+            return FALSE;
+        }
+        RtlCopyMemory(Buffer, DiskReadBuffer, ReadSectors * CacheDrive->BytesPerSector);
+
+        Buffer = (PVOID)((ULONG_PTR)Buffer + (ReadSectors * CacheDrive->BytesPerSector));
+        StartSector += ReadSectors;
+        SectorCount -= ReadSectors;
+    }
+
+    return TRUE;
+}
+
 BOOLEAN CacheInternalFreeBlock(PCACHE_DRIVE CacheDrive)
 {
     PCACHE_BLOCK    CacheBlockToFree;
@@ -156,15 +171,15 @@ BOOLEAN CacheInternalFreeBlock(PCACHE_DRIVE CacheDrive)
 
     // No blocks left in cache that can be freed
     // so just return
-    if (IsListEmpty(&CacheDrive->CacheBlockHead))
+    if (&CacheBlockToFree->ListEntry == &CacheDrive->CacheBlockHead)
     {
         return FALSE;
     }
 
     RemoveEntryList(&CacheBlockToFree->ListEntry);
+    RemoveEntryList(&CacheBlockToFree->HashListEntry);
 
-    // Free the block memory and the block structure
-    FrLdrTempFree(CacheBlockToFree->BlockData, TAG_CACHE_DATA);
+    // Free the block structure along with its data
     FrLdrTempFree(CacheBlockToFree, TAG_CACHE_BLOCK);
 
     // Update the cache data
@@ -193,6 +208,7 @@ VOID CacheInternalCheckCacheSizeLimits(PCACHE_DRIVE CacheDrive)
 
 VOID CacheInternalDumpBlockList(PCACHE_DRIVE CacheDrive)
 {
+#if DBG
     PCACHE_BLOCK    CacheBlock;
 
     TRACE("Dumping block list for BIOS drive 0x%x.\n", CacheDrive->DriveNumber);
@@ -218,6 +234,7 @@ VOID CacheInternalDumpBlockList(PCACHE_DRIVE CacheDrive)
 
         CacheBlock = CONTAINING_RECORD(CacheBlock->ListEntry.Flink, CACHE_BLOCK, ListEntry);
     }
+#endif
 }
 
 VOID CacheInternalOptimizeBlockList(PCACHE_DRIVE CacheDrive, PCACHE_BLOCK CacheBlock)
@@ -38,6 +38,7 @@ BOOLEAN CacheInitializeDrive(UCHAR DriveNumber)
 {
     PCACHE_BLOCK    NextCacheBlock;
     GEOMETRY    DriveGeometry;
+    ULONG        Idx;
 
     // If we already have a cache for this drive then
     // by all means lets keep it, unless it is a removable
@@ -72,7 +73,6 @@ BOOLEAN CacheInitializeDrive(UCHAR DriveNumber)
                                                CACHE_BLOCK,
                                                ListEntry);
 
-            FrLdrTempFree(NextCacheBlock->BlockData, TAG_CACHE_DATA);
             FrLdrTempFree(NextCacheBlock, TAG_CACHE_BLOCK);
         }
     }
@@ -80,6 +80,10 @@ BOOLEAN CacheInitializeDrive(UCHAR DriveNumber)
     // Initialize the structure
     RtlZeroMemory(&CacheManagerDrive, sizeof(CACHE_DRIVE));
     InitializeListHead(&CacheManagerDrive.CacheBlockHead);
+    for (Idx = 0; Idx < CACHE_HASH_SIZE; Idx++)
+    {
+        InitializeListHead(&CacheManagerDrive.CacheBlockHash[Idx]);
+    }
     CacheManagerDrive.DriveNumber = DriveNumber;
     if (!MachDiskGetDriveGeometry(DriveNumber, &DriveGeometry))
     {
@@ -90,16 +94,27 @@ BOOLEAN CacheInitializeDrive(UCHAR DriveNumber)
     // Get the number of sectors in each cache block
     CacheManagerDrive.BlockSize = MachDiskGetCacheableBlockCount(DriveNumber);
 
+    // Blocks are read through the disk read buffer, so it
+    // must hold at least one of them. Runs of missing blocks
+    // are read with as few disk reads as it allows.
+    CacheManagerDrive.MaxReadBlocks = (ULONG)(DiskReadBufferSize /
+        (CacheManagerDrive.BlockSize * CacheManagerDrive.BytesPerSector));
+    if (CacheManagerDrive.MaxReadBlocks == 0)
+    {
+        return FALSE;
+    }
+
     CacheBlockCount = 0;
     CacheSizeCurrent = 0;
     CacheSizeLimit = TotalPagesInLookupTable / 8 * MM_PAGE_SIZE;
-    CacheSizeLimit = min(CacheSizeLimit, TEMP_HEAP_SIZE - (128 * 1024));
+    CacheSizeLimit = min(CacheSizeLimit, TEMP_HEAP_SIZE / 4);
 
     CacheManagerInitialized = TRUE;
 
     TRACE("Initializing BIOS drive 0x%x.\n", DriveNumber);
     TRACE("BytesPerSector: %d.\n", CacheManagerDrive.BytesPerSector);
     TRACE("BlockSize: %d.\n", CacheManagerDrive.BlockSize);
+    TRACE("MaxReadBlocks: %d.\n", CacheManagerDrive.MaxReadBlocks);
     TRACE("CacheSizeLimit: %d.\n", CacheSizeLimit);
 
     return TRUE;
@@ -110,16 +125,88 @@ VOID CacheInvalidateCacheData(VOID)
     CacheManagerDataInvalid = TRUE;
 }
 
+//
+// Copies the part of a cache block that the request covers into the request buffer
+//
+static VOID CacheCopyFromBlock(ULONG BlockNumber, PVOID BlockData, ULONGLONG StartSector, ULONGLONG EndSector, PVOID Buffer)
+{
+    ULONGLONG    BlockStartSector = (ULONGLONG)BlockNumber * CacheManagerDrive.BlockSize;
+    ULONGLONG    CopyStartSector = max(BlockStartSector, StartSector);
+    ULONGLONG    CopyEndSector = min(BlockStartSector + CacheManagerDrive.BlockSize, EndSector);
+
+    RtlCopyMemory((PVOID)((ULONG_PTR)Buffer + (ULONG_PTR)((CopyStartSector - StartSector) * CacheManagerDrive.BytesPerSector)),
+        (PVOID)((ULONG_PTR)BlockData + (ULONG_PTR)((CopyStartSector - BlockStartSector) * CacheManagerDrive.BytesPerSector)),
+        (ULONG)(CopyEndSector - CopyStartSector) * CacheManagerDrive.BytesPerSector);
+}
+
+//
+// Reads a run of consecutive blocks that are not in the cache
+//
+static BOOLEAN CacheReadMissingBlocks(ULONG StartBlock, ULONG BlockCount, BOOLEAN Streaming, ULONGLONG StartSector, ULONGLONG EndSector, PVOID Buffer)
+{
+    ULONGLONG    RunStartSector;
+    ULONGLONG    RunEndSector;
+    ULONG        ReadBlocks;
+    ULONG        Idx;
+    PVOID        BlockData;
+
+    while (BlockCount > 0)
+    {
+        //
+        // Large reads are file data that is read only once. Read just the
+        // requested sectors, so they don't push metadata out of the cache.
+        //
+        ReadBlocks = Streaming ? BlockCount : min(BlockCount, CacheManagerDrive.MaxReadBlocks);
+        RunStartSector = max((ULONGLONG)StartBlock * CacheManagerDrive.BlockSize, StartSector);
+        RunEndSector = min((ULONGLONG)(StartBlock + ReadBlocks) * CacheManagerDrive.BlockSize, EndSector);
+
+        //
+        // Also read just the requested sectors when the
+        // whole blocks can't be read, e.g. at the end of the disk
+        //
+        if (Streaming ||
+            !MachDiskReadLogicalSectors(CacheManagerDrive.DriveNumber,
+                                        (ULONGLONG)StartBlock * CacheManagerDrive.BlockSize,
+                                        ReadBlocks * CacheManagerDrive.BlockSize,
+                                        DiskReadBuffer))
+        {
+            if (!CacheInternalReadSectors(&CacheManagerDrive,
+                                          RunStartSector,
+                                          (ULONG)(RunEndSector - RunStartSector),
+                                          (PVOID)((ULONG_PTR)Buffer + (ULONG_PTR)((RunStartSector - StartSector) * CacheManagerDrive.BytesPerSector))))
+            {
+                return FALSE;
+            }
+        }
+        else
+        {
+            //
+            // Hand out the requested parts and keep all the blocks read
+            //
+            for (Idx = 0; Idx < ReadBlocks; Idx++)
+            {
+                BlockData = (PVOID)((ULONG_PTR)DiskReadBuffer + (Idx * CacheManagerDrive.BlockSize * CacheManagerDrive.BytesPerSector));
+                CacheCopyFromBlock(StartBlock + Idx, BlockData, StartSector, EndSector, Buffer);
+                CacheInternalAddBlockToCache(&CacheManagerDrive, StartBlock + Idx, BlockData);
+            }
+        }
+
+        StartBlock += ReadBlocks;
+        BlockCount -= ReadBlocks;
+    }
+
+    return TRUE;
+}
+
 BOOLEAN CacheReadDiskSectors(UCHAR DiskNumber, ULONGLONG StartSector, ULONG SectorCount, PVOID Buffer)
 {
     PCACHE_BLOCK    CacheBlock;
+    ULONGLONG            EndSector;
     ULONG                StartBlock;
-    ULONG                SectorOffsetInStartBlock;
-    ULONG                CopyLengthInStartBlock;
     ULONG                EndBlock;
-    ULONG                SectorOffsetInEndBlock;
-    ULONG                BlockCount;
-    ULONG                Idx;
+    ULONG                Block;
+    ULONG                RunCount;
+    BOOLEAN            Streaming;
 
     TRACE("CacheReadDiskSectors() DiskNumber: 0x%x StartSector: %I64d SectorCount: %d Buffer: 0x%x\n", DiskNumber, StartSector, SectorCount, Buffer);
 
@@ -129,114 +216,49 @@ BOOLEAN CacheReadDiskSectors(UCHAR DiskNumber, ULONGLONG StartSector, ULONG Sect
         return FALSE;
     }
 
+    if (SectorCount == 0)
+    {
+        return TRUE;
+    }
+
     //
-    // Calculate which blocks we must cache
+    // Calculate which blocks we must read
     //
+    EndSector = StartSector + SectorCount;
     StartBlock = (ULONG)(StartSector / CacheManagerDrive.BlockSize);
-    SectorOffsetInStartBlock = (ULONG)(StartSector % CacheManagerDrive.BlockSize);
-    CopyLengthInStartBlock = (ULONG)((SectorCount > (CacheManagerDrive.BlockSize - SectorOffsetInStartBlock)) ? (CacheManagerDrive.BlockSize - SectorOffsetInStartBlock) : SectorCount);
-    EndBlock = (ULONG)((StartSector + (SectorCount - 1)) / CacheManagerDrive.BlockSize);
-    SectorOffsetInEndBlock = (ULONG)(1 + (StartSector + (SectorCount - 1)) % CacheManagerDrive.BlockSize);
-    BlockCount = (EndBlock - StartBlock) + 1;
-    TRACE("StartBlock: %d SectorOffsetInStartBlock: %d CopyLengthInStartBlock: %d EndBlock: %d SectorOffsetInEndBlock: %d BlockCount: %d\n", StartBlock, SectorOffsetInStartBlock, CopyLengthInStartBlock, EndBlock, SectorOffsetInEndBlock, BlockCount);
+    EndBlock = (ULONG)((EndSector - 1) / CacheManagerDrive.BlockSize);
+    Streaming = ((EndBlock - StartBlock) + 1 > CACHE_STREAMING_BLOCKS);
+    TRACE("StartBlock: %d EndBlock: %d Streaming: %d\n", StartBlock, EndBlock, Streaming);
 
-    //
-    // Read the first block into the buffer
-    //
-    if (BlockCount > 0)
+    for (Block = StartBlock; Block <= EndBlock; )
     {
         //
-        // Get cache block pointer (this forces the disk sectors into the cache memory)
+        // Copy the blocks we already have
         //
-        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, StartBlock);
-        if (CacheBlock == NULL)
+        CacheBlock = CacheInternalFindBlock(&CacheManagerDrive, Block);
+        if (CacheBlock != NULL)
         {
-            return FALSE;
+            CacheInternalOptimizeBlockList(&CacheManagerDrive, CacheBlock);
+            CacheCopyFromBlock(Block, CacheBlock->BlockData, StartSector, EndSector, Buffer);
+            Block++;
+            continue;
         }
 
         //
-        // Copy the portion requested into the buffer
-        //
-        RtlCopyMemory(Buffer,
-            (PVOID)((ULONG_PTR)CacheBlock->BlockData + (SectorOffsetInStartBlock * CacheManagerDrive.BytesPerSector)),
-            (CopyLengthInStartBlock * CacheManagerDrive.BytesPerSector));
-        TRACE("1 - RtlCopyMemory(0x%x, 0x%x, %d)\n", Buffer, ((ULONG_PTR)CacheBlock->BlockData + (SectorOffsetInStartBlock * CacheManagerDrive.BytesPerSector)), (CopyLengthInStartBlock * CacheManagerDrive.BytesPerSector));
-
-        //
-        // Update the buffer address
-        //
-        Buffer = (PVOID)((ULONG_PTR)Buffer + (CopyLengthInStartBlock * CacheManagerDrive.BytesPerSector));
-
-        //
-        // Update the block count
-        //
-        BlockCount--;
-    }
-
-    //
-    // Loop through the middle blocks and read them into the buffer
-    //
-    for (Idx=StartBlock+1; BlockCount>1; Idx++)
-    {
-        //
-        // Get cache block pointer (this forces the disk sectors into the cache memory)
+        // Gather the run of missing blocks, so that it is read at once
         //
-        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, Idx);
-        if (CacheBlock == NULL)
+        for (RunCount = 1; Block + RunCount <= EndBlock; RunCount++)
         {
-            return FALSE;
+            if (CacheInternalFindBlock(&CacheManagerDrive, Block + RunCount) != NULL)
+                break;
         }
 
-        //
-        // Copy the portion requested into the buffer
-        //
-        RtlCopyMemory(Buffer,
-            CacheBlock->BlockData,
-            CacheManagerDrive.BlockSize * CacheManagerDrive.BytesPerSector);
-        TRACE("2 - RtlCopyMemory(0x%x, 0x%x, %d)\n", Buffer, CacheBlock->BlockData, CacheManagerDrive.BlockSize * CacheManagerDrive.BytesPerSector);
-
-        //
-        // Update the buffer address
-        //
-        Buffer = (PVOID)((ULONG_PTR)Buffer + (CacheManagerDrive.BlockSize * CacheManagerDrive.BytesPerSector));
-
-        //
-        // Update the block count
-        //
-        BlockCount--;
-    }
-
-    //
-    // Read the last block into the buffer
-    //
-    if (BlockCount > 0)
-    {
-        //
-        // Get cache block pointer (this forces the disk sectors into the cache memory)
-        //
-        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, EndBlock);
-        if (CacheBlock == NULL)
+        if (!CacheReadMissingBlocks(Block, RunCount, Streaming, StartSector, EndSector, Buffer))
         {
             return FALSE;
         }
 
-        //
-        // Copy the portion requested into the buffer
-        //
-        RtlCopyMemory(Buffer,
-            CacheBlock->BlockData,
-            SectorOffsetInEndBlock * CacheManagerDrive.BytesPerSector);
-        TRACE("3 - RtlCopyMemory(0x%x, 0x%x, %d)\n", Buffer, CacheBlock->BlockData, SectorOffsetInEndBlock * CacheManagerDrive.BytesPerSector);
-
-        //
-        // Update the buffer address
-        //
-        Buffer = (PVOID)((ULONG_PTR)Buffer + (SectorOffsetInEndBlock * CacheManagerDrive.BytesPerSector));
-
-        //
-        // Update the block count
-        //
-        BlockCount--;
+        Block += RunCount;
     }
 
     return TRUE;
@@ -0,0 +1,364 @@
+/*
+ * PROJECT:     FreeLoader
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Serves boot drivers, hive and NLS files from a boot pack
+ *
+ * The boot pack (see sdk/include/reactos/bootpack.h) is read in a single
+ * sequential read. Once it has been validated, ArcOpen() still looks every
+ * file up on the boot volume, but reads it from memory when the pack holds
+ * a copy of the same size. Other files, and pack entries that no longer
+ * match the file on disk, are read through the file system.
+ */
+
+/* INCLUDES *******************************************************************/
+
+#include <freeldr.h>
+#include <bootpack.h>
+
+#include <debug.h>
+DBG_DEFAULT_CHANNEL(FILESYSTEM);
+
+/* GLOBALS ********************************************************************/
+
+#define TAG_BOOTPACK_FILE 'FkPB'
+
+typedef struct _BOOTPACK_FILE
+{
+    PBOOTPACK_ENTRY Entry;
+    ULONG Position;
+} BOOTPACK_FILE, *PBOOTPACK_FILE;
+
+static PUCHAR BootPackBase = NULL;
+static ULONG BootPackSize;
+static PBOOTPACK_ENTRY BootPackEntries;
+static ULONG BootPackEntryCount;
+static CHAR BootPackPrefix[MAX_PATH];
+static SIZE_T BootPackPrefixLength;
+
+/* FUNCTIONS ******************************************************************/
+
+/*
+ * Converts a path to the form used by the boot pack index:
+ * upper-cased, '\' as the only separator, and no repeated separators.
+ */
+static BOOLEAN
+BootPackNormalizePath(
+    IN PCSTR Path,
+    OUT PCHAR Buffer,
+    IN SIZE_T BufferSize)
+{
+    SIZE_T i = 0;
+    CHAR c;
+
+    for (; *Path; Path++)
+    {
+        c = *Path;
+        if (c == '/')
+            c = '\\';
+        if (c == '\\' && i > 0 && Buffer[i - 1] == '\\')
+            continue;
+
+        if (i + 1 >= BufferSize)
+            return FALSE;
+        Buffer[i++] = toupper((UCHAR)c);
+    }
+    Buffer[i] = ANSI_NULL;
+    return TRUE;
+}
+
+static PBOOTPACK_ENTRY
+BootPackFindEntry(
+    IN PCSTR Path)
+{
+    CHAR Name[MAX_PATH];
+    LONG Low, High, Middle;
+    INT Result;
+
+    if (!BootPackBase)
+        return NULL;
+
+    /* Only files below the system root can be in the pack */
+    if (!BootPackNormalizePath(Path, Name, sizeof(Name)) ||
+        strncmp(Name, BootPackPrefix, BootPackPrefixLength) != 0)
+    {
+        return NULL;
+    }
+
+    /* The index is sorted by name */
+    Low = 0;
+    High = (LONG)BootPackEntryCount - 1;
+    while (Low <= High)
+    {
+        Middle = (Low + High) / 2;
+        Result = strcmp(Name + BootPackPrefixLength,
+                        (PCSTR)(BootPackBase + BootPackEntries[Middle].NameOffset));
+        if (Result == 0)
+            return &BootPackEntries[Middle];
+        if (Result < 0)
+            High = Middle - 1;
+        else
+            Low = Middle + 1;
+    }
+
+    return NULL;
+}
+
+static ARC_STATUS BootPackClose(ULONG FileId)
+{
+    PBOOTPACK_FILE File = FsGetDeviceSpecific(FileId);
+
+    FrLdrTempFree(File, TAG_BOOTPACK_FILE);
+    return ESUCCESS;
+}
+
+static ARC_STATUS BootPackGetFileInformation(ULONG FileId, FILEINFORMATION* Information)
+{
+    PBOOTPACK_FILE File = FsGetDeviceSpecific(FileId);
+
+    RtlZeroMemory(Information, sizeof(*Information));
+    Information->EndingAddress.LowPart = File->Entry->DataSize;
+    Information->CurrentAddress.LowPart = File->Position;
+
+    return ESUCCESS;
+}
+
+static ARC_STATUS BootPackOpen(CHAR* Path, OPENMODE OpenMode, ULONG* FileId)
+{
+    PBOOTPACK_ENTRY Entry;
+    PBOOTPACK_FILE File;
+
+    if (OpenMode != OpenReadOnly)
+        return EACCES;
+
+    Entry = BootPackFindEntry(Path);
+    if (!Entry)
+        return ENOENT;
+
+    File = FrLdrTempAlloc(sizeof(BOOTPACK_FILE), TAG_BOOTPACK_FILE);
+    if (!File)
+        return ENOMEM;
+
+    File->Entry = Entry;
+    File->Position = 0;
+    FsSetDeviceSpecific(*FileId, File);
+
+    TRACE("BootPackOpen() '%s' served from the boot pack\n", Path);
+    return ESUCCESS;
+}
+
+static ARC_STATUS BootPackRead(ULONG FileId, VOID* Buffer, ULONG N, ULONG* Count)
+{
+    PBOOTPACK_FILE File = FsGetDeviceSpecific(FileId);
+
+    /* Read at most up to the end of the file */
+    N = min(N, File->Entry->DataSize - File->Position);
+
+    RtlCopyMemory(Buffer,
+                  BootPackBase + File->Entry->DataOffset + File->Position,
+                  N);
+    File->Position += N;
+    *Count = N;
+
+    return ESUCCESS;
+}
+
+static ARC_STATUS BootPackSeek(ULONG FileId, LARGE_INTEGER* Position, SEEKMODE SeekMode)
+{
+    PBOOTPACK_FILE File = FsGetDeviceSpecific(FileId);
+    LARGE_INTEGER NewPosition = *Position;
+
+    switch (SeekMode)
+    {
+        case SeekAbsolute:
+            break;
+        case SeekRelative:
+            NewPosition.QuadPart += File->Position;
+            break;
+        default:
+            ASSERT(FALSE);
+            return EINVAL;
+    }
+
+    if (NewPosition.QuadPart < 0 || NewPosition.QuadPart > File->Entry->DataSize)
+        return EINVAL;
+
+    File->Position = NewPosition.LowPart;
+    return ESUCCESS;
+}
+
+/* ServiceName is that of the file system the pack was read from */
+static DEVVTBL BootPackFuncTable =
+{
+    BootPackClose,
+    BootPackGetFileInformation,
+    BootPackOpen,
+    BootPackRead,
+    BootPackSeek,
+};
+
+static BOOLEAN
+BootPackValidate(
+    IN PUCHAR Base,
+    IN ULONG Size)
+{
+    PBOOTPACK_HEADER Header = (PBOOTPACK_HEADER)Base;
+    PBOOTPACK_ENTRY Entries = (PBOOTPACK_ENTRY)(Header + 1);
+    PCSTR Name, PreviousName = NULL;
+    ULONG i, Checksum;
+
+    if (Header->Signature != BOOTPACK_SIGNATURE ||
+        Header->Version != BOOTPACK_VERSION ||
+        Header->Flags != 0 ||
+        Header->TotalSize != Size ||
+        Header->EntryCount > (Size - sizeof(*Header)) / sizeof(*Entries))
+    {
+        WARN("Invalid boot pack header\n");
+        return FALSE;
+    }
+
+    Checksum = RtlComputeCrc32(0, Base + sizeof(*Header), Size - sizeof(*Header));
+    if (Checksum != Header->Checksum)
+    {
+        WARN("Boot pack checksum mismatch: 0x%08lx, expected 0x%08lx\n",
+             Checksum, Header->Checksum);
+        return FALSE;
+    }
+
+    for (i = 0; i < Header->EntryCount; i++)
+    {
+        if (Entries[i].NameOffset >= Size ||
+            !memchr(Base + Entries[i].NameOffset, ANSI_NULL, Size - Entries[i].NameOffset) ||
+            Entries[i].DataOffset > Size ||
+            Entries[i].DataSize > Size - Entries[i].DataOffset)
+        {
+            WARN("Boot pack entry %lu is out of bounds\n", i);
+            return FALSE;
+        }
+
+        /* The lookup relies on the index being sorted */
+        Name = (PCSTR)(Base + Entries[i].NameOffset);
+        if (PreviousName && strcmp(PreviousName, Name) >= 0)
+        {
+            WARN("Boot pack index is not sorted at '%s'\n", Name);
+            return FALSE;
+        }
+        PreviousName = Name;
+    }
+
+    return TRUE;
+}
+
+BOOLEAN
+BootPackLoad(
+    IN PCSTR BootPath)
+{
+    CHAR FullPath[MAX_PATH];
+    ARC_STATUS Status;
+    FILEINFORMATION Information;
+    ULONG FileId, Size, Count;
+    PCWSTR ServiceName;
+    PUCHAR Base;
+
+    BootPackUnload();
+
+    RtlStringCbCopyA(FullPath, sizeof(FullPath), BootPath);
+    RtlStringCbCatA(FullPath, sizeof(FullPath), "system32\\" BOOTPACK_FILE_NAME);
+
+    Status = ArcOpen(FullPath, OpenReadOnly, &FileId);
+    if (Status != ESUCCESS)
+    {
+        TRACE("No boot pack at '%s'\n", FullPath);
+        return FALSE;
+    }
+
+    Status = ArcGetFileInformation(FileId, &Information);
+    if (Status != ESUCCESS ||
+        Information.EndingAddress.HighPart != 0 ||
+        Information.EndingAddress.LowPart < sizeof(BOOTPACK_HEADER))
+    {
+        WARN("Boot pack '%s' has an invalid size\n", FullPath);
+        ArcClose(FileId);
+        return FALSE;
+    }
+    Size = Information.EndingAddress.LowPart;
+
+    Base = MmAllocateMemoryWithType(Size, LoaderFirmwareTemporary);
+    if (!Base)
+    {
+        WARN("Cannot allocate %lu bytes for the boot pack\n", Size);
+        ArcClose(FileId);
+        return FALSE;
+    }
+
+    /* Read the whole pack in one go, this is where the pack pays off */
+    Status = ArcRead(FileId, Base, Size, &Count);
+    ServiceName = FsGetServiceName(FileId);
+    ArcClose(FileId);
+
+    if (Status != ESUCCESS || Count != Size || !BootPackValidate(Base, Size))
+    {
+        WARN("Ignoring boot pack '%s', falling back to separate files\n", FullPath);
+        MmFreeMemory(Base);
+        return FALSE;
+    }
+
+    /* Files served from the pack still need the boot file system driver */
+    BootPackFuncTable.ServiceName = ServiceName;
+
+    if (!BootPackNormalizePath(BootPath, BootPackPrefix, sizeof(BootPackPrefix)))
+    {
+        MmFreeMemory(Base);
+        return FALSE;
+    }
+    BootPackPrefixLength = strlen(BootPackPrefix);
+
+    BootPackBase = Base;
+    BootPackSize = Size;
+    BootPackEntries = (PBOOTPACK_ENTRY)(Base + sizeof(BOOTPACK_HEADER));
+    BootPackEntryCount = ((PBOOTPACK_HEADER)Base)->EntryCount;
+
+    TRACE("Loaded boot pack '%s': %lu files, %lu bytes\n",
+          FullPath, BootPackEntryCount, BootPackSize);
+    return TRUE;
+}
+
+VOID
+BootPackUnload(VOID)
+{
+    if (!BootPackBase)
+        return;
+
+    MmFreeMemory(BootPackBase);
+    BootPackBase = NULL;
+    BootPackSize = 0;
+    BootPackEntries = NULL;
+    BootPackEntryCount = 0;
+}
+
+/*
+ * Returns the function table serving Path from the boot pack, if the pack
+ * holds a copy of the file already opened as FileId from the file system.
+ */
+const DEVVTBL*
+BootPackLookup(
+    IN PCSTR Path,
+    IN ULONG FileId)
+{
+    PBOOTPACK_ENTRY Entry;
+    FILEINFORMATION Information;
+
+    Entry = BootPackFindEntry(Path);
+    if (!Entry)
+        return NULL;
+
+    /* The file may have been replaced since the pack was made */
+    if (ArcGetFileInformation(FileId, &Information) != ESUCCESS ||
+        Information.EndingAddress.HighPart != 0 ||
+        Information.EndingAddress.LowPart != Entry->DataSize)
+    {
+        WARN("Boot pack copy of '%s' is stale, reading the file instead\n", Path);
+        return NULL;
+    }
+
+    return &BootPackFuncTable;
+}
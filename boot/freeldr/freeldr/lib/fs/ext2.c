@@ -364,6 +364,7 @@ BOOLEAN Ext2ReadFileBig(PEXT2_FILE_INFO Ext2FileInfo, ULONGLONG BytesToRead, ULO
     ULONG                OffsetInBlock;
     ULONG                LengthInBlock;
     ULONG                NumberOfBlocks;
+    ULONG                RunLength;
 
     TRACE("Ext2ReadFileBig() BytesToRead = %d Buffer = 0x%x\n", (ULONG)BytesToRead, Buffer);
 
@@ -495,21 +496,46 @@ BOOLEAN Ext2ReadFileBig(PEXT2_FILE_INFO Ext2FileInfo, ULONGLONG BytesToRead, ULO
             BlockNumberIndex = (ULONG)(Ext2FileInfo->FilePointer / Volume->BlockSizeInBytes);
             BlockNumber = Ext2FileInfo->FileBlockList[BlockNumberIndex];
 
+            //
+            // Find how many of the next blocks are contiguous on disk,
+            // so that the whole extent is read at once
+            //
+            RunLength = 1;
+            if (BlockNumber != 0)
+            {
+                while (RunLength < NumberOfBlocks &&
+                       Ext2FileInfo->FileBlockList[BlockNumberIndex + RunLength] == BlockNumber + RunLength &&
+                       BlockNumber + RunLength < Volume->SuperBlock->total_blocks)
+                {
+                    RunLength++;
+                }
+            }
+
             //
             // Now do the read and update BytesRead, BytesToRead, FilePointer, & Buffer
             //
-            if (!Ext2ReadBlock(Volume, BlockNumber, Buffer))
+            if (RunLength > 1)
+            {
+                if (!Ext2ReadVolumeSectors(Volume,
+                                           (ULONGLONG)BlockNumber * Volume->BlockSizeInSectors,
+                                           RunLength * Volume->BlockSizeInSectors,
+                                           Buffer))
+                {
+                    return FALSE;
+                }
+            }
+            else if (!Ext2ReadBlock(Volume, BlockNumber, Buffer))
             {
                 return FALSE;
             }
             if (BytesRead != NULL)
             {
-                *BytesRead += Volume->BlockSizeInBytes;
+                *BytesRead += RunLength * Volume->BlockSizeInBytes;
             }
-            BytesToRead -= Volume->BlockSizeInBytes;
-            Ext2FileInfo->FilePointer += Volume->BlockSizeInBytes;
-            Buffer = (PVOID)((ULONG_PTR)Buffer + Volume->BlockSizeInBytes);
-            NumberOfBlocks--;
+            BytesToRead -= RunLength * Volume->BlockSizeInBytes;
+            Ext2FileInfo->FilePointer += RunLength * Volume->BlockSizeInBytes;
+            Buffer = (PVOID)((ULONG_PTR)Buffer + RunLength * Volume->BlockSizeInBytes);
+            NumberOfBlocks -= RunLength;
         }
     }
 
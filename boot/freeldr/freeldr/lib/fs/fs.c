@@ -211,8 +211,39 @@ ARC_STATUS ArcOpen(CHAR* Path, OPENMODE OpenMode, ULONG* FileId)
     {
         FileData[i].FuncTable = NULL;
         *FileId = MAX_FDS;
+        return Status;
     }
-    return Status;
+
+    /* Read the data from the boot pack instead, if it holds the same file */
+    if (OpenMode == OpenReadOnly)
+    {
+        const DEVVTBL* FuncTable = BootPackLookup(Path, *FileId);
+        if (FuncTable)
+        {
+            for (i = 0; i < MAX_FDS; i++)
+            {
+                if (!FileData[i].FuncTable)
+                    break;
+            }
+            if (i < MAX_FDS)
+            {
+                FileData[i].FuncTable = FuncTable;
+                FileData[i].DeviceId = DeviceId;
+                if (FuncTable->Open(Path, OpenMode, &i) == ESUCCESS)
+                {
+                    ArcClose(*FileId);
+                    *FileId = i;
+                }
+                else
+                {
+                    FileData[i].FuncTable = NULL;
+                    FileData[i].DeviceId = -1;
+                }
+            }
+        }
+    }
+
+    return ESUCCESS;
 }
 
 ARC_STATUS ArcClose(ULONG FileId)
@@ -907,6 +907,11 @@ LoadAndBootWindows(
     /* Allocate and minimally-initialize the Loader Parameter Block */
     AllocateAndInitLPB(OperatingSystemVersion, &LoaderBlock);
 
+    /* Read the boot pack, if any: the files it holds that still match
+     * the ones on the boot volume are then read from memory */
+    if (!NtLdrGetOption(BootOptions, "NOBOOTPACK"))
+        BootPackLoad(BootPath);
+
     /* Load the system hive */
     UiDrawBackdrop();
     UiDrawProgressBarCenter(15, 100, "Loading system hive...");
@@ -989,6 +994,9 @@ LoadAndBootWindowsCommon(
     Success = WinLdrLoadBootDrivers(LoaderBlock, BootPath);
     TRACE("Boot drivers loading %s\n", Success ? "successful" : "failed");
 
+    /* Everything the boot pack could serve has been loaded */
+    BootPackUnload();
+
     /* Cleanup ini file */
     IniCleanup();
 
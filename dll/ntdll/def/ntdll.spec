@@ -308,6 +308,7 @@
 @ stdcall NtDeleteObjectAuditAlarm(ptr ptr long)
 @ stub -version=0x600+ NtDeletePrivateNamespace
 @ stdcall NtDeleteValueKey(long ptr)
+@ stdcall NtDeregisterIoBuffer(long)
 @ stdcall NtDeviceIoControlFile(long long long long long long long long long long)
 @ stdcall NtDisplayString(ptr)
 @ stdcall NtDuplicateObject(long long long ptr long long long)
@@ -474,6 +475,7 @@
 @ stub -version=0x600+ NtRecoverEnlistment
 @ stub -version=0x600+ NtRecoverResourceManager
 @ stub -version=0x600+ NtRecoverTransactionManager
+@ stdcall NtRegisterIoBuffer(ptr long ptr)
 @ stub -version=0x600+ NtRegisterProtocolAddressInformation
 @ stdcall NtRegisterThreadTerminatePort(ptr)
 @ stub -version=0x600+ NtReleaseCMFViewOwnership
@@ -482,7 +484,7 @@
 @ stdcall NtReleaseSemaphore(long long ptr)
 @ stub -version=0x600+ NtReleaseWorkerFactoryWorker
 @ stdcall NtRemoveIoCompletion(ptr ptr ptr ptr ptr)
-@ stub -version=0x600+ NtRemoveIoCompletionEx
+@ stdcall -version=0x600+ NtRemoveIoCompletionEx(ptr ptr long ptr ptr long)
 @ stdcall NtRemoveProcessDebug(ptr ptr)
 @ stdcall NtRenameKey(ptr ptr)
 @ stub -version=0x600+ NtRenameTransactionManager
@@ -1467,6 +1469,7 @@
 @ stdcall ZwDeleteObjectAuditAlarm(ptr ptr long)
 @ stub -version=0x600+ ZwDeletePrivateNamespace
 @ stdcall ZwDeleteValueKey(long ptr)
+@ stdcall ZwDeregisterIoBuffer(long)
 @ stdcall ZwDeviceIoControlFile(long long long long long long long long long long)
 @ stdcall ZwDisplayString(ptr)
 @ stdcall ZwDuplicateObject(long long long ptr long long long)
@@ -1632,6 +1635,7 @@
 @ stub -version=0x600+ ZwRecoverEnlistment
 @ stub -version=0x600+ ZwRecoverResourceManager
 @ stub -version=0x600+ ZwRecoverTransactionManager
+@ stdcall ZwRegisterIoBuffer(ptr long ptr)
 @ stub -version=0x600+ ZwRegisterProtocolAddressInformation
 @ stdcall ZwRegisterThreadTerminatePort(ptr)
 @ stub -version=0x600+ ZwReleaseCMFViewOwnership
@@ -1640,7 +1644,7 @@
 @ stdcall ZwReleaseSemaphore(long long ptr)
 @ stub -version=0x600+ ZwReleaseWorkerFactoryWorker
 @ stdcall ZwRemoveIoCompletion(ptr ptr ptr ptr ptr)
-@ stub -version=0x600+ ZwRemoveIoCompletionEx
+@ stdcall -version=0x600+ ZwRemoveIoCompletionEx(ptr ptr long ptr ptr long)
 @ stdcall ZwRemoveProcessDebug(ptr ptr)
 @ stdcall ZwRenameKey(ptr ptr)
 @ stub -version=0x600+ ZwRenameTransactionManager
@@ -18,6 +18,7 @@
 /* GLOBALS ********************************************************************/
 
 extern RTL_CRITICAL_SECTION ConsoleLock;
+extern RTL_CRITICAL_SECTION ConsoleOutputRingLock;
 extern BOOLEAN ConsoleInitialized;
 
 /* Console reserved "file" names */
@@ -443,6 +444,9 @@ DuplicateConsoleHandle(HANDLE hConsole,
     DuplicateHandleRequest->InheritHandle = bInheritHandle;
     DuplicateHandleRequest->Options       = dwOptions;
 
+    if (dwOptions & DUPLICATE_CLOSE_SOURCE)
+        IntRemoveOutputRingHandle(hConsole);
+
     CsrClientCallServer((PCSR_API_MESSAGE)&ApiMessage,
                         NULL,
                         CSR_CREATE_API_NUMBER(CONSRV_SERVERDLL_INDEX, ConsolepDuplicateHandle),
@@ -1147,6 +1151,9 @@ CloseConsoleHandle(HANDLE hHandle)
     CloseHandleRequest->ConsoleHandle = NtCurrentPeb()->ProcessParameters->ConsoleHandle;
     CloseHandleRequest->Handle        = hHandle;
 
+    /* The handle value may be reused for something else */
+    IntRemoveOutputRingHandle(hHandle);
+
     CsrClientCallServer((PCSR_API_MESSAGE)&ApiMessage,
                         NULL,
                         CSR_CREATE_API_NUMBER(CONSRV_SERVERDLL_INDEX, ConsolepCloseHandle),
@@ -1463,12 +1470,18 @@ FreeConsole(VOID)
     /* Set up the data to send to the Console Server */
     FreeConsoleRequest->ConsoleHandle = ConsoleHandle;
 
+    /* No thread may use the output ring while the server releases it */
+    RtlEnterCriticalSection(&ConsoleOutputRingLock);
+
     /* Call the server */
     CsrClientCallServer((PCSR_API_MESSAGE)&ApiMessage,
                         NULL,
                         CSR_CREATE_API_NUMBER(CONSRV_SERVERDLL_INDEX, ConsolepFree),
                         sizeof(*FreeConsoleRequest));
 
+    if (NT_SUCCESS(ApiMessage.Status)) IntResetOutputRing();
+    RtlLeaveCriticalSection(&ConsoleOutputRingLock);
+
     /* Check for success */
     if (!NT_SUCCESS(ApiMessage.Status))
     {
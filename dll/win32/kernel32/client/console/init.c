@@ -22,6 +22,7 @@
 /* GLOBALS ********************************************************************/
 
 RTL_CRITICAL_SECTION ConsoleLock;
+RTL_CRITICAL_SECTION ConsoleOutputRingLock;
 BOOLEAN ConsoleInitialized = FALSE;
 extern HANDLE InputWaitHandle;
 
@@ -357,6 +358,7 @@ ConDllInitialize(IN ULONG Reason,
             if (ConsoleInitialized != FALSE)
             {
                 ConsoleInitialized = FALSE;
+                RtlDeleteCriticalSection(&ConsoleOutputRingLock);
                 RtlDeleteCriticalSection(&ConsoleLock);
             }
         }
@@ -375,6 +377,12 @@ ConDllInitialize(IN ULONG Reason,
     /* Initialize our global console DLL lock */
     Status = RtlInitializeCriticalSection(&ConsoleLock);
     if (!NT_SUCCESS(Status)) return FALSE;
+    Status = RtlInitializeCriticalSection(&ConsoleOutputRingLock);
+    if (!NT_SUCCESS(Status))
+    {
+        RtlDeleteCriticalSection(&ConsoleLock);
+        return FALSE;
+    }
     ConsoleInitialized = TRUE;
 
     /* Show by default the console window when applicable */
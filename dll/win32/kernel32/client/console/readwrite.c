@@ -593,6 +593,211 @@ IntReadConsoleOutputCode(IN HANDLE hConsoleOutput,
  * Write functions *
  *******************/
 
+/*
+ * Shared-memory output ring (see conmsg.h). Small writes to an output
+ * handle that the server already accepted a WriteConsole for are appended
+ * to the ring, without waiting for the server.
+ */
+#define OUTPUT_RING_HANDLES 4
+
+extern RTL_CRITICAL_SECTION ConsoleOutputRingLock;
+static PCONSOLE_OUTPUT_RING OutputRing = NULL;
+static PCONSOLE_OUTPUT_RING_CONTROL OutputRingControl = NULL;
+static HANDLE OutputRingDoorbell = NULL;
+static HANDLE OutputRingHandles[OUTPUT_RING_HANDLES];
+static ULONG OutputRingNextHandle = 0;
+static BOOLEAN OutputRingUnavailable = FALSE;
+
+static
+VOID
+IntMapOutputRing(VOID)
+{
+    CONSOLE_API_MESSAGE ApiMessage;
+    PCONSOLE_MAPOUTPUTRING MapOutputRingRequest = &ApiMessage.Data.MapOutputRingRequest;
+
+    MapOutputRingRequest->ConsoleHandle = NtCurrentPeb()->ProcessParameters->ConsoleHandle;
+
+    CsrClientCallServer((PCSR_API_MESSAGE)&ApiMessage,
+                        NULL,
+                        CSR_CREATE_API_NUMBER(CONSRV_SERVERDLL_INDEX, ConsolepMapOutputRing),
+                        sizeof(*MapOutputRingRequest));
+    if (!NT_SUCCESS(ApiMessage.Status))
+    {
+        /* Do not ask again for this console */
+        DPRINT("Output ring unavailable, Status 0x%08lx\n", ApiMessage.Status);
+        OutputRingUnavailable = TRUE;
+        return;
+    }
+
+    OutputRing = MapOutputRingRequest->OutputRing;
+    OutputRingControl = MapOutputRingRequest->Control;
+    OutputRingDoorbell = MapOutputRingRequest->DoorbellEvent;
+}
+
+static
+VOID
+IntAddOutputRingHandle(IN HANDLE hConsoleOutput)
+{
+    ULONG i;
+
+    RtlEnterCriticalSection(&ConsoleOutputRingLock);
+
+    if (OutputRing == NULL && !OutputRingUnavailable)
+        IntMapOutputRing();
+
+    if (OutputRing != NULL)
+    {
+        for (i = 0; i < OUTPUT_RING_HANDLES; i++)
+        {
+            if (OutputRingHandles[i] == hConsoleOutput)
+                goto Quit;
+        }
+
+        OutputRingHandles[OutputRingNextHandle] = hConsoleOutput;
+        OutputRingNextHandle = (OutputRingNextHandle + 1) % OUTPUT_RING_HANDLES;
+    }
+
+Quit:
+    RtlLeaveCriticalSection(&ConsoleOutputRingLock);
+}
+
+VOID
+IntRemoveOutputRingHandle(IN HANDLE hConsoleOutput)
+{
+    ULONG i;
+
+    RtlEnterCriticalSection(&ConsoleOutputRingLock);
+
+    for (i = 0; i < OUTPUT_RING_HANDLES; i++)
+    {
+        if (OutputRingHandles[i] == hConsoleOutput)
+            OutputRingHandles[i] = NULL;
+    }
+
+    RtlLeaveCriticalSection(&ConsoleOutputRingLock);
+}
+
+/* Called with the output ring lock held, once the server released the ring */
+VOID
+IntResetOutputRing(VOID)
+{
+    if (OutputRingDoorbell) NtClose(OutputRingDoorbell);
+
+    OutputRing = NULL;
+    OutputRingControl = NULL;
+    OutputRingDoorbell = NULL;
+    RtlZeroMemory(OutputRingHandles, sizeof(OutputRingHandles));
+    OutputRingNextHandle = 0;
+    OutputRingUnavailable = FALSE;
+}
+
+/*
+ * Returns TRUE if the write was handled through the ring, with its
+ * outcome in Status, and FALSE if it must take the regular path.
+ */
+static
+BOOLEAN
+IntWriteConsoleRing(IN HANDLE hConsoleOutput,
+                    IN PVOID lpBuffer,
+                    IN ULONG SizeBytes,
+                    IN BOOLEAN bUnicode,
+                    OUT PNTSTATUS Status)
+{
+    BOOLEAN Success = FALSE;
+    PCONSOLE_OUTPUT_RING_ENTRY Entry;
+    ULONG WriteOffset, ReadOffset, Offset;
+    ULONG EntrySize, PadSize, i;
+
+    if (OutputRing == NULL) return FALSE;
+
+    RtlEnterCriticalSection(&ConsoleOutputRingLock);
+
+    if (OutputRing == NULL) goto Quit;
+
+    /*
+     * The server could not write out an earlier entry, after we told the
+     * caller it succeeded. Fail this write with that status instead, and
+     * stop using the ring until the server accepts a regular write again.
+     */
+    if (OutputRing->ErrorStatus != STATUS_SUCCESS)
+    {
+        *Status = InterlockedExchange(&OutputRing->ErrorStatus, STATUS_SUCCESS);
+        RtlZeroMemory(OutputRingHandles, sizeof(OutputRingHandles));
+        OutputRingNextHandle = 0;
+        Success = TRUE;
+        goto Quit;
+    }
+
+    if (SizeBytes == 0 || SizeBytes > CONSOLE_OUTPUT_RING_MAX_WRITE) goto Quit;
+
+    for (i = 0; i < OUTPUT_RING_HANDLES; i++)
+    {
+        if (OutputRingHandles[i] == hConsoleOutput)
+            break;
+    }
+    if (i == OUTPUT_RING_HANDLES) goto Quit;
+
+    /* While the console is paused, WriteConsole blocks in the server */
+    if (OutputRingControl->Paused) goto Quit;
+
+    /* Entries do not wrap around, pad up to the end of the ring instead */
+    EntrySize   = ALIGN_UP_BY(sizeof(*Entry) + SizeBytes, CONSOLE_OUTPUT_RING_ALIGNMENT);
+    WriteOffset = OutputRing->WriteOffset;
+    ReadOffset  = OutputRing->ReadOffset;
+    Offset      = WriteOffset & (CONSOLE_OUTPUT_RING_SIZE - 1);
+    PadSize     = (CONSOLE_OUTPUT_RING_SIZE - Offset < EntrySize) ? CONSOLE_OUTPUT_RING_SIZE - Offset : 0;
+
+    /* If the ring is full, the regular path lets the server catch up first */
+    if (CONSOLE_OUTPUT_RING_SIZE - (WriteOffset - ReadOffset) < PadSize + EntrySize)
+        goto Quit;
+
+    Entry = (PCONSOLE_OUTPUT_RING_ENTRY)&OutputRing->Data[(Offset + PadSize) & (CONSOLE_OUTPUT_RING_SIZE - 1)];
+
+    /* On a bad buffer the regular path fails the call the usual way */
+    _SEH2_TRY
+    {
+        RtlCopyMemory(Entry + 1, lpBuffer, SizeBytes);
+        Success = TRUE;
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        Success = FALSE;
+    }
+    _SEH2_END;
+
+    if (!Success) goto Quit;
+    *Status = STATUS_SUCCESS;
+
+    if (PadSize)
+    {
+        /* The rest of the ring is at least CONSOLE_OUTPUT_RING_ALIGNMENT bytes */
+        ((PCONSOLE_OUTPUT_RING_ENTRY)&OutputRing->Data[Offset])->Size = PadSize;
+        ((PCONSOLE_OUTPUT_RING_ENTRY)&OutputRing->Data[Offset])->NumBytes = 0;
+    }
+
+    Entry->Size         = EntrySize;
+    Entry->NumBytes     = SizeBytes;
+    Entry->OutputHandle = hConsoleOutput;
+    Entry->Unicode      = bUnicode;
+
+    /* The server writes the entries of all the processes in this order */
+    Entry->Sequence = (ULONG)InterlockedIncrement(&OutputRingControl->Sequence);
+
+    /*
+     * Publish the entry, then ring the doorbell only if the server had
+     * consumed everything before it. Otherwise the server is still busy
+     * with the ring and will see the new write offset by itself.
+     */
+    InterlockedExchange((PLONG)&OutputRing->WriteOffset,
+                        (LONG)(WriteOffset + PadSize + EntrySize));
+    if (OutputRing->ReadOffset == WriteOffset)
+        NtSetEvent(OutputRingDoorbell, NULL);
+
+Quit:
+    RtlLeaveCriticalSection(&ConsoleOutputRingLock);
+    return Success;
+}
+
 static
 BOOL
 IntWriteConsole(IN HANDLE hConsoleOutput,
@@ -603,6 +808,7 @@ IntWriteConsole(IN HANDLE hConsoleOutput,
                 IN BOOLEAN bUnicode)
 {
     BOOL Success;
+    NTSTATUS Status;
     CONSOLE_API_MESSAGE ApiMessage;
     PCONSOLE_WRITECONSOLE WriteConsoleRequest = &ApiMessage.Data.WriteConsoleRequest;
     PCSR_CAPTURE_BUFFER CaptureBuffer = NULL;
@@ -610,6 +816,33 @@ IntWriteConsole(IN HANDLE hConsoleOutput,
 
     DPRINT("IntWriteConsole\n");
 
+    /* Determine the needed size */
+    CharSize  = (bUnicode ? sizeof(WCHAR) : sizeof(CHAR));
+    SizeBytes = nNumberOfCharsToWrite * CharSize;
+
+    /* Small writes go through the shared output ring when possible */
+    if (IntWriteConsoleRing(hConsoleOutput, lpBuffer, SizeBytes, bUnicode, &Status))
+    {
+        if (!NT_SUCCESS(Status))
+        {
+            BaseSetLastNTError(Status);
+            return FALSE;
+        }
+
+        _SEH2_TRY
+        {
+            *lpNumberOfCharsWritten = nNumberOfCharsToWrite;
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            SetLastError(ERROR_INVALID_ACCESS);
+            _SEH2_YIELD(return FALSE);
+        }
+        _SEH2_END;
+
+        return TRUE;
+    }
+
     /* Set up the data to send to the Console Server */
     WriteConsoleRequest->ConsoleHandle = NtCurrentPeb()->ProcessParameters->ConsoleHandle;
     WriteConsoleRequest->OutputHandle  = hConsoleOutput;
@@ -619,10 +852,6 @@ IntWriteConsole(IN HANDLE hConsoleOutput,
     WriteConsoleRequest->Reserved1 = 0;
     // WriteConsoleRequest->Reserved2 = {0};
 
-    /* Determine the needed size */
-    CharSize  = (bUnicode ? sizeof(WCHAR) : sizeof(CHAR));
-    SizeBytes = nNumberOfCharsToWrite * CharSize;
-
     WriteConsoleRequest->NumBytes = SizeBytes;
 
     /*
@@ -684,6 +913,9 @@ IntWriteConsole(IN HANDLE hConsoleOutput,
     /* Retrieve the results */
     if (Success)
     {
+        /* The handle is a valid output handle, let the next writes use the ring */
+        IntAddOutputRingHandle(hConsoleOutput);
+
         _SEH2_TRY
         {
             *lpNumberOfCharsWritten = WriteConsoleRequest->NumBytes / CharSize;
@@ -22,22 +22,66 @@
 #define FILE_SKIP_SET_EVENT_ON_HANDLE        0x2
 #endif
 
+/* Same goes for its information class, which comes after the 2003 ones */
+#if (NTDDI_VERSION < NTDDI_VISTA)
+#define FileIoCompletionNotificationInformation \
+    ((FILE_INFORMATION_CLASS)FileMaximumInformation)
+#endif
+
 /*
- * @unimplemented
+ * NtRemoveIoCompletionEx is only exported by ntdll from 0x600 on, like
+ * GetQueuedCompletionStatusEx itself, so look it up when first needed.
+ */
+typedef NTSTATUS
+(NTAPI *PNT_REMOVE_IO_COMPLETION_EX)(HANDLE,
+                                     PFILE_IO_COMPLETION_INFORMATION,
+                                     ULONG,
+                                     PULONG,
+                                     PLARGE_INTEGER,
+                                     BOOLEAN);
+
+static PNT_REMOVE_IO_COMPLETION_EX pNtRemoveIoCompletionEx;
+
+/* The kernel fills these in as FILE_IO_COMPLETION_INFORMATION entries */
+C_ASSERT(sizeof(OVERLAPPED_ENTRY) == sizeof(FILE_IO_COMPLETION_INFORMATION));
+C_ASSERT(FIELD_OFFSET(OVERLAPPED_ENTRY, lpOverlapped) ==
+         FIELD_OFFSET(FILE_IO_COMPLETION_INFORMATION, ApcContext));
+C_ASSERT(FIELD_OFFSET(OVERLAPPED_ENTRY, dwNumberOfBytesTransferred) ==
+         FIELD_OFFSET(FILE_IO_COMPLETION_INFORMATION, IoStatusBlock.Information));
+
+/*
+ * @implemented
  */
 BOOL
 WINAPI
 SetFileCompletionNotificationModes(IN HANDLE FileHandle,
                                    IN UCHAR Flags)
 {
+    NTSTATUS Status;
+    ULONG NotificationFlags;
+    IO_STATUS_BLOCK IoStatusBlock;
+
     if (Flags & ~(FILE_SKIP_COMPLETION_PORT_ON_SUCCESS | FILE_SKIP_SET_EVENT_ON_HANDLE))
     {
         SetLastError(ERROR_INVALID_PARAMETER);
         return FALSE;
     }
 
-    UNIMPLEMENTED;
-    return FALSE;
+    /* Let the I/O manager know about the new modes */
+    NotificationFlags = Flags;
+    Status = NtSetInformationFile(FileHandle,
+                                  &IoStatusBlock,
+                                  &NotificationFlags,
+                                  sizeof(NotificationFlags),
+                                  FileIoCompletionNotificationInformation);
+    if (!NT_SUCCESS(Status))
+    {
+        /* Convert the error and fail */
+        BaseSetLastNTError(Status);
+        return FALSE;
+    }
+
+    return TRUE;
 }
 
 /*
@@ -167,6 +211,86 @@ GetQueuedCompletionStatus(IN HANDLE CompletionHandle,
     return TRUE;
 }
 
+/*
+ * @implemented
+ */
+BOOL
+WINAPI
+GetQueuedCompletionStatusEx(IN HANDLE CompletionPort,
+                            OUT LPOVERLAPPED_ENTRY lpCompletionPortEntries,
+                            IN ULONG ulCount,
+                            OUT PULONG ulNumEntriesRemoved,
+                            IN DWORD dwMilliseconds,
+                            IN BOOL fAlertable)
+{
+    NTSTATUS Status;
+    LARGE_INTEGER Time;
+    PLARGE_INTEGER TimePtr;
+    PNT_REMOVE_IO_COMPLETION_EX RemoveIoCompletionEx;
+
+    /* Check for invalid parameters */
+    if (!(lpCompletionPortEntries) || !(ulCount) || !(ulNumEntriesRemoved))
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return FALSE;
+    }
+
+    /* Get the native API if we don't have it yet */
+    RemoveIoCompletionEx = pNtRemoveIoCompletionEx;
+    if (!RemoveIoCompletionEx)
+    {
+        RemoveIoCompletionEx = (PNT_REMOVE_IO_COMPLETION_EX)
+            GetProcAddress(GetModuleHandleW(L"ntdll.dll"), "NtRemoveIoCompletionEx");
+        if (!RemoveIoCompletionEx)
+        {
+            SetLastError(ERROR_CALL_NOT_IMPLEMENTED);
+            return FALSE;
+        }
+        pNtRemoveIoCompletionEx = RemoveIoCompletionEx;
+    }
+
+    /* Convert the timeout and then call the native API */
+    *ulNumEntriesRemoved = 0;
+    TimePtr = BaseFormatTimeOut(&Time, dwMilliseconds);
+    Status = RemoveIoCompletionEx(CompletionPort,
+                                  (PFILE_IO_COMPLETION_INFORMATION)lpCompletionPortEntries,
+                                  ulCount,
+                                  ulNumEntriesRemoved,
+                                  TimePtr,
+                                  fAlertable != FALSE);
+    if (!(NT_SUCCESS(Status)) ||
+        (Status == STATUS_TIMEOUT) ||
+        (Status == STATUS_USER_APC) ||
+        (Status == STATUS_ALERTED))
+    {
+        /* Nothing was removed */
+        *ulNumEntriesRemoved = 0;
+
+        /* Check what kind of error we got */
+        if (Status == STATUS_TIMEOUT)
+        {
+            /* Timeout error is set directly since there's no conversion */
+            SetLastError(WAIT_TIMEOUT);
+        }
+        else if ((Status == STATUS_USER_APC) || (Status == STATUS_ALERTED))
+        {
+            /* The wait was interrupted to run APCs */
+            SetLastError(WAIT_IO_COMPLETION);
+        }
+        else
+        {
+            /* Any other error gets converted */
+            BaseSetLastNTError(Status);
+        }
+
+        /* This is a failure case */
+        return FALSE;
+    }
+
+    /* Unlike the single entry version, failed I/Os don't fail the call */
+    return TRUE;
+}
+
 /*
  * @implemented
  */
@@ -54,6 +54,12 @@ VerifyConsoleIoHandle(HANDLE Handle);
 BOOL WINAPI
 CloseConsoleHandle(HANDLE Handle);
 
+VOID
+IntRemoveOutputRingHandle(IN HANDLE hConsoleOutput);
+
+VOID
+IntResetOutputRing(VOID);
+
 HANDLE WINAPI
 GetConsoleInputWaitHandle(VOID);
 
@@ -63,6 +63,13 @@
 #define NPFS_WAIT_BLOCK_TAG     'tFpN'
 #define NPFS_WRITE_BLOCK_TAG    'wFpN'
 
+//
+// Reads at least this large lock the reader's buffer when they have to wait
+// for data, so that writers can copy straight into it instead of going
+// through an intermediate pool buffer
+//
+#define NPFS_DIRECT_READ_THRESHOLD  PAGE_SIZE
+
 //
 // NPFS bugchecking support
 //
@@ -608,6 +615,11 @@ NpReadDataQueue(IN PNP_DATA_QUEUE DataQueue,
                 IN PNP_CCB Ccb,
                 IN PLIST_ENTRY List);
 
+VOID
+NTAPI
+NpLockReadBuffer(IN PIRP Irp,
+                 IN ULONG BufferSize);
+
 
 NTSTATUS
 NTAPI
@@ -129,6 +129,8 @@ NpCommonRead(IN PFILE_OBJECT FileObject,
         goto Quickie;
     }
 
+    NpLockReadBuffer(Irp, BufferSize);
+
     Status = NpAddDataQueueEntry(NamedPipeEnd,
                                  Ccb,
                                  ReadQueue,
@@ -164,4 +164,30 @@ NpReadDataQueue(IN PNP_DATA_QUEUE DataQueue,
     return IoStatus;
 }
 
+VOID
+NTAPI
+NpLockReadBuffer(IN PIRP Irp,
+                 IN ULONG BufferSize)
+{
+    PMDL Mdl;
+    PAGED_CODE();
+
+    if ((Irp->MdlAddress) || (BufferSize < NPFS_DIRECT_READ_THRESHOLD)) return;
+
+    /* This is only an optimization, so the read simply stays buffered on failure */
+    Mdl = IoAllocateMdl(Irp->UserBuffer, BufferSize, FALSE, FALSE, Irp);
+    if (!Mdl) return;
+
+    _SEH2_TRY
+    {
+        MmProbeAndLockPages(Mdl, Irp->RequestorMode, IoWriteAccess);
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        Irp->MdlAddress = NULL;
+        IoFreeMdl(Mdl);
+    }
+    _SEH2_END;
+}
+
 /* EOF */
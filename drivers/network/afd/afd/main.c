@@ -367,6 +367,7 @@ AfdCreateSocket(PDEVICE_OBJECT DeviceObject, PIRP Irp,
 
     InitializeListHead( &FCB->DatagramList );
     InitializeListHead( &FCB->PendingConnections );
+    InitializeListHead( &FCB->PollWaiters );
 
     AFD_DbgPrint(MID_TRACE,("%p: Checking command channel\n", FCB));
 
@@ -52,6 +52,63 @@ VOID ZeroEvents( PAFD_HANDLE HandleArray,
 }
 
 
+/* Called with DeviceExt->Lock held */
+static VOID LinkPollWaitBlocks( PAFD_ACTIVE_POLL Poll,
+                                PAFD_POLL_INFO PollReq ) {
+    UINT i;
+    PFILE_OBJECT FileObject;
+    PAFD_FCB FCB;
+    PAFD_POLL_WAIT_BLOCK WaitBlock;
+
+    Poll->WaitBlockCount = 0;
+
+    for( i = 0; i < PollReq->HandleCount; i++ ) {
+        if( !AFD_HANDLES(PollReq)[i].Handle ) continue;
+
+        FileObject = (PFILE_OBJECT)AFD_HANDLES(PollReq)[i].Handle;
+        FCB = FileObject->FsContext;
+
+        WaitBlock = &Poll->WaitBlocks[Poll->WaitBlockCount++];
+        WaitBlock->Poll = Poll;
+        WaitBlock->FCB = FCB;
+        InsertTailList( &FCB->PollWaiters, &WaitBlock->FcbLink );
+
+        /* Full barrier: PollReeval must see the waiter before we
+         * (re)read the poll state of the socket */
+        InterlockedIncrement( &FCB->PollWaiterCount );
+    }
+}
+
+/* Called with DeviceExt->Lock held */
+static VOID UnlinkPollWaitBlocks( PAFD_ACTIVE_POLL Poll ) {
+    UINT i;
+    PAFD_POLL_WAIT_BLOCK WaitBlock;
+
+    for( i = 0; i < Poll->WaitBlockCount; i++ ) {
+        WaitBlock = &Poll->WaitBlocks[i];
+        RemoveEntryList( &WaitBlock->FcbLink );
+        InterlockedDecrement( &WaitBlock->FCB->PollWaiterCount );
+    }
+
+    Poll->WaitBlockCount = 0;
+}
+
+/* Returns the next waiter on the FCB list that belongs to another poll.
+ * The wait blocks of one poll are inserted in a single critical section,
+ * so those referencing the same FCB are always adjacent. */
+static PLIST_ENTRY NextPollWaiter( PAFD_FCB FCB, PLIST_ENTRY Entry ) {
+    PAFD_POLL_WAIT_BLOCK WaitBlock =
+        CONTAINING_RECORD( Entry, AFD_POLL_WAIT_BLOCK, FcbLink );
+    PAFD_ACTIVE_POLL Poll = WaitBlock->Poll;
+
+    do {
+        Entry = Entry->Flink;
+        WaitBlock = CONTAINING_RECORD( Entry, AFD_POLL_WAIT_BLOCK, FcbLink );
+    } while( Entry != &FCB->PollWaiters && WaitBlock->Poll == Poll );
+
+    return Entry;
+}
+
 /* you must pass either Poll OR Irp */
 VOID SignalSocket(
    PAFD_ACTIVE_POLL Poll OPTIONAL,
@@ -68,6 +125,7 @@ VOID SignalSocket(
     {
         KeCancelTimer( &Poll->Timer );
         RemoveEntryList( &Poll->ListEntry );
+        UnlinkPollWaitBlocks( Poll );
         ExFreePoolWithTag(Poll, TAG_AFD_ACTIVE_POLL);
     }
 
@@ -92,6 +150,8 @@ VOID SignalSocket(
     AFD_DbgPrint(MID_TRACE,("Done\n"));
 }
 
+static BOOLEAN UpdatePollWithFCB( PAFD_ACTIVE_POLL Poll, PFILE_OBJECT FileObject );
+
 static KDEFERRED_ROUTINE SelectTimeout;
 static VOID NTAPI SelectTimeout( PKDPC Dpc,
                            PVOID DeferredContext,
@@ -127,32 +187,27 @@ VOID KillSelectsForFCB( PAFD_DEVICE_EXTENSION DeviceExt,
                         BOOLEAN OnlyExclusive ) {
     KIRQL OldIrql;
     PLIST_ENTRY ListEntry;
+    PAFD_POLL_WAIT_BLOCK WaitBlock;
     PAFD_ACTIVE_POLL Poll;
-    PIRP Irp;
     PAFD_POLL_INFO PollReq;
-    PAFD_HANDLE HandleArray;
-    UINT i;
+    PAFD_FCB FCB = FileObject->FsContext;
 
     AFD_DbgPrint(MID_TRACE,("Killing selects that refer to %p\n", FileObject));
 
+    if( !FCB ) return;
+
     KeAcquireSpinLock( &DeviceExt->Lock, &OldIrql );
 
-    ListEntry = DeviceExt->Polls.Flink;
-    while ( ListEntry != &DeviceExt->Polls ) {
-        Poll = CONTAINING_RECORD(ListEntry, AFD_ACTIVE_POLL, ListEntry);
-        ListEntry = ListEntry->Flink;
-        Irp = Poll->Irp;
-        PollReq = Irp->AssociatedIrp.SystemBuffer;
-        HandleArray = AFD_HANDLES(PollReq);
+    ListEntry = FCB->PollWaiters.Flink;
+    while ( ListEntry != &FCB->PollWaiters ) {
+        WaitBlock = CONTAINING_RECORD(ListEntry, AFD_POLL_WAIT_BLOCK, FcbLink);
+        Poll = WaitBlock->Poll;
+        ListEntry = NextPollWaiter( FCB, ListEntry );
 
-        for( i = 0; i < PollReq->HandleCount; i++ ) {
-            AFD_DbgPrint(MAX_TRACE,("Req: %u, This %p\n",
-                                    HandleArray[i].Handle, FileObject));
-            if( (PVOID)HandleArray[i].Handle == FileObject &&
-                (!OnlyExclusive || (OnlyExclusive && Poll->Exclusive)) ) {
-                ZeroEvents( PollReq->Handles, PollReq->HandleCount );
-                SignalSocket( Poll, NULL, PollReq, STATUS_CANCELLED );
-            }
+        if( !OnlyExclusive || Poll->Exclusive ) {
+            PollReq = Poll->Irp->AssociatedIrp.SystemBuffer;
+            ZeroEvents( PollReq->Handles, PollReq->HandleCount );
+            SignalSocket( Poll, NULL, PollReq, STATUS_CANCELLED );
         }
     }
 
@@ -229,7 +284,8 @@ AfdSelect( PDEVICE_OBJECT DeviceObject, PIRP Irp,
        PAFD_ACTIVE_POLL Poll = NULL;
 
        Poll = ExAllocatePoolWithTag(NonPagedPool,
-                                    sizeof(AFD_ACTIVE_POLL),
+                                    FIELD_OFFSET(AFD_ACTIVE_POLL, WaitBlocks) +
+                                    sizeof(AFD_POLL_WAIT_BLOCK) * PollReq->HandleCount,
                                     TAG_AFD_ACTIVE_POLL);
 
        if (Poll){
@@ -243,11 +299,20 @@ AfdSelect( PDEVICE_OBJECT DeviceObject, PIRP Irp,
 
           InsertTailList( &DeviceExt->Polls, &Poll->ListEntry );
 
-          KeSetTimer( &Poll->Timer, PollReq->Timeout, &Poll->TimeoutDpc );
+          LinkPollWaitBlocks( Poll, PollReq );
 
-          Status = STATUS_PENDING;
-          IoMarkIrpPending( Irp );
-          (void)IoSetCancelRoutine(Irp, AfdCancelHandler);
+          /* PollReeval doesn't take the lock for sockets without waiters,
+           * so a state change may have slipped in before we were linked */
+          if( UpdatePollWithFCB( Poll, NULL ) ) {
+              Status = STATUS_SUCCESS;
+              SignalSocket( Poll, NULL, PollReq, Status );
+          } else {
+              KeSetTimer( &Poll->Timer, PollReq->Timeout, &Poll->TimeoutDpc );
+
+              Status = STATUS_PENDING;
+              IoMarkIrpPending( Irp );
+              (void)IoSetCancelRoutine(Irp, AfdCancelHandler);
+          }
        } else {
           AFD_DbgPrint(MAX_TRACE, ("FIXME: do something with the IRP!\n"));
           Status = STATUS_NO_MEMORY;
@@ -406,6 +471,7 @@ static BOOLEAN UpdatePollWithFCB( PAFD_ACTIVE_POLL Poll, PFILE_OBJECT FileObject
 
 VOID PollReeval( PAFD_DEVICE_EXTENSION DeviceExt, PFILE_OBJECT FileObject ) {
     PAFD_ACTIVE_POLL Poll = NULL;
+    PAFD_POLL_WAIT_BLOCK WaitBlock;
     PLIST_ENTRY ThePollEnt = NULL;
     PAFD_FCB FCB;
     KIRQL OldIrql;
@@ -414,33 +480,40 @@ VOID PollReeval( PAFD_DEVICE_EXTENSION DeviceExt, PFILE_OBJECT FileObject ) {
     AFD_DbgPrint(MID_TRACE,("Called: DeviceExt %p FileObject %p\n",
                             DeviceExt, FileObject));
 
-    KeAcquireSpinLock( &DeviceExt->Lock, &OldIrql );
-
     /* Take care of any event select signalling */
     FCB = (PAFD_FCB)FileObject->FsContext;
 
     if( !FCB ) {
-        KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
         return;
     }
 
-    /* Now signal normal select irps */
-    ThePollEnt = DeviceExt->Polls.Flink;
+    /* Order the poll state update of our caller against the waiter
+     * count. AfdSelect rechecks the state after linking, so a socket
+     * nobody is selecting on never touches the device lock. */
+    KeMemoryBarrier();
 
-    while( ThePollEnt != &DeviceExt->Polls ) {
-        Poll = CONTAINING_RECORD( ThePollEnt, AFD_ACTIVE_POLL, ListEntry );
-        PollReq = Poll->Irp->AssociatedIrp.SystemBuffer;
-        AFD_DbgPrint(MID_TRACE,("Checking poll %p\n", Poll));
+    if( FCB->PollWaiterCount ) {
+        KeAcquireSpinLock( &DeviceExt->Lock, &OldIrql );
 
-        if( UpdatePollWithFCB( Poll, FileObject ) ) {
-            ThePollEnt = ThePollEnt->Flink;
-            AFD_DbgPrint(MID_TRACE,("Signalling socket\n"));
-            SignalSocket( Poll, NULL, PollReq, STATUS_SUCCESS );
-        } else
-            ThePollEnt = ThePollEnt->Flink;
-    }
+        /* Now signal normal select irps that reference this socket */
+        ThePollEnt = FCB->PollWaiters.Flink;
 
-    KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
+        while( ThePollEnt != &FCB->PollWaiters ) {
+            WaitBlock = CONTAINING_RECORD( ThePollEnt, AFD_POLL_WAIT_BLOCK, FcbLink );
+            Poll = WaitBlock->Poll;
+            PollReq = Poll->Irp->AssociatedIrp.SystemBuffer;
+            AFD_DbgPrint(MID_TRACE,("Checking poll %p\n", Poll));
+
+            ThePollEnt = NextPollWaiter( FCB, ThePollEnt );
+
+            if( UpdatePollWithFCB( Poll, FileObject ) ) {
+                AFD_DbgPrint(MID_TRACE,("Signalling socket\n"));
+                SignalSocket( Poll, NULL, PollReq, STATUS_SUCCESS );
+            }
+        }
+
+        KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
+    }
 
     if((FCB->EventSelect) &&
        (FCB->PollState & (FCB->EventSelectTriggers & ~FCB->EventSelectDisabled)))
@@ -113,6 +113,17 @@ typedef struct _AFD_DEVICE_EXTENSION {
     KSPIN_LOCK Lock;
 } AFD_DEVICE_EXTENSION, *PAFD_DEVICE_EXTENSION;
 
+struct _AFD_ACTIVE_POLL;
+struct _AFD_FCB;
+
+/* One per polled handle, linked on the FCB so that a state change only
+ * has to look at the polls that actually reference the socket */
+typedef struct _AFD_POLL_WAIT_BLOCK {
+    LIST_ENTRY FcbLink;
+    struct _AFD_ACTIVE_POLL *Poll;
+    struct _AFD_FCB *FCB;
+} AFD_POLL_WAIT_BLOCK, *PAFD_POLL_WAIT_BLOCK;
+
 typedef struct _AFD_ACTIVE_POLL {
     LIST_ENTRY ListEntry;
     PIRP Irp;
@@ -121,6 +132,8 @@ typedef struct _AFD_ACTIVE_POLL {
     KTIMER Timer;
     PKEVENT EventObject;
     BOOLEAN Exclusive;
+    UINT WaitBlockCount;
+    AFD_POLL_WAIT_BLOCK WaitBlocks[ANYSIZE_ARRAY];
 } AFD_ACTIVE_POLL, *PAFD_ACTIVE_POLL;
 
 typedef struct _IRP_LIST {
@@ -201,6 +214,8 @@ typedef struct _AFD_FCB {
     LIST_ENTRY PendingIrpList[MAX_FUNCTIONS];
     LIST_ENTRY DatagramList;
     LIST_ENTRY PendingConnections;
+    LIST_ENTRY PollWaiters; /* AFD_POLL_WAIT_BLOCK, protected by DeviceExt->Lock */
+    volatile LONG PollWaiterCount;
 } AFD_FCB, *PAFD_FCB;
 
 /* bind.c */
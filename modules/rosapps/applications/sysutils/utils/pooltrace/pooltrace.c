@@ -0,0 +1,505 @@
+/*
+ * PROJECT:     ReactOS pool tracing utility
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Collects a pool allocation trace and reports the busiest
+ *              allocation sites and the allocations that were never freed
+ */
+
+#define WIN32_NO_STATUS
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ntndk.h>
+
+#define SITE_BUCKETS    4096
+#define BLOCK_BUCKETS   65536
+#define POLL_INTERVAL   250
+#define DEFAULT_RATE    16
+
+typedef struct _SITE
+{
+    struct _SITE *Next;
+    ULONG Tag;
+    PVOID Caller;
+    ULONG Allocs;
+    ULONG Frees;
+    ULONGLONG Bytes;
+    ULONG Live;
+    ULONGLONG LiveBytes;
+    ULONGLONG OldestLive;
+    UCHAR FrameCount;
+    PVOID Frames[SYSTEM_POOL_TRACE_FRAMES];
+} SITE, *PSITE;
+
+typedef struct _BLOCK
+{
+    struct _BLOCK *Next;
+    PVOID Va;
+    PSITE Site;
+    SIZE_T NumberOfBytes;
+    ULONGLONG TimeStamp;
+} BLOCK, *PBLOCK;
+
+static PSITE SiteBuckets[SITE_BUCKETS];
+static PBLOCK BlockBuckets[BLOCK_BUCKETS];
+static ULONG SiteCount;
+static ULONG RecordCount;
+static ULONG LostCount;
+static ULONG UnmatchedFrees;
+static ULONGLONG FirstTimeStamp;
+static ULONGLONG LastTimeStamp;
+static PRTL_PROCESS_MODULES Modules;
+static SYSTEM_POOL_TRACE_CONTROL Previous;
+static volatile LONG StopTracing;
+
+static ULONG HashPointer(PVOID Pointer, ULONG Buckets)
+{
+    return (ULONG)(((ULONG_PTR)Pointer >> 3) * 0x9E3779B1) & (Buckets - 1);
+}
+
+static PSITE LookupSite(ULONG Tag, PSYSTEM_POOL_TRACE_ENTRY Entry)
+{
+    ULONG Hash = (HashPointer(Entry->Caller, SITE_BUCKETS) ^ Tag) & (SITE_BUCKETS - 1);
+    PSITE Site;
+
+    for (Site = SiteBuckets[Hash]; Site; Site = Site->Next)
+    {
+        if (Site->Tag == Tag && Site->Caller == Entry->Caller)
+            return Site;
+    }
+
+    Site = calloc(1, sizeof(*Site));
+    if (!Site)
+        return NULL;
+
+    /* Keep the first stack we see as an example for this site */
+    Site->Tag = Tag;
+    Site->Caller = Entry->Caller;
+    Site->FrameCount = min(Entry->FrameCount, SYSTEM_POOL_TRACE_FRAMES);
+    memcpy(Site->Frames, Entry->Frames, Site->FrameCount * sizeof(PVOID));
+    Site->Next = SiteBuckets[Hash];
+    SiteBuckets[Hash] = Site;
+    SiteCount++;
+    return Site;
+}
+
+static PBLOCK *LookupBlock(PVOID Va)
+{
+    PBLOCK *Link = &BlockBuckets[HashPointer(Va, BLOCK_BUCKETS)];
+
+    while (*Link && (*Link)->Va != Va)
+        Link = &(*Link)->Next;
+    return Link;
+}
+
+static void RemoveLiveBlock(PBLOCK *Link)
+{
+    PBLOCK Block = *Link;
+
+    Block->Site->Live--;
+    Block->Site->LiveBytes -= Block->NumberOfBytes;
+    *Link = Block->Next;
+    free(Block);
+}
+
+static void ProcessEntry(PSYSTEM_POOL_TRACE_ENTRY Entry)
+{
+    PBLOCK *Link, Block;
+    PSITE Site;
+
+    Link = LookupBlock(Entry->Va);
+    if (Entry->Flags & SYSTEM_POOL_TRACE_FREE)
+    {
+        /* The free is charged to the site that made the allocation */
+        if (!*Link)
+        {
+            UnmatchedFrees++;
+            return;
+        }
+        (*Link)->Site->Frees++;
+        RemoveLiveBlock(Link);
+        return;
+    }
+
+    /* If we still think the block is live, we missed its free */
+    if (*Link)
+        RemoveLiveBlock(Link);
+
+    Site = LookupSite(Entry->Tag, Entry);
+    Block = malloc(sizeof(*Block));
+    if (!Site || !Block)
+    {
+        free(Block);
+        return;
+    }
+
+    Site->Allocs++;
+    Site->Bytes += Entry->NumberOfBytes;
+    Site->Live++;
+    Site->LiveBytes += Entry->NumberOfBytes;
+
+    Block->Va = Entry->Va;
+    Block->Site = Site;
+    Block->NumberOfBytes = Entry->NumberOfBytes;
+    Block->TimeStamp = Entry->TimeStamp;
+    Block->Next = NULL;
+    *Link = Block;
+}
+
+static int __cdecl CompareTimeStamps(const void *p1, const void *p2)
+{
+    const SYSTEM_POOL_TRACE_ENTRY *Entry1 = p1, *Entry2 = p2;
+
+    if (Entry1->TimeStamp < Entry2->TimeStamp)
+        return -1;
+    return Entry1->TimeStamp > Entry2->TimeStamp;
+}
+
+static NTSTATUS Collect(PSYSTEM_POOL_TRACE_INFORMATION Information, ULONG Length)
+{
+    NTSTATUS Status;
+    ULONG i;
+
+    /* Each processor's records come in order, but we need them all in order */
+    Status = NtQuerySystemInformation(SystemPoolTraceInformation,
+                                      Information,
+                                      Length,
+                                      NULL);
+    if (!NT_SUCCESS(Status))
+        return Status;
+
+    qsort(Information->Entries, Information->Count,
+          sizeof(Information->Entries[0]), CompareTimeStamps);
+    for (i = 0; i < Information->Count; i++)
+        ProcessEntry(&Information->Entries[i]);
+
+    if (Information->Count)
+    {
+        if (!FirstTimeStamp)
+            FirstTimeStamp = Information->Entries[0].TimeStamp;
+        LastTimeStamp = max(LastTimeStamp, Information->Entries[Information->Count - 1].TimeStamp);
+    }
+
+    RecordCount += Information->Count;
+    LostCount += Information->Lost;
+    return STATUS_SUCCESS;
+}
+
+static void LoadModules(void)
+{
+    ULONG Length = 0x10000;
+    NTSTATUS Status;
+
+    for (;;)
+    {
+        Modules = malloc(Length);
+        if (!Modules)
+            return;
+
+        Status = NtQuerySystemInformation(SystemModuleInformation, Modules, Length, &Length);
+        if (NT_SUCCESS(Status))
+            return;
+
+        free(Modules);
+        Modules = NULL;
+        if (Status != STATUS_INFO_LENGTH_MISMATCH)
+            return;
+    }
+}
+
+static void PrintAddress(PVOID Address)
+{
+    PRTL_PROCESS_MODULE_INFORMATION Module;
+    ULONG i;
+
+    for (i = 0; Modules && i < Modules->NumberOfModules; i++)
+    {
+        Module = &Modules->Modules[i];
+        if ((ULONG_PTR)Address >= (ULONG_PTR)Module->ImageBase &&
+            (ULONG_PTR)Address < (ULONG_PTR)Module->ImageBase + Module->ImageSize)
+        {
+            printf("%s+0x%lx",
+                   Module->FullPathName + Module->OffsetToFileName,
+                   (ULONG)((ULONG_PTR)Address - (ULONG_PTR)Module->ImageBase));
+            return;
+        }
+    }
+
+    printf("%p", Address);
+}
+
+static void PrintTag(ULONG Tag)
+{
+    ULONG i;
+    CHAR c;
+
+    for (i = 0; i < 4; i++)
+    {
+        c = (CHAR)(Tag >> (i * 8));
+        putchar((c >= 0x20 && c <= 0x7E) ? c : '.');
+    }
+}
+
+static void PrintSite(PSITE Site)
+{
+    ULONG i;
+
+    PrintTag(Site->Tag);
+    printf("  ");
+    PrintAddress(Site->Caller);
+    putchar('\n');
+    for (i = 0; i < Site->FrameCount; i++)
+    {
+        printf("        ");
+        PrintAddress(Site->Frames[i]);
+        putchar('\n');
+    }
+}
+
+static PSITE *GetSites(void)
+{
+    PSITE *Sites, Site;
+    ULONG i, Count = 0;
+
+    Sites = malloc((SiteCount + 1) * sizeof(PSITE));
+    if (!Sites)
+        return NULL;
+
+    for (i = 0; i < SITE_BUCKETS; i++)
+    {
+        for (Site = SiteBuckets[i]; Site; Site = Site->Next)
+            Sites[Count++] = Site;
+    }
+    return Sites;
+}
+
+static int __cdecl CompareChurn(const void *p1, const void *p2)
+{
+    PSITE Site1 = *(PSITE *)p1, Site2 = *(PSITE *)p2;
+    ULONGLONG Churn1 = (ULONGLONG)Site1->Allocs + Site1->Frees;
+    ULONGLONG Churn2 = (ULONGLONG)Site2->Allocs + Site2->Frees;
+
+    if (Churn1 != Churn2)
+        return Churn1 > Churn2 ? -1 : 1;
+    return 0;
+}
+
+static int __cdecl CompareLive(const void *p1, const void *p2)
+{
+    PSITE Site1 = *(PSITE *)p1, Site2 = *(PSITE *)p2;
+
+    if (Site1->LiveBytes != Site2->LiveBytes)
+        return Site1->LiveBytes > Site2->LiveBytes ? -1 : 1;
+    return 0;
+}
+
+static void Report(ULONG Top)
+{
+    ULONGLONG Duration = LastTimeStamp - FirstTimeStamp;
+    PSITE *Sites;
+    PBLOCK Block;
+    ULONG i, Shown;
+
+    Sites = GetSites();
+    if (!Sites)
+        return;
+
+    /* Find out how long the oldest live block of each site has been around */
+    for (i = 0; i < BLOCK_BUCKETS; i++)
+    {
+        for (Block = BlockBuckets[i]; Block; Block = Block->Next)
+        {
+            if (!Block->Site->OldestLive ||
+                Block->TimeStamp < Block->Site->OldestLive)
+            {
+                Block->Site->OldestLive = Block->TimeStamp;
+            }
+        }
+    }
+
+    printf("\n%lu records, %lu lost, %lu frees of blocks allocated before the trace\n",
+           RecordCount, LostCount, UnmatchedFrees);
+
+    printf("\nTop churners:\n");
+    printf("Allocs     Frees      Bytes        Tag   Caller\n");
+    qsort(Sites, SiteCount, sizeof(PSITE), CompareChurn);
+    for (i = 0; i < SiteCount && i < Top; i++)
+    {
+        printf("%-10lu %-10lu %-12I64u ", Sites[i]->Allocs, Sites[i]->Frees, Sites[i]->Bytes);
+        PrintSite(Sites[i]);
+    }
+
+    /* Blocks allocated during the last half of the trace could just be
+       blocks in use, so only older ones are reported. Time stamps are in
+       100 ns units */
+    printf("\nLeak candidates (still allocated, allocated more than %I64u ms before the end):\n",
+           Duration / 20000);
+    printf("Live       Bytes        Age (ms)   Tag   Caller\n");
+    qsort(Sites, SiteCount, sizeof(PSITE), CompareLive);
+    for (i = 0, Shown = 0; i < SiteCount && Shown < Top; i++)
+    {
+        if (!Sites[i]->Live || LastTimeStamp - Sites[i]->OldestLive < Duration / 2)
+            continue;
+
+        printf("%-10lu %-12I64u %-10I64u ",
+               Sites[i]->Live, Sites[i]->LiveBytes,
+               (LastTimeStamp - Sites[i]->OldestLive) / 10000);
+        PrintSite(Sites[i]);
+        Shown++;
+    }
+
+    free(Sites);
+}
+
+static void RestoreSettings(void)
+{
+    NtSetSystemInformation(SystemPoolTraceInformation, &Previous, sizeof(Previous));
+}
+
+static BOOL WINAPI CtrlHandler(DWORD dwCtrlType)
+{
+    switch (dwCtrlType)
+    {
+        case CTRL_C_EVENT:
+        case CTRL_BREAK_EVENT:
+            /* Stop early, main() restores the settings and reports */
+            InterlockedExchange(&StopTracing, TRUE);
+            return TRUE;
+
+        default:
+            /* We are about to be terminated, don't leave tracing on */
+            RestoreSettings();
+            return FALSE;
+    }
+}
+
+static void Usage(void)
+{
+    printf("Usage: pooltrace [-r rate] [-t tag] [-s frames] [-n count] [seconds]\n"
+           "       pooltrace off\n\n"
+           "  -r rate    Record one in every 'rate' blocks (default %u, 1 for all of them)\n"
+           "  -t tag     Only record blocks with this pool tag\n"
+           "  -s frames  Also record up to this many stack frames (default 0, max %u)\n"
+           "  -n count   Number of sites to report (default 10)\n"
+           "  seconds    How long to trace for (default 10, Ctrl+C stops early)\n",
+           DEFAULT_RATE, SYSTEM_POOL_TRACE_FRAMES);
+}
+
+int main(int argc, char *argv[])
+{
+    SYSTEM_POOL_TRACE_CONTROL Control = { DEFAULT_RATE, 0, 0 };
+    PSYSTEM_POOL_TRACE_INFORMATION Information;
+    ULONG Length, Seconds = 10, Top = 10;
+    BOOLEAN WasEnabled;
+    NTSTATUS Status;
+    DWORD dwEnd;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!_stricmp(argv[i], "off"))
+        {
+            Control.SampleRate = 0;
+            Seconds = 0;
+        }
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+            Control.SampleRate = max(strtoul(argv[++i], NULL, 0), 1);
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc && strlen(argv[i + 1]) <= 4)
+        {
+            /* Tags are stored with the first character in the low byte */
+            i++;
+            memset(&Control.Tag, ' ', sizeof(Control.Tag));
+            memcpy(&Control.Tag, argv[i], strlen(argv[i]));
+        }
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+            Control.FrameCount = min(strtoul(argv[++i], NULL, 0), SYSTEM_POOL_TRACE_FRAMES);
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            Top = strtoul(argv[++i], NULL, 0);
+        else if (argv[i][0] >= '0' && argv[i][0] <= '9')
+            Seconds = strtoul(argv[i], NULL, 0);
+        else
+        {
+            Usage();
+            return 1;
+        }
+    }
+
+    /* Both reading and changing the trace settings need this */
+    Status = RtlAdjustPrivilege(SE_DEBUG_PRIVILEGE, TRUE, FALSE, &WasEnabled);
+    if (!NT_SUCCESS(Status))
+    {
+        printf("Cannot enable the debug privilege: 0x%08lx\n", Status);
+        return 1;
+    }
+
+    /* Keep room for all the records of a few processors */
+    Length = FIELD_OFFSET(SYSTEM_POOL_TRACE_INFORMATION, Entries) +
+             8 * 2048 * sizeof(SYSTEM_POOL_TRACE_ENTRY);
+    Information = malloc(Length);
+    if (!Information)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+
+    /* Remember what was set before, to put it back afterwards */
+    Status = NtQuerySystemInformation(SystemPoolTraceInformation,
+                                      Information,
+                                      FIELD_OFFSET(SYSTEM_POOL_TRACE_INFORMATION, Entries),
+                                      NULL);
+    if (NT_SUCCESS(Status))
+        Previous = Information->Control;
+
+    /* Put them back however we exit */
+    if (Control.SampleRate)
+        SetConsoleCtrlHandler(CtrlHandler, TRUE);
+
+    Status = NtSetSystemInformation(SystemPoolTraceInformation, &Control, sizeof(Control));
+    if (!NT_SUCCESS(Status))
+    {
+        printf("Cannot change the pool trace settings: 0x%08lx\n", Status);
+        free(Information);
+        return 1;
+    }
+    if (!Control.SampleRate)
+    {
+        free(Information);
+        return 0;
+    }
+
+    /* Throw away whatever was recorded before we started */
+    Collect(Information, Length);
+    RecordCount = LostCount = UnmatchedFrees = 0;
+    FirstTimeStamp = LastTimeStamp = 0;
+    for (i = 0; i < BLOCK_BUCKETS; i++)
+    {
+        while (BlockBuckets[i])
+            RemoveLiveBlock(&BlockBuckets[i]);
+    }
+
+    printf("Tracing pool allocations for %lu seconds...\n", Seconds);
+    dwEnd = GetTickCount() + Seconds * 1000;
+    do
+    {
+        Sleep(POLL_INTERVAL);
+        Status = Collect(Information, Length);
+    } while (NT_SUCCESS(Status) && !StopTracing && (LONG)(dwEnd - GetTickCount()) > 0);
+
+    RestoreSettings();
+    if (!NT_SUCCESS(Status))
+    {
+        printf("Cannot read the pool trace: 0x%08lx\n", Status);
+        free(Information);
+        return 1;
+    }
+
+    if (Control.SampleRate > 1)
+        printf("Only one in %lu blocks was recorded\n", Control.SampleRate);
+
+    LoadModules();
+    Report(Top);
+
+    free(Modules);
+    free(Information);
+    return 0;
+}
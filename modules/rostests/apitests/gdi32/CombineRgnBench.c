@@ -0,0 +1,164 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Timing and consistency test for CombineRgn on window-like rects
+ */
+
+#include "precomp.h"
+
+#define SCREEN_WIDTH 1024
+#define SCREEN_HEIGHT 768
+#define WINDOW_COUNT 48
+#define VIS_ITERATIONS 2000
+#define RECT_ITERATIONS 100000
+
+static RECT arcWindows[WINDOW_COUNT];
+static RECT rcClip = { 16, 16, SCREEN_WIDTH - 16, SCREEN_HEIGHT - 16 };
+
+static void InitWindows(void)
+{
+    ULONG i, ulSeed = 0x1234;
+
+    for (i = 0; i < WINDOW_COUNT; i++)
+    {
+        ulSeed = ulSeed * 1103515245 + 12345;
+        arcWindows[i].left = (ulSeed >> 8) % (SCREEN_WIDTH - 64);
+        ulSeed = ulSeed * 1103515245 + 12345;
+        arcWindows[i].top = (ulSeed >> 8) % (SCREEN_HEIGHT - 64);
+        ulSeed = ulSeed * 1103515245 + 12345;
+        arcWindows[i].right = arcWindows[i].left + 32 + (ulSeed >> 8) % 256;
+        ulSeed = ulSeed * 1103515245 + 12345;
+        arcWindows[i].bottom = arcWindows[i].top + 32 + (ulSeed >> 8) % 192;
+    }
+}
+
+/* Same steps as a visible region: start from the window, clip to the
+   parent and cut out every window above it */
+static void ComputeVisRgn(HRGN hrgnVis, HRGN hrgnTemp)
+{
+    ULONG i;
+
+    SetRectRgn(hrgnVis, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+    SetRectRgn(hrgnTemp, rcClip.left, rcClip.top, rcClip.right, rcClip.bottom);
+    CombineRgn(hrgnVis, hrgnVis, hrgnTemp, RGN_AND);
+
+    for (i = 0; i < WINDOW_COUNT; i++)
+    {
+        SetRectRgn(hrgnTemp, arcWindows[i].left, arcWindows[i].top,
+                   arcWindows[i].right, arcWindows[i].bottom);
+        CombineRgn(hrgnVis, hrgnVis, hrgnTemp, RGN_DIFF);
+    }
+}
+
+static BOOL IsPointVisible(INT x, INT y)
+{
+    POINT pt = { x, y };
+    ULONG i;
+
+    if (!PtInRect(&rcClip, pt))
+        return FALSE;
+
+    for (i = 0; i < WINDOW_COUNT; i++)
+    {
+        if (PtInRect(&arcWindows[i], pt))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void Test_VisRgn(void)
+{
+    HRGN hrgnVis, hrgnTemp;
+    DWORD dwStart, dwElapsed;
+    ULONG i, cMismatches = 0;
+    INT x, y;
+
+    hrgnVis = CreateRectRgn(0, 0, 0, 0);
+    hrgnTemp = CreateRectRgn(0, 0, 0, 0);
+    ok(hrgnVis && hrgnTemp, "CreateRectRgn failed\n");
+    if (!hrgnVis || !hrgnTemp)
+        goto Cleanup;
+
+    dwStart = GetTickCount();
+    for (i = 0; i < VIS_ITERATIONS; i++)
+    {
+        ComputeVisRgn(hrgnVis, hrgnTemp);
+    }
+    dwElapsed = GetTickCount() - dwStart;
+
+    ok(GetRegionData(hrgnVis, 0, NULL) > sizeof(RGNDATAHEADER),
+       "The visible region is empty\n");
+
+    /* The region must match the rects it was built from */
+    for (y = 0; y < SCREEN_HEIGHT; y += 3)
+    {
+        for (x = 0; x < SCREEN_WIDTH; x += 3)
+        {
+            if (PtInRegion(hrgnVis, x, y) != IsPointVisible(x, y))
+                cMismatches++;
+        }
+    }
+
+    ok(cMismatches == 0, "Got %lu mismatching points\n", cMismatches);
+    trace("%lu visible regions of %u windows in %lu ms\n",
+          i, WINDOW_COUNT, dwElapsed);
+
+Cleanup:
+    if (hrgnVis) DeleteObject(hrgnVis);
+    if (hrgnTemp) DeleteObject(hrgnTemp);
+}
+
+static void Test_RectOps(void)
+{
+    static const INT aiModes[] = { RGN_AND, RGN_DIFF, RGN_XOR };
+    static const INT aiExpected[] = { SIMPLEREGION, COMPLEXREGION, COMPLEXREGION };
+    HRGN hrgn1, hrgn2, hrgnDest;
+    DWORD dwStart, dwElapsed;
+    ULONG i, j, cErrors;
+    RECT rcBox;
+
+    hrgn1 = CreateRectRgn(100, 100, 300, 250);
+    hrgn2 = CreateRectRgn(150, 50, 250, 200);
+    hrgnDest = CreateRectRgn(0, 0, 0, 0);
+    ok(hrgn1 && hrgn2 && hrgnDest, "CreateRectRgn failed\n");
+    if (!hrgn1 || !hrgn2 || !hrgnDest)
+        goto Cleanup;
+
+    for (j = 0; j < ARRAYSIZE(aiModes); j++)
+    {
+        cErrors = 0;
+        dwStart = GetTickCount();
+        for (i = 0; i < RECT_ITERATIONS; i++)
+        {
+            if (CombineRgn(hrgnDest, hrgn1, hrgn2, aiModes[j]) != aiExpected[j])
+                cErrors++;
+        }
+        dwElapsed = GetTickCount() - dwStart;
+
+        ok(cErrors == 0, "Mode %d: got %lu unexpected results\n", aiModes[j], cErrors);
+        trace("Mode %d: %lu rect operations in %lu ms\n", aiModes[j], i, dwElapsed);
+    }
+
+    /* The last result is the XOR: both rects, minus their common part */
+    ok_int(GetRgnBox(hrgnDest, &rcBox), COMPLEXREGION);
+    ok_long(rcBox.left, 100);
+    ok_long(rcBox.top, 50);
+    ok_long(rcBox.right, 300);
+    ok_long(rcBox.bottom, 250);
+    ok_int(PtInRegion(hrgnDest, 200, 150), FALSE);
+    ok_int(PtInRegion(hrgnDest, 200, 75), TRUE);
+    ok_int(PtInRegion(hrgnDest, 200, 225), TRUE);
+
+Cleanup:
+    if (hrgn1) DeleteObject(hrgn1);
+    if (hrgn2) DeleteObject(hrgn2);
+    if (hrgnDest) DeleteObject(hrgnDest);
+}
+
+START_TEST(CombineRgnBench)
+{
+    InitWindows();
+    Test_VisRgn();
+    Test_RectOps();
+}
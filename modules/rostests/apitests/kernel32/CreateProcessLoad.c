@@ -0,0 +1,169 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Process creation latency while other threads flood the console server
+ */
+
+#include "precomp.h"
+
+#include <ndk/lpctypes.h>
+#include <csr/csr.h>
+#include <win/console.h>
+#include <win/conmsg.h>
+
+/* More than the API threads csrss runs by default (16), so that calls queue */
+#define LOAD_THREADS 32
+#define LOAD_BUFFER_WIDTH 1000
+#define LOAD_BUFFER_HEIGHT 1000
+#define PROCESS_COUNT 10
+
+static volatile LONG StopLoad;
+
+static BOOL QueryFillStatistics(PCSR_API_STATISTICS Statistics)
+{
+    CSR_API_MESSAGE ApiMessage;
+    PCSR_QUERY_API_STATISTICS QueryRequest = &ApiMessage.Data.QueryApiStatistics;
+    PCSR_CAPTURE_BUFFER CaptureBuffer;
+    ULONG ApiCount = ConsolepMaxApiNumber - CONSRV_FIRST_API_NUMBER;
+    NTSTATUS Status;
+
+    CaptureBuffer = CsrAllocateCaptureBuffer(1, ApiCount * sizeof(CSR_API_STATISTICS));
+    if (!CaptureBuffer)
+        return FALSE;
+
+    QueryRequest->ServerId = CONSRV_SERVERDLL_INDEX;
+    QueryRequest->ApiCount = ApiCount;
+    CsrAllocateMessagePointer(CaptureBuffer,
+                              ApiCount * sizeof(CSR_API_STATISTICS),
+                              (PVOID*)&QueryRequest->Statistics);
+
+    Status = CsrClientCallServer(&ApiMessage,
+                                 CaptureBuffer,
+                                 CSR_CREATE_API_NUMBER(CSRSRV_SERVERDLL_INDEX, CsrpQueryApiStatistics),
+                                 sizeof(*QueryRequest));
+    ok(NT_SUCCESS(Status), "CsrpQueryApiStatistics failed with 0x%lx\n", Status);
+    if (NT_SUCCESS(Status))
+    {
+        /* One entry per console API, not per API number */
+        ok(QueryRequest->ApiCount == ApiCount, "ApiCount = %lu, expected %lu\n",
+           QueryRequest->ApiCount, ApiCount);
+        *Statistics = QueryRequest->Statistics[ConsolepFillConsoleOutput - CONSRV_FIRST_API_NUMBER];
+    }
+
+    CsrFreeCaptureBuffer(CaptureBuffer);
+    return NT_SUCCESS(Status);
+}
+
+static DWORD WINAPI ConsoleLoadThread(LPVOID lpParameter)
+{
+    HANDLE hConOut = (HANDLE)lpParameter;
+    COORD Coord = { 0, 0 };
+    DWORD dwFilled;
+    ULONG cCalls = 0;
+
+    /* Filling the whole big buffer keeps a server thread busy for a while */
+    while (!StopLoad)
+    {
+        FillConsoleOutputCharacterW(hConOut, L'x',
+                                    LOAD_BUFFER_WIDTH * LOAD_BUFFER_HEIGHT,
+                                    Coord, &dwFilled);
+        cCalls++;
+    }
+
+    return cCalls;
+}
+
+static DWORD CreateProcesses(void)
+{
+    WCHAR szCommandLine[MAX_PATH + 16];
+    STARTUPINFOW si = { sizeof(si) };
+    PROCESS_INFORMATION pi;
+    DWORD dwStart, dwExitCode;
+    ULONG i, cFailures = 0;
+
+    GetSystemDirectoryW(szCommandLine, MAX_PATH);
+    StringCchCatW(szCommandLine, ARRAYSIZE(szCommandLine), L"\\cmd.exe /c exit 7");
+
+    dwStart = GetTickCount();
+    for (i = 0; i < PROCESS_COUNT; i++)
+    {
+        if (!CreateProcessW(NULL, szCommandLine, NULL, NULL, FALSE,
+                            CREATE_NO_WINDOW, NULL, NULL, &si, &pi))
+        {
+            cFailures++;
+            continue;
+        }
+
+        WaitForSingleObject(pi.hProcess, INFINITE);
+        if (!GetExitCodeProcess(pi.hProcess, &dwExitCode) || dwExitCode != 7)
+            cFailures++;
+        CloseHandle(pi.hThread);
+        CloseHandle(pi.hProcess);
+    }
+
+    ok(cFailures == 0, "%lu processes failed\n", cFailures);
+    return GetTickCount() - dwStart;
+}
+
+START_TEST(CreateProcessLoad)
+{
+    HANDLE ahThreads[LOAD_THREADS];
+    HANDLE hConOut;
+    COORD Size = { LOAD_BUFFER_WIDTH, LOAD_BUFFER_HEIGHT };
+    CSR_API_STATISTICS Before, After;
+    DWORD dwIdle, dwLoaded, dwCalls;
+    ULONG i, cThreads, cCalls = 0;
+    BOOL bStatistics;
+
+    /* A buffer of our own, big enough for the fills to be long calls */
+    hConOut = CreateConsoleScreenBuffer(GENERIC_READ | GENERIC_WRITE,
+                                        FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                        NULL, CONSOLE_TEXTMODE_BUFFER, NULL);
+    if (hConOut == INVALID_HANDLE_VALUE)
+    {
+        skip("No console\n");
+        return;
+    }
+    ok(SetConsoleScreenBufferSize(hConOut, Size), "SetConsoleScreenBufferSize failed\n");
+
+    dwIdle = CreateProcesses();
+
+    bStatistics = QueryFillStatistics(&Before);
+
+    /* Keep more threads busy with long console calls than the server may use */
+    StopLoad = FALSE;
+    for (cThreads = 0; cThreads < LOAD_THREADS; cThreads++)
+    {
+        ahThreads[cThreads] = CreateThread(NULL, 0, ConsoleLoadThread, hConOut, 0, NULL);
+        ok(ahThreads[cThreads] != NULL, "CreateThread failed\n");
+        if (!ahThreads[cThreads])
+            break;
+    }
+
+    Sleep(500);
+    dwLoaded = CreateProcesses();
+
+    InterlockedExchange(&StopLoad, TRUE);
+    WaitForMultipleObjects(cThreads, ahThreads, TRUE, INFINITE);
+    for (i = 0; i < cThreads; i++)
+    {
+        if (GetExitCodeThread(ahThreads[i], &dwCalls))
+            cCalls += dwCalls;
+        CloseHandle(ahThreads[i]);
+    }
+
+    ok(cCalls > 0, "The load threads made no console calls\n");
+    trace("%u processes in %lu ms idle, %lu ms with %lu console threads (%lu calls)\n",
+          PROCESS_COUNT, dwIdle, dwLoaded, cThreads, cCalls);
+
+    /* The server had to queue fills instead of giving them every thread */
+    if (bStatistics && QueryFillStatistics(&After))
+    {
+        ok(After.CallCount > Before.CallCount, "CallCount %lu -> %lu\n",
+           Before.CallCount, After.CallCount);
+        ok(After.QueuedCount > Before.QueuedCount, "QueuedCount %lu -> %lu\n",
+           Before.QueuedCount, After.QueuedCount);
+    }
+
+    CloseHandle(hConOut);
+}
@@ -0,0 +1,191 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Test for named pipe data transfer (ping-pong and bulk)
+ */
+
+#include "precomp.h"
+
+#define PIPE_NAME L"\\\\.\\pipe\\rostest_npfs_transfer"
+#define PING_COUNT 10000
+#define BULK_SIZE (256 * 1024)
+#define BULK_COUNT 64
+
+static
+HANDLE
+OpenServerEnd(DWORD OpenMode, DWORD BufferSize)
+{
+    return CreateNamedPipeW(PIPE_NAME,
+                            PIPE_ACCESS_DUPLEX | OpenMode,
+                            PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT,
+                            1,
+                            BufferSize,
+                            BufferSize,
+                            0,
+                            NULL);
+}
+
+static
+HANDLE
+OpenClientEnd(void)
+{
+    HANDLE hClient;
+    DWORD Mode = PIPE_READMODE_MESSAGE;
+
+    hClient = CreateFileW(PIPE_NAME,
+                          GENERIC_READ | GENERIC_WRITE,
+                          0,
+                          NULL,
+                          OPEN_EXISTING,
+                          0,
+                          NULL);
+    if (hClient != INVALID_HANDLE_VALUE)
+        SetNamedPipeHandleState(hClient, &Mode, NULL, NULL);
+    return hClient;
+}
+
+static
+DWORD
+WINAPI
+PingPongEcho(LPVOID Param)
+{
+    HANDLE hClient = (HANDLE)Param;
+    ULONG Value;
+    DWORD Transferred;
+
+    while (ReadFile(hClient, &Value, sizeof(Value), &Transferred, NULL))
+    {
+        if (!WriteFile(hClient, &Value, sizeof(Value), &Transferred, NULL))
+            break;
+    }
+    return 0;
+}
+
+static
+void
+TestPingPong(void)
+{
+    HANDLE hServer, hClient, hThread;
+    ULONG i, Value, Mismatches = 0;
+    DWORD Transferred, Start, Elapsed;
+
+    hServer = OpenServerEnd(0, 4096);
+    ok(hServer != INVALID_HANDLE_VALUE, "CreateNamedPipeW failed: %lu\n", GetLastError());
+    if (hServer == INVALID_HANDLE_VALUE)
+        return;
+
+    hClient = OpenClientEnd();
+    ok(hClient != INVALID_HANDLE_VALUE, "CreateFileW failed: %lu\n", GetLastError());
+    if (hClient == INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(hServer);
+        return;
+    }
+
+    hThread = CreateThread(NULL, 0, PingPongEcho, hClient, 0, NULL);
+    ok(hThread != NULL, "CreateThread failed: %lu\n", GetLastError());
+
+    Start = GetTickCount();
+    for (i = 0; hThread && i < PING_COUNT; i++)
+    {
+        if (!WriteFile(hServer, &i, sizeof(i), &Transferred, NULL) ||
+            !ReadFile(hServer, &Value, sizeof(Value), &Transferred, NULL))
+        {
+            ok(0, "Transfer %lu failed: %lu\n", i, GetLastError());
+            break;
+        }
+        if (Value != i)
+            Mismatches++;
+    }
+    Elapsed = GetTickCount() - Start;
+
+    ok(Mismatches == 0, "Got %lu mismatching replies\n", Mismatches);
+    trace("%lu round trips in %lu ms\n", i, Elapsed);
+
+    /* Closing the server end breaks the echo loop */
+    CloseHandle(hServer);
+    if (hThread)
+    {
+        WaitForSingleObject(hThread, INFINITE);
+        CloseHandle(hThread);
+    }
+    CloseHandle(hClient);
+}
+
+static
+void
+TestBulk(void)
+{
+    HANDLE hServer, hClient;
+    OVERLAPPED Overlapped = { 0 };
+    PUCHAR SendBuffer, RecvBuffer;
+    ULONG i, j, Mismatches = 0;
+    DWORD Transferred, Start, Elapsed;
+    BOOL Ret;
+
+    SendBuffer = HeapAlloc(GetProcessHeap(), 0, BULK_SIZE);
+    RecvBuffer = HeapAlloc(GetProcessHeap(), 0, BULK_SIZE);
+    if (!SendBuffer || !RecvBuffer)
+    {
+        skip("Out of memory\n");
+        goto Cleanup;
+    }
+
+    hServer = OpenServerEnd(FILE_FLAG_OVERLAPPED, BULK_SIZE);
+    ok(hServer != INVALID_HANDLE_VALUE, "CreateNamedPipeW failed: %lu\n", GetLastError());
+    if (hServer == INVALID_HANDLE_VALUE)
+        goto Cleanup;
+
+    hClient = OpenClientEnd();
+    ok(hClient != INVALID_HANDLE_VALUE, "CreateFileW failed: %lu\n", GetLastError());
+    if (hClient == INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(hServer);
+        goto Cleanup;
+    }
+
+    Overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+
+    Start = GetTickCount();
+    for (i = 0; i < BULK_COUNT; i++)
+    {
+        for (j = 0; j < BULK_SIZE; j++)
+            SendBuffer[j] = (UCHAR)(i + j);
+
+        /* Post the read first so the write finds a waiting reader */
+        ResetEvent(Overlapped.hEvent);
+        Ret = ReadFile(hServer, RecvBuffer, BULK_SIZE, NULL, &Overlapped);
+        ok(Ret || GetLastError() == ERROR_IO_PENDING, "ReadFile failed: %lu\n", GetLastError());
+
+        Ret = WriteFile(hClient, SendBuffer, BULK_SIZE, &Transferred, NULL);
+        ok(Ret, "WriteFile failed: %lu\n", GetLastError());
+        ok(Transferred == BULK_SIZE, "Wrote %lu bytes\n", Transferred);
+
+        Ret = GetOverlappedResult(hServer, &Overlapped, &Transferred, TRUE);
+        ok(Ret, "GetOverlappedResult failed: %lu\n", GetLastError());
+        ok(Transferred == BULK_SIZE, "Read %lu bytes\n", Transferred);
+        if (!Ret)
+            break;
+
+        if (memcmp(SendBuffer, RecvBuffer, BULK_SIZE))
+            Mismatches++;
+    }
+    Elapsed = GetTickCount() - Start;
+
+    ok(Mismatches == 0, "Got %lu corrupted messages\n", Mismatches);
+    trace("%lu messages of %u bytes in %lu ms\n", i, BULK_SIZE, Elapsed);
+
+    CloseHandle(Overlapped.hEvent);
+    CloseHandle(hClient);
+    CloseHandle(hServer);
+
+Cleanup:
+    if (SendBuffer) HeapFree(GetProcessHeap(), 0, SendBuffer);
+    if (RecvBuffer) HeapFree(GetProcessHeap(), 0, RecvBuffer);
+}
+
+START_TEST(NamedPipe)
+{
+    TestPingPong();
+    TestBulk();
+}
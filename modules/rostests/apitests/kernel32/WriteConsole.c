@@ -0,0 +1,213 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Test for many small WriteConsole calls and their ordering
+ */
+
+#include "precomp.h"
+
+#define BUFFER_WIDTH 80
+#define BUFFER_HEIGHT 50
+#define LINE_COUNT 20000
+#define CHILD_LINE_COUNT 5
+
+static void Test_Ordering(HANDLE hConOut)
+{
+    static const WORD awAttributes[] = { FOREGROUND_RED, FOREGROUND_GREEN, FOREGROUND_BLUE };
+    CONSOLE_SCREEN_BUFFER_INFO csbi;
+    WCHAR szLine[BUFFER_WIDTH + 1], szRead[BUFFER_WIDTH];
+    WORD awRead[4];
+    COORD Coord = { 0, 0 };
+    DWORD dwWritten, dwRead;
+    ULONG i;
+
+    ok(SetConsoleCursorPosition(hConOut, Coord), "SetConsoleCursorPosition failed\n");
+
+    /* Each line is written with its own attribute, in three pieces */
+    for (i = 0; i < ARRAYSIZE(awAttributes); i++)
+    {
+        ok(SetConsoleTextAttribute(hConOut, awAttributes[i]), "SetConsoleTextAttribute failed\n");
+        StringCchPrintfW(szLine, ARRAYSIZE(szLine), L"Line %lu", i);
+        ok(WriteConsoleW(hConOut, szLine, 4, &dwWritten, NULL), "WriteConsoleW failed\n");
+        ok_long(dwWritten, 4);
+        ok(WriteConsoleW(hConOut, szLine + 4, (DWORD)wcslen(szLine + 4), &dwWritten, NULL),
+           "WriteConsoleW failed\n");
+        ok(WriteConsoleW(hConOut, L"\n", 1, &dwWritten, NULL), "WriteConsoleW failed\n");
+    }
+
+    /* Everything written above must be seen by the next calls */
+    ok(GetConsoleScreenBufferInfo(hConOut, &csbi), "GetConsoleScreenBufferInfo failed\n");
+    ok_int(csbi.dwCursorPosition.X, 0);
+    ok_int(csbi.dwCursorPosition.Y, ARRAYSIZE(awAttributes));
+
+    for (i = 0; i < ARRAYSIZE(awAttributes); i++)
+    {
+        Coord.Y = (SHORT)i;
+        StringCchPrintfW(szLine, ARRAYSIZE(szLine), L"Line %lu", i);
+        ok(ReadConsoleOutputCharacterW(hConOut, szRead, (DWORD)wcslen(szLine), Coord, &dwRead),
+           "ReadConsoleOutputCharacterW failed\n");
+        ok(dwRead == wcslen(szLine) && !memcmp(szRead, szLine, dwRead * sizeof(WCHAR)),
+           "Line %lu: got '%.*S'\n", i, (int)dwRead, szRead);
+        ok(ReadConsoleOutputAttribute(hConOut, awRead, ARRAYSIZE(awRead), Coord, &dwRead),
+           "ReadConsoleOutputAttribute failed\n");
+        ok(awRead[0] == awAttributes[i] && awRead[3] == awAttributes[i],
+           "Line %lu: got attributes 0x%x, 0x%x\n", i, awRead[0], awRead[3]);
+    }
+}
+
+static void Test_ManyWrites(HANDLE hConOut)
+{
+    CONSOLE_SCREEN_BUFFER_INFO csbi;
+    CHAR szLine[BUFFER_WIDTH + 1];
+    WCHAR szRead[BUFFER_WIDTH];
+    COORD Coord = { 0, 0 };
+    DWORD dwStart, dwElapsed, dwWritten, dwRead;
+    ULONG i, cFailures = 0;
+    INT cch;
+
+    ok(SetConsoleCursorPosition(hConOut, Coord), "SetConsoleCursorPosition failed\n");
+
+    /* Like the output of a build: many short lines */
+    dwStart = GetTickCount();
+    for (i = 0; i < LINE_COUNT; i++)
+    {
+        cch = sprintf(szLine, "Compiling file%05lu.c\n", i);
+        if (!WriteConsoleA(hConOut, szLine, cch, &dwWritten, NULL) || dwWritten != (DWORD)cch)
+            cFailures++;
+    }
+    ok(GetConsoleScreenBufferInfo(hConOut, &csbi), "GetConsoleScreenBufferInfo failed\n");
+    dwElapsed = GetTickCount() - dwStart;
+
+    ok(cFailures == 0, "%lu WriteConsoleA calls failed\n", cFailures);
+    trace("%u lines in %lu ms\n", LINE_COUNT, dwElapsed);
+
+    /* The last line written is right above the cursor */
+    ok_int(csbi.dwCursorPosition.X, 0);
+    ok_int(csbi.dwCursorPosition.Y, BUFFER_HEIGHT - 1);
+    Coord.Y = csbi.dwCursorPosition.Y - 1;
+    cch = sprintf(szLine, "Compiling file%05lu.c", LINE_COUNT - 1);
+    ok(ReadConsoleOutputCharacterW(hConOut, szRead, cch, Coord, &dwRead),
+       "ReadConsoleOutputCharacterW failed\n");
+    ok_long(dwRead, cch);
+    for (i = 0; i < dwRead; i++)
+    {
+        if (szRead[i] != (WCHAR)szLine[i])
+            break;
+    }
+    ok(i == dwRead, "Got '%.*S', expected '%s'\n", (int)dwRead, szRead, szLine);
+}
+
+static void Child_Write(HANDLE hConOut)
+{
+    CHAR szLine[BUFFER_WIDTH + 1];
+    DWORD dwWritten;
+    ULONG i;
+    INT cch;
+
+    for (i = 0; i < CHILD_LINE_COUNT; i++)
+    {
+        cch = sprintf(szLine, "Child %lu\n", i);
+        WriteConsoleA(hConOut, szLine, cch, &dwWritten, NULL);
+    }
+}
+
+static void Test_ParentChild(HANDLE hConOut)
+{
+    WCHAR szFileName[MAX_PATH], szCommandLine[MAX_PATH + 64];
+    CHAR szLine[BUFFER_WIDTH + 1];
+    WCHAR szRead[BUFFER_WIDTH];
+    STARTUPINFOW StartupInfo;
+    PROCESS_INFORMATION ProcessInfo;
+    CONSOLE_SCREEN_BUFFER_INFO csbi;
+    COORD Coord = { 0, 0 };
+    DWORD dwWritten, dwRead, dwWait;
+    ULONG i, j;
+    INT cch;
+
+    ok(SetConsoleCursorPosition(hConOut, Coord), "SetConsoleCursorPosition failed\n");
+
+    /* The second write of the handle goes through the output ring */
+    ok(WriteConsoleA(hConOut, "Parent ", 7, &dwWritten, NULL), "WriteConsoleA failed\n");
+    ok(WriteConsoleA(hConOut, "before\n", 7, &dwWritten, NULL), "WriteConsoleA failed\n");
+
+    /* The child writes to the same screen buffer of the same console */
+    GetModuleFileNameW(NULL, szFileName, ARRAYSIZE(szFileName));
+    StringCchPrintfW(szCommandLine, ARRAYSIZE(szCommandLine),
+                     L"\"%ls\" WriteConsole child %p", szFileName, hConOut);
+    ZeroMemory(&StartupInfo, sizeof(StartupInfo));
+    StartupInfo.cb = sizeof(StartupInfo);
+    if (!CreateProcessW(szFileName, szCommandLine, NULL, NULL, TRUE, 0,
+                        NULL, NULL, &StartupInfo, &ProcessInfo))
+    {
+        skip("CreateProcess failed with %lu\n", GetLastError());
+        return;
+    }
+    CloseHandle(ProcessInfo.hThread);
+    dwWait = WaitForSingleObject(ProcessInfo.hProcess, 30000);
+    ok(dwWait == WAIT_OBJECT_0, "WaitForSingleObject returned %lu\n", dwWait);
+    CloseHandle(ProcessInfo.hProcess);
+
+    /* Like the next prompt of a shell, after the child exited */
+    ok(WriteConsoleA(hConOut, "Parent after\n", 13, &dwWritten, NULL), "WriteConsoleA failed\n");
+
+    ok(GetConsoleScreenBufferInfo(hConOut, &csbi), "GetConsoleScreenBufferInfo failed\n");
+    ok_int(csbi.dwCursorPosition.X, 0);
+    ok_int(csbi.dwCursorPosition.Y, CHILD_LINE_COUNT + 2);
+
+    for (i = 0; i < CHILD_LINE_COUNT + 2; i++)
+    {
+        if (i == 0)
+            cch = sprintf(szLine, "Parent before");
+        else if (i <= CHILD_LINE_COUNT)
+            cch = sprintf(szLine, "Child %lu", i - 1);
+        else
+            cch = sprintf(szLine, "Parent after");
+
+        Coord.Y = (SHORT)i;
+        ok(ReadConsoleOutputCharacterW(hConOut, szRead, cch, Coord, &dwRead),
+           "ReadConsoleOutputCharacterW failed\n");
+        for (j = 0; j < dwRead; j++)
+        {
+            if (szRead[j] != (WCHAR)szLine[j])
+                break;
+        }
+        ok(dwRead == (DWORD)cch && j == dwRead,
+           "Line %lu: got '%.*S', expected '%s'\n", i, (int)dwRead, szRead, szLine);
+    }
+}
+
+START_TEST(WriteConsole)
+{
+    HANDLE hConOut;
+    COORD Size = { BUFFER_WIDTH, BUFFER_HEIGHT };
+    SECURITY_ATTRIBUTES Inheritable = { sizeof(Inheritable), NULL, TRUE };
+    char **argv;
+    int argc;
+
+    argc = winetest_get_mainargs(&argv);
+    if (argc >= 4 && !strcmp(argv[2], "child"))
+    {
+        /* Started by Test_ParentChild */
+        if (sscanf(argv[3], "%p", &hConOut) == 1)
+            Child_Write(hConOut);
+        return;
+    }
+
+    /* Use our own screen buffer, the output of the tests stays readable */
+    hConOut = CreateConsoleScreenBuffer(GENERIC_READ | GENERIC_WRITE,
+                                        FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                        &Inheritable, CONSOLE_TEXTMODE_BUFFER, NULL);
+    if (hConOut == INVALID_HANDLE_VALUE)
+    {
+        skip("No console available\n");
+        return;
+    }
+
+    ok(SetConsoleScreenBufferSize(hConOut, Size), "SetConsoleScreenBufferSize failed\n");
+
+    Test_Ordering(hConOut);
+    Test_ManyWrites(hConOut);
+    Test_ParentChild(hConOut);
+
+    CloseHandle(hConOut);
+}
@@ -0,0 +1,369 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Test for batched completion port dequeue and skip-on-success
+ */
+
+#include "precomp.h"
+
+#define PACKET_COUNT 20000
+#define BATCH_SIZE 16
+
+/* Not in the headers we build against */
+#if (NTDDI_VERSION < NTDDI_VISTA)
+#define FileIoCompletionNotificationInformation \
+    ((FILE_INFORMATION_CLASS)FileMaximumInformation)
+#endif
+#ifndef FILE_SKIP_COMPLETION_PORT_ON_SUCCESS
+#define FILE_SKIP_COMPLETION_PORT_ON_SUCCESS 0x1
+#define FILE_SKIP_SET_EVENT_ON_HANDLE        0x2
+#endif
+
+static NTSTATUS (NTAPI *pNtRemoveIoCompletionEx)(HANDLE, PFILE_IO_COMPLETION_INFORMATION, ULONG, PULONG, PLARGE_INTEGER, BOOLEAN);
+static ULONG ApcCount;
+
+static
+VOID
+NTAPI
+UserApc(
+    _In_ PVOID NormalContext,
+    _In_ PVOID SystemArgument1,
+    _In_ PVOID SystemArgument2)
+{
+    ApcCount++;
+}
+
+static
+VOID
+Test_Batch(
+    _In_ HANDLE PortHandle)
+{
+    FILE_IO_COMPLETION_INFORMATION Info[BATCH_SIZE];
+    LARGE_INTEGER Timeout;
+    NTSTATUS Status;
+    ULONG i, Count;
+
+    Timeout.QuadPart = 0;
+
+    /* No room for anything */
+    Count = 0x55555555;
+    Status = pNtRemoveIoCompletionEx(PortHandle, Info, 0, &Count, &Timeout, FALSE);
+    ok_hex(Status, STATUS_INVALID_PARAMETER_3);
+    ok_dec(Count, 0x55555555);
+
+    /* Nothing queued */
+    Status = pNtRemoveIoCompletionEx(PortHandle, Info, BATCH_SIZE, &Count, &Timeout, FALSE);
+    ok_hex(Status, STATUS_TIMEOUT);
+
+    for (i = 0; i < 5; i++)
+    {
+        Status = NtSetIoCompletion(PortHandle,
+                                   (PVOID)(ULONG_PTR)(0x100 + i),
+                                   (PVOID)(ULONG_PTR)(0x200 + i),
+                                   i ? STATUS_SUCCESS : STATUS_END_OF_FILE,
+                                   0x300 + i);
+        ok_hex(Status, STATUS_SUCCESS);
+    }
+
+    /* Entries come back in order, no more than asked for */
+    RtlFillMemory(Info, sizeof(Info), 0x55);
+    Status = pNtRemoveIoCompletionEx(PortHandle, Info, 3, &Count, &Timeout, FALSE);
+    ok_hex(Status, STATUS_SUCCESS);
+    ok_dec(Count, 3);
+    for (i = 0; i < 3; i++)
+    {
+        ok_ptr(Info[i].KeyContext, (PVOID)(ULONG_PTR)(0x100 + i));
+        ok_ptr(Info[i].ApcContext, (PVOID)(ULONG_PTR)(0x200 + i));
+        ok_hex(Info[i].IoStatusBlock.Status, i ? STATUS_SUCCESS : STATUS_END_OF_FILE);
+        ok_size_t(Info[i].IoStatusBlock.Information, 0x300 + i);
+    }
+    ok_ptr(Info[3].KeyContext, (PVOID)(ULONG_PTR)0x5555555555555555ULL);
+
+    /* The rest, without waiting for more */
+    Status = pNtRemoveIoCompletionEx(PortHandle, Info, BATCH_SIZE, &Count, &Timeout, FALSE);
+    ok_hex(Status, STATUS_SUCCESS);
+    ok_dec(Count, 2);
+    ok_ptr(Info[0].KeyContext, (PVOID)0x103);
+    ok_ptr(Info[1].KeyContext, (PVOID)0x104);
+
+    Status = pNtRemoveIoCompletionEx(PortHandle, Info, BATCH_SIZE, &Count, &Timeout, FALSE);
+    ok_hex(Status, STATUS_TIMEOUT);
+
+    /* An alertable wait runs user APCs */
+    ApcCount = 0;
+    Status = NtQueueApcThread(NtCurrentThread(), UserApc, NULL, NULL, NULL);
+    ok_hex(Status, STATUS_SUCCESS);
+    Timeout.QuadPart = -10 * 1000 * 1000;
+    Status = pNtRemoveIoCompletionEx(PortHandle, Info, BATCH_SIZE, &Count, &Timeout, TRUE);
+    ok_hex(Status, STATUS_USER_APC);
+    ok_dec(ApcCount, 1);
+}
+
+static
+VOID
+Test_SkipOnSuccess(
+    _In_ HANDLE PortHandle)
+{
+    WCHAR FileName[MAX_PATH];
+    UNICODE_STRING NtFileName;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    IO_STATUS_BLOCK IoStatus, ReadIoStatus;
+    FILE_COMPLETION_INFORMATION CompletionInfo;
+    LARGE_INTEGER Offset, Timeout;
+    HANDLE FileHandle;
+    PVOID Key, Apc;
+    UCHAR Buffer[64];
+    ULONG Flags;
+    NTSTATUS Status;
+
+    GetModuleFileNameW(NULL, FileName, RTL_NUMBER_OF(FileName));
+    if (!RtlDosPathNameToNtPathName_U(FileName, &NtFileName, NULL, NULL))
+    {
+        skip("Failed to convert %ls\n", FileName);
+        return;
+    }
+
+    /* Asynchronous handle, like FILE_FLAG_OVERLAPPED */
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &NtFileName,
+                               OBJ_CASE_INSENSITIVE,
+                               NULL,
+                               NULL);
+    Status = NtOpenFile(&FileHandle,
+                        FILE_READ_DATA,
+                        &ObjectAttributes,
+                        &IoStatus,
+                        FILE_SHARE_READ | FILE_SHARE_DELETE,
+                        FILE_NON_DIRECTORY_FILE);
+    RtlFreeUnicodeString(&NtFileName);
+    ok_hex(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+        return;
+
+    CompletionInfo.Port = PortHandle;
+    CompletionInfo.Key = (PVOID)0x1234;
+    Status = NtSetInformationFile(FileHandle,
+                                  &IoStatus,
+                                  &CompletionInfo,
+                                  sizeof(CompletionInfo),
+                                  FileCompletionInformation);
+    ok_hex(Status, STATUS_SUCCESS);
+
+    /* Unknown modes are refused */
+    Flags = 0x80;
+    Status = NtSetInformationFile(FileHandle,
+                                  &IoStatus,
+                                  &Flags,
+                                  sizeof(Flags),
+                                  FileIoCompletionNotificationInformation);
+    ok_hex(Status, STATUS_INVALID_PARAMETER);
+
+    Status = NtSetInformationFile(FileHandle,
+                                  &IoStatus,
+                                  &Flags,
+                                  sizeof(UCHAR),
+                                  FileIoCompletionNotificationInformation);
+    ok_hex(Status, STATUS_INFO_LENGTH_MISMATCH);
+
+    /* By default, even reads that complete right away get a packet */
+    Offset.QuadPart = 0;
+    Timeout.QuadPart = -10 * 1000 * 1000;
+    Status = NtReadFile(FileHandle, NULL, NULL, &ReadIoStatus, &ReadIoStatus,
+                        Buffer, sizeof(Buffer), &Offset, NULL);
+    ok(Status == STATUS_SUCCESS || Status == STATUS_PENDING, "Status = 0x%lx\n", Status);
+    Status = NtRemoveIoCompletion(PortHandle, &Key, &Apc, &IoStatus, &Timeout);
+    ok_hex(Status, STATUS_SUCCESS);
+    ok_ptr(Key, (PVOID)0x1234);
+    ok_ptr(Apc, &ReadIoStatus);
+    ok_hex(IoStatus.Status, STATUS_SUCCESS);
+    ok_size_t(IoStatus.Information, sizeof(Buffer));
+
+    Flags = FILE_SKIP_COMPLETION_PORT_ON_SUCCESS;
+    Status = NtSetInformationFile(FileHandle,
+                                  &IoStatus,
+                                  &Flags,
+                                  sizeof(Flags),
+                                  FileIoCompletionNotificationInformation);
+    ok_hex(Status, STATUS_SUCCESS);
+
+    /* Now only the ones that pend do */
+    Status = NtReadFile(FileHandle, NULL, NULL, &ReadIoStatus, &ReadIoStatus,
+                        Buffer, sizeof(Buffer), &Offset, NULL);
+    ok(Status == STATUS_SUCCESS || Status == STATUS_PENDING, "Status = 0x%lx\n", Status);
+    if (Status == STATUS_SUCCESS)
+    {
+        ok_hex(ReadIoStatus.Status, STATUS_SUCCESS);
+        ok_size_t(ReadIoStatus.Information, sizeof(Buffer));
+        Timeout.QuadPart = 0;
+    }
+    Status = NtRemoveIoCompletion(PortHandle, &Key, &Apc, &IoStatus, &Timeout);
+    ok_hex(Status, Timeout.QuadPart ? STATUS_SUCCESS : STATUS_TIMEOUT);
+
+    NtClose(FileHandle);
+}
+
+static
+DWORD
+WINAPI
+PipeReadThread(
+    _In_ LPVOID Parameter)
+{
+    CHAR Buffer[16];
+    DWORD dwRead = 0;
+
+    /* Synchronous handle: the I/O manager waits on the file object event */
+    if (!ReadFile((HANDLE)Parameter, Buffer, sizeof(Buffer), &dwRead, NULL))
+        return 0;
+
+    return dwRead;
+}
+
+static
+VOID
+Test_SkipSetEventSynchronous(VOID)
+{
+    WCHAR PipeName[64];
+    HANDLE ServerHandle, ClientHandle, ThreadHandle;
+    IO_STATUS_BLOCK IoStatus;
+    DWORD dwWritten, dwWait, dwRead;
+    ULONG Flags;
+    NTSTATUS Status;
+
+    StringCchPrintfW(PipeName, RTL_NUMBER_OF(PipeName),
+                     L"\\\\.\\pipe\\NtRemoveIoCompletionEx_%lu",
+                     GetCurrentProcessId());
+    ServerHandle = CreateNamedPipeW(PipeName,
+                                    PIPE_ACCESS_OUTBOUND,
+                                    PIPE_TYPE_BYTE | PIPE_WAIT,
+                                    1,
+                                    64,
+                                    64,
+                                    0,
+                                    NULL);
+    ok(ServerHandle != INVALID_HANDLE_VALUE, "CreateNamedPipeW failed with %lu\n", GetLastError());
+    if (ServerHandle == INVALID_HANDLE_VALUE)
+        return;
+
+    ClientHandle = CreateFileW(PipeName, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, NULL);
+    ok(ClientHandle != INVALID_HANDLE_VALUE, "CreateFileW failed with %lu\n", GetLastError());
+    if (ClientHandle == INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(ServerHandle);
+        return;
+    }
+
+    /* Allowed, but synchronous I/O still gets its event */
+    Flags = FILE_SKIP_SET_EVENT_ON_HANDLE;
+    Status = NtSetInformationFile(ClientHandle,
+                                  &IoStatus,
+                                  &Flags,
+                                  sizeof(Flags),
+                                  FileIoCompletionNotificationInformation);
+    ok_hex(Status, STATUS_SUCCESS);
+
+    /* Nothing was written yet, so the read pends */
+    ThreadHandle = CreateThread(NULL, 0, PipeReadThread, ClientHandle, 0, NULL);
+    ok(ThreadHandle != NULL, "CreateThread failed with %lu\n", GetLastError());
+    if (ThreadHandle)
+    {
+        Sleep(100);
+        ok(WriteFile(ServerHandle, "pending", 7, &dwWritten, NULL),
+           "WriteFile failed with %lu\n", GetLastError());
+
+        dwWait = WaitForSingleObject(ThreadHandle, 5000);
+        ok(dwWait == WAIT_OBJECT_0, "The pending read never completed\n");
+        if (dwWait == WAIT_OBJECT_0)
+        {
+            ok(GetExitCodeThread(ThreadHandle, &dwRead), "GetExitCodeThread failed\n");
+            ok_dec(dwRead, 7);
+        }
+        CloseHandle(ThreadHandle);
+    }
+
+    CloseHandle(ClientHandle);
+    CloseHandle(ServerHandle);
+}
+
+static
+DWORD
+Drain(
+    _In_ HANDLE PortHandle,
+    _In_ ULONG BatchSize)
+{
+    FILE_IO_COMPLETION_INFORMATION Info[BATCH_SIZE];
+    LARGE_INTEGER Timeout;
+    NTSTATUS Status;
+    DWORD dwStart;
+    ULONG i, Count, Removed = 0, Calls = 0;
+
+    /* Queue everything up front, like a burst of completed I/O */
+    for (i = 0; i < PACKET_COUNT; i++)
+    {
+        Status = NtSetIoCompletion(PortHandle, NULL, (PVOID)(ULONG_PTR)i, STATUS_SUCCESS, 0);
+        if (!NT_SUCCESS(Status))
+            break;
+    }
+    ok(i == PACKET_COUNT, "Queued only %lu packets\n", i);
+
+    Timeout.QuadPart = 0;
+    dwStart = GetTickCount();
+    for (;;)
+    {
+        if (BatchSize == 1)
+        {
+            Status = NtRemoveIoCompletion(PortHandle,
+                                          &Info[0].KeyContext,
+                                          &Info[0].ApcContext,
+                                          &Info[0].IoStatusBlock,
+                                          &Timeout);
+            Count = 1;
+        }
+        else
+        {
+            Status = pNtRemoveIoCompletionEx(PortHandle, Info, BatchSize, &Count, &Timeout, FALSE);
+        }
+        if (Status != STATUS_SUCCESS)
+            break;
+
+        Removed += Count;
+        Calls++;
+    }
+
+    ok_hex(Status, STATUS_TIMEOUT);
+    ok(Removed == i, "Removed %lu packets out of %lu\n", Removed, i);
+    trace("Batches of %lu: %lu packets in %lu calls, %lu ms\n",
+          BatchSize, Removed, Calls, GetTickCount() - dwStart);
+    return Calls;
+}
+
+START_TEST(NtRemoveIoCompletionEx)
+{
+    HANDLE PortHandle;
+    NTSTATUS Status;
+
+    Status = NtCreateIoCompletion(&PortHandle, IO_COMPLETION_ALL_ACCESS, NULL, 0);
+    ok_hex(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+    {
+        skip("Failed to create completion port\n");
+        return;
+    }
+
+    /* Only exported for 0x600 and later */
+    pNtRemoveIoCompletionEx = (PVOID)GetProcAddress(GetModuleHandleW(L"ntdll.dll"),
+                                                    "NtRemoveIoCompletionEx");
+    if (!skip(pNtRemoveIoCompletionEx != NULL, "NtRemoveIoCompletionEx is not exported\n"))
+    {
+        Test_Batch(PortHandle);
+
+        /* A batch takes the dispatcher lock and crosses into the kernel once */
+        Drain(PortHandle, 1);
+        ok(Drain(PortHandle, BATCH_SIZE) <= PACKET_COUNT / BATCH_SIZE + 1,
+           "Batches were not filled\n");
+    }
+
+    Test_SkipOnSuccess(PortHandle);
+    Test_SkipSetEventSynchronous();
+
+    NtClose(PortHandle);
+}
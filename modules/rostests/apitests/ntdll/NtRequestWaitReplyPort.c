@@ -0,0 +1,266 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     LPC ping-pong test for NtRequestWaitReplyPort round trips
+ */
+
+#include "precomp.h"
+
+#include <process.h>
+
+#define SERVER_THREADS 4
+#define MAX_CLIENTS 4
+#define ROUND_TRIPS 20000
+#define PING_QUIT 0xdead0000
+
+typedef struct _PING_MESSAGE
+{
+    PORT_MESSAGE Header;
+    ULONG Value;
+} PING_MESSAGE, *PPING_MESSAGE;
+
+static UNICODE_STRING PortName = RTL_CONSTANT_STRING(L"\\NtdllApitestNtRequestWaitReplyPortTestPort");
+static HANDLE AcceptedPorts[MAX_CLIENTS * 4];
+static LONG AcceptedPortCount;
+
+static
+UINT
+CALLBACK
+ServerThread(
+    _Inout_ PVOID Parameter)
+{
+    NTSTATUS Status;
+    PING_MESSAGE Message;
+    PPORT_MESSAGE ReplyMessage = NULL;
+    HANDLE PortHandle;
+    HANDLE ServerPortHandle = Parameter;
+    LONG Index;
+
+    for (;;)
+    {
+        /* Reply to the last request and wait for the next one at once */
+        Status = NtReplyWaitReceivePort(ServerPortHandle,
+                                        NULL,
+                                        ReplyMessage,
+                                        &Message.Header);
+        ReplyMessage = NULL;
+        if (!NT_SUCCESS(Status))
+        {
+            ok_hex(Status, STATUS_SUCCESS);
+            break;
+        }
+
+        switch (Message.Header.u2.s2.Type)
+        {
+            case LPC_CONNECTION_REQUEST:
+                Status = NtAcceptConnectPort(&PortHandle,
+                                             NULL,
+                                             &Message.Header,
+                                             TRUE,
+                                             NULL,
+                                             NULL);
+                ok_hex(Status, STATUS_SUCCESS);
+                if (!NT_SUCCESS(Status))
+                    break;
+
+                Status = NtCompleteConnectPort(PortHandle);
+                ok_hex(Status, STATUS_SUCCESS);
+
+                /* Keep it to close it at the end */
+                Index = InterlockedIncrement(&AcceptedPortCount) - 1;
+                if (Index < (LONG)RTL_NUMBER_OF(AcceptedPorts))
+                    AcceptedPorts[Index] = PortHandle;
+                else
+                    NtClose(PortHandle);
+                break;
+
+            case LPC_REQUEST:
+                /* Send the value back, plus one */
+                Message.Value++;
+                ReplyMessage = &Message.Header;
+                break;
+
+            case LPC_DATAGRAM:
+                if (Message.Value == PING_QUIT)
+                    return 0;
+                break;
+
+            default:
+                /* Closed ports and dead clients */
+                break;
+        }
+    }
+
+    return 0;
+}
+
+static
+NTSTATUS
+ConnectToServer(
+    _Out_ PHANDLE PortHandle)
+{
+    SECURITY_QUALITY_OF_SERVICE SecurityQos;
+
+    SecurityQos.Length = sizeof(SecurityQos);
+    SecurityQos.ImpersonationLevel = SecurityIdentification;
+    SecurityQos.EffectiveOnly = TRUE;
+    SecurityQos.ContextTrackingMode = SECURITY_STATIC_TRACKING;
+
+    return NtConnectPort(PortHandle,
+                         &PortName,
+                         &SecurityQos,
+                         NULL,
+                         NULL,
+                         NULL,
+                         NULL,
+                         NULL);
+}
+
+static
+UINT
+CALLBACK
+ClientThread(
+    _Inout_ PVOID Parameter)
+{
+    NTSTATUS Status;
+    HANDLE PortHandle;
+    PING_MESSAGE Message;
+    ULONG i, cErrors = 0;
+
+    Status = ConnectToServer(&PortHandle);
+    ok_hex(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+        return ROUND_TRIPS;
+
+    for (i = 0; i < ROUND_TRIPS; i++)
+    {
+        RtlZeroMemory(&Message, sizeof(Message));
+        Message.Header.u1.s1.TotalLength = sizeof(Message);
+        Message.Header.u1.s1.DataLength = sizeof(Message.Value);
+        Message.Value = i;
+        Status = NtRequestWaitReplyPort(PortHandle,
+                                        &Message.Header,
+                                        &Message.Header);
+        if (!NT_SUCCESS(Status) ||
+            Message.Header.u2.s2.Type != LPC_REPLY ||
+            Message.Value != i + 1)
+        {
+            cErrors++;
+        }
+    }
+
+    NtClose(PortHandle);
+    return cErrors;
+}
+
+static
+VOID
+Test_PingPong(
+    _In_ ULONG cClients)
+{
+    HANDLE ThreadHandles[MAX_CLIENTS];
+    DWORD dwStart, dwElapsed, dwErrors;
+    ULONG i, cErrors = 0;
+
+    dwStart = GetTickCount();
+    for (i = 0; i < cClients; i++)
+    {
+        ThreadHandles[i] = (HANDLE)_beginthreadex(NULL,
+                                                  0,
+                                                  ClientThread,
+                                                  NULL,
+                                                  0,
+                                                  NULL);
+        ok(ThreadHandles[i] != NULL, "_beginthreadex failed\n");
+        if (!ThreadHandles[i])
+        {
+            cClients = i;
+            break;
+        }
+    }
+
+    WaitForMultipleObjects(cClients, ThreadHandles, TRUE, INFINITE);
+    dwElapsed = GetTickCount() - dwStart;
+
+    for (i = 0; i < cClients; i++)
+    {
+        if (GetExitCodeThread(ThreadHandles[i], &dwErrors))
+            cErrors += dwErrors;
+        CloseHandle(ThreadHandles[i]);
+    }
+
+    ok(cErrors == 0, "%lu clients: got %lu failed round trips\n", cClients, cErrors);
+    trace("%lu clients: %lu round trips in %lu ms\n",
+          cClients, cClients * ROUND_TRIPS, dwElapsed);
+}
+
+START_TEST(NtRequestWaitReplyPort)
+{
+    NTSTATUS Status;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    HANDLE PortHandle, ClientPortHandle;
+    HANDLE ServerThreads[SERVER_THREADS];
+    PING_MESSAGE Message;
+    ULONG i, cServers, cClients;
+
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &PortName,
+                               OBJ_CASE_INSENSITIVE,
+                               NULL,
+                               NULL);
+    Status = NtCreatePort(&PortHandle,
+                          &ObjectAttributes,
+                          0,
+                          sizeof(PING_MESSAGE),
+                          0);
+    ok_hex(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+    {
+        skip("Failed to create port\n");
+        return;
+    }
+
+    for (cServers = 0; cServers < SERVER_THREADS; cServers++)
+    {
+        ServerThreads[cServers] = (HANDLE)_beginthreadex(NULL,
+                                                         0,
+                                                         ServerThread,
+                                                         PortHandle,
+                                                         0,
+                                                         NULL);
+        ok(ServerThreads[cServers] != NULL, "_beginthreadex failed\n");
+        if (!ServerThreads[cServers])
+            break;
+    }
+
+    /* One client measures the round trip latency, more of them the throughput */
+    for (cClients = 1; cServers && cClients <= MAX_CLIENTS; cClients *= 2)
+        Test_PingPong(cClients);
+
+    /* Tell every server thread to stop */
+    Status = cServers ? ConnectToServer(&ClientPortHandle) : STATUS_UNSUCCESSFUL;
+    ok_hex(Status, STATUS_SUCCESS);
+    if (NT_SUCCESS(Status))
+    {
+        for (i = 0; i < cServers; i++)
+        {
+            RtlZeroMemory(&Message, sizeof(Message));
+            Message.Header.u1.s1.TotalLength = sizeof(Message);
+            Message.Header.u1.s1.DataLength = sizeof(Message.Value);
+            Message.Value = PING_QUIT;
+            Status = NtRequestPort(ClientPortHandle, &Message.Header);
+            ok_hex(Status, STATUS_SUCCESS);
+        }
+
+        WaitForMultipleObjects(cServers, ServerThreads, TRUE, INFINITE);
+        NtClose(ClientPortHandle);
+    }
+
+    for (i = 0; i < cServers; i++)
+        CloseHandle(ServerThreads[i]);
+
+    for (i = 0; i < min((ULONG)AcceptedPortCount, RTL_NUMBER_OF(AcceptedPorts)); i++)
+        NtClose(AcceptedPorts[i]);
+
+    NtClose(PortHandle);
+}
@@ -595,6 +595,26 @@ Test_RtlFindClearRuns(void)
 void
 Test_RtlFindLongestRunClear(void)
 {
+    RTL_BITMAP BitMapHeader;
+    ULONG *Buffer;
+    ULONG Index;
+
+    Buffer = AllocateGuarded(2 * sizeof(*Buffer));
+    Buffer[0] = 0xF9F078B2;
+    Buffer[1] = 0x3F303F30;
+
+    RtlInitializeBitMap(&BitMapHeader, Buffer, 8);
+    ok_int(RtlFindLongestRunClear(&BitMapHeader, &Index), 2);
+    ok_int(Index, 2);
+
+    RtlInitializeBitMap(&BitMapHeader, Buffer, 32);
+    ok_int(RtlFindLongestRunClear(&BitMapHeader, &Index), 5);
+    ok_int(Index, 15);
+
+    RtlInitializeBitMap(&BitMapHeader, Buffer, 64);
+    ok_int(RtlFindLongestRunClear(&BitMapHeader, &Index), 6);
+    ok_int(Index, 46);
+    FreeGuarded(Buffer);
 }
 
 
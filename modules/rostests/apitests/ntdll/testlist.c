@@ -31,6 +31,8 @@ extern void func_NtQuerySystemInformation(void);
 extern void func_NtQueryValueKey(void);
 extern void func_NtQueryVolumeInformationFile(void);
 extern void func_NtReadFile(void);
+extern void func_NtRemoveIoCompletionEx(void);
+extern void func_NtRequestWaitReplyPort(void);
 extern void func_NtSaveKey(void);
 extern void func_NtSetInformationFile(void);
 extern void func_NtSetInformationProcess(void);
@@ -106,6 +108,8 @@ const struct test winetest_testlist[] =
     { "NtQueryValueKey",                func_NtQueryValueKey },
     { "NtQueryVolumeInformationFile",   func_NtQueryVolumeInformationFile },
     { "NtReadFile",                     func_NtReadFile },
+    { "NtRemoveIoCompletionEx",         func_NtRemoveIoCompletionEx },
+    { "NtRequestWaitReplyPort",         func_NtRequestWaitReplyPort },
     { "NtSaveKey",                      func_NtSaveKey},
     { "NtSetInformationFile",           func_NtSetInformationFile },
     { "NtSetInformationProcess",        func_NtSetInformationProcess },
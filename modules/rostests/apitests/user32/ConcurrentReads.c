@@ -0,0 +1,97 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Test for read-only USER calls made from many threads at once
+ */
+
+#include "precomp.h"
+
+#define MAX_THREADS 8
+#define CALLS_PER_THREAD 20000
+
+static HWND hWndParent;
+static HWND hWndChild;
+static HANDLE hStartEvent;
+
+static DWORD WINAPI ReaderThread(LPVOID lpParameter)
+{
+    POINT pt = { 20, 20 };
+    ULONG i, cErrors = 0;
+
+    WaitForSingleObject(hStartEvent, INFINITE);
+
+    for (i = 0; i < CALLS_PER_THREAD; i++)
+    {
+        if (GetAncestor(hWndChild, GA_ROOT) != hWndParent)
+            cErrors++;
+        if (GetAncestor(hWndChild, GA_ROOTOWNER) != hWndParent)
+            cErrors++;
+        if (ChildWindowFromPointEx(hWndParent, pt, CWP_ALL) != hWndChild)
+            cErrors++;
+    }
+
+    return cErrors;
+}
+
+static void Test_Threads(ULONG cThreads)
+{
+    HANDLE ahThreads[MAX_THREADS];
+    DWORD dwErrors;
+    ULONG i, cErrors = 0;
+
+    ResetEvent(hStartEvent);
+    for (i = 0; i < cThreads; i++)
+    {
+        ahThreads[i] = CreateThread(NULL, 0, ReaderThread, NULL, 0, NULL);
+        ok(ahThreads[i] != NULL, "CreateThread failed\n");
+        if (!ahThreads[i])
+        {
+            cThreads = i;
+            break;
+        }
+    }
+
+    /* Let all the threads go at once */
+    SetEvent(hStartEvent);
+    WaitForMultipleObjects(cThreads, ahThreads, TRUE, INFINITE);
+
+    for (i = 0; i < cThreads; i++)
+    {
+        if (GetExitCodeThread(ahThreads[i], &dwErrors))
+            cErrors += dwErrors;
+        CloseHandle(ahThreads[i]);
+    }
+
+    ok(cErrors == 0, "%lu threads: got %lu wrong results\n", cThreads, cErrors);
+}
+
+START_TEST(ConcurrentReads)
+{
+    SYSTEM_INFO SystemInfo;
+    ULONG cThreads;
+
+    hWndParent = CreateWindowExW(0, L"static", L"", WS_OVERLAPPEDWINDOW,
+                                 0, 0, 200, 200, NULL, NULL,
+                                 GetModuleHandleW(NULL), NULL);
+    ok(hWndParent != NULL, "CreateWindowExW failed\n");
+    if (!hWndParent)
+        return;
+
+    hWndChild = CreateWindowExW(0, L"static", L"", WS_CHILD | WS_VISIBLE,
+                                0, 0, 50, 50, hWndParent, NULL,
+                                GetModuleHandleW(NULL), NULL);
+    ok(hWndChild != NULL, "CreateWindowExW failed\n");
+    hStartEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    ok(hStartEvent != NULL, "CreateEventW failed\n");
+    if (!hWndChild || !hStartEvent)
+        goto Cleanup;
+
+    /* Enough threads for the calls to overlap on every processor */
+    GetSystemInfo(&SystemInfo);
+    cThreads = min(max(SystemInfo.dwNumberOfProcessors * 2, 2), MAX_THREADS);
+    Test_Threads(cThreads);
+
+Cleanup:
+    if (hStartEvent) CloseHandle(hStartEvent);
+    DestroyWindow(hWndParent);
+}
@@ -0,0 +1,137 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Test for SetTimer and KillTimer with many timers
+ */
+
+#include "precomp.h"
+
+#define IDLE_TIMER_COUNT 4000
+#define IDLE_TIMER_ELAPSE 60000
+#define FAST_TIMER_ID 0xFFFF
+#define FAST_TIMER_ELAPSE 50
+#define FAST_TIMER_RUN 1000
+
+static void Test_ManyTimers(HWND hWnd)
+{
+    DWORD dwStart, dwElapsed, dwWait;
+    ULONG i, cFailures = 0, cFastTicks = 0;
+    MSG msg;
+
+    /* Timers that never expire during the test, they only make the
+       timer queue large */
+    dwStart = GetTickCount();
+    for (i = 1; i <= IDLE_TIMER_COUNT; i++)
+    {
+        if (SetTimer(hWnd, i, IDLE_TIMER_ELAPSE + i, NULL) != i)
+            cFailures++;
+    }
+    dwElapsed = GetTickCount() - dwStart;
+    ok(cFailures == 0, "%lu SetTimer calls failed\n", cFailures);
+    trace("Created %u timers in %lu ms\n", IDLE_TIMER_COUNT, dwElapsed);
+
+    /* Resetting existing timers has to find them first */
+    cFailures = 0;
+    dwStart = GetTickCount();
+    for (i = IDLE_TIMER_COUNT; i >= 1; i--)
+    {
+        if (SetTimer(hWnd, i, IDLE_TIMER_ELAPSE + i, NULL) != i)
+            cFailures++;
+    }
+    dwElapsed = GetTickCount() - dwStart;
+    ok(cFailures == 0, "%lu SetTimer calls failed\n", cFailures);
+    trace("Reset %u timers in %lu ms\n", IDLE_TIMER_COUNT, dwElapsed);
+
+    /* A fast timer must keep its rate with all the others queued */
+    ok(SetTimer(hWnd, FAST_TIMER_ID, FAST_TIMER_ELAPSE, NULL) == FAST_TIMER_ID,
+       "SetTimer failed\n");
+    dwStart = GetTickCount();
+    while ((dwElapsed = GetTickCount() - dwStart) < FAST_TIMER_RUN)
+    {
+        /* Don't wait past the end of the run, even if no timer fires */
+        if (!PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE))
+        {
+            dwWait = MsgWaitForMultipleObjects(0, NULL, FALSE,
+                                               FAST_TIMER_RUN - dwElapsed,
+                                               QS_ALLINPUT);
+            ok(dwWait == WAIT_OBJECT_0 || dwWait == WAIT_TIMEOUT,
+               "MsgWaitForMultipleObjects returned %lu\n", dwWait);
+            if (dwWait != WAIT_OBJECT_0 && dwWait != WAIT_TIMEOUT)
+                break;
+            continue;
+        }
+        if (msg.message == WM_TIMER && msg.hwnd == hWnd)
+        {
+            if (msg.wParam == FAST_TIMER_ID)
+                cFastTicks++;
+            else
+                ok(0, "Unexpected timer %Iu\n", msg.wParam);
+            continue;
+        }
+        DispatchMessageW(&msg);
+    }
+    ok(cFastTicks >= FAST_TIMER_RUN / FAST_TIMER_ELAPSE / 2 &&
+       cFastTicks <= FAST_TIMER_RUN / FAST_TIMER_ELAPSE + 1,
+       "Got %lu ticks of the %u ms timer in %u ms\n",
+       cFastTicks, FAST_TIMER_ELAPSE, FAST_TIMER_RUN);
+    trace("%lu ticks of the %u ms timer in %u ms\n",
+          cFastTicks, FAST_TIMER_ELAPSE, FAST_TIMER_RUN);
+    ok(KillTimer(hWnd, FAST_TIMER_ID), "KillTimer failed\n");
+
+    cFailures = 0;
+    dwStart = GetTickCount();
+    for (i = 1; i <= IDLE_TIMER_COUNT; i++)
+    {
+        if (!KillTimer(hWnd, i))
+            cFailures++;
+    }
+    dwElapsed = GetTickCount() - dwStart;
+    ok(cFailures == 0, "%lu KillTimer calls failed\n", cFailures);
+    trace("Killed %u timers in %lu ms\n", IDLE_TIMER_COUNT, dwElapsed);
+
+    /* They are gone */
+    ok(!KillTimer(hWnd, 1), "KillTimer succeeded on a killed timer\n");
+    ok(!KillTimer(hWnd, IDLE_TIMER_COUNT), "KillTimer succeeded on a killed timer\n");
+}
+
+static void Test_SameIdOtherWindow(HWND hWnd1, HWND hWnd2)
+{
+    MSG msg;
+
+    /* Timers are identified by window and id together */
+    ok(SetTimer(hWnd1, 7, 10000, NULL) == 7, "SetTimer failed\n");
+    ok(SetTimer(hWnd2, 7, 10000, NULL) == 7, "SetTimer failed\n");
+    ok(KillTimer(hWnd1, 7), "KillTimer failed\n");
+    ok(!KillTimer(hWnd1, 7), "KillTimer succeeded twice\n");
+    ok(KillTimer(hWnd2, 7), "KillTimer failed\n");
+
+    /* The id of another window's timer does not kill it */
+    ok(SetTimer(hWnd1, 9, 10000, NULL) == 9, "SetTimer failed\n");
+    ok(!KillTimer(hWnd2, 9), "KillTimer killed the timer of another window\n");
+    ok(KillTimer(hWnd1, 9), "KillTimer failed\n");
+
+    /* Destroying a window kills its timers */
+    ok(SetTimer(hWnd2, 8, 10000, NULL) == 8, "SetTimer failed\n");
+    DestroyWindow(hWnd2);
+    while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE))
+        DispatchMessageW(&msg);
+    ok(!KillTimer(hWnd2, 8), "KillTimer succeeded on a destroyed window\n");
+}
+
+START_TEST(SetTimer)
+{
+    HWND hWnd1, hWnd2;
+
+    hWnd1 = CreateWindowExW(0, L"static", L"", 0, 0, 0, 0, 0,
+                            HWND_MESSAGE, NULL, GetModuleHandleW(NULL), NULL);
+    hWnd2 = CreateWindowExW(0, L"static", L"", 0, 0, 0, 0, 0,
+                            HWND_MESSAGE, NULL, GetModuleHandleW(NULL), NULL);
+    ok(hWnd1 != NULL && hWnd2 != NULL, "CreateWindowExW failed\n");
+    if (!hWnd1 || !hWnd2)
+        return;
+
+    Test_ManyTimers(hWnd1);
+    Test_SameIdOtherWindow(hWnd1, hWnd2);
+
+    DestroyWindow(hWnd1);
+}
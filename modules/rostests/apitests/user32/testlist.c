@@ -5,6 +5,7 @@
 
 extern void func_AttachThreadInput(void);
 extern void func_CloseWindow(void);
+extern void func_ConcurrentReads(void);
 extern void func_CreateDialog(void);
 extern void func_CreateIconFromResourceEx(void);
 extern void func_CreateWindowEx(void);
@@ -44,6 +45,7 @@ extern void func_SetParent(void);
 extern void func_SetProp(void);
 extern void func_SetScrollInfo(void);
 extern void func_SetScrollRange(void);
+extern void func_SetTimer(void);
 extern void func_SwitchToThisWindow(void);
 extern void func_SystemParametersInfo(void);
 extern void func_TrackMouseEvent(void);
@@ -54,6 +56,7 @@ const struct test winetest_testlist[] =
 {
     { "AttachThreadInput", func_AttachThreadInput },
     { "CloseWindow", func_CloseWindow },
+    { "ConcurrentReads", func_ConcurrentReads },
     { "CreateDialog", func_CreateDialog },
     { "CreateIconFromResourceEx", func_CreateIconFromResourceEx },
     { "CreateWindowEx", func_CreateWindowEx },
@@ -93,6 +96,7 @@ const struct test winetest_testlist[] =
     { "SetProp", func_SetProp },
     { "SetScrollInfo", func_SetScrollInfo },
     { "SetScrollRange", func_SetScrollRange },
+    { "SetTimer", func_SetTimer },
     { "SwitchToThisWindow", func_SwitchToThisWindow },
     { "SystemParametersInfo", func_SystemParametersInfo },
     { "TrackMouseEvent", func_TrackMouseEvent },
@@ -0,0 +1,153 @@
+/*
+ * Measures how fast true color bitmaps are blitted to 8bpp and 4bpp
+ * DIB sections, which translates every pixel to the nearest palette index.
+ */
+
+#include <windows.h>
+#include <stdio.h>
+
+#define BMP_WIDTH 640
+#define BMP_HEIGHT 480
+#define BLT_COUNT 50
+
+typedef struct
+{
+    BITMAPINFOHEADER bmiHeader;
+    RGBQUAD bmiColors[256];
+} BITMAPINFO256;
+
+static HBITMAP
+CreateSource(HDC hdc, WORD wBitCount)
+{
+    BITMAPINFO bmi;
+    HBITMAP hbm;
+    PBYTE pjBits;
+    ULONG x, y, cjLine;
+
+    ZeroMemory(&bmi, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = BMP_WIDTH;
+    bmi.bmiHeader.biHeight = BMP_HEIGHT;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = wBitCount;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    hbm = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, (PVOID*)&pjBits, NULL, 0);
+    if (!hbm) return NULL;
+
+    /* Fill it with a gradient, so that many different colors are used */
+    cjLine = ((BMP_WIDTH * wBitCount + 31) & ~31) / 8;
+    for (y = 0; y < BMP_HEIGHT; y++)
+    {
+        for (x = 0; x < BMP_WIDTH; x++)
+        {
+            BYTE r = (BYTE)(x * 255 / BMP_WIDTH);
+            BYTE g = (BYTE)(y * 255 / BMP_HEIGHT);
+            BYTE b = (BYTE)((x + y) & 0xFF);
+
+            if (wBitCount == 16)
+            {
+                ((PWORD)(pjBits + y * cjLine))[x] =
+                    ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3);
+            }
+            else
+            {
+                PBYTE pj = pjBits + y * cjLine + x * (wBitCount / 8);
+                pj[0] = b;
+                pj[1] = g;
+                pj[2] = r;
+            }
+        }
+    }
+
+    return hbm;
+}
+
+static HBITMAP
+CreateTarget(HDC hdc, WORD wBitCount)
+{
+    BITMAPINFO256 bmi;
+    PVOID pvBits;
+    ULONG i, cColors = 1 << wBitCount;
+
+    ZeroMemory(&bmi, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = BMP_WIDTH;
+    bmi.bmiHeader.biHeight = BMP_HEIGHT;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = wBitCount;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    bmi.bmiHeader.biClrUsed = cColors;
+
+    /* Use a 6x6x6 color cube plus grays, like a halftone palette */
+    for (i = 0; i < cColors; i++)
+    {
+        if (i < 216)
+        {
+            bmi.bmiColors[i].rgbRed = (BYTE)((i / 36) * 51);
+            bmi.bmiColors[i].rgbGreen = (BYTE)(((i / 6) % 6) * 51);
+            bmi.bmiColors[i].rgbBlue = (BYTE)((i % 6) * 51);
+        }
+        else
+        {
+            bmi.bmiColors[i].rgbRed =
+            bmi.bmiColors[i].rgbGreen =
+            bmi.bmiColors[i].rgbBlue = (BYTE)((i - 216) * 6);
+        }
+    }
+
+    return CreateDIBSection(hdc, (BITMAPINFO*)&bmi, DIB_RGB_COLORS, &pvBits, NULL, 0);
+}
+
+static void
+RunBench(WORD wSrcBpp, WORD wDstBpp)
+{
+    HDC hdcSrc, hdcDst;
+    HBITMAP hbmSrc, hbmDst, hbmOldSrc, hbmOldDst;
+    DWORD dwStart, dwElapsed;
+    ULONG i;
+
+    hdcSrc = CreateCompatibleDC(NULL);
+    hdcDst = CreateCompatibleDC(NULL);
+    hbmSrc = CreateSource(hdcSrc, wSrcBpp);
+    hbmDst = CreateTarget(hdcDst, wDstBpp);
+    if (!hbmSrc || !hbmDst)
+    {
+        printf("Failed to create bitmaps (error %lu)\n", GetLastError());
+        goto Cleanup;
+    }
+
+    hbmOldSrc = SelectObject(hdcSrc, hbmSrc);
+    hbmOldDst = SelectObject(hdcDst, hbmDst);
+
+    dwStart = GetTickCount();
+    for (i = 0; i < BLT_COUNT; i++)
+    {
+        BitBlt(hdcDst, 0, 0, BMP_WIDTH, BMP_HEIGHT, hdcSrc, 0, 0, SRCCOPY);
+    }
+    GdiFlush();
+    dwElapsed = GetTickCount() - dwStart;
+
+    printf("%2ubpp -> %ubpp: %u blits of %ux%u in %lu ms (%.1f blits/s)\n",
+           wSrcBpp, wDstBpp, BLT_COUNT, BMP_WIDTH, BMP_HEIGHT, dwElapsed,
+           dwElapsed ? BLT_COUNT * 1000.0 / dwElapsed : 0.0);
+
+    SelectObject(hdcSrc, hbmOldSrc);
+    SelectObject(hdcDst, hbmOldDst);
+
+Cleanup:
+    if (hbmSrc) DeleteObject(hbmSrc);
+    if (hbmDst) DeleteObject(hbmDst);
+    DeleteDC(hdcSrc);
+    DeleteDC(hdcDst);
+}
+
+int
+main(int argc, char *argv[])
+{
+    RunBench(32, 8);
+    RunBench(24, 8);
+    RunBench(16, 8);
+    RunBench(32, 4);
+    return 0;
+}
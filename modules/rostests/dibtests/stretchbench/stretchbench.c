@@ -0,0 +1,127 @@
+/*
+ * Measures StretchBlt with COLORONCOLOR between DIB sections of common
+ * formats and checks every destination pixel against a nearest neighbour
+ * reference computed here.
+ */
+
+#include <windows.h>
+#include <stdio.h>
+
+#define SRC_WIDTH 256
+#define SRC_HEIGHT 192
+#define BLT_COUNT 50
+
+static const SIZE DestSizes[] =
+{
+    { 640, 480 }, /* Upscale */
+    { 96, 72 },   /* Thumbnail */
+    { 300, 500 }  /* Mixed */
+};
+
+static HBITMAP
+CreateDib(HDC hdc, LONG cx, LONG cy, WORD wBitCount, PVOID *ppvBits)
+{
+    BITMAPINFO bmi;
+
+    ZeroMemory(&bmi, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = cx;
+    bmi.bmiHeader.biHeight = -cy;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = wBitCount;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    return CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, ppvBits, NULL, 0);
+}
+
+static ULONG
+GetDibPixel(PBYTE pjBits, LONG cx, WORD wBitCount, LONG x, LONG y)
+{
+    ULONG cjLine = ((cx * wBitCount + 31) & ~31) / 8;
+    PBYTE pj = pjBits + y * cjLine + x * (wBitCount / 8);
+
+    if (wBitCount == 16) return *(PWORD)pj;
+    if (wBitCount == 24) return pj[0] | (pj[1] << 8) | (pj[2] << 16);
+    return *(PULONG)pj & 0xFFFFFF;
+}
+
+static void
+RunBench(WORD wBitCount, const SIZE *pDestSize)
+{
+    HDC hdcSrc, hdcDst;
+    HBITMAP hbmSrc, hbmDst, hbmOldSrc, hbmOldDst;
+    PBYTE pjSrc, pjDst;
+    DWORD dwStart, dwElapsed;
+    ULONG i, cjImage, cMismatches = 0;
+    LONG x, y, cx = pDestSize->cx, cy = pDestSize->cy;
+
+    hdcSrc = CreateCompatibleDC(NULL);
+    hdcDst = CreateCompatibleDC(NULL);
+    hbmSrc = CreateDib(hdcSrc, SRC_WIDTH, SRC_HEIGHT, wBitCount, (PVOID*)&pjSrc);
+    hbmDst = CreateDib(hdcDst, cx, cy, wBitCount, (PVOID*)&pjDst);
+    if (!hbmSrc || !hbmDst)
+    {
+        printf("Failed to create bitmaps (error %lu)\n", GetLastError());
+        goto Cleanup;
+    }
+
+    /* Fill the source with noise, so that every pixel matters */
+    cjImage = (((SRC_WIDTH * wBitCount + 31) & ~31) / 8) * SRC_HEIGHT;
+    for (i = 0; i < cjImage; i++)
+        pjSrc[i] = (BYTE)((i * 2654435761u) >> 24);
+
+    hbmOldSrc = SelectObject(hdcSrc, hbmSrc);
+    hbmOldDst = SelectObject(hdcDst, hbmDst);
+    SetStretchBltMode(hdcDst, COLORONCOLOR);
+
+    dwStart = GetTickCount();
+    for (i = 0; i < BLT_COUNT; i++)
+    {
+        StretchBlt(hdcDst, 0, 0, cx, cy, hdcSrc, 0, 0, SRC_WIDTH, SRC_HEIGHT, SRCCOPY);
+    }
+    GdiFlush();
+    dwElapsed = GetTickCount() - dwStart;
+
+    /* Every destination pixel must come from the nearest source pixel */
+    for (y = 0; y < cy; y++)
+    {
+        for (x = 0; x < cx; x++)
+        {
+            if (GetDibPixel(pjDst, cx, wBitCount, x, y) !=
+                GetDibPixel(pjSrc, SRC_WIDTH, wBitCount,
+                            x * SRC_WIDTH / cx, y * SRC_HEIGHT / cy))
+            {
+                cMismatches++;
+            }
+        }
+    }
+
+    printf("%2ubpp %3ux%3u -> %3ldx%3ld: %u blits in %lu ms, %lu mismatching pixels%s\n",
+           wBitCount, SRC_WIDTH, SRC_HEIGHT, cx, cy, BLT_COUNT, dwElapsed,
+           cMismatches, cMismatches ? " FAILED" : "");
+
+    SelectObject(hdcSrc, hbmOldSrc);
+    SelectObject(hdcDst, hbmOldDst);
+
+Cleanup:
+    if (hbmSrc) DeleteObject(hbmSrc);
+    if (hbmDst) DeleteObject(hbmDst);
+    DeleteDC(hdcSrc);
+    DeleteDC(hdcDst);
+}
+
+int
+main(int argc, char *argv[])
+{
+    static const WORD awBitCounts[] = { 16, 24, 32 };
+    ULONG i, j;
+
+    for (i = 0; i < ARRAYSIZE(awBitCounts); i++)
+    {
+        for (j = 0; j < ARRAYSIZE(DestSizes); j++)
+        {
+            RunBench(awBitCounts[i], &DestSizes[j]);
+        }
+    }
+    return 0;
+}
@@ -114,6 +114,7 @@ typedef enum
     TESTENTRY_NO_EXCLUSIVE_DEVICE = 8,
     TESTENTRY_NO_READONLY_DEVICE = 16,
     TESTENTRY_BUFFERED_IO_DEVICE = 32,
+    TESTENTRY_DIRECT_IO_DEVICE = 64,
 } KMT_TESTENTRY_FLAGS;
 
 NTSTATUS TestEntry(IN PDRIVER_OBJECT DriverObject, IN PCUNICODE_STRING RegistryPath, OUT PCWSTR *DeviceName, IN OUT INT *Flags);
@@ -134,6 +134,8 @@ DriverEntry(
 
         if (Flags & TESTENTRY_BUFFERED_IO_DEVICE)
             TestDeviceObject->Flags |= DO_BUFFERED_IO;
+        else if (Flags & TESTENTRY_DIRECT_IO_DEVICE)
+            TestDeviceObject->Flags |= DO_DIRECT_IO;
 
         DPRINT("DriverEntry. Created DeviceObject %p\n",
                  TestDeviceObject);
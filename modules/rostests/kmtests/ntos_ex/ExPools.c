@@ -305,6 +305,212 @@ TestBigPoolExpansion(VOID)
     }
 }
 
+#define POOL_ACCOUNTING_BLOCKS 16
+#define POOL_ACCOUNTING_SIZE 40
+#define TAG_POOLACCOUNTING 'APmK'
+
+static
+BOOLEAN
+QueryPoolTag(
+    _In_ ULONG Tag,
+    _Out_ PSYSTEM_POOLTAG PoolTag)
+{
+    NTSTATUS Status;
+    PSYSTEM_POOLTAG_INFORMATION TagInformation;
+    ULONG Length = 64 * 1024, ReturnLength, i;
+
+    RtlZeroMemory(PoolTag, sizeof(*PoolTag));
+
+    for (;;)
+    {
+        TagInformation = ExAllocatePoolWithTag(PagedPool, Length, TAG_POOLTEST);
+        if (skip(TagInformation != NULL, "No memory for the tag information\n"))
+            return FALSE;
+
+        ReturnLength = 0;
+        Status = ZwQuerySystemInformation(SystemPoolTagInformation,
+                                          TagInformation,
+                                          Length,
+                                          &ReturnLength);
+        if (Status != STATUS_INFO_LENGTH_MISMATCH || ReturnLength <= Length)
+            break;
+
+        ExFreePoolWithTag(TagInformation, TAG_POOLTEST);
+        Length = ReturnLength;
+    }
+
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+    {
+        ExFreePoolWithTag(TagInformation, TAG_POOLTEST);
+        return FALSE;
+    }
+
+    /* A tag that was never used has no entry, which reads as all zeroes */
+    for (i = 0; i < TagInformation->Count; i++)
+    {
+        if (TagInformation->TagInfo[i].TagUlong == Tag)
+        {
+            *PoolTag = TagInformation->TagInfo[i];
+            break;
+        }
+    }
+
+    ExFreePoolWithTag(TagInformation, TAG_POOLTEST);
+    return TRUE;
+}
+
+static
+VOID
+TestPoolTagAccounting(VOID)
+{
+    PVOID *Blocks;
+    SYSTEM_POOLTAG Before, After;
+    POOL_TYPE PoolType;
+    ULONG Count, Processor, i;
+    SIZE_T Used;
+
+    Count = KeNumberProcessors * POOL_ACCOUNTING_BLOCKS;
+    Blocks = ExAllocatePoolWithTag(NonPagedPool, Count * sizeof(*Blocks), TAG_POOLTEST);
+    if (skip(Blocks != NULL, "No memory for the block list\n"))
+        return;
+
+    for (PoolType = NonPagedPool; PoolType <= PagedPool; PoolType++)
+    {
+        if (!QueryPoolTag(TAG_POOLACCOUNTING, &Before))
+            break;
+
+        /* Allocate on every processor, so that each one counts some of them */
+        for (Processor = 0; Processor < (ULONG)KeNumberProcessors; Processor++)
+        {
+            KeSetSystemAffinityThread((KAFFINITY)1 << Processor);
+            ok_eq_ulong(KeGetCurrentProcessorNumber(), Processor);
+            for (i = 0; i < POOL_ACCOUNTING_BLOCKS; i++)
+            {
+                Blocks[Processor * POOL_ACCOUNTING_BLOCKS + i] =
+                    ExAllocatePoolWithTag(PoolType, POOL_ACCOUNTING_SIZE, TAG_POOLACCOUNTING);
+            }
+        }
+        KeRevertToUserAffinityThread();
+
+        for (i = 0; i < Count; i++)
+            ok(Blocks[i] != NULL, "Allocation %lu failed\n", i);
+
+        /* The query adds up the counters of all processors */
+        if (QueryPoolTag(TAG_POOLACCOUNTING, &After))
+        {
+            if (PoolType == NonPagedPool)
+            {
+                ok_eq_ulong(After.NonPagedAllocs - Before.NonPagedAllocs, Count);
+                ok_eq_ulong(After.NonPagedFrees - Before.NonPagedFrees, 0UL);
+                ok_eq_ulong(After.PagedAllocs - Before.PagedAllocs, 0UL);
+                Used = After.NonPagedUsed - Before.NonPagedUsed;
+            }
+            else
+            {
+                ok_eq_ulong(After.PagedAllocs - Before.PagedAllocs, Count);
+                ok_eq_ulong(After.PagedFrees - Before.PagedFrees, 0UL);
+                ok_eq_ulong(After.NonPagedAllocs - Before.NonPagedAllocs, 0UL);
+                Used = After.PagedUsed - Before.PagedUsed;
+            }
+
+            /* Used includes the pool headers */
+            ok(Used >= (SIZE_T)Count * POOL_ACCOUNTING_SIZE,
+               "Used = %lu for %lu blocks of %u bytes\n",
+               (ULONG)Used, Count, POOL_ACCOUNTING_SIZE);
+        }
+
+        /* Free them all from this thread, whichever processor it runs on */
+        for (i = 0; i < Count; i++)
+        {
+            if (Blocks[i])
+                ExFreePoolWithTag(Blocks[i], TAG_POOLACCOUNTING);
+        }
+
+        if (QueryPoolTag(TAG_POOLACCOUNTING, &After))
+        {
+            ok_eq_ulong(After.NonPagedAllocs - Before.NonPagedAllocs,
+                        After.NonPagedFrees - Before.NonPagedFrees);
+            ok_eq_ulong(After.PagedAllocs - Before.PagedAllocs,
+                        After.PagedFrees - Before.PagedFrees);
+            ok_eq_size(After.NonPagedUsed, Before.NonPagedUsed);
+            ok_eq_size(After.PagedUsed, Before.PagedUsed);
+        }
+    }
+
+    ExFreePoolWithTag(Blocks, TAG_POOLTEST);
+}
+
+static
+VOID
+TestPoolTrace(VOID)
+{
+    NTSTATUS Status;
+    SYSTEM_POOL_TRACE_CONTROL Control, Previous;
+    PSYSTEM_POOL_TRACE_INFORMATION TraceInformation;
+    PSYSTEM_POOL_TRACE_ENTRY Entry;
+    PVOID Memory;
+    ULONG Length, i, Allocs = 0, Frees = 0;
+
+    Length = FIELD_OFFSET(SYSTEM_POOL_TRACE_INFORMATION, Entries) +
+             64 * sizeof(SYSTEM_POOL_TRACE_ENTRY);
+    TraceInformation = ExAllocatePoolWithTag(PagedPool, Length, TAG_POOLTEST);
+    if (skip(TraceInformation != NULL, "No memory for the trace\n"))
+        return;
+
+    Status = ZwQuerySystemInformation(SystemPoolTraceInformation,
+                                      TraceInformation,
+                                      FIELD_OFFSET(SYSTEM_POOL_TRACE_INFORMATION, Entries),
+                                      NULL);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    Previous = TraceInformation->Control;
+
+    /* Only trace our own tag, and throw away anything from before */
+    Control.SampleRate = 1;
+    Control.Tag = 'TrmK';
+    Control.FrameCount = SYSTEM_POOL_TRACE_FRAMES + 1;
+    Status = ZwSetSystemInformation(SystemPoolTraceInformation, &Control, sizeof(Control));
+    ok_eq_hex(Status, STATUS_INVALID_PARAMETER);
+    Control.FrameCount = 2;
+    Status = ZwSetSystemInformation(SystemPoolTraceInformation, &Control, sizeof(Control));
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (skip(NT_SUCCESS(Status), "No pool tracing\n"))
+    {
+        ExFreePoolWithTag(TraceInformation, TAG_POOLTEST);
+        return;
+    }
+    ZwQuerySystemInformation(SystemPoolTraceInformation, TraceInformation, Length, NULL);
+
+    Memory = ExAllocatePoolWithTag(NonPagedPool, 40, 'TrmK');
+    ok(Memory != NULL, "ExAllocatePoolWithTag failed\n");
+    if (Memory)
+        ExFreePoolWithTag(Memory, 'TrmK');
+
+    Status = ZwQuerySystemInformation(SystemPoolTraceInformation, TraceInformation, Length, NULL);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (NT_SUCCESS(Status))
+    {
+        ok_eq_ulong(TraceInformation->Control.SampleRate, 1UL);
+        ok_eq_tag(TraceInformation->Control.Tag, 'TrmK');
+        for (i = 0; i < TraceInformation->Count; i++)
+        {
+            Entry = &TraceInformation->Entries[i];
+            ok_eq_tag(Entry->Tag, 'TrmK');
+            ok_eq_pointer(Entry->Va, Memory);
+            ok(Entry->NumberOfBytes >= 40, "NumberOfBytes = %lu\n", (ULONG)Entry->NumberOfBytes);
+            if (Entry->Flags & SYSTEM_POOL_TRACE_FREE)
+                Frees++;
+            else
+                Allocs++;
+        }
+        ok_eq_ulong(Allocs, 1UL);
+        ok_eq_ulong(Frees, 1UL);
+    }
+
+    ZwSetSystemInformation(SystemPoolTraceInformation, &Previous, sizeof(Previous));
+    ExFreePoolWithTag(TraceInformation, TAG_POOLTEST);
+}
+
 START_TEST(ExPools)
 {
     PoolsTest();
@@ -312,4 +518,6 @@ START_TEST(ExPools)
     TestPoolTags();
     TestPoolQuota();
     TestBigPoolExpansion();
+    TestPoolTagAccounting();
+    TestPoolTrace();
 }
@@ -0,0 +1,20 @@
+/*
+ * PROJECT:     ReactOS kernel-mode tests
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Direct I/O and registered buffer test declarations
+ */
+
+#ifndef _KMTEST_IODIRECTIO_H_
+#define _KMTEST_IODIRECTIO_H_
+
+/* The driver fills reads with, and expects writes to contain, the key's low byte */
+#define KEY_DATA(c) ((c) & 0xff)
+#define KEY_GET_DATA(key) ((UCHAR)((key) & 0xff))
+
+/* Complete without touching the data, to time only the I/O manager's work */
+#define KEY_NO_DATA 0x100
+
+/* Success status the driver returns when it got a partial MDL */
+#define STATUS_REGISTERED_BUFFER STATUS_WAIT_1
+
+#endif /* !defined _KMTEST_IODIRECTIO_H_ */
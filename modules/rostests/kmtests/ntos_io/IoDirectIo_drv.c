@@ -0,0 +1,116 @@
+/*
+ * PROJECT:     ReactOS kernel-mode tests
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Test driver for direct I/O from registered buffers
+ */
+
+#include <kmt_test.h>
+#include "IoDirectIo.h"
+
+#define NDEBUG
+#include <debug.h>
+
+static KMT_IRP_HANDLER TestIrpHandler;
+
+NTSTATUS
+TestEntry(
+    _In_ PDRIVER_OBJECT DriverObject,
+    _In_ PCUNICODE_STRING RegistryPath,
+    _Out_ PCWSTR *DeviceName,
+    _Inout_ INT *Flags)
+{
+    PAGED_CODE();
+
+    UNREFERENCED_PARAMETER(DriverObject);
+    UNREFERENCED_PARAMETER(RegistryPath);
+
+    *DeviceName = L"IoDirectIo";
+    *Flags = TESTENTRY_NO_EXCLUSIVE_DEVICE |
+             TESTENTRY_DIRECT_IO_DEVICE |
+             TESTENTRY_NO_READONLY_DEVICE;
+
+    KmtRegisterIrpHandler(IRP_MJ_READ, NULL, TestIrpHandler);
+    KmtRegisterIrpHandler(IRP_MJ_WRITE, NULL, TestIrpHandler);
+
+    return STATUS_SUCCESS;
+}
+
+VOID
+TestUnload(
+    _In_ PDRIVER_OBJECT DriverObject)
+{
+    PAGED_CODE();
+}
+
+static
+NTSTATUS
+TestIrpHandler(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIRP Irp,
+    _In_ PIO_STACK_LOCATION IoStack)
+{
+    NTSTATUS Status = STATUS_SUCCESS;
+    PMDL Mdl = Irp->MdlAddress;
+    PUCHAR Buffer;
+    ULONG Length, Key, i;
+
+    PAGED_CODE();
+
+    DPRINT("IRP %x/%x\n", IoStack->MajorFunction, IoStack->MinorFunction);
+    ASSERT(IoStack->MajorFunction == IRP_MJ_READ ||
+           IoStack->MajorFunction == IRP_MJ_WRITE);
+
+    if (IoStack->MajorFunction == IRP_MJ_READ)
+    {
+        Length = IoStack->Parameters.Read.Length;
+        Key = IoStack->Parameters.Read.Key;
+    }
+    else
+    {
+        Length = IoStack->Parameters.Write.Length;
+        Key = IoStack->Parameters.Write.Key;
+    }
+
+    ok(Mdl != NULL, "No MDL for %lu bytes\n", Length);
+    if (Mdl)
+    {
+        ok_eq_ulong(MmGetMdlByteCount(Mdl), Length);
+
+        /* Only the pages of a registered buffer come as a partial MDL */
+        if (Mdl->MdlFlags & MDL_PARTIAL)
+            Status = STATUS_REGISTERED_BUFFER;
+        else
+            ok(Mdl->MdlFlags & MDL_PAGES_LOCKED, "MdlFlags = %x\n", Mdl->MdlFlags);
+
+        if (!(Key & KEY_NO_DATA))
+        {
+            Buffer = MmGetSystemAddressForMdlSafe(Mdl, NormalPagePriority);
+            ok(Buffer != NULL, "Failed to map the MDL\n");
+            if (!Buffer)
+            {
+                Status = STATUS_INSUFFICIENT_RESOURCES;
+            }
+            else if (IoStack->MajorFunction == IRP_MJ_READ)
+            {
+                RtlFillMemory(Buffer, Length, KEY_GET_DATA(Key));
+            }
+            else
+            {
+                for (i = 0; i < Length; i++)
+                {
+                    if (Buffer[i] != KEY_GET_DATA(Key))
+                    {
+                        Status = STATUS_DATA_ERROR;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    Irp->IoStatus.Status = Status;
+    Irp->IoStatus.Information = NT_SUCCESS(Status) ? Length : 0;
+    IoCompleteRequest(Irp, IO_NO_INCREMENT);
+
+    return Status;
+}
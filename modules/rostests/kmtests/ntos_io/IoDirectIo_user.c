@@ -0,0 +1,301 @@
+/*
+ * PROJECT:     ReactOS kernel-mode tests
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Test for direct I/O from registered buffers
+ */
+
+#include <kmt_test.h>
+#include "IoDirectIo.h"
+
+#define BUFFER_SIZE (64 * 1024)
+#define SMALL_IO_SIZE 512
+#define ITERATIONS 20000
+
+static
+NTSTATUS
+TestIo(
+    _In_ HANDLE FileHandle,
+    _In_ BOOLEAN Write,
+    _In_ PUCHAR Buffer,
+    _In_ ULONG Length,
+    _In_ ULONG Key)
+{
+    NTSTATUS Status;
+    IO_STATUS_BLOCK IoStatus;
+    LARGE_INTEGER Offset;
+
+    RtlFillMemory(&IoStatus, sizeof(IoStatus), 0x55);
+    Offset.QuadPart = 0;
+    if (Write)
+        Status = NtWriteFile(FileHandle, NULL, NULL, NULL, &IoStatus,
+                             Buffer, Length, &Offset, &Key);
+    else
+        Status = NtReadFile(FileHandle, NULL, NULL, NULL, &IoStatus,
+                            Buffer, Length, &Offset, &Key);
+    if (NT_SUCCESS(Status))
+    {
+        ok_eq_hex(IoStatus.Status, Status);
+        ok_eq_ulongptr(IoStatus.Information, Length);
+    }
+    return Status;
+}
+
+static
+BOOLEAN
+CheckData(
+    _In_ PUCHAR Buffer,
+    _In_ ULONG Length,
+    _In_ UCHAR Data)
+{
+    ULONG i;
+
+    for (i = 0; i < Length; i++)
+    {
+        if (Buffer[i] != Data)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static
+VOID
+TestRegistration(
+    _In_ HANDLE FileHandle,
+    _In_ PUCHAR Buffer)
+{
+    NTSTATUS Status;
+    ULONG BufferId, OtherId;
+
+    /* Plain direct I/O gets a locked MDL */
+    Status = TestIo(FileHandle, FALSE, Buffer, SMALL_IO_SIZE, KEY_DATA(0x11));
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ok(CheckData(Buffer, SMALL_IO_SIZE, 0x11), "Wrong data\n");
+
+    /* Register the first half of the allocation */
+    BufferId = 0;
+    Status = NtRegisterIoBuffer(Buffer, BUFFER_SIZE, &BufferId);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (skip(NT_SUCCESS(Status), "Registration failed\n"))
+        return;
+    ok(BufferId != 0, "BufferId = %lu\n", BufferId);
+
+    /* Registrations of the same process can't overlap */
+    OtherId = 0x55555555;
+    Status = NtRegisterIoBuffer(Buffer + BUFFER_SIZE / 2, BUFFER_SIZE, &OtherId);
+    ok_eq_hex(Status, STATUS_CONFLICTING_ADDRESSES);
+    ok_eq_ulong(OtherId, 0x55555555);
+
+    /* Transfers inside the buffer use its pages */
+    Status = TestIo(FileHandle, FALSE, Buffer + 100, SMALL_IO_SIZE, KEY_DATA(0x22));
+    ok_eq_hex(Status, STATUS_REGISTERED_BUFFER);
+    ok(CheckData(Buffer + 100, SMALL_IO_SIZE, 0x22), "Wrong data\n");
+
+    RtlFillMemory(Buffer + BUFFER_SIZE - SMALL_IO_SIZE, SMALL_IO_SIZE, 0x33);
+    Status = TestIo(FileHandle, TRUE, Buffer + BUFFER_SIZE - SMALL_IO_SIZE, SMALL_IO_SIZE, KEY_DATA(0x33));
+    ok_eq_hex(Status, STATUS_REGISTERED_BUFFER);
+
+    /* Transfers crossing its end still work, the usual way */
+    Status = TestIo(FileHandle, FALSE, Buffer + BUFFER_SIZE - 100, SMALL_IO_SIZE, KEY_DATA(0x44));
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ok(CheckData(Buffer + BUFFER_SIZE - 100, SMALL_IO_SIZE, 0x44), "Wrong data\n");
+
+    /* Once deregistered, the buffer is back to normal */
+    Status = NtDeregisterIoBuffer(BufferId);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    Status = NtDeregisterIoBuffer(BufferId);
+    ok_eq_hex(Status, STATUS_INVALID_PARAMETER);
+
+    Status = TestIo(FileHandle, FALSE, Buffer + 100, SMALL_IO_SIZE, KEY_DATA(0x55));
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ok(CheckData(Buffer + 100, SMALL_IO_SIZE, 0x55), "Wrong data\n");
+
+    /* The range can be registered again */
+    Status = NtRegisterIoBuffer(Buffer + BUFFER_SIZE / 2, BUFFER_SIZE, &OtherId);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (NT_SUCCESS(Status))
+    {
+        ok(OtherId != BufferId, "Got the same ID %lu again\n", OtherId);
+        Status = NtDeregisterIoBuffer(OtherId);
+        ok_eq_hex(Status, STATUS_SUCCESS);
+    }
+
+    Status = NtRegisterIoBuffer(Buffer, 0, &OtherId);
+    ok_eq_hex(Status, STATUS_INVALID_PARAMETER_2);
+}
+
+static
+VOID
+TestFreedBuffer(
+    _In_ HANDLE FileHandle)
+{
+    NTSTATUS Status;
+    ULONG BufferId;
+    PUCHAR Buffer, NewBuffer;
+    BOOL Ret;
+
+    Buffer = VirtualAlloc(NULL, BUFFER_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    ok(Buffer != NULL, "VirtualAlloc failed with %lu\n", GetLastError());
+    if (!Buffer)
+        return;
+
+    /* Decommitting the pages drops the registration */
+    Status = NtRegisterIoBuffer(Buffer, BUFFER_SIZE, &BufferId);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    Ret = VirtualFree(Buffer, BUFFER_SIZE, MEM_DECOMMIT);
+    ok(Ret, "VirtualFree failed with %lu\n", GetLastError());
+    NewBuffer = VirtualAlloc(Buffer, BUFFER_SIZE, MEM_COMMIT, PAGE_READWRITE);
+    ok(NewBuffer == Buffer, "NewBuffer = %p, Buffer = %p\n", NewBuffer, Buffer);
+
+    Status = TestIo(FileHandle, FALSE, Buffer + 100, SMALL_IO_SIZE, KEY_DATA(0x66));
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ok(CheckData(Buffer + 100, SMALL_IO_SIZE, 0x66), "Wrong data\n");
+    Status = NtDeregisterIoBuffer(BufferId);
+    ok_eq_hex(Status, STATUS_INVALID_PARAMETER);
+
+    /* So does releasing them, even if the same address comes back */
+    Status = NtRegisterIoBuffer(Buffer, BUFFER_SIZE, &BufferId);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    Ret = VirtualFree(Buffer, 0, MEM_RELEASE);
+    ok(Ret, "VirtualFree failed with %lu\n", GetLastError());
+    NewBuffer = VirtualAlloc(Buffer, BUFFER_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (skip(NewBuffer != NULL, "Address %p was taken\n", Buffer))
+        return;
+
+    Status = TestIo(FileHandle, FALSE, NewBuffer + 100, SMALL_IO_SIZE, KEY_DATA(0x77));
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ok(CheckData(NewBuffer + 100, SMALL_IO_SIZE, 0x77), "Wrong data\n");
+    Status = NtDeregisterIoBuffer(BufferId);
+    ok_eq_hex(Status, STATUS_INVALID_PARAMETER);
+
+    /* The new memory can be registered without conflict */
+    Status = NtRegisterIoBuffer(NewBuffer, BUFFER_SIZE, &BufferId);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (NT_SUCCESS(Status))
+    {
+        Status = NtDeregisterIoBuffer(BufferId);
+        ok_eq_hex(Status, STATUS_SUCCESS);
+    }
+
+    VirtualFree(NewBuffer, 0, MEM_RELEASE);
+}
+
+static
+ULONGLONG
+TimeIo(
+    _In_ HANDLE FileHandle,
+    _In_ BOOLEAN Write,
+    _In_ PUCHAR Buffer)
+{
+    LARGE_INTEGER Start, End;
+    NTSTATUS Status;
+    ULONG i, Failures = 0;
+
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < ITERATIONS; i++)
+    {
+        Status = TestIo(FileHandle, Write, Buffer, SMALL_IO_SIZE, KEY_NO_DATA);
+        if (!NT_SUCCESS(Status))
+            Failures++;
+    }
+    QueryPerformanceCounter(&End);
+
+    ok_eq_ulong(Failures, 0LU);
+    return End.QuadPart - Start.QuadPart;
+}
+
+static
+VOID
+TestLatency(
+    _In_ HANDLE FileHandle,
+    _In_ PUCHAR Buffer,
+    _In_ BOOLEAN CanRegister)
+{
+    LARGE_INTEGER Frequency;
+    ULONGLONG Read, Write;
+    NTSTATUS Status;
+    ULONG BufferId;
+
+    QueryPerformanceFrequency(&Frequency);
+
+    /* Probe and lock on every request */
+    Read = TimeIo(FileHandle, FALSE, Buffer);
+    Write = TimeIo(FileHandle, TRUE, Buffer);
+    trace("Locked:     %u bytes: read %I64u ns, write %I64u ns\n",
+          SMALL_IO_SIZE,
+          Read * 1000000000 / Frequency.QuadPart / ITERATIONS,
+          Write * 1000000000 / Frequency.QuadPart / ITERATIONS);
+
+    if (skip(CanRegister, "No registration\n"))
+        return;
+
+    /* Use the pages locked at registration */
+    Status = NtRegisterIoBuffer(Buffer, BUFFER_SIZE, &BufferId);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+        return;
+
+    Read = TimeIo(FileHandle, FALSE, Buffer);
+    Write = TimeIo(FileHandle, TRUE, Buffer);
+    trace("Registered: %u bytes: read %I64u ns, write %I64u ns\n",
+          SMALL_IO_SIZE,
+          Read * 1000000000 / Frequency.QuadPart / ITERATIONS,
+          Write * 1000000000 / Frequency.QuadPart / ITERATIONS);
+
+    Status = NtDeregisterIoBuffer(BufferId);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+}
+
+START_TEST(IoDirectIo)
+{
+    UNICODE_STRING FileName = RTL_CONSTANT_STRING(L"\\Device\\Kmtest-IoDirectIo");
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    IO_STATUS_BLOCK IoStatus;
+    HANDLE FileHandle = NULL;
+    PUCHAR Buffer;
+    BOOLEAN WasEnabled;
+    NTSTATUS Status;
+
+    KmtLoadDriver(L"IoDirectIo", FALSE);
+    KmtOpenDriver();
+
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &FileName,
+                               OBJ_CASE_INSENSITIVE,
+                               NULL,
+                               NULL);
+    Status = NtOpenFile(&FileHandle,
+                        FILE_READ_DATA | FILE_WRITE_DATA | SYNCHRONIZE,
+                        &ObjectAttributes,
+                        &IoStatus,
+                        0,
+                        FILE_NON_DIRECTORY_FILE |
+                        FILE_SYNCHRONOUS_IO_NONALERT);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+
+    Buffer = VirtualAlloc(NULL, 2 * BUFFER_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    ok(Buffer != NULL, "VirtualAlloc failed with %lu\n", GetLastError());
+
+    if (!skip(NT_SUCCESS(Status) && Buffer != NULL, "No file or buffer\n"))
+    {
+        /* Registered pages stay locked, like the ones of VirtualLock */
+        Status = RtlAdjustPrivilege(SE_LOCK_MEMORY_PRIVILEGE, TRUE, FALSE, &WasEnabled);
+        if (!skip(NT_SUCCESS(Status), "No SeLockMemoryPrivilege\n"))
+        {
+            TestRegistration(FileHandle, Buffer);
+            TestFreedBuffer(FileHandle);
+        }
+
+        TestLatency(FileHandle, Buffer, NT_SUCCESS(Status));
+
+        if (NT_SUCCESS(Status) && !WasEnabled)
+            RtlAdjustPrivilege(SE_LOCK_MEMORY_PRIVILEGE, FALSE, FALSE, &WasEnabled);
+    }
+
+    if (Buffer)
+        VirtualFree(Buffer, 0, MEM_RELEASE);
+    if (FileHandle)
+        NtClose(FileHandle);
+
+    KmtCloseDriver();
+    KmtUnloadDriver();
+}
@@ -0,0 +1,174 @@
+/*
+ * PROJECT:     ReactOS kernel-mode tests
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Kernel-Mode Test Suite handle table open/close stress test
+ */
+
+#include <kmt_test.h>
+
+#define NDEBUG
+#include <debug.h>
+
+#define HANDLES_PER_ROUND 64
+#define ROUNDS 200
+#define MAX_THREADS 8
+
+/* Live handles of all threads, indexed by handle value / 4 */
+#define LIVE_TABLE_SIZE 0x10000
+#define LIVE_TABLE_TAG 'sHmK'
+#define HandleToLiveIndex(h) (((ULONG_PTR)(h) & 0x7FFFFFFF) >> 2)
+
+typedef struct _STRESS_CONTEXT
+{
+    HANDLE SourceHandle;
+    KEVENT StartEvent;
+    volatile LONG *LiveTable;
+    volatile LONG Opened;
+    volatile LONG Collisions;
+    volatile LONG Untracked;
+    volatile LONG Failures;
+} STRESS_CONTEXT, *PSTRESS_CONTEXT;
+
+static
+VOID
+NTAPI
+StressThread(
+    _In_ PVOID Parameter)
+{
+    PSTRESS_CONTEXT Context = Parameter;
+    HANDLE Handles[HANDLES_PER_ROUND];
+    NTSTATUS Status;
+    ULONG_PTR Index;
+    ULONG Round, i;
+
+    KeWaitForSingleObject(&Context->StartEvent, Executive, KernelMode, FALSE, NULL);
+
+    for (Round = 0; Round < ROUNDS; Round++)
+    {
+        for (i = 0; i < HANDLES_PER_ROUND; i++)
+        {
+            Status = ZwDuplicateObject(ZwCurrentProcess(),
+                                       Context->SourceHandle,
+                                       ZwCurrentProcess(),
+                                       &Handles[i],
+                                       0,
+                                       OBJ_KERNEL_HANDLE,
+                                       DUPLICATE_SAME_ACCESS);
+            if (!NT_SUCCESS(Status))
+            {
+                InterlockedIncrement(&Context->Failures);
+                break;
+            }
+            InterlockedIncrement(&Context->Opened);
+
+            /* No thread may hold the same handle value at the same time */
+            Index = HandleToLiveIndex(Handles[i]);
+            if (Index >= LIVE_TABLE_SIZE)
+                InterlockedIncrement(&Context->Untracked);
+            else if (InterlockedCompareExchange(&Context->LiveTable[Index], 1, 0) != 0)
+                InterlockedIncrement(&Context->Collisions);
+        }
+
+        while (i--)
+        {
+            /* Give the slot up while the handle is still ours */
+            Index = HandleToLiveIndex(Handles[i]);
+            if (Index < LIVE_TABLE_SIZE &&
+                InterlockedExchange(&Context->LiveTable[Index], 0) != 1)
+            {
+                InterlockedIncrement(&Context->Collisions);
+            }
+
+            Status = ZwClose(Handles[i]);
+            if (!NT_SUCCESS(Status))
+                InterlockedIncrement(&Context->Failures);
+        }
+    }
+}
+
+static
+VOID
+RunStress(
+    _In_ HANDLE SourceHandle,
+    _In_ volatile LONG *LiveTable,
+    _In_ ULONG ThreadCount)
+{
+    STRESS_CONTEXT Context;
+    PKTHREAD Threads[MAX_THREADS];
+    ULONG i, LiveCount;
+
+    Context.SourceHandle = SourceHandle;
+    Context.LiveTable = LiveTable;
+    Context.Opened = 0;
+    Context.Collisions = 0;
+    Context.Untracked = 0;
+    Context.Failures = 0;
+    KeInitializeEvent(&Context.StartEvent, NotificationEvent, FALSE);
+
+    for (i = 0; i < ThreadCount; i++)
+    {
+        Threads[i] = KmtStartThread(StressThread, &Context);
+    }
+
+    KeSetEvent(&Context.StartEvent, IO_NO_INCREMENT, FALSE);
+
+    for (i = 0; i < ThreadCount; i++)
+    {
+        KmtFinishThread(Threads[i], NULL);
+    }
+
+    ok_eq_long(Context.Failures, 0L);
+    ok_eq_long(Context.Opened, (LONG)(ThreadCount * ROUNDS * HANDLES_PER_ROUND));
+    ok_eq_long(Context.Collisions, 0L);
+    ok_eq_long(Context.Untracked, 0L);
+
+    /* Every handle that was opened has been given back */
+    LiveCount = 0;
+    for (i = 0; i < LIVE_TABLE_SIZE; i++)
+    {
+        if (LiveTable[i])
+            LiveCount++;
+    }
+    ok_eq_ulong(LiveCount, 0UL);
+}
+
+START_TEST(ObHandleStress)
+{
+    NTSTATUS Status;
+    HANDLE EventHandle;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    volatile LONG *LiveTable;
+    ULONG ThreadCount;
+
+    InitializeObjectAttributes(&ObjectAttributes,
+                               NULL,
+                               OBJ_KERNEL_HANDLE,
+                               NULL,
+                               NULL);
+    Status = ZwCreateEvent(&EventHandle,
+                           EVENT_ALL_ACCESS,
+                           &ObjectAttributes,
+                           NotificationEvent,
+                           FALSE);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (skip(NT_SUCCESS(Status), "No event\n"))
+        return;
+
+    LiveTable = ExAllocatePoolWithTag(NonPagedPool,
+                                      LIVE_TABLE_SIZE * sizeof(LONG),
+                                      LIVE_TABLE_TAG);
+    ok(LiveTable != NULL, "Failed to allocate the live handle table\n");
+    if (!skip(LiveTable != NULL, "No memory for the live handle table\n"))
+    {
+        RtlZeroMemory((PVOID)LiveTable, LIVE_TABLE_SIZE * sizeof(LONG));
+
+        /* At least two threads, so that handles also move between processors */
+        ThreadCount = min(max((ULONG)KeNumberProcessors * 2, 2), MAX_THREADS);
+        RunStress(EventHandle, LiveTable, ThreadCount);
+
+        ExFreePoolWithTag((PVOID)LiveTable, LIVE_TABLE_TAG);
+    }
+
+    Status = ZwClose(EventHandle);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+}
@@ -20,6 +20,44 @@ EX_PUSH_LOCK HandleTableListLock;
 #define SizeOfHandle(x) (sizeof(HANDLE) * (x))
 #define INDEX_TO_HANDLE_VALUE(x) ((x) << HANDLE_TAG_BITS)
 
+/*
+ * Per-processor caches of free handle values. They live right behind the
+ * HANDLE_TABLE so that its NDK layout stays untouched. A slot is either
+ * zero or holds the value of a free handle; because the value names the
+ * entry, slots are claimed with a single compare-exchange without any ABA
+ * concern, and a thread migrating to another processor merely uses a cold
+ * cache. Hits never touch the table push locks or the shared free lists.
+ */
+#define EXP_HANDLE_CACHE_SLOTS  15
+#define EXP_MAX_HANDLE_CACHES   8
+
+typedef struct _EXP_HANDLE_FREE_CACHE
+{
+    volatile LONG Slots[EXP_HANDLE_CACHE_SLOTS];
+    ULONG Padding;
+} EXP_HANDLE_FREE_CACHE, *PEXP_HANDLE_FREE_CACHE;
+
+typedef struct _EXP_HANDLE_TABLE
+{
+    HANDLE_TABLE Table;
+    ULONG CacheCount;
+    EXP_HANDLE_FREE_CACHE Cache[ANYSIZE_ARRAY];
+} EXP_HANDLE_TABLE, *PEXP_HANDLE_TABLE;
+
+FORCEINLINE
+PEXP_HANDLE_FREE_CACHE
+ExpGetHandleFreeCache(IN PHANDLE_TABLE HandleTable)
+{
+    PEXP_HANDLE_TABLE ExpTable = CONTAINING_RECORD(HandleTable,
+                                                   EXP_HANDLE_TABLE,
+                                                   Table);
+
+    /* Strict FIFO tables must hand out handles in order */
+    if ((HandleTable->StrictFIFO) || !(ExpTable->CacheCount)) return NULL;
+
+    return &ExpTable->Cache[KeGetCurrentProcessorNumber() % ExpTable->CacheCount];
+}
+
 /* PRIVATE FUNCTIONS *********************************************************/
 
 CODE_SEG("INIT")
@@ -259,7 +297,8 @@ ExpFreeHandleTableEntry(IN PHANDLE_TABLE HandleTable,
                         IN PHANDLE_TABLE_ENTRY HandleTableEntry)
 {
     ULONG OldValue, *Free;
-    ULONG LockIndex;
+    ULONG LockIndex, i;
+    PEXP_HANDLE_FREE_CACHE Cache;
     PAGED_CODE();
 
     /* Sanity checks */
@@ -272,6 +311,22 @@ ExpFreeHandleTableEntry(IN PHANDLE_TABLE HandleTable,
     /* Mark the handle as free */
     Handle.TagBits = 0;
 
+    /* Try to park it in the cache of the current processor first */
+    Cache = ExpGetHandleFreeCache(HandleTable);
+    if (Cache)
+    {
+        HandleTableEntry->NextFreeTableEntry = 0;
+        for (i = 0; i < EXP_HANDLE_CACHE_SLOTS; i++)
+        {
+            if (!Cache->Slots[i] &&
+                !InterlockedCompareExchange(&Cache->Slots[i], Handle.AsULONG, 0))
+            {
+                /* Cached, nothing else to do */
+                return;
+            }
+        }
+    }
+
     /* Check if we're FIFO */
     if (!HandleTable->StrictFIFO)
     {
@@ -310,15 +365,27 @@ ExpAllocateHandleTable(IN PEPROCESS Process OPTIONAL,
                        IN BOOLEAN NewTable)
 {
     PHANDLE_TABLE HandleTable;
+    PEXP_HANDLE_TABLE ExpTable;
     PHANDLE_TABLE_ENTRY HandleTableTable, HandleEntry;
-    ULONG i;
+    ULONG i, CacheCount;
+    SIZE_T Size;
     PAGED_CODE();
 
+    /*
+     * Use one free handle cache per processor. Tables without a process,
+     * such as the kernel one, are created before the other processors
+     * are started, so give them the maximum right away.
+     */
+    CacheCount = Process ? min((ULONG)KeNumberProcessors, EXP_MAX_HANDLE_CACHES) :
+                           EXP_MAX_HANDLE_CACHES;
+    Size = FIELD_OFFSET(EXP_HANDLE_TABLE, Cache) +
+           CacheCount * sizeof(EXP_HANDLE_FREE_CACHE);
+
     /* Allocate the table */
-    HandleTable = ExAllocatePoolWithTag(PagedPool,
-                                        sizeof(HANDLE_TABLE),
-                                        TAG_OBJECT_TABLE);
-    if (!HandleTable) return NULL;
+    ExpTable = ExAllocatePoolWithTag(PagedPool,
+                                     Size,
+                                     TAG_OBJECT_TABLE);
+    if (!ExpTable) return NULL;
 
     /* Check if we have a process */
     if (Process)
@@ -326,8 +393,10 @@ ExpAllocateHandleTable(IN PEPROCESS Process OPTIONAL,
         /* FIXME: Charge quota */
     }
 
-    /* Clear the table */
-    RtlZeroMemory(HandleTable, sizeof(HANDLE_TABLE));
+    /* Clear the table and its caches */
+    RtlZeroMemory(ExpTable, Size);
+    ExpTable->CacheCount = CacheCount;
+    HandleTable = &ExpTable->Table;
 
     /* Now allocate the first level structures */
     HandleTableTable = ExpAllocateTablePagedPoolNoZero(Process, PAGE_SIZE);
@@ -652,6 +721,29 @@ ExpAllocateHandleTableEntry(IN PHANDLE_TABLE HandleTable,
     EXHANDLE Handle, OldHandle;
     BOOLEAN Result;
     ULONG i;
+    PEXP_HANDLE_FREE_CACHE Cache;
+
+    /* Check the cache of the current processor first */
+    Cache = ExpGetHandleFreeCache(HandleTable);
+    if (Cache)
+    {
+        for (i = 0; i < EXP_HANDLE_CACHE_SLOTS; i++)
+        {
+            OldValue = Cache->Slots[i];
+            if ((OldValue) &&
+                (InterlockedCompareExchange(&Cache->Slots[i], 0, OldValue) == (LONG)OldValue))
+            {
+                /* Got one, it is ours now */
+                Handle.Value = OldValue;
+                Entry = ExpLookupHandleTableEntry(HandleTable, Handle);
+                ASSERT(Entry->Object == NULL);
+
+                InterlockedIncrement(&HandleTable->HandleCount);
+                *NewHandle = Handle;
+                return Entry;
+            }
+        }
+    }
 
     /* Start allocation loop */
     for (;;)
@@ -1560,6 +1560,9 @@ Phase1InitializationDiscard(IN PVOID Context)
     /* Initialize all processors */
     if (!HalAllProcessorsStarted()) KeBugCheck(HAL1_INITIALIZATION_FAILED);
 
+    /* Now that they are all running, give them their own pool lists */
+    ExInitializeProcessorPools();
+
 #ifdef CONFIG_SMP
     /* HACK: We should use RtlFindMessage and not only fallback to this */
     MpString = "MultiProcessor Kernel\r\n";
@@ -2815,6 +2815,37 @@ QSI_DEF(SystemFirmwareTableInformation)
     return Status;
 }
 
+/* Class 0x1000 - Pool allocation tracing (ReactOS-specific) */
+QSI_DEF(SystemPoolTraceInformation)
+{
+    /* The records contain kernel addresses */
+    if (!SeSinglePrivilegeCheck(SeDebugPrivilege, ExGetPreviousMode()))
+    {
+        return STATUS_ACCESS_DENIED;
+    }
+
+    return ExGetPoolTraceInfo(Buffer, Size, ReqSize);
+}
+
+SSI_DEF(SystemPoolTraceInformation)
+{
+    SYSTEM_POOL_TRACE_CONTROL Control;
+
+    if (sizeof(SYSTEM_POOL_TRACE_CONTROL) != Size)
+    {
+        return STATUS_INFO_LENGTH_MISMATCH;
+    }
+
+    if (!SeSinglePrivilegeCheck(SeDebugPrivilege, ExGetPreviousMode()))
+    {
+        return STATUS_ACCESS_DENIED;
+    }
+
+    /* Capture the settings before using them */
+    Control = *(PSYSTEM_POOL_TRACE_CONTROL)Buffer;
+    return ExSetPoolTraceInfo(&Control);
+}
+
 /* Query/Set Calls Table */
 typedef
 struct _QSSI_CALLS
@@ -2920,6 +2951,34 @@ C_ASSERT(SystemBasicInformation == 0);
 #define MIN_SYSTEM_INFO_CLASS (SystemBasicInformation)
 #define MAX_SYSTEM_INFO_CLASS (sizeof(CallQS) / sizeof(CallQS[0]))
 
+/* ReactOS-specific classes, kept out of the range Windows uses */
+static
+QSSI_CALLS
+CallQSReactOS [] =
+{
+    SI_QS(SystemPoolTraceInformation),
+};
+
+C_ASSERT(sizeof(CallQSReactOS) / sizeof(CallQSReactOS[0]) ==
+         MaxSystemReactOSInfoClass - SystemReactOSInformationBase);
+#define MIN_REACTOS_INFO_CLASS (SystemReactOSInformationBase)
+#define MAX_REACTOS_INFO_CLASS (SystemReactOSInformationBase + sizeof(CallQSReactOS) / sizeof(CallQSReactOS[0]))
+
+static
+QSSI_CALLS*
+ExpGetSystemInformationCalls(IN SYSTEM_INFORMATION_CLASS SystemInformationClass)
+{
+    ULONG Class = (ULONG)SystemInformationClass;
+
+    if ((Class >= MIN_SYSTEM_INFO_CLASS) && (Class < MAX_SYSTEM_INFO_CLASS))
+        return &CallQS[Class];
+
+    if ((Class >= MIN_REACTOS_INFO_CLASS) && (Class < MAX_REACTOS_INFO_CLASS))
+        return &CallQSReactOS[Class - MIN_REACTOS_INFO_CLASS];
+
+    return NULL;
+}
+
 /*
  * @implemented
  */
@@ -2936,6 +2995,7 @@ NtQuerySystemInformation(
     ULONG ResultLength = 0;
     ULONG Alignment = TYPE_ALIGNMENT(ULONG);
     NTSTATUS FStatus = STATUS_NOT_IMPLEMENTED;
+    QSSI_CALLS *Calls;
 
     PAGED_CODE();
 
@@ -2947,8 +3007,8 @@ NtQuerySystemInformation(
         /*
          * Check if the request is valid.
          */
-        if (SystemInformationClass < MIN_SYSTEM_INFO_CLASS ||
-            SystemInformationClass >= MAX_SYSTEM_INFO_CLASS)
+        Calls = ExpGetSystemInformationCalls(SystemInformationClass);
+        if (!Calls)
         {
             _SEH2_YIELD(return STATUS_INVALID_INFO_CLASS);
         }
@@ -2972,21 +3032,21 @@ NtQuerySystemInformation(
         /*
          * Check if the request is valid.
          */
-        if (SystemInformationClass < MIN_SYSTEM_INFO_CLASS ||
-            SystemInformationClass >= MAX_SYSTEM_INFO_CLASS)
+        Calls = ExpGetSystemInformationCalls(SystemInformationClass);
+        if (!Calls)
         {
             _SEH2_YIELD(return STATUS_INVALID_INFO_CLASS);
         }
 #endif
 
-        if (NULL != CallQS [SystemInformationClass].Query)
+        if (NULL != Calls->Query)
         {
             /*
              * Hand the request to a subhandler.
              */
-            FStatus = CallQS [SystemInformationClass].Query(SystemInformation,
-                                                            Length,
-                                                            &ResultLength);
+            FStatus = Calls->Query(SystemInformation,
+                                   Length,
+                                   &ResultLength);
 
             /* Save the result length to the caller */
             if (UnsafeResultLength)
@@ -3011,6 +3071,7 @@ NtSetSystemInformation (IN SYSTEM_INFORMATION_CLASS SystemInformationClass,
 {
     NTSTATUS Status = STATUS_INVALID_INFO_CLASS;
     KPROCESSOR_MODE PreviousMode;
+    QSSI_CALLS *Calls;
 
     PAGED_CODE();
 
@@ -3030,16 +3091,16 @@ NtSetSystemInformation (IN SYSTEM_INFORMATION_CLASS SystemInformationClass,
         /*
          * Check the request is valid.
          */
-        if ((SystemInformationClass >= MIN_SYSTEM_INFO_CLASS) &&
-            (SystemInformationClass < MAX_SYSTEM_INFO_CLASS))
+        Calls = ExpGetSystemInformationCalls(SystemInformationClass);
+        if (Calls)
         {
-            if (NULL != CallQS [SystemInformationClass].Set)
+            if (NULL != Calls->Set)
             {
                 /*
                  * Hand the request to a subhandler.
                  */
-                Status = CallQS [SystemInformationClass].Set(SystemInformation,
-                                                             SystemInformationLength);
+                Status = Calls->Set(SystemInformation,
+                                    SystemInformationLength);
             }
         }
     }
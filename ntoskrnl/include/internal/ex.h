@@ -165,6 +165,20 @@ ExGetPoolTagInfo(
     IN OUT PULONG ReturnLength OPTIONAL
 );
 
+NTSTATUS
+NTAPI
+ExGetPoolTraceInfo(
+    IN PSYSTEM_POOL_TRACE_INFORMATION SystemInformation,
+    IN ULONG SystemInformationLength,
+    IN OUT PULONG ReturnLength OPTIONAL
+);
+
+NTSTATUS
+NTAPI
+ExSetPoolTraceInfo(
+    IN PSYSTEM_POOL_TRACE_CONTROL Control
+);
+
 typedef struct _UUID_CACHED_VALUES_STRUCT
 {
     ULONGLONG Time;
@@ -291,6 +305,10 @@ VOID
 NTAPI
 ExInitPoolLookasidePointers(VOID);
 
+VOID
+NTAPI
+ExInitializeProcessorPools(VOID);
+
 /* Callback Functions ********************************************************/
 
 VOID
@@ -92,6 +92,21 @@
 #define IOP_USE_TOP_LEVEL_DEVICE_HINT       0x01
 #define IOP_CREATE_FILE_OBJECT_EXTENSION    0x02
 
+//
+// Private IRP flag: the first MDL of the IRP only holds a reference on a
+// registered buffer, its pages are not locked for this request
+//
+#define IRP_REGISTERED_BUFFER_IO            0x00010000
+
+//
+// Set-only information class of Windows 2003 SP2, which the headers we build
+// against don't know about. It comes right after the last one they have.
+//
+#if (NTDDI_VERSION < NTDDI_VISTA)
+#define FileIoCompletionNotificationInformation         \
+    ((FILE_INFORMATION_CLASS)FileMaximumInformation)
+#endif
+
 
 typedef struct _FILE_OBJECT_EXTENSION
 {
@@ -119,6 +134,13 @@ typedef struct _FILE_OBJECT_EXTENSION
         FALSE :                                         \
         FileObject->Flags & FO_SYNCHRONOUS_IO))         \
 
+//
+// Determines if a request which didn't pend can skip the completion port
+//
+#define IopSkipCompletionPort(FileObject, Status)       \
+    ((FileObject->Flags & FO_SKIP_COMPLETION_PORT) &&   \
+     NT_SUCCESS(Status))                                \
+
 //
 // Returns the internal Device Object Extension
 //
@@ -1057,6 +1079,44 @@ IopCompleteRequest(
     IN PVOID* SystemArgument2
 );
 
+//
+// Registered Buffer Routines
+//
+PMDL
+NTAPI
+IopAllocateRegisteredBufferMdl(
+    IN PVOID VirtualAddress,
+    IN ULONG Length,
+    IN PIRP Irp
+);
+
+VOID
+NTAPI
+IopReleaseRegisteredBufferMdl(
+    IN PMDL Mdl
+);
+
+VOID
+NTAPI
+IopDropRegisteredBuffers(
+    IN PEPROCESS Process,
+    IN ULONG_PTR StartingAddress,
+    IN ULONG_PTR EndingAddress,
+    OUT PLIST_ENTRY FreeList
+);
+
+VOID
+NTAPI
+IopReleaseRegisteredBuffers(
+    IN PLIST_ENTRY FreeList
+);
+
+VOID
+NTAPI
+IopRundownRegisteredBuffers(
+    IN PEPROCESS Process
+);
+
 //
 // Error Logging Routines
 //
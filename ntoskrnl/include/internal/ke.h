@@ -70,6 +70,19 @@ typedef struct _DPC_QUEUE_ENTRY
     PVOID Context;
 } DPC_QUEUE_ENTRY, *PDPC_QUEUE_ENTRY;
 
+typedef struct DECLSPEC_CACHEALIGN _KI_DPC_STATISTICS
+{
+    ULONGLONG RequestTime;
+    ULONGLONG TotalLatency;
+    ULONGLONG MaximumLatency;
+    ULONG RetireCount;
+    ULONG MaximumQueueDepth;
+    ULONG IpiRequestCount;
+    ULONG IpiCoalescedCount;
+    KAFFINITY DeferredIpiSet;
+    BOOLEAN DeferIpis;
+} KI_DPC_STATISTICS, *PKI_DPC_STATISTICS;
+
 typedef struct _KNMI_HANDLER_CALLBACK
 {
     struct _KNMI_HANDLER_CALLBACK* Next;
@@ -116,6 +129,7 @@ extern ULONG KiMinimumDpcRate;
 extern ULONG KiAdjustDpcThreshold;
 extern ULONG KiIdealDpcRate;
 extern BOOLEAN KeThreadDpcEnable;
+extern KI_DPC_STATISTICS KiDpcStatistics[MAXIMUM_PROCESSORS];
 extern LARGE_INTEGER KiTimeIncrementReciprocal;
 extern UCHAR KiTimeIncrementShiftCount;
 extern ULONG KiTimeLimitIsrMicroseconds;
@@ -645,6 +659,17 @@ KiInsertQueue(
     BOOLEAN Head
 );
 
+ULONG
+NTAPI
+KeRemoveQueueEx(
+    IN PKQUEUE Queue,
+    IN KPROCESSOR_MODE WaitMode,
+    IN BOOLEAN Alertable,
+    IN PLARGE_INTEGER Timeout OPTIONAL,
+    OUT PLIST_ENTRY *EntryArray,
+    IN ULONG Count
+);
+
 VOID
 NTAPI
 KiTimerExpiration(
@@ -101,23 +101,18 @@ LpcpAllocateFromPortZone(VOID)
 {
     PLPCP_MESSAGE Message;
 
-    /* Allocate a message from the port zone while holding the lock */
-    KeAcquireGuardedMutex(&LpcpLock);
+    /* Allocate a message from the port zone, the lookaside list is interlocked */
     Message = (PLPCP_MESSAGE)ExAllocateFromPagedLookasideList(&LpcpMessagesLookaside);
     if (!Message)
     {
         /* Fail, and let caller cleanup */
-        KeReleaseGuardedMutex(&LpcpLock);
         return NULL;
     }
 
-    /* Initialize it */
+    /* Initialize it, nobody else can see it yet */
     InitializeListHead(&Message->Entry);
     Message->RepliedToThread = NULL;
     Message->Request.u2.ZeroInit = 0;
-
-    /* Release the lock */
-    KeReleaseGuardedMutex(&LpcpLock);
     return Message;
 }
 
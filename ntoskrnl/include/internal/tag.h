@@ -71,6 +71,7 @@
 #define TAG_EA              'aEoI'
 #define TAG_IO_NAME         'mNoI'
 #define TAG_REINIT          'iRoI'
+#define TAG_IO_BUFFER       'fBoI'
 
 /* formerly located in io/work.c */
 #define TAG_IOWI 'IWOI'
@@ -0,0 +1,445 @@
+/*
+ * PROJECT:         ReactOS Kernel
+ * LICENSE:         GPL - See COPYING in the top level directory
+ * FILE:            ntoskrnl/io/iomgr/iobuf.c
+ * PURPOSE:         Registered User Buffers for Direct I/O
+ */
+
+/* INCLUDES *****************************************************************/
+
+#include <ntoskrnl.h>
+#define NDEBUG
+#include <debug.h>
+
+/*
+ * A registered buffer is a range of user memory that is probed and locked
+ * once, when the process registers it, instead of on every read and write.
+ * Direct I/O that falls entirely inside a registered buffer gets a partial
+ * MDL built from the cached one, which only copies the page frame numbers,
+ * and the IRP is marked with IRP_REGISTERED_BUFFER_IO.
+ *
+ * Every entry holds one reference for the registration itself and one for
+ * each IRP that is using its pages. The pages are unlocked when the last
+ * reference goes away, so deregistering a buffer with I/O still in flight
+ * is safe. Entries stay on the list of their process until then and never
+ * overlap each other, which lets I/O completion find the entry again from
+ * the partial MDL alone.
+ *
+ * Freeing or unmapping memory drops the registrations inside it, so that
+ * whatever gets mapped at the same address later is not served from the
+ * old pages. Mm does this in two steps: the registrations are marked as
+ * deregistered while it still holds the address space lock, before the
+ * PTEs go away, and the pages they kept locked are only released once the
+ * lock has been dropped.
+ */
+typedef struct _IO_REGISTERED_BUFFER
+{
+    LIST_ENTRY ListEntry;
+    PEPROCESS Process;
+    PMDL Mdl;
+    ULONG_PTR Start;
+    ULONG_PTR End;
+    ULONG Id;
+    LONG References;
+    BOOLEAN Deregistered;
+} IO_REGISTERED_BUFFER, *PIO_REGISTERED_BUFFER;
+
+ULONG IopRegisteredBufferId;
+
+/* PRIVATE FUNCTIONS *********************************************************/
+
+static
+VOID
+IopFreeRegisteredBuffer(IN PIO_REGISTERED_BUFFER Buffer)
+{
+    /* Unlock the pages and get rid of the entry */
+    MmUnlockPages(Buffer->Mdl);
+    IoFreeMdl(Buffer->Mdl);
+    ObDereferenceObject(Buffer->Process);
+    ExFreePoolWithTag(Buffer, TAG_IO_BUFFER);
+}
+
+static
+BOOLEAN
+IopDereferenceRegisteredBufferLocked(IN PIO_REGISTERED_BUFFER Buffer)
+{
+    /* Drop the reference and unlink the entry if it was the last one */
+    ASSERT(Buffer->References > 0);
+    if (--Buffer->References) return FALSE;
+
+    RemoveEntryList(&Buffer->ListEntry);
+    return TRUE;
+}
+
+static
+VOID
+IopDereferenceRegisteredBuffer(IN PIO_REGISTERED_BUFFER Buffer)
+{
+    PEPROCESS Process = Buffer->Process;
+    KIRQL OldIrql;
+    BOOLEAN Free;
+
+    KeAcquireSpinLock(&Process->RegisteredIoBufferLock, &OldIrql);
+    Free = IopDereferenceRegisteredBufferLocked(Buffer);
+    KeReleaseSpinLock(&Process->RegisteredIoBufferLock, OldIrql);
+
+    /* This was the last I/O on a buffer that has been deregistered */
+    if (Free) IopFreeRegisteredBuffer(Buffer);
+}
+
+static
+PIO_REGISTERED_BUFFER
+IopFindRegisteredBufferLocked(IN PEPROCESS Process,
+                              IN ULONG_PTR Start,
+                              IN ULONG_PTR End)
+{
+    PLIST_ENTRY ListEntry;
+    PIO_REGISTERED_BUFFER Buffer;
+
+    /* Look for the entry of this process which contains the range */
+    for (ListEntry = Process->RegisteredIoBufferListHead.Flink;
+         ListEntry != &Process->RegisteredIoBufferListHead;
+         ListEntry = ListEntry->Flink)
+    {
+        Buffer = CONTAINING_RECORD(ListEntry, IO_REGISTERED_BUFFER, ListEntry);
+        if ((Start >= Buffer->Start) && (End <= Buffer->End)) return Buffer;
+    }
+
+    return NULL;
+}
+
+static
+VOID
+IopDeregisterBuffers(IN PEPROCESS Process,
+                     IN ULONG_PTR Start,
+                     IN ULONG_PTR End,
+                     IN PLIST_ENTRY FreeList)
+{
+    PLIST_ENTRY ListEntry, NextEntry;
+    PIO_REGISTERED_BUFFER Buffer;
+    KIRQL OldIrql;
+
+    /* Drop the registration reference of every live buffer in the range */
+    KeAcquireSpinLock(&Process->RegisteredIoBufferLock, &OldIrql);
+    for (ListEntry = Process->RegisteredIoBufferListHead.Flink;
+         ListEntry != &Process->RegisteredIoBufferListHead;
+         ListEntry = NextEntry)
+    {
+        NextEntry = ListEntry->Flink;
+        Buffer = CONTAINING_RECORD(ListEntry, IO_REGISTERED_BUFFER, ListEntry);
+        if ((Buffer->Deregistered) ||
+            (Buffer->Start >= End) ||
+            (Start >= Buffer->End))
+        {
+            continue;
+        }
+
+        Buffer->Deregistered = TRUE;
+        if (IopDereferenceRegisteredBufferLocked(Buffer))
+        {
+            InsertTailList(FreeList, &Buffer->ListEntry);
+        }
+    }
+    KeReleaseSpinLock(&Process->RegisteredIoBufferLock, OldIrql);
+}
+
+PMDL
+NTAPI
+IopAllocateRegisteredBufferMdl(IN PVOID VirtualAddress,
+                               IN ULONG Length,
+                               IN PIRP Irp)
+{
+    PEPROCESS Process = PsGetCurrentProcess();
+    PIO_REGISTERED_BUFFER Buffer;
+    ULONG_PTR Start = (ULONG_PTR)VirtualAddress;
+    KIRQL OldIrql;
+    PMDL Mdl;
+
+    /* Nothing to do if the process has not registered anything */
+    if (IsListEmpty(&Process->RegisteredIoBufferListHead)) return NULL;
+    if ((Start + Length) < Start) return NULL;
+
+    /* Find a registered buffer covering the whole transfer and reference it */
+    KeAcquireSpinLock(&Process->RegisteredIoBufferLock, &OldIrql);
+    Buffer = IopFindRegisteredBufferLocked(Process, Start, Start + Length);
+    if ((Buffer) && !(Buffer->Deregistered))
+    {
+        Buffer->References++;
+    }
+    else
+    {
+        Buffer = NULL;
+    }
+    KeReleaseSpinLock(&Process->RegisteredIoBufferLock, OldIrql);
+    if (!Buffer) return NULL;
+
+    /* Describe the transfer with the pages we already have locked */
+    Mdl = IoAllocateMdl(VirtualAddress, Length, FALSE, TRUE, Irp);
+    if (!Mdl)
+    {
+        /* Let the caller go the usual way */
+        IopDereferenceRegisteredBuffer(Buffer);
+        return NULL;
+    }
+
+    /* Tell completion that this MDL only holds a reference */
+    IoBuildPartialMdl(Buffer->Mdl, Mdl, VirtualAddress, Length);
+    Irp->Flags |= IRP_REGISTERED_BUFFER_IO;
+    return Mdl;
+}
+
+VOID
+NTAPI
+IopReleaseRegisteredBufferMdl(IN PMDL Mdl)
+{
+    PEPROCESS Process = Mdl->Process;
+    PIO_REGISTERED_BUFFER Buffer;
+    ULONG_PTR Start;
+    KIRQL OldIrql;
+    BOOLEAN Free;
+
+    ASSERT(Mdl->MdlFlags & MDL_PARTIAL);
+    Start = (ULONG_PTR)Mdl->StartVa + Mdl->ByteOffset;
+
+    /*
+     * The IRP holds a reference, so the entry is still on the list, and it
+     * is the only one there containing the range.
+     */
+    KeAcquireSpinLock(&Process->RegisteredIoBufferLock, &OldIrql);
+    Buffer = IopFindRegisteredBufferLocked(Process,
+                                           Start,
+                                           Start + Mdl->ByteCount);
+    ASSERT(Buffer);
+    Free = IopDereferenceRegisteredBufferLocked(Buffer);
+    KeReleaseSpinLock(&Process->RegisteredIoBufferLock, OldIrql);
+
+    /* This was the last I/O on a buffer that has been deregistered */
+    if (Free) IopFreeRegisteredBuffer(Buffer);
+}
+
+VOID
+NTAPI
+IopDropRegisteredBuffers(IN PEPROCESS Process,
+                         IN ULONG_PTR StartingAddress,
+                         IN ULONG_PTR EndingAddress,
+                         OUT PLIST_ENTRY FreeList)
+{
+    InitializeListHead(FreeList);
+
+    /* Nothing to do if the process has not registered anything */
+    if (IsListEmpty(&Process->RegisteredIoBufferListHead)) return;
+
+    /*
+     * The memory is going away, so is every registration inside of it. No
+     * new I/O can use them from now on, the caller releases the ones that
+     * have no I/O left with IopReleaseRegisteredBuffers.
+     */
+    IopDeregisterBuffers(Process, StartingAddress, EndingAddress, FreeList);
+}
+
+VOID
+NTAPI
+IopReleaseRegisteredBuffers(IN PLIST_ENTRY FreeList)
+{
+    PLIST_ENTRY ListEntry;
+    PIO_REGISTERED_BUFFER Buffer;
+
+    /* Unlock the pages of the buffers that no I/O is using anymore */
+    while (!IsListEmpty(FreeList))
+    {
+        ListEntry = RemoveHeadList(FreeList);
+        Buffer = CONTAINING_RECORD(ListEntry, IO_REGISTERED_BUFFER, ListEntry);
+        IopFreeRegisteredBuffer(Buffer);
+    }
+}
+
+VOID
+NTAPI
+IopRundownRegisteredBuffers(IN PEPROCESS Process)
+{
+    LIST_ENTRY FreeList;
+
+    /* Drop the registration reference of every buffer the process still has */
+    IopDropRegisteredBuffers(Process, 0, MAXULONG_PTR, &FreeList);
+    IopReleaseRegisteredBuffers(&FreeList);
+}
+
+/* PUBLIC FUNCTIONS **********************************************************/
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+NtRegisterIoBuffer(IN PVOID BaseAddress,
+                   IN ULONG Length,
+                   OUT PULONG BufferId)
+{
+    KPROCESSOR_MODE PreviousMode = ExGetPreviousMode();
+    PEPROCESS Process = PsGetCurrentProcess();
+    PIO_REGISTERED_BUFFER Buffer, Existing;
+    PLIST_ENTRY ListEntry;
+    ULONG_PTR Start = (ULONG_PTR)BaseAddress;
+    KIRQL OldIrql;
+    ULONG Id = 0;
+    NTSTATUS Status = STATUS_SUCCESS;
+    PAGED_CODE();
+
+    /* Only whole ranges of user memory can be registered */
+    if (!Length) return STATUS_INVALID_PARAMETER_2;
+    if (((Start + Length) < Start) ||
+        ((Start + Length) > MmUserProbeAddress))
+    {
+        return STATUS_INVALID_PARAMETER_1;
+    }
+
+    /* Check if this was a user-mode call */
+    if (PreviousMode != KernelMode)
+    {
+        /* Wrap probing in SEH */
+        _SEH2_TRY
+        {
+            /* Probe the ID */
+            ProbeForWriteUlong(BufferId);
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            /* Return the exception code */
+            _SEH2_YIELD(return _SEH2_GetExceptionCode());
+        }
+        _SEH2_END;
+    }
+
+    /* The pages stay locked until deregistration, just like VirtualLock */
+    if (!SeSinglePrivilegeCheck(SeLockMemoryPrivilege, PreviousMode))
+    {
+        return STATUS_PRIVILEGE_NOT_HELD;
+    }
+
+    /* Allocate the entry and the MDL describing the whole buffer */
+    Buffer = ExAllocatePoolWithTag(NonPagedPool,
+                                   sizeof(IO_REGISTERED_BUFFER),
+                                   TAG_IO_BUFFER);
+    if (!Buffer) return STATUS_INSUFFICIENT_RESOURCES;
+
+    Buffer->Mdl = IoAllocateMdl(BaseAddress, Length, FALSE, FALSE, NULL);
+    if (!Buffer->Mdl)
+    {
+        ExFreePoolWithTag(Buffer, TAG_IO_BUFFER);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    /* Lock the pages for writing, which covers reads from them too */
+    _SEH2_TRY
+    {
+        MmProbeAndLockPages(Buffer->Mdl, PreviousMode, IoWriteAccess);
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        Status = _SEH2_GetExceptionCode();
+    }
+    _SEH2_END;
+    if (!NT_SUCCESS(Status))
+    {
+        IoFreeMdl(Buffer->Mdl);
+        ExFreePoolWithTag(Buffer, TAG_IO_BUFFER);
+        return Status;
+    }
+
+    /* Fill out the entry */
+    Buffer->Process = Process;
+    ObReferenceObject(Process);
+    Buffer->Start = Start;
+    Buffer->End = Start + Length;
+    Buffer->References = 1;
+    Buffer->Deregistered = FALSE;
+
+    /* Refuse overlaps, including buffers that still have I/O in flight */
+    KeAcquireSpinLock(&Process->RegisteredIoBufferLock, &OldIrql);
+    for (ListEntry = Process->RegisteredIoBufferListHead.Flink;
+         ListEntry != &Process->RegisteredIoBufferListHead;
+         ListEntry = ListEntry->Flink)
+    {
+        Existing = CONTAINING_RECORD(ListEntry, IO_REGISTERED_BUFFER, ListEntry);
+        if ((Existing->Start < Buffer->End) &&
+            (Buffer->Start < Existing->End))
+        {
+            Status = STATUS_CONFLICTING_ADDRESSES;
+            break;
+        }
+    }
+
+    if (NT_SUCCESS(Status))
+    {
+        /* Hand out a non-zero ID and make the buffer visible to I/O */
+        do
+        {
+            Id = InterlockedIncrement((PLONG)&IopRegisteredBufferId);
+        } while (!Id);
+        Buffer->Id = Id;
+        InsertTailList(&Process->RegisteredIoBufferListHead, &Buffer->ListEntry);
+    }
+    KeReleaseSpinLock(&Process->RegisteredIoBufferLock, OldIrql);
+
+    if (!NT_SUCCESS(Status))
+    {
+        IopFreeRegisteredBuffer(Buffer);
+        return Status;
+    }
+
+    /* Protect writing the ID in SEH */
+    _SEH2_TRY
+    {
+        /* Write the ID back */
+        *BufferId = Id;
+    }
+    _SEH2_EXCEPT(ExSystemExceptionFilter())
+    {
+        /* Get the exception code and undo the registration */
+        Status = _SEH2_GetExceptionCode();
+    }
+    _SEH2_END;
+
+    if (!NT_SUCCESS(Status)) NtDeregisterIoBuffer(Id);
+    return Status;
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+NtDeregisterIoBuffer(IN ULONG BufferId)
+{
+    PEPROCESS Process = PsGetCurrentProcess();
+    PIO_REGISTERED_BUFFER Buffer = NULL;
+    PLIST_ENTRY ListEntry;
+    KIRQL OldIrql;
+    BOOLEAN Free = FALSE;
+    PAGED_CODE();
+
+    /* Find the live registration with this ID */
+    KeAcquireSpinLock(&Process->RegisteredIoBufferLock, &OldIrql);
+    for (ListEntry = Process->RegisteredIoBufferListHead.Flink;
+         ListEntry != &Process->RegisteredIoBufferListHead;
+         ListEntry = ListEntry->Flink)
+    {
+        Buffer = CONTAINING_RECORD(ListEntry, IO_REGISTERED_BUFFER, ListEntry);
+        if ((Buffer->Id == BufferId) && !(Buffer->Deregistered))
+        {
+            /* New I/O can't use it anymore, running I/O keeps the pages */
+            Buffer->Deregistered = TRUE;
+            Free = IopDereferenceRegisteredBufferLocked(Buffer);
+            break;
+        }
+
+        Buffer = NULL;
+    }
+    KeReleaseSpinLock(&Process->RegisteredIoBufferLock, OldIrql);
+
+    if (!Buffer) return STATUS_INVALID_PARAMETER;
+    if (Free) IopFreeRegisteredBuffer(Buffer);
+    return STATUS_SUCCESS;
+}
+
+/* EOF */
@@ -17,6 +17,9 @@ POBJECT_TYPE IoCompletionType;
 
 GENERAL_LOOKASIDE IoCompletionPacketLookaside;
 
+/* Most entries NtRemoveIoCompletionEx removes from the queue at once */
+#define IOP_MAX_REMOVE_BATCH 16
+
 GENERIC_MAPPING IopCompletionMapping =
 {
     STANDARD_RIGHTS_READ | IO_COMPLETION_QUERY_STATE,
@@ -137,6 +140,50 @@ IopDeleteIoCompletion(PVOID ObjectBody)
     }
 }
 
+static
+VOID
+IopUnpackCompletionPacket(IN PLIST_ENTRY ListEntry,
+                          OUT PVOID *KeyContext,
+                          OUT PVOID *ApcContext,
+                          OUT PIO_STATUS_BLOCK IoStatusBlock)
+{
+    PIOP_MINI_COMPLETION_PACKET Packet;
+    PIRP Irp;
+
+    /* Get the Packet Data */
+    Packet = CONTAINING_RECORD(ListEntry,
+                               IOP_MINI_COMPLETION_PACKET,
+                               ListEntry);
+
+    /* Check if this is piggybacked on an IRP */
+    if (Packet->PacketType == IopCompletionPacketIrp)
+    {
+        /* Get the IRP */
+        Irp = CONTAINING_RECORD(ListEntry,
+                                IRP,
+                                Tail.Overlay.ListEntry);
+
+        /* Save values */
+        *KeyContext = Irp->Tail.CompletionKey;
+        *ApcContext = Irp->Overlay.AsynchronousParameters.UserApcContext;
+        *IoStatusBlock = Irp->IoStatus;
+
+        /* Free the IRP */
+        IoFreeIrp(Irp);
+    }
+    else
+    {
+        /* Save values */
+        *KeyContext = Packet->KeyContext;
+        *ApcContext = Packet->ApcContext;
+        IoStatusBlock->Status = Packet->IoStatus;
+        IoStatusBlock->Information = Packet->IoStatusInformation;
+
+        /* Free the packet */
+        IopFreeMiniPacket(Packet);
+    }
+}
+
 /* PUBLIC FUNCTIONS **********************************************************/
 
 /*
@@ -449,11 +496,9 @@ NtRemoveIoCompletion(IN HANDLE IoCompletionHandle,
 {
     LARGE_INTEGER SafeTimeout;
     PKQUEUE Queue;
-    PIOP_MINI_COMPLETION_PACKET Packet;
     PLIST_ENTRY ListEntry;
     KPROCESSOR_MODE PreviousMode = ExGetPreviousMode();
     NTSTATUS Status;
-    PIRP Irp;
     PVOID Apc, Key;
     IO_STATUS_BLOCK IoStatus;
     PAGED_CODE();
@@ -506,46 +551,127 @@ NtRemoveIoCompletion(IN HANDLE IoCompletionHandle,
         }
         else
         {
-            /* Get the Packet Data */
-            Packet = CONTAINING_RECORD(ListEntry,
-                                       IOP_MINI_COMPLETION_PACKET,
-                                       ListEntry);
+            /* Get the values and free the packet */
+            IopUnpackCompletionPacket(ListEntry, &Key, &Apc, &IoStatus);
 
-            /* Check if this is piggybacked on an IRP */
-            if (Packet->PacketType == IopCompletionPacketIrp)
+            /* Enter SEH to write back the values */
+            _SEH2_TRY
+            {
+                /* Write the values to caller */
+                *ApcContext = Apc;
+                *KeyContext = Key;
+                *IoStatusBlock = IoStatus;
+            }
+            _SEH2_EXCEPT(ExSystemExceptionFilter())
             {
-                /* Get the IRP */
-                Irp = CONTAINING_RECORD(ListEntry,
-                                        IRP,
-                                        Tail.Overlay.ListEntry);
+                /* Get the exception code */
+                Status = _SEH2_GetExceptionCode();
+            }
+            _SEH2_END;
+        }
 
-                /* Save values */
-                Key = Irp->Tail.CompletionKey;
-                Apc = Irp->Overlay.AsynchronousParameters.UserApcContext;
-                IoStatus = Irp->IoStatus;
+        /* Dereference the Object */
+        ObDereferenceObject(Queue);
+    }
 
-                /* Free the IRP */
-                IoFreeIrp(Irp);
-            }
-            else
+    /* Return status */
+    return Status;
+}
+
+NTSTATUS
+NTAPI
+NtRemoveIoCompletionEx(IN HANDLE IoCompletionHandle,
+                       OUT PFILE_IO_COMPLETION_INFORMATION IoCompletionInformation,
+                       IN ULONG Count,
+                       OUT PULONG NumEntriesRemoved,
+                       IN PLARGE_INTEGER Timeout OPTIONAL,
+                       IN BOOLEAN Alertable)
+{
+    LARGE_INTEGER SafeTimeout;
+    PKQUEUE Queue;
+    PLIST_ENTRY EntryArray[IOP_MAX_REMOVE_BATCH];
+    FILE_IO_COMPLETION_INFORMATION CompletionInfo[IOP_MAX_REMOVE_BATCH];
+    KPROCESSOR_MODE PreviousMode = ExGetPreviousMode();
+    NTSTATUS Status;
+    ULONG Entries, i;
+    PAGED_CODE();
+
+    /* There must be room for at least one entry */
+    if (!Count) return STATUS_INVALID_PARAMETER_3;
+
+    /* We never return more than a batch, so don't look further */
+    Count = min(Count, IOP_MAX_REMOVE_BATCH);
+
+    /* Check if the call was from user mode */
+    if (PreviousMode != KernelMode)
+    {
+        /* Protect probes in SEH */
+        _SEH2_TRY
+        {
+            /* Probe the array and the count */
+            ProbeForWrite(IoCompletionInformation,
+                          Count * sizeof(FILE_IO_COMPLETION_INFORMATION),
+                          sizeof(PVOID));
+            ProbeForWriteUlong(NumEntriesRemoved);
+            if (Timeout)
             {
-                /* Save values */
-                Key = Packet->KeyContext;
-                Apc = Packet->ApcContext;
-                IoStatus.Status = Packet->IoStatus;
-                IoStatus.Information = Packet->IoStatusInformation;
+                /* Probe and capture the timeout */
+                SafeTimeout = ProbeForReadLargeInteger(Timeout);
+                Timeout = &SafeTimeout;
+            }
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            /* Return the exception code */
+            _SEH2_YIELD(return _SEH2_GetExceptionCode());
+        }
+        _SEH2_END;
+    }
 
-                /* Free the packet */
-                IopFreeMiniPacket(Packet);
+    /* Open the Object */
+    Status = ObReferenceObjectByHandle(IoCompletionHandle,
+                                       IO_COMPLETION_MODIFY_STATE,
+                                       IoCompletionType,
+                                       PreviousMode,
+                                       (PVOID*)&Queue,
+                                       NULL);
+    if (NT_SUCCESS(Status))
+    {
+        /* Wait for one entry, and take the ones already queued with it */
+        Entries = KeRemoveQueueEx(Queue,
+                                  PreviousMode,
+                                  Alertable,
+                                  Timeout,
+                                  EntryArray,
+                                  Count);
+
+        /* If we got a timeout, an alert or user_apc back, return the status */
+        if (((NTSTATUS)(ULONG_PTR)EntryArray[0] == STATUS_TIMEOUT) ||
+            ((NTSTATUS)(ULONG_PTR)EntryArray[0] == STATUS_USER_APC) ||
+            ((NTSTATUS)(ULONG_PTR)EntryArray[0] == STATUS_ALERTED))
+        {
+            /* Set this as the status */
+            Status = (NTSTATUS)(ULONG_PTR)EntryArray[0];
+        }
+        else
+        {
+            /* Get the values and free the packets */
+            for (i = 0; i < Entries; i++)
+            {
+                IopUnpackCompletionPacket(EntryArray[i],
+                                          &CompletionInfo[i].KeyContext,
+                                          &CompletionInfo[i].ApcContext,
+                                          &CompletionInfo[i].IoStatusBlock);
             }
 
             /* Enter SEH to write back the values */
             _SEH2_TRY
             {
                 /* Write the values to caller */
-                *ApcContext = Apc;
-                *KeyContext = Key;
-                *IoStatusBlock = IoStatus;
+                RtlCopyMemory(IoCompletionInformation,
+                              CompletionInfo,
+                              Entries * sizeof(FILE_IO_COMPLETION_INFORMATION));
+                *NumEntriesRemoved = Entries;
             }
             _SEH2_EXCEPT(ExSystemExceptionFilter())
             {
@@ -444,8 +444,9 @@ IopDeviceFsIoControl(IN HANDLE DeviceHandle,
                     IopUnlockFileObject(FileObject);
                 }
 
-                /* Set completion if required */
-                if (CompletionInfo.Port != NULL && UserApcContext != NULL)
+                /* Set completion if required, fast I/O never pends */
+                if (CompletionInfo.Port != NULL && UserApcContext != NULL &&
+                    !IopSkipCompletionPort(FileObject, KernelIosb.Status))
                 {
                     if (!NT_SUCCESS(IoSetIoCompletion(CompletionInfo.Port,
                                                       CompletionInfo.Key,
@@ -1134,6 +1135,91 @@ IopGetDriverPathInformation(IN PFILE_OBJECT FileObject,
     return STATUS_SUCCESS;
 }
 
+static
+NTSTATUS
+IopSetIoCompletionNotification(IN HANDLE FileHandle,
+                               OUT PIO_STATUS_BLOCK IoStatusBlock,
+                               IN PVOID FileInformation,
+                               IN ULONG Length,
+                               IN KPROCESSOR_MODE PreviousMode)
+{
+    PFILE_OBJECT FileObject;
+    ULONG Flags, FileObjectFlags = 0;
+    NTSTATUS Status;
+
+    /* Validate the length */
+    if (Length < sizeof(FILE_IO_COMPLETION_NOTIFICATION_INFORMATION))
+    {
+        /* Invalid length */
+        return STATUS_INFO_LENGTH_MISMATCH;
+    }
+
+    /* Enter SEH for probing and capturing */
+    _SEH2_TRY
+    {
+        if (PreviousMode != KernelMode)
+        {
+            /* Probe the I/O Status block and the information */
+            ProbeForWriteIoStatusBlock(IoStatusBlock);
+            ProbeForRead(FileInformation,
+                         sizeof(FILE_IO_COMPLETION_NOTIFICATION_INFORMATION),
+                         sizeof(ULONG));
+        }
+
+        /* Capture the flags */
+        Flags = ((PFILE_IO_COMPLETION_NOTIFICATION_INFORMATION)FileInformation)->Flags;
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        /* Return the exception code */
+        _SEH2_YIELD(return _SEH2_GetExceptionCode());
+    }
+    _SEH2_END;
+
+    /* Only the port and handle event modes are supported */
+    if (Flags & ~(FILE_SKIP_COMPLETION_PORT_ON_SUCCESS |
+                  FILE_SKIP_SET_EVENT_ON_HANDLE))
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    if (Flags & FILE_SKIP_COMPLETION_PORT_ON_SUCCESS)
+        FileObjectFlags |= FO_SKIP_COMPLETION_PORT;
+
+    if (Flags & FILE_SKIP_SET_EVENT_ON_HANDLE)
+        FileObjectFlags |= FO_SKIP_SET_EVENT;
+
+    /* Reference the Handle */
+    Status = ObReferenceObjectByHandle(FileHandle,
+                                       0,
+                                       IoFileObjectType,
+                                       PreviousMode,
+                                       (PVOID *)&FileObject,
+                                       NULL);
+    if (!NT_SUCCESS(Status)) return Status;
+
+    /*
+     * This is all on the I/O manager's side, so there's no IRP to send.
+     * The modes can only be turned on, never off again.
+     */
+    InterlockedOr((PLONG)&FileObject->Flags, FileObjectFlags);
+    ObDereferenceObject(FileObject);
+
+    /* Write the IOSB back */
+    _SEH2_TRY
+    {
+        IoStatusBlock->Status = STATUS_SUCCESS;
+        IoStatusBlock->Information = 0;
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        /* Ignore any error */
+    }
+    _SEH2_END;
+
+    return STATUS_SUCCESS;
+}
+
 /* PUBLIC FUNCTIONS **********************************************************/
 
 /*
@@ -1875,8 +1961,9 @@ NtLockFile(IN HANDLE FileHandle,
                 ObDereferenceObject(Event);
             }
 
-            /* Set completion if required */
-            if (FileObject->CompletionContext != NULL && ApcContext != NULL)
+            /* Set completion if required, fast I/O never pends */
+            if (FileObject->CompletionContext != NULL && ApcContext != NULL &&
+                !IopSkipCompletionPort(FileObject, KernelIosb.Status))
             {
                 if (!NT_SUCCESS(IoSetIoCompletion(FileObject->CompletionContext->Port,
                                                   FileObject->CompletionContext->Key,
@@ -2958,11 +3045,16 @@ NtReadFile(IN HANDLE FileHandle,
         {
             _SEH2_TRY
             {
-                /* Allocate an MDL */
-                Mdl = IoAllocateMdl(Buffer, Length, FALSE, TRUE, Irp);
+                /* Use the locked pages of a registered buffer if we can */
+                Mdl = IopAllocateRegisteredBufferMdl(Buffer, Length, Irp);
                 if (!Mdl)
-                    ExRaiseStatus(STATUS_INSUFFICIENT_RESOURCES);
-                MmProbeAndLockPages(Mdl, PreviousMode, IoWriteAccess);
+                {
+                    /* Allocate an MDL */
+                    Mdl = IoAllocateMdl(Buffer, Length, FALSE, TRUE, Irp);
+                    if (!Mdl)
+                        ExRaiseStatus(STATUS_INSUFFICIENT_RESOURCES);
+                    MmProbeAndLockPages(Mdl, PreviousMode, IoWriteAccess);
+                }
             }
             _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
             {
@@ -2974,8 +3066,8 @@ NtReadFile(IN HANDLE FileHandle,
 
         }
 
-        /* No allocation flags */
-        Irp->Flags = 0;
+        /* No allocation flags, but keep the mark of a registered buffer */
+        Irp->Flags &= IRP_REGISTERED_BUFFER_IO;
     }
     else
     {
@@ -3065,6 +3157,16 @@ NtSetInformationFile(IN HANDLE FileHandle,
     PAGED_CODE();
     IOTRACE(IO_API_DEBUG, "FileHandle: %p\n", FileHandle);
 
+    /* Completion notification modes don't involve the driver */
+    if (FileInformationClass == FileIoCompletionNotificationInformation)
+    {
+        return IopSetIoCompletionNotification(FileHandle,
+                                              IoStatusBlock,
+                                              FileInformation,
+                                              Length,
+                                              PreviousMode);
+    }
+
     /* Check if we're called from user mode */
     if (PreviousMode != KernelMode)
     {
@@ -4018,11 +4120,16 @@ NtWriteFile(IN HANDLE FileHandle,
         {
             _SEH2_TRY
             {
-                /* Allocate an MDL */
-                Mdl = IoAllocateMdl(Buffer, Length, FALSE, TRUE, Irp);
+                /* Use the locked pages of a registered buffer if we can */
+                Mdl = IopAllocateRegisteredBufferMdl(Buffer, Length, Irp);
                 if (!Mdl)
-                    ExRaiseStatus(STATUS_INSUFFICIENT_RESOURCES);
-                MmProbeAndLockPages(Mdl, PreviousMode, IoReadAccess);
+                {
+                    /* Allocate an MDL */
+                    Mdl = IoAllocateMdl(Buffer, Length, FALSE, TRUE, Irp);
+                    if (!Mdl)
+                        ExRaiseStatus(STATUS_INSUFFICIENT_RESOURCES);
+                    MmProbeAndLockPages(Mdl, PreviousMode, IoReadAccess);
+                }
             }
             _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
             {
@@ -4033,8 +4140,8 @@ NtWriteFile(IN HANDLE FileHandle,
             _SEH2_END;
         }
 
-        /* No allocation flags */
-        Irp->Flags = 0;
+        /* No allocation flags, but keep the mark of a registered buffer */
+        Irp->Flags &= IRP_REGISTERED_BUFFER_IO;
     }
     else
     {
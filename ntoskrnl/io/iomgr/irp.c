@@ -399,8 +399,16 @@ IopCompleteRequest(IN PKAPC Apc,
         }
         else if (FileObject)
         {
-            /* Signal the file object and set the status */
-            KeSetEvent(&FileObject->Event, 0, FALSE);
+            /*
+             * Signal the file object and set the status. Callers can ask us
+             * not to, but synchronous I/O waits on this event, so it is
+             * always set for those.
+             */
+            if (!(FileObject->Flags & FO_SKIP_SET_EVENT) ||
+                (FileObject->Flags & FO_SYNCHRONOUS_IO))
+            {
+                KeSetEvent(&FileObject->Event, 0, FALSE);
+            }
             FileObject->FinalStatus = Irp->IoStatus.Status;
 
             /*
@@ -460,7 +468,9 @@ IopCompleteRequest(IN PKAPC Apc,
             KeInsertQueueApc(&Irp->Tail.Apc, Irp->UserIosb, NULL, 2);
         }
         else if ((Port) &&
-                 (Irp->Overlay.AsynchronousParameters.UserApcContext))
+                 (Irp->Overlay.AsynchronousParameters.UserApcContext) &&
+                 ((Irp->PendingReturned) ||
+                  !(IopSkipCompletionPort(FileObject, Irp->IoStatus.Status))))
         {
             /* We have an I/O Completion setup... create the special Overlay */
             Irp->Tail.CompletionKey = Key;
@@ -1530,6 +1540,12 @@ IofCompleteRequest(IN PIRP Irp,
 
     /* Unlock MDL Pages, page 167. */
     Mdl = Irp->MdlAddress;
+    if (Irp->Flags & IRP_REGISTERED_BUFFER_IO)
+    {
+        /* This one only holds a reference on a registered buffer */
+        IopReleaseRegisteredBufferMdl(Mdl);
+        Mdl = Mdl->Next;
+    }
     while (Mdl)
     {
         MmUnlockPages(Mdl);
@@ -576,6 +576,7 @@ KDDEBUGGER_DATA64 KdDebuggerDataBlock =
     {(ULONG_PTR)&MmModifiedNoWritePageListHead},
     {(ULONG_PTR)&MmAvailablePages},
     {(ULONG_PTR)&MmResidentAvailablePages},
+    /* Only processor 0's tag counts, the others are in ExPoolTagTables */
     {(ULONG_PTR)&PoolTrackTable},
     {(ULONG_PTR)&NonPagedPoolDescriptor},
     {(ULONG_PTR)&MmHighestUserAddress},
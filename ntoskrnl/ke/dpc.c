@@ -25,6 +25,7 @@ FAST_MUTEX KiGenericCallDpcMutex;
 KDPC KiTimerExpireDpc;
 ULONG KiTimeLimitIsrMicroseconds;
 ULONG KiDPCTimeout = 110;
+KI_DPC_STATISTICS KiDpcStatistics[MAXIMUM_PROCESSORS];
 
 /* PRIVATE FUNCTIONS *********************************************************/
 
@@ -566,6 +567,8 @@ KiRetireDpcList(IN PKPRCB Prcb)
     PKDEFERRED_ROUTINE DeferredRoutine;
     PVOID DeferredContext, SystemArgument1, SystemArgument2;
     ULONG_PTR TimerHand;
+    PKI_DPC_STATISTICS Statistics;
+    ULONGLONG Latency;
 #ifdef CONFIG_SMP
     KIRQL OldIrql;
 #endif
@@ -573,6 +576,7 @@ KiRetireDpcList(IN PKPRCB Prcb)
     /* Get data and list variables before starting anything else */
     DpcData = &Prcb->DpcData[DPC_NORMAL];
     ListHead = &DpcData->DpcListHead;
+    Statistics = &KiDpcStatistics[Prcb->Number];
 
     /* Main outer loop */
     do
@@ -580,6 +584,17 @@ KiRetireDpcList(IN PKPRCB Prcb)
         /* Set us as active */
         Prcb->DpcRoutineActive = TRUE;
 
+        /* Account for the time the queue waited since the request */
+        if (Statistics->RequestTime)
+        {
+            Latency = KeQueryInterruptTime() - Statistics->RequestTime;
+            Statistics->RequestTime = 0;
+            Statistics->TotalLatency += Latency;
+            if (Latency > Statistics->MaximumLatency)
+                Statistics->MaximumLatency = Latency;
+        }
+        Statistics->RetireCount++;
+
         /* Check if this is a timer expiration request */
         if (Prcb->TimerRequest)
         {
@@ -729,6 +744,7 @@ KeInsertQueueDpc(IN PKDPC Dpc,
     PKPRCB Prcb, CurrentPrcb;
     ULONG Cpu;
     PKDPC_DATA DpcData;
+    PKI_DPC_STATISTICS Statistics;
     BOOLEAN DpcConfigured = FALSE, DpcInserted = FALSE;
     ASSERT_DPC(Dpc);
 
@@ -778,6 +794,11 @@ KeInsertQueueDpc(IN PKDPC Dpc,
         DpcData->DpcCount++;
         DpcConfigured = TRUE;
 
+        /* Remember the deepest queue this processor has seen */
+        Statistics = &KiDpcStatistics[Cpu];
+        if (DpcData->DpcQueueDepth > Statistics->MaximumQueueDepth)
+            Statistics->MaximumQueueDepth = DpcData->DpcQueueDepth;
+
         /* Check if this is a high importance DPC */
         if (Dpc->Importance == HighImportance)
         {
@@ -845,6 +866,9 @@ KeInsertQueueDpc(IN PKDPC Dpc,
         }
     }
 
+    /* Start measuring how long the queue waits to be retired */
+    if (DpcInserted) KiDpcStatistics[Cpu].RequestTime = KeQueryInterruptTime();
+
     /* Release the lock */
     KiReleaseSpinLock(&DpcData->DpcLock);
 
@@ -1031,4 +1055,30 @@ KeSignalCallDpcSynchronize(IN PVOID SystemArgument2)
     return TRUE;
 }
 
+#if DBG && defined(KDBG)
+BOOLEAN
+KiKdbgExtDpcStats(ULONG Argc, PCHAR Argv[])
+{
+    PKI_DPC_STATISTICS Statistics;
+    ULONG i;
+
+    /* The latencies are kept in interrupt time units, print them in microseconds */
+    KdbpPrint("CPU\tRetires\tMaxDepth\tTotalLat(us)\tMaxLat(us)\tIPIs\tCoalesced\n");
+    for (i = 0; i < (ULONG)KeNumberProcessors; i++)
+    {
+        Statistics = &KiDpcStatistics[i];
+        KdbpPrint("%lu\t%lu\t%lu\t\t%I64u\t\t%I64u\t\t%lu\t%lu\n",
+                  i,
+                  Statistics->RetireCount,
+                  Statistics->MaximumQueueDepth,
+                  Statistics->TotalLatency / 10,
+                  Statistics->MaximumLatency / 10,
+                  Statistics->IpiRequestCount,
+                  Statistics->IpiCoalescedCount);
+    }
+
+    return TRUE;
+}
+#endif // DBG && KDBG
+
 /* EOF */
@@ -34,8 +34,34 @@ FASTCALL
 KiIpiSend(IN KAFFINITY TargetProcessors,
           IN ULONG IpiRequest)
 {
-    /* FIXME: TODO */
-    ASSERTMSG("Not yet implemented\n", FALSE);
+#ifdef CONFIG_SMP
+    KAFFINITY Current, SendSet = 0;
+    PKI_DPC_STATISTICS Statistics;
+    PKPRCB Prcb;
+    ULONG i;
+
+    Statistics = &KiDpcStatistics[KeGetCurrentProcessorNumber()];
+
+    for (i = 0, Current = 1; i < (ULONG)KeNumberProcessors; i++, Current <<= 1)
+    {
+        if (!(TargetProcessors & Current)) continue;
+
+        /* Only interrupt the processor if the request is not pending yet */
+        Prcb = KiProcessorBlock[i];
+        if (!InterlockedBitTestAndSet((PLONG)&Prcb->IpiFrozen, IpiRequest))
+        {
+            SendSet |= Current;
+            Statistics->IpiRequestCount++;
+        }
+        else
+        {
+            Statistics->IpiCoalescedCount++;
+        }
+    }
+
+    /* Deliver all the new requests at once */
+    if (SendSet) HalRequestIpi(SendSet);
+#endif
 }
 
 VOID
@@ -138,6 +138,47 @@ KiInsertQueue(IN PKQUEUE Queue,
     return InitialState;
 }
 
+/*
+ * Called with the dispatcher lock held by a thread which already removed an
+ * entry, and thus already counts as running on behalf of the queue
+ */
+static
+ULONG
+KiRemoveQueueEntries(IN PKQUEUE Queue,
+                     OUT PLIST_ENTRY *EntryArray,
+                     IN ULONG Count)
+{
+    PLIST_ENTRY QueueEntry;
+    ULONG Entries = 0;
+
+    /* Take whatever is queued, up to the count */
+    while (Entries < Count)
+    {
+        QueueEntry = Queue->EntryListHead.Flink;
+        if (QueueEntry == &Queue->EntryListHead) break;
+
+        /* Check if the entry is valid. If not, bugcheck */
+        if (!(QueueEntry->Flink) || !(QueueEntry->Blink))
+        {
+            /* Invalid item */
+            KeBugCheckEx(INVALID_WORK_QUEUE_ITEM,
+                         (ULONG_PTR)QueueEntry,
+                         (ULONG_PTR)Queue,
+                         (ULONG_PTR)NULL,
+                         (ULONG_PTR)((PWORK_QUEUE_ITEM)QueueEntry)->
+                                     WorkerRoutine);
+        }
+
+        /* Decrease the number of entries and remove this one */
+        Queue->Header.SignalState--;
+        RemoveEntryList(QueueEntry);
+        QueueEntry->Flink = NULL;
+        EntryArray[Entries++] = QueueEntry;
+    }
+
+    return Entries;
+}
+
 /* PUBLIC FUNCTIONS **********************************************************/
 
 /*
@@ -240,7 +281,32 @@ KeRemoveQueue(IN PKQUEUE Queue,
               IN PLARGE_INTEGER Timeout OPTIONAL)
 {
     PLIST_ENTRY QueueEntry;
+
+    /* Remove a single entry, without an alertable wait */
+    KeRemoveQueueEx(Queue, WaitMode, FALSE, Timeout, &QueueEntry, 1);
+    return QueueEntry;
+}
+
+/*
+ * @implemented
+ *
+ * Waits for one entry like KeRemoveQueue, then also takes the entries that
+ * are already queued, up to Count. EntryArray[0] receives the status if the
+ * wait ended without an entry.
+ */
+ULONG
+NTAPI
+KeRemoveQueueEx(IN PKQUEUE Queue,
+                IN KPROCESSOR_MODE WaitMode,
+                IN BOOLEAN Alertable,
+                IN PLARGE_INTEGER Timeout OPTIONAL,
+                OUT PLIST_ENTRY *EntryArray,
+                IN ULONG Count)
+{
+    PLIST_ENTRY QueueEntry;
     LONG_PTR Status;
+    ULONG Entries = 1;
+    KIRQL OldIrql;
     PKTHREAD Thread = KeGetCurrentThread();
     PKQUEUE PreviousQueue;
     PKWAIT_BLOCK WaitBlock = &Thread->WaitBlock[0];
@@ -252,6 +318,7 @@ KeRemoveQueue(IN PKQUEUE Queue,
     ULONG Hand = 0;
     ASSERT_QUEUE(Queue);
     ASSERT_IRQL_LESS_OR_EQUAL(DISPATCH_LEVEL);
+    ASSERT(Count != 0);
 
     /* Check if the Lock is already held */
     if (Thread->WaitNext)
@@ -328,6 +395,9 @@ KeRemoveQueue(IN PKQUEUE Queue,
             RemoveEntryList(QueueEntry);
             QueueEntry->Flink = NULL;
 
+            /* Take more entries while we hold the lock */
+            Entries += KiRemoveQueueEntries(Queue, &EntryArray[1], Count - 1);
+
             /* Nothing to wait on */
             break;
         }
@@ -344,12 +414,12 @@ KeRemoveQueue(IN PKQUEUE Queue,
             }
             else
             {
-                /* Fail if there's a User APC Pending */
-                if ((WaitMode != KernelMode) &&
-                    (Thread->ApcState.UserApcPending))
+                /* Fail if we're alerted or there's a User APC Pending */
+                Status = KiCheckAlertability(Thread, Alertable, WaitMode);
+                if (Status != STATUS_WAIT_0)
                 {
                     /* Return the status and increase the pending threads */
-                    QueueEntry = (PLIST_ENTRY)STATUS_USER_APC;
+                    QueueEntry = (PLIST_ENTRY)Status;
                     Queue->CurrentCount++;
                     break;
                 }
@@ -404,7 +474,25 @@ KeRemoveQueue(IN PKQUEUE Queue,
                 Thread->WaitReason = 0;
 
                 /* Check if we were executing an APC */
-                if (Status != STATUS_KERNEL_APC) return (PLIST_ENTRY)Status;
+                if (Status != STATUS_KERNEL_APC)
+                {
+                    /* We were given an entry, or the wait failed */
+                    EntryArray[0] = (PLIST_ENTRY)Status;
+                    if ((Count > 1) &&
+                        (Status != STATUS_TIMEOUT) &&
+                        (Status != STATUS_USER_APC) &&
+                        (Status != STATUS_ALERTED))
+                    {
+                        /* Take what got queued while we were waking up */
+                        OldIrql = KiAcquireDispatcherLock();
+                        Entries += KiRemoveQueueEntries(Queue,
+                                                        &EntryArray[1],
+                                                        Count - 1);
+                        KiReleaseDispatcherLock(OldIrql);
+                    }
+
+                    return Entries;
+                }
 
                 /* Check if we had a timeout */
                 if (Timeout)
@@ -427,7 +515,8 @@ KeRemoveQueue(IN PKQUEUE Queue,
     /* Unlock Database and return */
     KiReleaseDispatcherLockFromSynchLevel();
     KiExitDispatcher(Thread->WaitIrql);
-    return QueueEntry;
+    EntryArray[0] = QueueEntry;
+    return Entries;
 }
 
 /*
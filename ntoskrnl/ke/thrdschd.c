@@ -27,6 +27,24 @@ ULONG_PTR KiIdleSMTSummary;
 
 /* FUNCTIONS *****************************************************************/
 
+static
+VOID
+KiRequestRemoteDispatch(IN ULONG Processor)
+{
+    PKI_DPC_STATISTICS Statistics;
+
+    /* While a deferred ready list is processed, collect the targets */
+    Statistics = &KiDpcStatistics[KeGetCurrentProcessorNumber()];
+    if (Statistics->DeferIpis)
+    {
+        Statistics->DeferredIpiSet |= AFFINITY_MASK(Processor);
+        return;
+    }
+
+    /* Otherwise interrupt the processor right away */
+    KiIpiSend(AFFINITY_MASK(Processor), IPI_DPC);
+}
+
 PKTHREAD
 FASTCALL
 KiIdleSchedule(IN PKPRCB Prcb)
@@ -42,6 +60,8 @@ KiProcessDeferredReadyList(IN PKPRCB Prcb)
 {
     PSINGLE_LIST_ENTRY ListEntry;
     PKTHREAD Thread;
+    PKI_DPC_STATISTICS Statistics;
+    KAFFINITY IpiSet;
 
     /* Make sure there is something on the ready list */
     ASSERT(Prcb->DeferredReadyListHead.Next != NULL);
@@ -50,6 +70,10 @@ KiProcessDeferredReadyList(IN PKPRCB Prcb)
     ListEntry = Prcb->DeferredReadyListHead.Next;
     Prcb->DeferredReadyListHead.Next = NULL;
 
+    /* Send one IPI per processor for the whole list instead of per thread */
+    Statistics = &KiDpcStatistics[Prcb->Number];
+    Statistics->DeferIpis = TRUE;
+
     /* Start processing loop */
     do
     {
@@ -63,6 +87,12 @@ KiProcessDeferredReadyList(IN PKPRCB Prcb)
 
     /* Make sure the ready list is still empty */
     ASSERT(Prcb->DeferredReadyListHead.Next == NULL);
+
+    /* Now notify every processor that got a new thread */
+    IpiSet = Statistics->DeferredIpiSet;
+    Statistics->DeferredIpiSet = 0;
+    Statistics->DeferIpis = FALSE;
+    if (IpiSet) KiIpiSend(IpiSet, IPI_DPC);
 }
 
 VOID
@@ -294,7 +324,7 @@ KiDeferredReadyThread(IN PKTHREAD Thread)
             if (KeGetCurrentProcessorNumber() != Thread->NextProcessor)
             {
                 /* We are, send an IPI */
-                KiIpiSend(AFFINITY_MASK(Thread->NextProcessor), IPI_DPC);
+                KiRequestRemoteDispatch(Thread->NextProcessor);
             }
             return;
         }
@@ -273,23 +273,7 @@ NtReplyPort(IN HANDLE PortHandle,
         return STATUS_NO_MEMORY;
     }
 
-    /* Keep the lock acquired */
-    KeAcquireGuardedMutex(&LpcpLock);
-
-    /* Make sure this is the reply the thread is waiting for */
-    if ((WakeupThread->LpcReplyMessageId != CapturedReplyMessage.MessageId) ||
-        ((LpcpGetMessageFromThread(WakeupThread)) &&
-        (LpcpGetMessageType(&LpcpGetMessageFromThread(WakeupThread)-> Request)
-            != LPC_REQUEST)))
-    {
-        /* It isn't, fail */
-        LpcpFreeToPortZone(Message, LPCP_LOCK_HELD | LPCP_LOCK_RELEASE);
-        ObDereferenceObject(WakeupThread);
-        ObDereferenceObject(Port);
-        return STATUS_REPLY_MESSAGE_MISMATCH;
-    }
-
-    /* Copy the message */
+    /* Copy the message, it is still private so don't hold the lock for it */
     _SEH2_TRY
     {
         LpcpMoveMessage(&Message->Request,
@@ -301,13 +285,29 @@ NtReplyPort(IN HANDLE PortHandle,
     _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
     {
         /* Cleanup and return the exception code */
-        LpcpFreeToPortZone(Message, LPCP_LOCK_HELD | LPCP_LOCK_RELEASE);
+        LpcpFreeToPortZone(Message, 0);
         ObDereferenceObject(WakeupThread);
         ObDereferenceObject(Port);
         _SEH2_YIELD(return _SEH2_GetExceptionCode());
     }
     _SEH2_END;
 
+    /* Keep the lock acquired */
+    KeAcquireGuardedMutex(&LpcpLock);
+
+    /* Make sure this is the reply the thread is waiting for */
+    if ((WakeupThread->LpcReplyMessageId != CapturedReplyMessage.MessageId) ||
+        ((LpcpGetMessageFromThread(WakeupThread)) &&
+        (LpcpGetMessageType(&LpcpGetMessageFromThread(WakeupThread)-> Request)
+            != LPC_REQUEST)))
+    {
+        /* It isn't, fail */
+        LpcpFreeToPortZone(Message, LPCP_LOCK_HELD | LPCP_LOCK_RELEASE);
+        ObDereferenceObject(WakeupThread);
+        ObDereferenceObject(Port);
+        return STATUS_REPLY_MESSAGE_MISMATCH;
+    }
+
     /* Reference the thread while we use it */
     ObReferenceObject(WakeupThread);
     Message->RepliedToThread = WakeupThread;
@@ -517,24 +517,7 @@ NtReplyWaitReceivePortEx(IN HANDLE PortHandle,
             return STATUS_NO_MEMORY;
         }
 
-        /* Keep the lock acquired */
-        KeAcquireGuardedMutex(&LpcpLock);
-
-        /* Make sure this is the reply the thread is waiting for */
-        if ((WakeupThread->LpcReplyMessageId != CapturedReplyMessage.MessageId) ||
-            ((LpcpGetMessageFromThread(WakeupThread)) &&
-             (LpcpGetMessageType(&LpcpGetMessageFromThread(WakeupThread)->Request)
-                != LPC_REQUEST)))
-        {
-            /* It isn't, fail */
-            LpcpFreeToPortZone(Message, LPCP_LOCK_HELD | LPCP_LOCK_RELEASE);
-            if (ConnectionPort) ObDereferenceObject(ConnectionPort);
-            ObDereferenceObject(WakeupThread);
-            ObDereferenceObject(Port);
-            return STATUS_REPLY_MESSAGE_MISMATCH;
-        }
-
-        /* Copy the message */
+        /* Copy the message, it is still private so don't hold the lock for it */
         _SEH2_TRY
         {
             LpcpMoveMessage(&Message->Request,
@@ -546,7 +529,7 @@ NtReplyWaitReceivePortEx(IN HANDLE PortHandle,
         _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
         {
             /* Cleanup and return the exception code */
-            LpcpFreeToPortZone(Message, LPCP_LOCK_HELD | LPCP_LOCK_RELEASE);
+            LpcpFreeToPortZone(Message, 0);
             if (ConnectionPort) ObDereferenceObject(ConnectionPort);
             ObDereferenceObject(WakeupThread);
             ObDereferenceObject(Port);
@@ -554,6 +537,23 @@ NtReplyWaitReceivePortEx(IN HANDLE PortHandle,
         }
         _SEH2_END;
 
+        /* Keep the lock acquired */
+        KeAcquireGuardedMutex(&LpcpLock);
+
+        /* Make sure this is the reply the thread is waiting for */
+        if ((WakeupThread->LpcReplyMessageId != CapturedReplyMessage.MessageId) ||
+            ((LpcpGetMessageFromThread(WakeupThread)) &&
+             (LpcpGetMessageType(&LpcpGetMessageFromThread(WakeupThread)->Request)
+                != LPC_REQUEST)))
+        {
+            /* It isn't, fail */
+            LpcpFreeToPortZone(Message, LPCP_LOCK_HELD | LPCP_LOCK_RELEASE);
+            if (ConnectionPort) ObDereferenceObject(ConnectionPort);
+            ObDereferenceObject(WakeupThread);
+            ObDereferenceObject(Port);
+            return STATUS_REPLY_MESSAGE_MISMATCH;
+        }
+
         /* Reference the thread while we use it */
         ObReferenceObject(WakeupThread);
         Message->RepliedToThread = WakeupThread;
@@ -586,11 +586,15 @@ NtReplyWaitReceivePortEx(IN HANDLE PortHandle,
                                 CapturedReplyMessage.CallbackId,
                                 CapturedReplyMessage.ClientId);
 
-        /* Release the lock and release the LPC semaphore to wake up waiters */
+        /*
+         * Release the lock and release the LPC semaphore to wake up the
+         * client. Don't switch straight to our own wait: the client thread
+         * must not stay referenced for as long as we wait for a message.
+         */
         KeReleaseGuardedMutex(&LpcpLock);
         LpcpCompleteWait(&WakeupThread->LpcReplySemaphore);
 
-        /* Now we can let go of the thread */
+        /* Now we can let go of the thread we replied to */
         ObDereferenceObject(WakeupThread);
     }
 
@@ -641,6 +645,39 @@ NtReplyWaitReceivePortEx(IN HANDLE PortHandle,
     Thread->LpcReceivedMessageId = Message->Request.MessageId;
     Thread->LpcReceivedMsgIdValid = TRUE;
 
+    /*
+     * Once off the queue, a request or datagram without data information
+     * is only known to us, so copy it out without holding the lock
+     */
+    if ((LpcpGetMessageType(&Message->Request) != LPC_CONNECTION_REQUEST) &&
+        (LpcpGetMessageType(&Message->Request) != LPC_REPLY) &&
+        !(Message->Request.u2.s2.DataInfoOffset))
+    {
+        KeReleaseGuardedMutex(&LpcpLock);
+
+        _SEH2_TRY
+        {
+            /* Copy it */
+            LpcpMoveMessage(ReceiveMessage,
+                            &Message->Request,
+                            (&Message->Request) + 1,
+                            0,
+                            NULL);
+
+            /* Return its context */
+            if (PortContext) *PortContext = Message->PortContext;
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            Status = _SEH2_GetExceptionCode();
+        }
+        _SEH2_END;
+
+        /* We are done with the message */
+        LpcpFreeToPortZone(Message, 0);
+        goto Cleanup;
+    }
+
     _SEH2_TRY
     {
         /* Check if this was a connection request */
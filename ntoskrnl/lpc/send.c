@@ -351,7 +351,11 @@ LpcRequestWaitReplyPort(IN PVOID PortObject,
         }
     }
 
-    /* Now release the semaphore */
+    /*
+     * Now release the semaphore. Don't switch straight to the server here:
+     * that would return at DISPATCH_LEVEL with the dispatcher lock held, and
+     * we still have to leave the critical region before waiting.
+     */
     LpcpCompleteWait(Semaphore);
     KeLeaveCriticalRegion();
 
@@ -956,7 +960,11 @@ NtRequestWaitReplyPort(IN HANDLE PortHandle,
         }
     }
 
-    /* Now release the semaphore */
+    /*
+     * Now release the semaphore. Don't switch straight to the server here:
+     * that would return at DISPATCH_LEVEL with the dispatcher lock held, and
+     * we still have to leave the critical region before waiting.
+     */
     LpcpCompleteWait(Semaphore);
     KeLeaveCriticalRegion();
 
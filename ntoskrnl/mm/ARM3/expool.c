@@ -30,6 +30,16 @@ typedef struct _POOL_DPC_CONTEXT
     SIZE_T PoolTrackTableSizeExpansion;
 } POOL_DPC_CONTEXT, *PPOOL_DPC_CONTEXT;
 
+#define POOL_TRACE_ENTRIES 2048
+
+typedef struct _POOL_TRACE_BUFFER
+{
+    volatile LONG WriteIndex;
+    volatile LONG ReadIndex;
+    volatile ULONG Sequence[POOL_TRACE_ENTRIES];
+    SYSTEM_POOL_TRACE_ENTRY Entries[POOL_TRACE_ENTRIES];
+} POOL_TRACE_BUFFER, *PPOOL_TRACE_BUFFER;
+
 ULONG ExpNumberOfPagedPools;
 POOL_DESCRIPTOR NonPagedPoolDescriptor;
 PPOOL_DESCRIPTOR ExpPagedPoolDescriptor[16 + 1];
@@ -39,6 +49,13 @@ SIZE_T PoolTrackTableSize, PoolTrackTableMask;
 SIZE_T PoolBigPageTableSize, PoolBigPageTableHash;
 ULONG ExpBigTableExpansionFailed;
 PPOOL_TRACKER_TABLE PoolTrackTable;
+
+//
+// Per-processor tag tables, PoolTrackTable being the one of processor 0.
+// The debugger data block only has room for PoolTrackTable, so debuggers
+// must go through this array, by symbol, to see all the counts.
+//
+PPOOL_TRACKER_TABLE ExPoolTagTables[MAXIMUM_PROCESSORS];
 PPOOL_TRACKER_BIG_PAGES PoolBigPageTable;
 KSPIN_LOCK ExpTaggedPoolLock;
 ULONG PoolHitTag;
@@ -48,6 +65,10 @@ ULONG ExpPoolBigEntriesInUse;
 ULONG ExpPoolFlags;
 ULONG ExPoolFailures;
 ULONGLONG MiLastPoolDumpTime;
+ULONG ExpPoolTraceSampleRate;
+ULONG ExpPoolTraceTag;
+ULONG ExpPoolTraceFrameCount;
+PPOOL_TRACE_BUFFER ExpPoolTraceBuffers[MAXIMUM_PROCESSORS];
 
 /* Pool block/header/list access macros */
 #define POOL_ENTRY(x)       (PPOOL_HEADER)((ULONG_PTR)(x) - sizeof(POOL_HEADER))
@@ -462,6 +483,255 @@ ExpComputePartialHashForAddress(IN PVOID BaseAddress)
     return (Result >> 24) ^ (Result >> 16) ^ (Result >> 8) ^ Result;
 }
 
+FORCEINLINE
+PPOOL_TRACKER_TABLE
+ExpGetPoolTrackerTable(VOID)
+{
+    PPOOL_TRACKER_TABLE Table;
+
+    //
+    // Each processor counts its allocations and frees in its own copy of the
+    // tracker table, so that processors don't keep stealing the same cache
+    // lines from each other. The copies are merged back when queried. Until
+    // they have been allocated, everyone uses the boot processor's table.
+    //
+    // Note that we may get moved to another processor right after this, which
+    // is fine: all the updates are interlocked, and it doesn't matter which
+    // copy a given allocation or free ends up being counted in.
+    //
+    Table = ExPoolTagTables[KeGetCurrentProcessorNumber()];
+    return Table ? Table : PoolTrackTable;
+}
+
+PPOOL_TRACKER_TABLE
+NTAPI
+ExpFindPoolTrackerEntry(IN PPOOL_TRACKER_TABLE Table,
+                        IN ULONG Key,
+                        IN BOOLEAN Create)
+{
+    ULONG Hash, Index;
+    KIRQL OldIrql;
+    PPOOL_TRACKER_TABLE TableEntry;
+
+    //
+    // Compute the hash for this key, and loop all the possible buckets
+    //
+    Hash = ExpComputeHashForTag(Key, PoolTrackTableMask);
+    Index = Hash;
+    while (TRUE)
+    {
+        //
+        // Do we already have an entry for this tag?
+        //
+        TableEntry = &Table[Hash];
+        if (TableEntry->Key == Key) return TableEntry;
+
+        //
+        // We don't have an entry yet, but we've found a free bucket for it
+        //
+        if (!(TableEntry->Key) && (Hash != PoolTrackTableSize - 1))
+        {
+            //
+            // If the caller only wanted to look, the tag isn't in this table
+            //
+            if (!Create) return NULL;
+
+            //
+            // We need to hold the lock while creating a new entry, since other
+            // processors might be in this code path as well
+            //
+            ExAcquireSpinLock(&ExpTaggedPoolLock, &OldIrql);
+            if (!TableEntry->Key)
+            {
+                //
+                // We've won the race, so now create this entry in the bucket
+                //
+                TableEntry->Key = Key;
+            }
+            ExReleaseSpinLock(&ExpTaggedPoolLock, OldIrql);
+
+            //
+            // Now we force the loop to run again, and we should now end up in
+            // the code path above which returns the entry...
+            //
+            continue;
+        }
+
+        //
+        // This path is hit when we don't have an entry, and the current bucket
+        // is full, so we simply try the next one
+        //
+        Hash = (Hash + 1) & PoolTrackTableMask;
+        if (Hash == Index) break;
+    }
+
+    //
+    // And finally this path is hit when all the buckets are full, and we need
+    // some expansion. This path is not yet supported in ReactOS
+    //
+    return NULL;
+}
+
+VOID
+NTAPI
+ExpMergePoolTrackerTable(IN PPOOL_TRACKER_TABLE Target,
+                         IN PPOOL_TRACKER_TABLE Source)
+{
+    SIZE_T i;
+    PPOOL_TRACKER_TABLE SourceEntry, TargetEntry;
+
+    //
+    // Add the counters of every tag in the source table to the target one
+    //
+    for (i = 0; i < PoolTrackTableSize; i++)
+    {
+        SourceEntry = &Source[i];
+        if (!SourceEntry->Key) continue;
+
+        //
+        // The per-processor tables start out as a copy of the boot one, so
+        // most tags live in the same bucket in both, and we can skip hashing
+        //
+        TargetEntry = &Target[i];
+        if (TargetEntry->Key != SourceEntry->Key)
+        {
+            TargetEntry = ExpFindPoolTrackerEntry(Target, SourceEntry->Key, TRUE);
+            if (!TargetEntry)
+            {
+                DPRINT1("Out of pool tag space, ignoring...\n");
+                continue;
+            }
+        }
+
+        TargetEntry->NonPagedAllocs += SourceEntry->NonPagedAllocs;
+        TargetEntry->NonPagedFrees += SourceEntry->NonPagedFrees;
+        TargetEntry->NonPagedBytes += SourceEntry->NonPagedBytes;
+        TargetEntry->PagedAllocs += SourceEntry->PagedAllocs;
+        TargetEntry->PagedFrees += SourceEntry->PagedFrees;
+        TargetEntry->PagedBytes += SourceEntry->PagedBytes;
+    }
+}
+
+VOID
+NTAPI
+ExpRecordPoolTrace(IN PVOID Va,
+                   IN ULONG Tag,
+                   IN SIZE_T NumberOfBytes,
+                   IN POOL_TYPE PoolType,
+                   IN PVOID Caller,
+                   IN BOOLEAN Free)
+{
+    ULONG SampleRate, Processor, Index, Slot, FrameCount = 0, i;
+    PVOID Frames[SYSTEM_POOL_TRACE_FRAMES + 8];
+    PPOOL_TRACE_BUFFER Buffer;
+    PSYSTEM_POOL_TRACE_ENTRY Entry;
+    KIRQL OldIrql;
+
+    //
+    // Tracing might have been turned off in the meantime
+    //
+    SampleRate = ExpPoolTraceSampleRate;
+    if (!SampleRate) return;
+
+    //
+    // Check if the caller only wants a given tag
+    //
+    Tag &= ~PROTECTED_POOL;
+    if ((ExpPoolTraceTag) && (Tag != ExpPoolTraceTag)) return;
+
+    //
+    // Sample based on the address rather than on a count, so that when we
+    // record an allocation, we also record its free, and the other way around.
+    // This is what makes it possible to find leaks from a sampled trace
+    //
+    if ((SampleRate > 1) &&
+        (((ULONG)((ULONG_PTR)Va / POOL_BLOCK_SIZE) * 0x9E3779B1) % SampleRate))
+    {
+        return;
+    }
+
+    //
+    // Walk the stack first, so that we spend as little time as possible at
+    // DISPATCH_LEVEL below
+    //
+    if (ExpPoolTraceFrameCount)
+    {
+        FrameCount = RtlWalkFrameChain(Frames, RTL_NUMBER_OF(Frames), 0);
+    }
+
+    //
+    // Each processor records into its own ring buffer. Stay on this processor
+    // and don't let another writer run on it until the record is published,
+    // otherwise a preempted writer could be lapped, and then overwrite a
+    // newer record in the same slot
+    //
+    KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
+    Processor = KeGetCurrentProcessorNumber();
+    Buffer = ExpPoolTraceBuffers[Processor];
+    if (!Buffer)
+    {
+        KeLowerIrql(OldIrql);
+        return;
+    }
+
+    //
+    // Take the next slot, overwriting the oldest record if the reader didn't
+    // get to it in time, and mark it as being written
+    //
+    Index = (ULONG)InterlockedIncrement(&Buffer->WriteIndex) - 1;
+    Slot = Index & (POOL_TRACE_ENTRIES - 1);
+    InterlockedExchange((PLONG)&Buffer->Sequence[Slot], 0);
+
+    Entry = &Buffer->Entries[Slot];
+    Entry->TimeStamp = KeQueryInterruptTime();
+    Entry->Va = Va;
+    Entry->Caller = Caller;
+    Entry->NumberOfBytes = NumberOfBytes;
+    Entry->Tag = Tag;
+    Entry->PoolType = (UCHAR)PoolType;
+    Entry->Flags = Free ? SYSTEM_POOL_TRACE_FREE : 0;
+    Entry->Processor = (UCHAR)Processor;
+    Entry->FrameCount = 0;
+
+    //
+    // If asked to, also save who called the caller. Our own frames, and the
+    // caller itself which we already have, are skipped
+    //
+    if (FrameCount)
+    {
+        for (i = 0; (i < FrameCount) && (Frames[i] != Caller); i++);
+        for (i++; (i < FrameCount) && (Entry->FrameCount < ExpPoolTraceFrameCount); i++)
+        {
+            Entry->Frames[Entry->FrameCount++] = Frames[i];
+        }
+    }
+
+    //
+    // The record can now be read
+    //
+    InterlockedExchange((PLONG)&Buffer->Sequence[Slot], Index + 1);
+    KeLowerIrql(OldIrql);
+}
+
+FORCEINLINE
+VOID
+ExpTracePoolBlock(IN PVOID Va,
+                  IN ULONG Tag,
+                  IN SIZE_T NumberOfBytes,
+                  IN POOL_TYPE PoolType,
+                  IN PVOID Caller,
+                  IN BOOLEAN Free)
+{
+    //
+    // Allocation tracing is off unless someone asked for it, and then all
+    // this costs is checking a global
+    //
+    if (ExpPoolTraceSampleRate)
+    {
+        ExpRecordPoolTrace(Va, Tag, NumberOfBytes, PoolType, Caller, Free);
+    }
+}
+
 #if DBG
 /*
  * FORCEINLINE
@@ -480,6 +750,58 @@ ExpComputePartialHashForAddress(IN PVOID BaseAddress)
     DPRINT1(fmt, ##__VA_ARGS__)
 #endif
 
+BOOLEAN
+NTAPI
+ExpSumPoolTrackerEntries(IN ULONG Processor,
+                         IN SIZE_T Index,
+                         OUT PPOOL_TRACKER_TABLE Total)
+{
+    ULONG i, Key;
+    PPOOL_TRACKER_TABLE Table, TableEntry;
+
+    //
+    // Get the tag in this bucket of this processor's table, if any
+    //
+    Table = ExPoolTagTables[Processor];
+    if (!Table) return FALSE;
+    Key = Table[Index].Key;
+    if (!Key) return FALSE;
+
+    //
+    // If an earlier processor has this tag too, it has already been summed up
+    //
+    for (i = 0; i < Processor; i++)
+    {
+        if (ExPoolTagTables[i] &&
+            ExpFindPoolTrackerEntry(ExPoolTagTables[i], Key, FALSE))
+        {
+            return FALSE;
+        }
+    }
+
+    //
+    // Otherwise, add up what this and the later processors have counted. This
+    // doesn't allocate anything, since it can be called from the debugger
+    //
+    RtlZeroMemory(Total, sizeof(*Total));
+    Total->Key = Key;
+    for (i = Processor; i < (ULONG)KeNumberProcessors; i++)
+    {
+        if (!ExPoolTagTables[i]) continue;
+        TableEntry = ExpFindPoolTrackerEntry(ExPoolTagTables[i], Key, FALSE);
+        if (!TableEntry) continue;
+
+        Total->NonPagedAllocs += TableEntry->NonPagedAllocs;
+        Total->NonPagedFrees += TableEntry->NonPagedFrees;
+        Total->NonPagedBytes += TableEntry->NonPagedBytes;
+        Total->PagedAllocs += TableEntry->PagedAllocs;
+        Total->PagedFrees += TableEntry->PagedFrees;
+        Total->PagedBytes += TableEntry->PagedBytes;
+    }
+
+    return TRUE;
+}
+
 VOID
 MiDumpPoolConsumers(BOOLEAN CalledFromDbg, ULONG Tag, ULONG Mask, ULONG Flags)
 {
@@ -522,13 +844,24 @@ MiDumpPoolConsumers(BOOLEAN CalledFromDbg, ULONG Tag, ULONG Mask, ULONG Flags)
     }
 
     //
-    // We'll extract allocations for all the tracked pools
+    // We'll extract allocations for all the tracked pools, going through the
+    // tables of all the processors one after the other
     //
-    for (i = 0; i < PoolTrackTableSize; ++i)
+    for (i = 0; i < KeNumberProcessors * PoolTrackTableSize; ++i)
     {
+        POOL_TRACKER_TABLE MergedEntry;
         PPOOL_TRACKER_TABLE TableEntry;
 
-        TableEntry = &PoolTrackTable[i];
+        //
+        // Each tag is printed once, with what all the processors counted
+        //
+        if (!ExpSumPoolTrackerEntries((ULONG)(i / PoolTrackTableSize),
+                                      i % PoolTrackTableSize,
+                                      &MergedEntry))
+        {
+            continue;
+        }
+        TableEntry = &MergedEntry;
 
         //
         // We only care about tags which have allocated memory
@@ -749,9 +1082,7 @@ ExpRemovePoolTracker(IN ULONG Key,
                      IN SIZE_T NumberOfBytes,
                      IN POOL_TYPE PoolType)
 {
-    ULONG Hash, Index;
-    PPOOL_TRACKER_TABLE Table, TableEntry;
-    SIZE_T TableMask, TableSize;
+    PPOOL_TRACKER_TABLE TableEntry;
 
     //
     // Remove the PROTECTED_POOL flag which is not part of the tag
@@ -765,73 +1096,35 @@ ExpRemovePoolTracker(IN ULONG Key,
     if (Key == PoolHitTag) DbgBreakPoint();
 
     //
-    // Why the double indirection? Because normally this function is also used
-    // when doing session pool allocations, which has another set of tables,
-    // sizes, and masks that live in session pool. Now we don't support session
-    // pool so we only ever use the regular tables, but I'm keeping the code this
-    // way so that the day we DO support session pool, it won't require that
-    // many changes
-    //
-    Table = PoolTrackTable;
-    TableMask = PoolTrackTableMask;
-    TableSize = PoolTrackTableSize;
-    DBG_UNREFERENCED_LOCAL_VARIABLE(TableSize);
-
-    //
-    // Compute the hash for this key, and loop all the possible buckets
+    // Find the entry for this tag in this processor's table. The block may
+    // well have been allocated on another processor, in which case this table
+    // might not have an entry for the tag yet, so create one if needed: the
+    // counters only have to add up once all the tables are merged
     //
-    Hash = ExpComputeHashForTag(Key, TableMask);
-    Index = Hash;
-    while (TRUE)
+    TableEntry = ExpFindPoolTrackerEntry(ExpGetPoolTrackerTable(), Key, TRUE);
+    if (!TableEntry)
     {
         //
-        // Have we found the entry for this tag? */
+        // All the buckets are full, and we need some expansion. This path is
+        // not yet supported in ReactOS and so we'll ignore the tag
         //
-        TableEntry = &Table[Hash];
-        if (TableEntry->Key == Key)
-        {
-            //
-            // Decrement the counters depending on if this was paged or nonpaged
-            // pool
-            //
-            if ((PoolType & BASE_POOL_TYPE_MASK) == NonPagedPool)
-            {
-                InterlockedIncrement(&TableEntry->NonPagedFrees);
-                InterlockedExchangeAddSizeT(&TableEntry->NonPagedBytes,
-                                            -(SSIZE_T)NumberOfBytes);
-                return;
-            }
-            InterlockedIncrement(&TableEntry->PagedFrees);
-            InterlockedExchangeAddSizeT(&TableEntry->PagedBytes,
-                                        -(SSIZE_T)NumberOfBytes);
-            return;
-        }
-
-        //
-        // We should have only ended up with an empty entry if we've reached
-        // the last bucket
-        //
-        if (!TableEntry->Key)
-        {
-            DPRINT1("Empty item reached in tracker table. Hash=0x%lx, TableMask=0x%lx, Tag=0x%08lx, NumberOfBytes=%lu, PoolType=%d\n",
-                    Hash, TableMask, Key, (ULONG)NumberOfBytes, PoolType);
-            ASSERT(Hash == TableMask);
-        }
-
-        //
-        // This path is hit when we don't have an entry, and the current bucket
-        // is full, so we simply try the next one
-        //
-        Hash = (Hash + 1) & TableMask;
-        if (Hash == Index) break;
+        DPRINT1("Out of pool tag space, ignoring...\n");
+        return;
     }
 
     //
-    // And finally this path is hit when all the buckets are full, and we need
-    // some expansion. This path is not yet supported in ReactOS and so we'll
-    // ignore the tag
+    // Decrement the counters depending on if this was paged or nonpaged pool
     //
-    DPRINT1("Out of pool tag space, ignoring...\n");
+    if ((PoolType & BASE_POOL_TYPE_MASK) == NonPagedPool)
+    {
+        InterlockedIncrement(&TableEntry->NonPagedFrees);
+        InterlockedExchangeAddSizeT(&TableEntry->NonPagedBytes,
+                                    -(SSIZE_T)NumberOfBytes);
+        return;
+    }
+    InterlockedIncrement(&TableEntry->PagedFrees);
+    InterlockedExchangeAddSizeT(&TableEntry->PagedBytes,
+                                -(SSIZE_T)NumberOfBytes);
 }
 
 VOID
@@ -840,10 +1133,7 @@ ExpInsertPoolTracker(IN ULONG Key,
                      IN SIZE_T NumberOfBytes,
                      IN POOL_TYPE PoolType)
 {
-    ULONG Hash, Index;
-    KIRQL OldIrql;
-    PPOOL_TRACKER_TABLE Table, TableEntry;
-    SIZE_T TableMask, TableSize;
+    PPOOL_TRACKER_TABLE TableEntry;
 
     //
     // Remove the PROTECTED_POOL flag which is not part of the tag
@@ -865,91 +1155,32 @@ ExpInsertPoolTracker(IN ULONG Key,
     // ASSERT on ReactOS features not yet supported
     //
     ASSERT(!(PoolType & SESSION_POOL_MASK));
-    ASSERT(KeGetCurrentProcessorNumber() == 0);
 
     //
-    // Why the double indirection? Because normally this function is also used
-    // when doing session pool allocations, which has another set of tables,
-    // sizes, and masks that live in session pool. Now we don't support session
-    // pool so we only ever use the regular tables, but I'm keeping the code this
-    // way so that the day we DO support session pool, it won't require that
-    // many changes
+    // Find or create the entry for this tag in this processor's table
     //
-    Table = PoolTrackTable;
-    TableMask = PoolTrackTableMask;
-    TableSize = PoolTrackTableSize;
-    DBG_UNREFERENCED_LOCAL_VARIABLE(TableSize);
-
-    //
-    // Compute the hash for this key, and loop all the possible buckets
-    //
-    Hash = ExpComputeHashForTag(Key, TableMask);
-    Index = Hash;
-    while (TRUE)
+    TableEntry = ExpFindPoolTrackerEntry(ExpGetPoolTrackerTable(), Key, TRUE);
+    if (!TableEntry)
     {
         //
-        // Do we already have an entry for this tag? */
-        //
-        TableEntry = &Table[Hash];
-        if (TableEntry->Key == Key)
-        {
-            //
-            // Increment the counters depending on if this was paged or nonpaged
-            // pool
-            //
-            if ((PoolType & BASE_POOL_TYPE_MASK) == NonPagedPool)
-            {
-                InterlockedIncrement(&TableEntry->NonPagedAllocs);
-                InterlockedExchangeAddSizeT(&TableEntry->NonPagedBytes, NumberOfBytes);
-                return;
-            }
-            InterlockedIncrement(&TableEntry->PagedAllocs);
-            InterlockedExchangeAddSizeT(&TableEntry->PagedBytes, NumberOfBytes);
-            return;
-        }
-
-        //
-        // We don't have an entry yet, but we've found a free bucket for it
-        //
-        if (!(TableEntry->Key) && (Hash != PoolTrackTableSize - 1))
-        {
-            //
-            // We need to hold the lock while creating a new entry, since other
-            // processors might be in this code path as well
-            //
-            ExAcquireSpinLock(&ExpTaggedPoolLock, &OldIrql);
-            if (!PoolTrackTable[Hash].Key)
-            {
-                //
-                // We've won the race, so now create this entry in the bucket
-                //
-                ASSERT(Table[Hash].Key == 0);
-                PoolTrackTable[Hash].Key = Key;
-                TableEntry->Key = Key;
-            }
-            ExReleaseSpinLock(&ExpTaggedPoolLock, OldIrql);
-
-            //
-            // Now we force the loop to run again, and we should now end up in
-            // the code path above which does the interlocked increments...
-            //
-            continue;
-        }
-
-        //
-        // This path is hit when we don't have an entry, and the current bucket
-        // is full, so we simply try the next one
+        // All the buckets are full, and we need some expansion. This path is
+        // not yet supported in ReactOS and so we'll ignore the tag
         //
-        Hash = (Hash + 1) & TableMask;
-        if (Hash == Index) break;
+        DPRINT1("Out of pool tag space, ignoring...\n");
+        return;
     }
 
     //
-    // And finally this path is hit when all the buckets are full, and we need
-    // some expansion. This path is not yet supported in ReactOS and so we'll
-    // ignore the tag
+    // Increment the counters depending on if this was paged or nonpaged pool
     //
-    DPRINT1("Out of pool tag space, ignoring...\n");
+    if ((PoolType & BASE_POOL_TYPE_MASK) == NonPagedPool)
+    {
+        InterlockedIncrement(&TableEntry->NonPagedAllocs);
+        InterlockedExchangeAddSizeT(&TableEntry->NonPagedBytes, NumberOfBytes);
+        return;
+    }
+    InterlockedIncrement(&TableEntry->PagedAllocs);
+    InterlockedExchangeAddSizeT(&TableEntry->PagedBytes, NumberOfBytes);
 }
 
 CODE_SEG("INIT")
@@ -1105,6 +1336,12 @@ InitializePool(IN POOL_TYPE PoolType,
         //
         ExpSeedHotTags();
 
+        //
+        // This is also the boot processor's own table. The other processors
+        // get theirs once they have all been started
+        //
+        ExPoolTagTables[0] = PoolTrackTable;
+
         //
         // We now do the exact same thing with the tracker table for big pages
         //
@@ -1257,6 +1494,82 @@ InitializePool(IN POOL_TYPE PoolType,
     }
 }
 
+CODE_SEG("INIT")
+VOID
+NTAPI
+ExInitializeProcessorPools(VOID)
+{
+    ULONG Processor, i;
+    PKPRCB Prcb;
+    PGENERAL_LOOKASIDE Lookaside;
+    PPOOL_TRACKER_TABLE Table;
+
+    //
+    // All the processors have been started by now, so give each of them its
+    // own small block lookaside lists and tracker table
+    //
+    for (Processor = 0; Processor < (ULONG)KeNumberProcessors; Processor++)
+    {
+        Prcb = KiProcessorBlock[Processor];
+        if (!Prcb) continue;
+
+        //
+        // Until now, the per-CPU lookaside lists of every processor were the
+        // same as the global ones. Give the processor lists of its own, which
+        // it can push to and pop from without touching anyone else's cache
+        // lines, and keep the global lists as a second level, shared by
+        // everyone, before having to go take the pool lock
+        //
+        Lookaside = ExAllocatePoolWithTag(NonPagedPool,
+                                          2 * NUMBER_POOL_LOOKASIDE_LISTS *
+                                          sizeof(GENERAL_LOOKASIDE),
+                                          'looP');
+        if (Lookaside)
+        {
+            for (i = 0; i < NUMBER_POOL_LOOKASIDE_LISTS; i++)
+            {
+                ExInitializeSystemLookasideList(&Lookaside[i],
+                                                NonPagedPool,
+                                                (i + 1) * 8,
+                                                'looP',
+                                                256,
+                                                &ExPoolLookasideListHead);
+                ExInitializeSystemLookasideList(&Lookaside[NUMBER_POOL_LOOKASIDE_LISTS + i],
+                                                PagedPool,
+                                                (i + 1) * 8,
+                                                'looP',
+                                                256,
+                                                &ExPoolLookasideListHead);
+
+                Prcb->PPNPagedLookasideList[i].P = &Lookaside[i];
+                Prcb->PPPagedLookasideList[i].P = &Lookaside[NUMBER_POOL_LOOKASIDE_LISTS + i];
+            }
+        }
+
+        //
+        // The boot processor already uses the original tracker table
+        //
+        if (ExPoolTagTables[Processor]) continue;
+
+        //
+        // The other ones get a copy of it with the same tags in the same
+        // buckets, but no counts. If this fails, they just keep sharing the
+        // boot processor's table
+        //
+        Table = ExAllocatePoolWithTag(NonPagedPool,
+                                      PoolTrackTableSize * sizeof(POOL_TRACKER_TABLE),
+                                      'looP');
+        if (!Table) continue;
+
+        RtlZeroMemory(Table, PoolTrackTableSize * sizeof(POOL_TRACKER_TABLE));
+        for (i = 0; i < PoolTrackTableSize; i++)
+        {
+            Table[i].Key = PoolTrackTable[i].Key;
+        }
+        ExPoolTagTables[Processor] = Table;
+    }
+}
+
 FORCEINLINE
 KIRQL
 ExLockPool(IN PPOOL_DESCRIPTOR Descriptor)
@@ -1313,6 +1626,7 @@ ExpGetPoolTagInfoTarget(IN PKDPC Dpc,
                         IN PVOID SystemArgument2)
 {
     PPOOL_DPC_CONTEXT Context = DeferredContext;
+    ULONG i;
     UNREFERENCED_PARAMETER(Dpc);
     ASSERT(KeGetCurrentIrql() == DISPATCH_LEVEL);
 
@@ -1325,6 +1639,15 @@ ExpGetPoolTagInfoTarget(IN PKDPC Dpc,
                       PoolTrackTable,
                       Context->PoolTrackTableSize * sizeof(POOL_TRACKER_TABLE));
 
+        //
+        // And add in what the other processors counted in their own tables
+        //
+        for (i = 1; i < (ULONG)KeNumberProcessors; i++)
+        {
+            if (!ExPoolTagTables[i]) continue;
+            ExpMergePoolTrackerTable(Context->PoolTrackTable, ExPoolTagTables[i]);
+        }
+
         //
         // This is here because ReactOS does not yet support expansion
         //
@@ -1445,6 +1768,150 @@ ExGetPoolTagInfo(IN PSYSTEM_POOLTAG_INFORMATION SystemInformation,
     return Status;
 }
 
+NTSTATUS
+NTAPI
+ExGetPoolTraceInfo(IN PSYSTEM_POOL_TRACE_INFORMATION SystemInformation,
+                   IN ULONG SystemInformationLength,
+                   IN OUT PULONG ReturnLength OPTIONAL)
+{
+    ULONG Processor, MaxCount, Count, Lost;
+    ULONG ReadIndex, Start, End, Index, Slot;
+    PPOOL_TRACE_BUFFER Buffer;
+    PSYSTEM_POOL_TRACE_ENTRY Entry;
+    ASSERT(KeGetCurrentIrql() == PASSIVE_LEVEL);
+
+    //
+    // The caller's buffer must at least hold the header
+    //
+    if (SystemInformationLength < FIELD_OFFSET(SYSTEM_POOL_TRACE_INFORMATION, Entries))
+    {
+        if (ReturnLength) *ReturnLength = FIELD_OFFSET(SYSTEM_POOL_TRACE_INFORMATION, Entries);
+        return STATUS_INFO_LENGTH_MISMATCH;
+    }
+    MaxCount = (SystemInformationLength -
+                FIELD_OFFSET(SYSTEM_POOL_TRACE_INFORMATION, Entries)) /
+               sizeof(SYSTEM_POOL_TRACE_ENTRY);
+
+    //
+    // Return the current settings
+    //
+    SystemInformation->Control.SampleRate = ExpPoolTraceSampleRate;
+    SystemInformation->Control.Tag = ExpPoolTraceTag;
+    SystemInformation->Control.FrameCount = ExpPoolTraceFrameCount;
+    SystemInformation->EntriesPerProcessor = POOL_TRACE_ENTRIES;
+
+    //
+    // Now return the records that no one has read yet, from every processor
+    //
+    Count = 0;
+    Lost = 0;
+    for (Processor = 0; Processor < (ULONG)KeNumberProcessors; Processor++)
+    {
+        Buffer = ExpPoolTraceBuffers[Processor];
+        if (!Buffer) continue;
+
+        //
+        // Claim as many records as the caller has room for. The writers never
+        // wait for us, so anything they wrapped around and overwrote since the
+        // last time is lost
+        //
+        do
+        {
+            ReadIndex = (ULONG)Buffer->ReadIndex;
+            End = (ULONG)Buffer->WriteIndex;
+            Start = ReadIndex;
+            if ((End - Start) > POOL_TRACE_ENTRIES) Start = End - POOL_TRACE_ENTRIES;
+            if ((End - Start) > (MaxCount - Count)) End = Start + (MaxCount - Count);
+        } while ((ULONG)InterlockedCompareExchange(&Buffer->ReadIndex,
+                                                    (LONG)End,
+                                                    (LONG)ReadIndex) != ReadIndex);
+        Lost += Start - ReadIndex;
+
+        for (Index = Start; Index != End; Index++)
+        {
+            //
+            // Copy the record, and make sure it wasn't being written or
+            // overwritten while we did so
+            //
+            Slot = Index & (POOL_TRACE_ENTRIES - 1);
+            Entry = &SystemInformation->Entries[Count];
+            if (Buffer->Sequence[Slot] == Index + 1)
+            {
+                *Entry = Buffer->Entries[Slot];
+                KeMemoryBarrier();
+                if (Buffer->Sequence[Slot] == Index + 1)
+                {
+                    Count++;
+                    continue;
+                }
+            }
+            Lost++;
+        }
+    }
+
+    //
+    // Return how many records we copied and how many were lost
+    //
+    SystemInformation->Lost = Lost;
+    SystemInformation->Count = Count;
+    if (ReturnLength)
+    {
+        *ReturnLength = FIELD_OFFSET(SYSTEM_POOL_TRACE_INFORMATION, Entries) +
+                        Count * sizeof(SYSTEM_POOL_TRACE_ENTRY);
+    }
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+NTAPI
+ExSetPoolTraceInfo(IN PSYSTEM_POOL_TRACE_CONTROL Control)
+{
+    ULONG Processor;
+    PPOOL_TRACE_BUFFER Buffer;
+    ASSERT(KeGetCurrentIrql() == PASSIVE_LEVEL);
+
+    //
+    // We only have so much room for the stack
+    //
+    if (Control->FrameCount > SYSTEM_POOL_TRACE_FRAMES) return STATUS_INVALID_PARAMETER;
+
+    //
+    // Allocate the ring buffers the first time tracing gets turned on. They
+    // are never freed, since the pool might be writing to them at any time
+    //
+    if (Control->SampleRate)
+    {
+        for (Processor = 0; Processor < (ULONG)KeNumberProcessors; Processor++)
+        {
+            if (ExpPoolTraceBuffers[Processor]) continue;
+
+            Buffer = ExAllocatePoolWithTag(NonPagedPool, sizeof(POOL_TRACE_BUFFER), 'looP');
+            if (!Buffer) return STATUS_INSUFFICIENT_RESOURCES;
+            RtlZeroMemory(Buffer, sizeof(POOL_TRACE_BUFFER));
+
+            //
+            // Someone else could be doing this too
+            //
+            if (InterlockedCompareExchangePointer((PVOID*)&ExpPoolTraceBuffers[Processor],
+                                                  Buffer,
+                                                  NULL))
+            {
+                ExFreePoolWithTag(Buffer, 'looP');
+            }
+        }
+    }
+
+    //
+    // Stop tracing while changing the settings, then start again with the new
+    // ones if we should
+    //
+    InterlockedExchange((PLONG)&ExpPoolTraceSampleRate, 0);
+    ExpPoolTraceTag = Control->Tag;
+    ExpPoolTraceFrameCount = Control->FrameCount;
+    InterlockedExchange((PLONG)&ExpPoolTraceSampleRate, Control->SampleRate);
+    return STATUS_SUCCESS;
+}
+
 _IRQL_requires_(DISPATCH_LEVEL)
 BOOLEAN
 NTAPI
@@ -2003,6 +2470,12 @@ ExAllocatePoolWithTag(IN POOL_TYPE PoolType,
             Tag = ' GIB';
         }
         ExpInsertPoolTracker(Tag, ROUND_TO_PAGES(NumberOfBytes), OriginalType);
+        ExpTracePoolBlock(Entry,
+                          Tag,
+                          ROUND_TO_PAGES(NumberOfBytes),
+                          OriginalType,
+                          _ReturnAddress(),
+                          FALSE);
         return Entry;
     }
 
@@ -2066,6 +2539,12 @@ ExAllocatePoolWithTag(IN POOL_TYPE PoolType,
             ExpInsertPoolTracker(Tag,
                                  Entry->BlockSize * POOL_BLOCK_SIZE,
                                  OriginalType);
+            ExpTracePoolBlock(POOL_FREE_BLOCK(Entry),
+                              Tag,
+                              Entry->BlockSize * POOL_BLOCK_SIZE,
+                              OriginalType,
+                              _ReturnAddress(),
+                              FALSE);
 
             //
             // Return the pool allocation
@@ -2250,6 +2729,12 @@ ExAllocatePoolWithTag(IN POOL_TYPE PoolType,
             ExpInsertPoolTracker(Tag,
                                  Entry->BlockSize * POOL_BLOCK_SIZE,
                                  OriginalType);
+            ExpTracePoolBlock(POOL_FREE_BLOCK(Entry),
+                              Tag,
+                              Entry->BlockSize * POOL_BLOCK_SIZE,
+                              OriginalType,
+                              _ReturnAddress(),
+                              FALSE);
 
             //
             // Return the pool allocation
@@ -2394,6 +2879,12 @@ ExAllocatePoolWithTag(IN POOL_TYPE PoolType,
     ExpInsertPoolTracker(Tag,
                          Entry->BlockSize * POOL_BLOCK_SIZE,
                          OriginalType);
+    ExpTracePoolBlock(POOL_FREE_BLOCK(Entry),
+                      Tag,
+                      Entry->BlockSize * POOL_BLOCK_SIZE,
+                      OriginalType,
+                      _ReturnAddress(),
+                      FALSE);
 
     //
     // And return the pool allocation
@@ -2560,6 +3051,12 @@ ExFreePoolWithTag(IN PVOID P,
         // tracker now
         //
         ExpRemovePoolTracker(Tag, PageCount << PAGE_SHIFT, PoolType);
+        ExpTracePoolBlock(P,
+                          Tag,
+                          PageCount << PAGE_SHIFT,
+                          PoolType,
+                          _ReturnAddress(),
+                          TRUE);
 
         //
         // Check if any of the debug flags are enabled
@@ -2645,6 +3142,12 @@ ExFreePoolWithTag(IN PVOID P,
     ExpRemovePoolTracker(Tag,
                          BlockSize * POOL_BLOCK_SIZE,
                          Entry->PoolType - 1);
+    ExpTracePoolBlock(P,
+                      Tag,
+                      BlockSize * POOL_BLOCK_SIZE,
+                      Entry->PoolType - 1,
+                      _ReturnAddress(),
+                      TRUE);
 
     //
     // Release pool quota, if any
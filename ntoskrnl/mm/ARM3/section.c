@@ -823,8 +823,10 @@ MiUnmapViewOfSection(IN PEPROCESS Process,
     KAPC_STATE ApcState;
     PMMVAD Vad;
     PVOID DbgBase = NULL;
+    ULONG_PTR StartingAddress;
     SIZE_T RegionSize;
     NTSTATUS Status;
+    LIST_ENTRY RegisteredBuffers;
     PETHREAD CurrentThread = PsGetCurrentThread();
     PEPROCESS CurrentProcess = PsGetCurrentProcess();
     PAGED_CODE();
@@ -879,6 +881,7 @@ MiUnmapViewOfSection(IN PEPROCESS Process,
     }
 
     /* Compute the size of the VAD region */
+    StartingAddress = Vad->StartingVpn << PAGE_SHIFT;
     RegionSize = PAGE_SIZE + ((Vad->EndingVpn - Vad->StartingVpn) << PAGE_SHIFT);
 
     /* For SEC_NO_CHANGE sections, we need some extra checks */
@@ -903,6 +906,12 @@ MiUnmapViewOfSection(IN PEPROCESS Process,
 
     /* FIXME: Remove VAD charges */
 
+    /* Registered I/O buffers in the view lose their pages, stop new I/O on them */
+    IopDropRegisteredBuffers(Process,
+                             StartingAddress,
+                             StartingAddress + RegionSize,
+                             &RegisteredBuffers);
+
     /* Lock the working set */
     MiLockProcessWorkingSetUnsafe(Process, CurrentThread);
 
@@ -919,8 +928,11 @@ MiUnmapViewOfSection(IN PEPROCESS Process,
     Process->VirtualSize -= RegionSize;
     if (!Flags) MmUnlockAddressSpace(&Process->Vm);
 
-    /* Destroy the VAD and return success */
+    /* Destroy the VAD */
     ExFreePool(Vad);
+
+    /* Unlock the pages the dropped registrations had locked */
+    IopReleaseRegisteredBuffers(&RegisteredBuffers);
     Status = STATUS_SUCCESS;
 
     /* Failure and success case -- send debugger message, detach, and return */
@@ -5145,6 +5145,7 @@ NtFreeVirtualMemory(IN HANDLE ProcessHandle,
     PEPROCESS CurrentProcess = PsGetCurrentProcess();
     KPROCESSOR_MODE PreviousMode = KeGetPreviousMode();
     KAPC_STATE ApcState;
+    LIST_ENTRY RegisteredBuffers;
     BOOLEAN Attached = FALSE;
     PAGED_CODE();
 
@@ -5442,6 +5443,13 @@ NtFreeVirtualMemory(IN HANDLE ProcessHandle,
             }
         }
 
+        //
+        // I/O buffers registered in the range must not keep serving the old
+        // pages to whatever gets allocated there next, so stop new I/O from
+        // using them before the pages go away
+        //
+        IopDropRegisteredBuffers(Process, StartingAddress, EndingAddress + 1, &RegisteredBuffers);
+
         //
         // Now we have a range of pages to dereference, so call the right API
         // to do that and then release the working set, since we're done messing
@@ -5468,6 +5476,12 @@ FinalPath:
         MmUnlockAddressSpace(AddressSpace);
         if (Vad) ExFreePool(Vad);
         if (Attached) KeUnstackDetachProcess(&ApcState);
+
+        //
+        // Unlock the pages of the registered I/O buffers that were dropped
+        // above, now that the address space lock is released
+        //
+        IopReleaseRegisteredBuffers(&RegisteredBuffers);
         if (ProcessHandle != NtCurrentProcess()) ObDereferenceObject(Process);
 
         //
@@ -5517,6 +5531,11 @@ FinalPath:
         EndingAddress = (Vad->EndingVpn << PAGE_SHIFT) | (PAGE_SIZE - 1);
     }
 
+    //
+    // Registered I/O buffers in the range lose their pages too
+    //
+    IopDropRegisteredBuffers(Process, StartingAddress, EndingAddress + 1, &RegisteredBuffers);
+
     //
     // Decommit the PTEs for the range plus the actual backing pages for the
     // range, then reduce that amount from the commit charge in the VAD
@@ -4141,6 +4141,8 @@ MiRosUnmapViewOfSection(IN PEPROCESS Process,
     PMMSUPPORT AddressSpace;
     PROS_SECTION_OBJECT Section;
     PVOID ImageBaseAddress = 0;
+    ULONG_PTR ViewStart, ViewEnd;
+    LIST_ENTRY RegisteredBuffers;
 
     DPRINT("Opening memory area Process %p BaseAddress %p\n",
            Process, BaseAddress);
@@ -4194,6 +4196,17 @@ MiRosUnmapViewOfSection(IN PEPROCESS Process,
             KeBugCheck(MEMORY_MANAGEMENT);
         }
 
+        ViewStart = ViewEnd = (ULONG_PTR)ImageBaseAddress;
+        for (i = 0; i < NrSegments; i++)
+        {
+            ViewEnd = max(ViewEnd,
+                          ViewStart + (ULONG_PTR)SectionSegments[i].Image.VirtualAddress +
+                          (ULONG_PTR)SectionSegments[i].Length.QuadPart);
+        }
+
+        /* Registered I/O buffers in the view lose their pages, stop new I/O on them */
+        IopDropRegisteredBuffers(Process, ViewStart, ViewEnd, &RegisteredBuffers);
+
         for (i = 0; i < NrSegments; i++)
         {
             PVOID SBaseAddress = (PVOID)
@@ -4210,6 +4223,12 @@ MiRosUnmapViewOfSection(IN PEPROCESS Process,
     }
     else
     {
+        ViewStart = MA_GetStartingAddress(MemoryArea);
+        ViewEnd = MA_GetEndingAddress(MemoryArea);
+
+        /* Registered I/O buffers in the view lose their pages, stop new I/O on them */
+        IopDropRegisteredBuffers(Process, ViewStart, ViewEnd, &RegisteredBuffers);
+
         Status = MmUnmapViewOfSegment(AddressSpace, BaseAddress);
         if (!NT_SUCCESS(Status))
         {
@@ -4221,6 +4240,9 @@ MiRosUnmapViewOfSection(IN PEPROCESS Process,
 
     MmUnlockAddressSpace(AddressSpace);
 
+    /* Unlock the pages the dropped registrations had locked */
+    IopReleaseRegisteredBuffers(&RegisteredBuffers);
+
     /* Notify debugger */
     if (ImageBaseAddress && !SkipDebuggerNotify) DbgkUnMapViewOfSection(ImageBaseAddress);
 
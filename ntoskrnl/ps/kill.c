@@ -836,6 +836,9 @@ PspExitThread(IN NTSTATUS ExitStatus)
         /* Kill the process in the Object Manager */
         ObKillProcess(CurrentProcess);
 
+        /* Unlock the buffers it had registered for I/O */
+        IopRundownRegisteredBuffers(CurrentProcess);
+
         /* Check if we have a section object */
         if (CurrentProcess->SectionObject)
         {
@@ -439,6 +439,10 @@ PspCreateProcess(OUT PHANDLE ProcessHandle,
     /* Setup the Thread List Head */
     InitializeListHead(&Process->ThreadListHead);
 
+    /* Setup the list of buffers registered for I/O */
+    InitializeListHead(&Process->RegisteredIoBufferListHead);
+    KeInitializeSpinLock(&Process->RegisteredIoBufferLock);
+
     /* Set up the Quota Block from the Parent */
     PspInheritQuota(Process, Parent);
 
@@ -819,6 +819,30 @@ function(create_registry_hives)
         DESTINATION reactos/system32/config
         FOR livecd)
 
+    # LiveCD boot pack: the SYSTEM hive and the default NLS tables,
+    # which FreeLoader then reads from the CD in a single read
+    add_custom_command(
+        OUTPUT ${CMAKE_BINARY_DIR}/boot/bootdata/bootpack.bin
+        COMMAND native-mkbootpack ${CMAKE_BINARY_DIR}/boot/bootdata/bootpack.bin ${CMAKE_BINARY_DIR}/boot/bootdata
+            system32/config/SYSTEM=${CMAKE_BINARY_DIR}/boot/bootdata/system
+            system32/c_1252.nls=${CMAKE_SOURCE_DIR}/media/nls/c_1252.nls
+            system32/c_437.nls=${CMAKE_SOURCE_DIR}/media/nls/c_437.nls
+            system32/l_intl.nls=${CMAKE_SOURCE_DIR}/media/nls/l_intl.nls
+        DEPENDS native-mkbootpack
+                ${CMAKE_BINARY_DIR}/boot/bootdata/system
+                ${CMAKE_SOURCE_DIR}/media/nls/c_1252.nls
+                ${CMAKE_SOURCE_DIR}/media/nls/c_437.nls
+                ${CMAKE_SOURCE_DIR}/media/nls/l_intl.nls)
+
+    add_custom_target(livecd_bootpack
+        DEPENDS ${CMAKE_BINARY_DIR}/boot/bootdata/bootpack.bin)
+
+    add_cd_file(
+        FILE ${CMAKE_BINARY_DIR}/boot/bootdata/bootpack.bin
+        TARGET livecd_bootpack
+        DESTINATION reactos/system32
+        FOR livecd)
+
     # BCD Hive
     add_custom_command(
         OUTPUT ${CMAKE_BINARY_DIR}/boot/bootdata/BCD
@@ -313,6 +313,13 @@ typedef enum _SYSTEM_INFORMATION_CLASS
     SystemPrefetchPathInformation,
     SystemVerifierFaultsInformation,
     MaxSystemInfoClass,
+
+    //
+    // ReactOS-specific classes, numbered well past the Windows ones
+    //
+    SystemReactOSInformationBase = 0x1000,
+    SystemPoolTraceInformation = SystemReactOSInformationBase,
+    MaxSystemReactOSInfoClass,
 } SYSTEM_INFORMATION_CLASS;
 
 //
@@ -1528,6 +1535,42 @@ typedef struct _SYSTEM_MEMORY_LIST_INFORMATION
     SIZE_T ModifiedPageCountPageFile;
 } SYSTEM_MEMORY_LIST_INFORMATION, *PSYSTEM_MEMORY_LIST_INFORMATION;
 
+//
+// Class SystemPoolTraceInformation (ReactOS-specific)
+//
+#define SYSTEM_POOL_TRACE_FRAMES                6
+#define SYSTEM_POOL_TRACE_FREE                  0x01
+
+typedef struct _SYSTEM_POOL_TRACE_CONTROL
+{
+    ULONG SampleRate;
+    ULONG Tag;
+    ULONG FrameCount;
+} SYSTEM_POOL_TRACE_CONTROL, *PSYSTEM_POOL_TRACE_CONTROL;
+
+typedef struct _SYSTEM_POOL_TRACE_ENTRY
+{
+    ULONGLONG TimeStamp;
+    PVOID Va;
+    PVOID Caller;
+    SIZE_T NumberOfBytes;
+    ULONG Tag;
+    UCHAR PoolType;
+    UCHAR Flags;
+    UCHAR Processor;
+    UCHAR FrameCount;
+    PVOID Frames[SYSTEM_POOL_TRACE_FRAMES];
+} SYSTEM_POOL_TRACE_ENTRY, *PSYSTEM_POOL_TRACE_ENTRY;
+
+typedef struct _SYSTEM_POOL_TRACE_INFORMATION
+{
+    SYSTEM_POOL_TRACE_CONTROL Control;
+    ULONG EntriesPerProcessor;
+    ULONG Lost;
+    ULONG Count;
+    SYSTEM_POOL_TRACE_ENTRY Entries[1];
+} SYSTEM_POOL_TRACE_INFORMATION, *PSYSTEM_POOL_TRACE_INFORMATION;
+
 #ifdef __cplusplus
 }; // extern "C"
 #endif
@@ -177,6 +177,13 @@ NtDeleteFile(
     _In_ POBJECT_ATTRIBUTES ObjectAttributes
 );
 
+NTSYSCALLAPI
+NTSTATUS
+NTAPI
+NtDeregisterIoBuffer(
+    _In_ ULONG BufferId
+);
+
 __kernel_entry
 NTSYSCALLAPI
 NTSTATUS
@@ -468,6 +475,15 @@ NtReadFileScatter(
     _In_opt_ PULONG Key
 );
 
+NTSYSCALLAPI
+NTSTATUS
+NTAPI
+NtRegisterIoBuffer(
+    _In_ PVOID BaseAddress,
+    _In_ ULONG Length,
+    _Out_ PULONG BufferId
+);
+
 NTSYSCALLAPI
 NTSTATUS
 NTAPI
@@ -479,6 +495,18 @@ NtRemoveIoCompletion(
     _In_opt_ PLARGE_INTEGER Timeout
 );
 
+NTSYSCALLAPI
+NTSTATUS
+NTAPI
+NtRemoveIoCompletionEx(
+    _In_ HANDLE IoCompletionHandle,
+    _Out_writes_to_(Count, *NumEntriesRemoved) PFILE_IO_COMPLETION_INFORMATION IoCompletionInformation,
+    _In_ ULONG Count,
+    _Out_ PULONG NumEntriesRemoved,
+    _In_opt_ PLARGE_INTEGER Timeout,
+    _In_ BOOLEAN Alertable
+);
+
 NTSYSCALLAPI
 NTSTATUS
 NTAPI
@@ -710,6 +738,13 @@ ZwDeleteFile(
     _In_ POBJECT_ATTRIBUTES ObjectAttributes
 );
 
+NTSYSAPI
+NTSTATUS
+NTAPI
+ZwDeregisterIoBuffer(
+    _In_ ULONG BufferId
+);
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 NTSYSAPI
 NTSTATUS
@@ -951,6 +986,15 @@ ZwReadFileScatter(
     _In_opt_ PULONG Key
 );
 
+NTSYSAPI
+NTSTATUS
+NTAPI
+ZwRegisterIoBuffer(
+    _In_ PVOID BaseAddress,
+    _In_ ULONG Length,
+    _Out_ PULONG BufferId
+);
+
 NTSYSAPI
 NTSTATUS
 NTAPI
@@ -962,6 +1006,18 @@ ZwRemoveIoCompletion(
     _In_opt_ PLARGE_INTEGER Timeout
 );
 
+NTSYSAPI
+NTSTATUS
+NTAPI
+ZwRemoveIoCompletionEx(
+    _In_ HANDLE IoCompletionHandle,
+    _Out_writes_to_(Count, *NumEntriesRemoved) PFILE_IO_COMPLETION_INFORMATION IoCompletionInformation,
+    _In_ ULONG Count,
+    _Out_ PULONG NumEntriesRemoved,
+    _In_opt_ PLARGE_INTEGER Timeout,
+    _In_ BOOLEAN Alertable
+);
+
 #ifdef NTOS_MODE_USER
 NTSYSAPI
 NTSTATUS
@@ -1257,7 +1257,8 @@ typedef struct _EPROCESS
     PVOID EtwDataSource;
     PVOID FreeTebHint;
 #else
-    PVOID Spare0[3];
+    LIST_ENTRY RegisteredIoBufferListHead;
+    KSPIN_LOCK RegisteredIoBufferLock;
 #endif
     union
     {
@@ -2349,6 +2349,9 @@ GetProfileStringW(
   _In_ DWORD nSize);
 
 BOOL WINAPI GetQueuedCompletionStatus(HANDLE,PDWORD,PULONG_PTR,LPOVERLAPPED*,DWORD);
+#if (_WIN32_WINNT >= 0x0600)
+BOOL WINAPI GetQueuedCompletionStatusEx(_In_ HANDLE, _Out_writes_to_(ulCount, *ulNumEntriesRemoved) LPOVERLAPPED_ENTRY, _In_ ULONG ulCount, _Out_ PULONG ulNumEntriesRemoved, _In_ DWORD, _In_ BOOL);
+#endif
 BOOL WINAPI GetSecurityDescriptorControl(PSECURITY_DESCRIPTOR,PSECURITY_DESCRIPTOR_CONTROL,PDWORD);
 BOOL WINAPI GetSecurityDescriptorDacl(PSECURITY_DESCRIPTOR,LPBOOL,PACL*,LPBOOL);
 BOOL WINAPI GetSecurityDescriptorGroup(PSECURITY_DESCRIPTOR,PSID*,LPBOOL);
@@ -0,0 +1,59 @@
+/*
+ * PROJECT:     ReactOS Boot Loader
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Boot pack file format, shared by FreeLoader and mkbootpack
+ */
+
+#ifndef REACTOS_BOOTPACK_H_INCLUDED
+#define REACTOS_BOOTPACK_H_INCLUDED
+
+/*
+ * A boot pack is a single file holding the boot drivers, the SYSTEM hive and
+ * the NLS tables, so that the loader can read all of them in one sequential
+ * read instead of walking the file system for every single file.
+ *
+ * Layout:
+ *   BOOTPACK_HEADER
+ *   BOOTPACK_ENTRY[EntryCount], sorted by name (see below)
+ *   Names, NUL-terminated
+ *   File data, each file aligned on BOOTPACK_DATA_ALIGNMENT
+ *
+ * Names are relative to the system root (e.g. "SYSTEM32\DRIVERS\DISK.SYS"),
+ * upper-cased, use '\' as separator, and are sorted by strcmp() order.
+ * Checksum is the CRC32 (RtlComputeCrc32) of everything after the header.
+ *
+ * Each entry records the size and last write time of the file it was made
+ * from. FreeLoader only serves an entry whose size matches the file on the
+ * boot volume, and reads the file itself otherwise. ARC file information
+ * has no time stamps, so FreeLoader cannot compare SourceTime; it tells
+ * whoever inspects a pack which build of each file it holds.
+ */
+
+#define BOOTPACK_SIGNATURE      0x4B505442  /* "BTPK" */
+#define BOOTPACK_VERSION        2
+#define BOOTPACK_DATA_ALIGNMENT 16
+#define BOOTPACK_FILE_NAME      "bootpack.bin"
+
+#include <pshpack4.h>
+
+typedef struct _BOOTPACK_HEADER
+{
+    ULONG Signature;
+    USHORT Version;
+    USHORT Flags;       /* Must be zero */
+    ULONG EntryCount;
+    ULONG TotalSize;    /* Including this header */
+    ULONG Checksum;
+} BOOTPACK_HEADER, *PBOOTPACK_HEADER;
+
+typedef struct _BOOTPACK_ENTRY
+{
+    ULONG NameOffset;   /* From the start of the pack */
+    ULONG DataOffset;   /* From the start of the pack */
+    ULONG DataSize;     /* Size of the source file */
+    ULONG SourceTime;   /* Last write time of the source file, in seconds since 1970 */
+} BOOTPACK_ENTRY, *PBOOTPACK_ENTRY;
+
+#include <poppack.h>
+
+#endif /* REACTOS_BOOTPACK_H_INCLUDED */
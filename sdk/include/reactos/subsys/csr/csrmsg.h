@@ -27,6 +27,7 @@ typedef enum _CSRSRV_API_NUMBER
     CsrpProfileControl,
     CsrpIdentifyAlertable,
     CsrpSetPriorityClass,
+    CsrpQueryApiStatistics, // ReactOS-specific
 
     CsrpMaxApiNumber
 } CSRSRV_API_NUMBER, *PCSRSRV_API_NUMBER;
@@ -82,6 +83,22 @@ typedef struct
     CLIENT_ID Cid;
 } CSRSS_IDENTIFY_ALERTABLE_THREAD, *PCSRSS_IDENTIFY_ALERTABLE_THREAD;
 
+typedef struct _CSR_API_STATISTICS
+{
+    ULONG CallCount;        // Calls made to the API
+    ULONG QueuedCount;      // Of those, calls that waited for a busy server
+    ULONGLONG TotalTime;    // Time spent in the API, in performance counter ticks
+    ULONGLONG MaxTime;      // Longest single call
+} CSR_API_STATISTICS, *PCSR_API_STATISTICS;
+
+typedef struct _CSR_QUERY_API_STATISTICS
+{
+    ULONG ServerId;
+    ULONG ApiCount;                 // In: entries in Statistics. Out: APIs of the server.
+    LARGE_INTEGER Frequency;        // Performance counter frequency, for the times
+    PCSR_API_STATISTICS Statistics; // Captured buffer, one entry per API
+} CSR_QUERY_API_STATISTICS, *PCSR_QUERY_API_STATISTICS;
+
 typedef struct _CSR_CLIENT_CONNECT
 {
     ULONG ServerId;
@@ -116,6 +133,7 @@ typedef struct _CSR_API_MESSAGE
                 CSR_CLIENT_CONNECT CsrClientConnect;
                 CSR_SET_PRIORITY_CLASS SetPriorityClass;
                 CSR_IDENTIFY_ALTERTABLE_THREAD IdentifyAlertableThread;
+                CSR_QUERY_API_STATISTICS QueryApiStatistics;
 
                 //
                 // This padding is used to make the CSR_API_MESSAGE structure
@@ -111,6 +111,8 @@ typedef enum _CONSRV_API_NUMBER
     // ConsolepSetScreenBufferInfo,            // Added in Vista+
     // ConsolepClientConnect,                  // Added in Win7
 
+    ConsolepMapOutputRing,                  // ReactOS-specific
+
     ConsolepMaxApiNumber
 } CONSRV_API_NUMBER, *PCONSRV_API_NUMBER;
 
@@ -250,6 +252,54 @@ typedef struct _CONSOLE_WRITECONSOLE
     CHAR Reserved2[6];
 } CONSOLE_WRITECONSOLE, *PCONSOLE_WRITECONSOLE;
 
+/*
+ * Shared-memory output ring. The client appends WriteConsole entries
+ * and advances WriteOffset, the server consumes them in order and
+ * advances ReadOffset. Both offsets are free-running byte counts.
+ * An entry never wraps around the end of the ring: when it does not
+ * fit, the client first appends a padding entry (NumBytes == 0) that
+ * fills up the rest of the ring.
+ *
+ * Each process has its own ring. Entries are stamped from a sequence
+ * counter shared by all the processes of the console, and the server
+ * writes them out across rings in that order.
+ */
+#define CONSOLE_OUTPUT_RING_SIZE        0x10000
+#define CONSOLE_OUTPUT_RING_ALIGNMENT   8
+#define CONSOLE_OUTPUT_RING_MAX_WRITE   0x1000
+
+typedef struct _CONSOLE_OUTPUT_RING_ENTRY
+{
+    ULONG   Size;       // Size of the whole entry, aligned
+    ULONG   NumBytes;   // Size of the data that follows
+    ULONG   Sequence;   // Console-wide order of the entry
+    HANDLE  OutputHandle;
+    BOOLEAN Unicode;
+} CONSOLE_OUTPUT_RING_ENTRY, *PCONSOLE_OUTPUT_RING_ENTRY;
+
+typedef struct _CONSOLE_OUTPUT_RING_CONTROL
+{
+    volatile LONG Sequence; // Incremented by the clients for each entry
+    volatile LONG Paused;   // Only written by the server
+} CONSOLE_OUTPUT_RING_CONTROL, *PCONSOLE_OUTPUT_RING_CONTROL;
+
+typedef struct _CONSOLE_OUTPUT_RING
+{
+    volatile ULONG WriteOffset; // Only written by the client
+    volatile ULONG ReadOffset;  // Only written by the server
+    volatile LONG ErrorStatus;  // First failed entry, cleared by the client
+    ULONG Reserved;
+    UCHAR Data[CONSOLE_OUTPUT_RING_SIZE];
+} CONSOLE_OUTPUT_RING, *PCONSOLE_OUTPUT_RING;
+
+typedef struct _CONSOLE_MAPOUTPUTRING
+{
+    HANDLE ConsoleHandle;
+    PCONSOLE_OUTPUT_RING OutputRing;
+    PCONSOLE_OUTPUT_RING_CONTROL Control;
+    HANDLE DoorbellEvent;
+} CONSOLE_MAPOUTPUTRING, *PCONSOLE_MAPOUTPUTRING;
+
 typedef struct _CONSOLE_READCONSOLE
 {
     HANDLE ConsoleHandle;
@@ -966,6 +1016,7 @@ typedef struct _CONSOLE_API_MESSAGE
 
         /* Write */
         CONSOLE_WRITECONSOLE WriteConsoleRequest;       // SrvWriteConsole / WriteConsole
+        CONSOLE_MAPOUTPUTRING MapOutputRingRequest;
         CONSOLE_WRITEINPUT WriteInputRequest;
         CONSOLE_WRITEOUTPUT WriteOutputRequest;
         CONSOLE_WRITEOUTPUTCODE WriteOutputCodeRequest;
@@ -132,6 +132,7 @@ InfpFreeSection (PINFCACHESECTION Section)
       Section->FirstLine = InfpFreeLine (Section->FirstLine);
     }
   Section->LastLine = NULL;
+  Section->LastFoundLine = NULL;
 
   FREE (Section);
 
@@ -293,12 +294,17 @@ InfpFindLineById(PINFCACHESECTION Section, UINT Id)
 {
     PINFCACHELINE Line;
 
-    for (Line = Section->FirstLine;
-         Line != NULL;
-         Line = Line->Next)
+    /* Line ids grow along the list and contexts mostly move forward,
+       so resume the search from the line found last time */
+    Line = Section->LastFoundLine;
+    if (Line == NULL || Line->Id > Id)
+        Line = Section->FirstLine;
+
+    for (; Line != NULL; Line = Line->Next)
     {
         if (Line->Id == Id)
         {
+            Section->LastFoundLine = Line;
             return Line;
         }
     }
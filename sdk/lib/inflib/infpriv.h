@@ -48,6 +48,7 @@ typedef struct _INFCACHESECTION
 
   PINFCACHELINE FirstLine;
   PINFCACHELINE LastLine;
+  PINFCACHELINE LastFoundLine;
   UINT Id;
 
   LONG LineCount;
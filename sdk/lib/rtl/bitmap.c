@@ -65,34 +65,47 @@ typedef ULONG BITMAP_INDEX, *PBITMAP_INDEX;
 typedef ULONG BITMAP_BUFFER, *PBITMAP_BUFFER;
 #endif
 
-/* DATA *********************************************************************/
+/* Number of buffer elements that run searches try to skip at once */
+#define _BLOCKCOUNT 8
 
-/* Number of set bits per byte value */
-static const
-UCHAR
-BitCountTable[256] =
+/* PRIVATE FUNCTIONS ********************************************************/
+
+static __inline
+BITMAP_INDEX
+RtlpCountSetBits(
+    _In_ BITMAP_BUFFER Value)
 {
-    /* x0 x1 x2 x3 x4 x5 x6 x7 x8 x9 xA xB xC xD xE xF */
-       0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, /* 0x */
-       1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, /* 1x */
-       1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, /* 2x */
-       2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, /* 3x */
-       1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, /* 4x */
-       2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, /* 5x */
-       2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, /* 6c */
-       3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7, /* 7x */
-       1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, /* 8x */
-       2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, /* 9x */
-       2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, /* Ax */
-       3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7, /* Bx */
-       2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, /* Cx */
-       3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7, /* Dx */
-       3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7, /* Ex */
-       4, 5, 5, 6, 5, 6, 6, 7, 5, 6, 6, 7, 6, 7, 7, 8  /* Fx */
-};
+    /* Count the bits of all bytes in parallel, then sum the bytes up */
+#ifdef USE_RTL_BITMAP64
+    Value = Value - ((Value >> 1) & 0x5555555555555555ULL);
+    Value = (Value & 0x3333333333333333ULL) + ((Value >> 2) & 0x3333333333333333ULL);
+    Value = (Value + (Value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (BITMAP_INDEX)((Value * 0x0101010101010101ULL) >> 56);
+#else
+    Value = Value - ((Value >> 1) & 0x55555555);
+    Value = (Value & 0x33333333) + ((Value >> 2) & 0x33333333);
+    Value = (Value + (Value >> 4)) & 0x0F0F0F0F;
+    return (Value * 0x01010101) >> 24;
+#endif
+}
 
+static __inline
+BOOLEAN
+RtlpIsBlockClear(
+    _In_ PBITMAP_BUFFER Buffer)
+{
+    return (Buffer[0] | Buffer[1] | Buffer[2] | Buffer[3] |
+            Buffer[4] | Buffer[5] | Buffer[6] | Buffer[7]) == 0;
+}
 
-/* PRIVATE FUNCTIONS ********************************************************/
+static __inline
+BOOLEAN
+RtlpIsBlockSet(
+    _In_ PBITMAP_BUFFER Buffer)
+{
+    return (Buffer[0] & Buffer[1] & Buffer[2] & Buffer[3] &
+            Buffer[4] & Buffer[5] & Buffer[6] & Buffer[7]) == MAXINDEX;
+}
 
 static __inline
 BITMAP_INDEX
@@ -123,6 +136,14 @@ RtlpGetLengthOfRunClear(
     /* Skip all clear ULONGs */
     while (Value == 0 && Buffer < MaxBuffer)
     {
+        /* Skip whole blocks first, large free areas are common */
+        while ((MaxBuffer - Buffer >= _BLOCKCOUNT) && RtlpIsBlockClear(Buffer))
+        {
+            Buffer += _BLOCKCOUNT;
+        }
+
+        if (Buffer == MaxBuffer) break;
+
         Value = *Buffer++;
     }
 
@@ -177,6 +198,14 @@ RtlpGetLengthOfRunSet(
     /* Skip all set ULONGs */
     while (InvValue == 0 && Buffer < MaxBuffer)
     {
+        /* Skip whole blocks first, large used areas are common */
+        while ((MaxBuffer - Buffer >= _BLOCKCOUNT) && RtlpIsBlockSet(Buffer))
+        {
+            Buffer += _BLOCKCOUNT;
+        }
+
+        if (Buffer == MaxBuffer) break;
+
         InvValue = ~(*Buffer++);
     }
 
@@ -474,22 +503,24 @@ NTAPI
 RtlNumberOfSetBits(
     _In_ PRTL_BITMAP BitMapHeader)
 {
-    PUCHAR Byte, MaxByte;
+    PBITMAP_BUFFER Buffer, MaxBuffer;
     BITMAP_INDEX BitCount = 0;
     ULONG Shift;
 
-    Byte = (PUCHAR)BitMapHeader->Buffer;
-    MaxByte = Byte + BitMapHeader->SizeOfBitMap / 8;
+    Buffer = BitMapHeader->Buffer;
+    MaxBuffer = Buffer + BitMapHeader->SizeOfBitMap / _BITCOUNT;
 
-    while (Byte < MaxByte)
+    /* Count a whole ULONG at a time */
+    while (Buffer < MaxBuffer)
     {
-        BitCount += BitCountTable[*Byte++];
+        BitCount += RtlpCountSetBits(*Buffer++);
     }
 
-    if (BitMapHeader->SizeOfBitMap & 7)
+    /* Shift out the bits past the end of the bitmap */
+    if (BitMapHeader->SizeOfBitMap & (_BITCOUNT - 1))
     {
-        Shift = 8 - (BitMapHeader->SizeOfBitMap & 7);
-        BitCount += BitCountTable[((*Byte) << Shift) & 0xFF];
+        Shift = _BITCOUNT - (BitMapHeader->SizeOfBitMap & (_BITCOUNT - 1));
+        BitCount += RtlpCountSetBits(*Buffer << Shift);
     }
 
     return BitCount;
@@ -873,7 +904,7 @@ RtlFindClearRuns(
             for (Run = 0; Run < SizeOfRunArray; Run++)
             {
                 /*Is this the new smallest run? */
-                if (NumberOfBits < RunArray[SmallestRun].NumberOfBits)
+                if (RunArray[Run].NumberOfBits < RunArray[SmallestRun].NumberOfBits)
                 {
                     /* Set it as new smallest run */
                     SmallestRun = Run;
@@ -881,8 +912,8 @@ RtlFindClearRuns(
             }
         }
 
-        /* Advance bits */
-        FromIndex += NumberOfBits;
+        /* Continue after this run */
+        FromIndex = StartingIndex + NumberOfBits;
     }
 
     return Run;
@@ -914,8 +945,8 @@ RtlFindLongestRunClear(
             *StartingIndex = Index;
         }
 
-        /* Advance bits */
-        FromIndex += NumberOfBits;
+        /* Continue after this run */
+        FromIndex = Index + NumberOfBits;
     }
 
     return MaxNumberOfBits;
@@ -947,8 +978,8 @@ RtlFindLongestRunSet(
             *StartingIndex = Index;
         }
 
-        /* Advance bits */
-        FromIndex += NumberOfBits;
+        /* Continue after this run */
+        FromIndex = Index + NumberOfBits;
     }
 
     return MaxNumberOfBits;
@@ -0,0 +1,267 @@
+/*
+ * PROJECT:     ReactOS cabinet manager
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     CCFDATACompressor class implementation
+ */
+
+#include "CCFDATACompressor.h"
+#include "raw.h"
+#include "mszip.h"
+
+#if !defined(CAB_READ_ONLY)
+
+/**
+* @name CCFDATACompressor class
+* @implemented
+*
+* Default constructor
+*/
+CCFDATACompressor::CCFDATACompressor()
+{
+    MaxQueued = 0;
+    Stopping = false;
+}
+
+/**
+* @name CCFDATACompressor class
+* @implemented
+*
+* Default destructor
+*/
+CCFDATACompressor::~CCFDATACompressor()
+{
+    Stop();
+}
+
+/**
+* @name CCFDATACompressor class
+* @implemented
+*
+* Starts the worker threads. Each worker owns a codec instance, so its
+* compression state is reused for all blocks it compresses
+*
+* @param CodecId
+* Codec to compress the blocks with
+*
+* @param ThreadCount
+* Number of worker threads
+*
+* @return
+* Status of operation
+*/
+ULONG CCFDATACompressor::Start(LONG CodecId, ULONG ThreadCount)
+{
+    ULONG i;
+
+    ASSERT(Workers.empty());
+
+    for (i = 0; i < ThreadCount; i++)
+    {
+        CCABCodec* Codec;
+
+        switch (CodecId)
+        {
+            case CAB_CODEC_RAW:
+                Codec = new CRawCodec();
+                break;
+
+            case CAB_CODEC_MSZIP:
+                Codec = new CMSZipCodec();
+                break;
+
+            default:
+                Stop();
+                return CAB_STATUS_UNSUPPCOMP;
+        }
+        Codecs.push_back(Codec);
+    }
+
+    /* Enough blocks to keep every worker busy while the oldest one is written */
+    MaxQueued = ThreadCount * 4;
+    Stopping = false;
+
+    for (i = 0; i < ThreadCount; i++)
+        Workers.push_back(std::thread(&CCFDATACompressor::WorkerThread, this, Codecs[i]));
+
+    return CAB_STATUS_SUCCESS;
+}
+
+/**
+* @name CCFDATACompressor class
+* @implemented
+*
+* Stops the worker threads and frees all blocks
+*/
+void CCFDATACompressor::Stop()
+{
+    {
+        std::lock_guard<std::mutex> Guard(Lock);
+        Stopping = true;
+    }
+    WorkAvailable.notify_all();
+
+    for (std::thread& Worker : Workers)
+        Worker.join();
+    Workers.clear();
+
+    for (CCABCodec* Codec : Codecs)
+        delete Codec;
+    Codecs.clear();
+
+    for (PCFDATA_JOB Job : Queued)
+        delete Job;
+    Queued.clear();
+    Work.clear();
+
+    for (PCFDATA_JOB Job : FreeJobs)
+        delete Job;
+    FreeJobs.clear();
+}
+
+/**
+* @name CCFDATACompressor class
+* @implemented
+*
+* Returns whether the maximum number of blocks is queued
+*/
+bool CCFDATACompressor::IsFull()
+{
+    std::lock_guard<std::mutex> Guard(Lock);
+    return Queued.size() >= MaxQueued;
+}
+
+/**
+* @name CCFDATACompressor class
+* @implemented
+*
+* Returns whether no blocks are queued
+*/
+bool CCFDATACompressor::IsEmpty()
+{
+    std::lock_guard<std::mutex> Guard(Lock);
+    return Queued.empty();
+}
+
+/**
+* @name CCFDATACompressor class
+* @implemented
+*
+* Queues a block for compression. The data is copied, so the caller
+* may reuse its buffer right away
+*
+* @param FolderNode
+* Folder the block belongs to
+*
+* @param Buffer
+* Uncompressed data
+*
+* @param Size
+* Size of the uncompressed data
+*
+* @return
+* Status of operation
+*/
+ULONG CCFDATACompressor::Submit(PCFFOLDER_NODE FolderNode, void* Buffer, ULONG Size)
+{
+    PCFDATA_JOB Job = NULL;
+
+    ASSERT(Size <= CAB_BLOCKSIZE);
+
+    {
+        std::lock_guard<std::mutex> Guard(Lock);
+        if (!FreeJobs.empty())
+        {
+            Job = FreeJobs.back();
+            FreeJobs.pop_back();
+        }
+    }
+
+    if (!Job)
+    {
+        Job = new CFDATA_JOB;
+        if (!Job)
+            return CAB_STATUS_NOMEMORY;
+    }
+
+    Job->FolderNode = FolderNode;
+    Job->UncompSize = Size;
+    Job->CompSize = 0;
+    Job->Status = CS_SUCCESS;
+    Job->Done = false;
+    memcpy(Job->InputBuffer, Buffer, Size);
+
+    {
+        std::lock_guard<std::mutex> Guard(Lock);
+        Queued.push_back(Job);
+        Work.push_back(Job);
+    }
+    WorkAvailable.notify_one();
+
+    return CAB_STATUS_SUCCESS;
+}
+
+/**
+* @name CCFDATACompressor class
+* @implemented
+*
+* Removes the oldest block from the queue, waiting until it is compressed.
+* Blocks are returned in the order they were submitted
+*
+* @return
+* The block, or NULL if no blocks are queued. The block must be given
+* back with Release
+*/
+PCFDATA_JOB CCFDATACompressor::WaitOldest()
+{
+    std::unique_lock<std::mutex> Guard(Lock);
+    PCFDATA_JOB Job;
+
+    if (Queued.empty())
+        return NULL;
+
+    Job = Queued.front();
+    WorkDone.wait(Guard, [Job] { return Job->Done; });
+    Queued.pop_front();
+
+    return Job;
+}
+
+/**
+* @name CCFDATACompressor class
+* @implemented
+*
+* Gives back a block returned by WaitOldest
+*/
+void CCFDATACompressor::Release(PCFDATA_JOB Job)
+{
+    std::lock_guard<std::mutex> Guard(Lock);
+    FreeJobs.push_back(Job);
+}
+
+void CCFDATACompressor::WorkerThread(CCABCodec* Codec)
+{
+    std::unique_lock<std::mutex> Guard(Lock);
+    PCFDATA_JOB Job;
+
+    for (;;)
+    {
+        WorkAvailable.wait(Guard, [this] { return Stopping || !Work.empty(); });
+        if (Work.empty())
+            break;
+
+        Job = Work.front();
+        Work.pop_front();
+
+        Guard.unlock();
+        Job->Status = Codec->Compress(Job->OutputBuffer,
+                                      Job->InputBuffer,
+                                      Job->UncompSize,
+                                      &Job->CompSize);
+        Guard.lock();
+
+        Job->Done = true;
+        WorkDone.notify_all();
+    }
+}
+
+#endif /* CAB_READ_ONLY */
@@ -0,0 +1,59 @@
+/*
+ * PROJECT:     ReactOS cabinet manager
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     CCFDATACompressor class declaration
+ */
+
+#pragma once
+
+#include "cabinet.h"
+
+#ifndef CAB_READ_ONLY
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef struct _CFDATA_JOB
+{
+    PCFFOLDER_NODE FolderNode;  // Folder the block belongs to
+    ULONG UncompSize;
+    ULONG CompSize;
+    ULONG Status;               // Codec status (CS_xxx)
+    bool Done;
+    unsigned char InputBuffer[CAB_BLOCKSIZE + 12];
+    unsigned char OutputBuffer[CAB_BLOCKSIZE + 12];
+} CFDATA_JOB, *PCFDATA_JOB;
+
+class CCFDATACompressor
+{
+public:
+    /* Default constructor */
+    CCFDATACompressor();
+    /* Default destructor */
+    virtual ~CCFDATACompressor();
+    ULONG Start(LONG CodecId, ULONG ThreadCount);
+    void Stop();
+    bool IsFull();
+    bool IsEmpty();
+    ULONG Submit(PCFFOLDER_NODE FolderNode, void* Buffer, ULONG Size);
+    PCFDATA_JOB WaitOldest();
+    void Release(PCFDATA_JOB Job);
+private:
+    void WorkerThread(CCABCodec* Codec);
+
+    std::mutex Lock;
+    std::condition_variable WorkAvailable;
+    std::condition_variable WorkDone;
+    std::deque<PCFDATA_JOB> Queued;     // All blocks in submission order
+    std::deque<PCFDATA_JOB> Work;       // Blocks no worker has picked yet
+    std::vector<PCFDATA_JOB> FreeJobs;
+    std::vector<std::thread> Workers;
+    std::vector<CCABCodec*> Codecs;
+    ULONG MaxQueued;
+    bool Stopping;
+};
+
+#endif /* CAB_READ_ONLY */
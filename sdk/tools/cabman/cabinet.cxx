@@ -23,8 +23,10 @@
 # include <sys/stat.h>
 # include <sys/types.h>
 #endif
+#include <thread>
 #include "cabinet.h"
 #include "CCFDATAStorage.h"
+#include "CCFDATACompressor.h"
 #include "raw.h"
 #include "mszip.h"
 
@@ -92,6 +94,11 @@ CCabinet::CCabinet()
     MaxDiskSize  = 0;
     BlockIsSplit = false;
     ScratchFile  = NULL;
+    Compressor   = NULL;
+
+    CompressionThreads = std::thread::hardware_concurrency();
+    if (CompressionThreads == 0)
+        CompressionThreads = 1;
 
     FolderUncompSize = 0;
     BytesLeftInBlock = 0;
@@ -114,6 +121,9 @@ CCabinet::~CCabinet()
 
     if (CodecSelected)
         delete Codec;
+
+    if (Compressor)
+        delete Compressor;
 }
 
 bool CCabinet::IsSeparator(char Char)
@@ -1132,6 +1142,12 @@ ULONG CCabinet::NewDisk()
  *     Status of operation
  */
 {
+    ULONG Status;
+
+    Status = FlushDataBlocks();
+    if (Status != CAB_STATUS_SUCCESS)
+        return Status;
+
     // NextFolderNumber is 0-based
     NextFolderNumber = 1;
 
@@ -1156,8 +1172,15 @@ ULONG CCabinet::NewFolder()
  *     Status of operation
  */
 {
+    ULONG Status;
+
     DPRINT(MAX_TRACE, ("Creating new folder.\n"));
 
+    /* Queued blocks belong to the previous folder */
+    Status = FlushDataBlocks();
+    if (Status != CAB_STATUS_SUCCESS)
+        return Status;
+
     CurrentFolderNode = NewFolderNode();
     if (!CurrentFolderNode)
     {
@@ -1401,6 +1424,10 @@ ULONG CCabinet::CommitDisk(ULONG MoreDisks)
 {
     ULONG Status;
 
+    Status = FlushDataBlocks();
+    if (Status != CAB_STATUS_SUCCESS)
+        return Status;
+
     OnCabinetName(CurrentDiskNumber, CabinetName);
 
     /* Create file, fail if it already exists */
@@ -1483,6 +1510,12 @@ ULONG CCabinet::CloseCabinet()
 {
     ULONG Status;
 
+    if (Compressor)
+    {
+        delete Compressor;
+        Compressor = NULL;
+    }
+
     DestroyFileNodes();
 
     DestroyFolderNodes();
@@ -1727,6 +1760,16 @@ void CCabinet::SetMaxDiskSize(ULONG Size)
     MaxDiskSize = Size;
 }
 
+void CCabinet::SetCompressionThreads(ULONG Count)
+/*
+ * FUNCTION: Sets the number of threads used to compress data blocks
+ * ARGUMENTS:
+ *     Count = Number of threads (1 compresses on the calling thread)
+ */
+{
+    CompressionThreads = (Count > 0) ? Count : 1;
+}
+
 #endif /* CAB_READ_ONLY */
 
 
@@ -2756,8 +2799,19 @@ ULONG CCabinet::WriteDataBlock()
  */
 {
     ULONG Status;
-    ULONG BytesWritten;
-    PCFDATA_NODE DataNode;
+
+    /* Blocks are compressed independently of each other, so they can be
+       compressed in parallel as long as they are stored in order. Blocks
+       that may be split across disks need the serial path */
+    if ((CompressionThreads > 1) && (CodecId == CAB_CODEC_MSZIP) &&
+        (MaxDiskSize == 0) && (!BlockIsSplit))
+    {
+        return QueueDataBlock();
+    }
+
+    Status = FlushDataBlocks();
+    if (Status != CAB_STATUS_SUCCESS)
+        return Status;
 
     if (!BlockIsSplit)
     {
@@ -2773,7 +2827,35 @@ ULONG CCabinet::WriteDataBlock()
         CurrentOBufferSize = TotalCompSize;
     }
 
-    DataNode = NewDataNode(CurrentFolderNode);
+    Status = StoreDataBlock(CurrentFolderNode, CurrentIBufferSize);
+    if (Status != CAB_STATUS_SUCCESS)
+        return Status;
+
+    if (!BlockIsSplit)
+    {
+        CurrentIBufferSize = 0;
+        CurrentIBuffer     = InputBuffer;
+    }
+
+    return CAB_STATUS_SUCCESS;
+}
+
+
+ULONG CCabinet::StoreDataBlock(PCFFOLDER_NODE FolderNode, ULONG UncompSize)
+/*
+ * FUNCTION: Writes the compressed data in the output buffer to the scratch file
+ * ARGUMENTS:
+ *     FolderNode = Pointer to folder node the block belongs to
+ *     UncompSize = Uncompressed size of the block
+ * RETURNS:
+ *     Status of operation
+ */
+{
+    ULONG Status;
+    ULONG BytesWritten;
+    PCFDATA_NODE DataNode;
+
+    DataNode = NewDataNode(FolderNode);
     if (!DataNode)
     {
         DPRINT(MIN_TRACE, ("Insufficient memory.\n"));
@@ -2797,7 +2879,7 @@ ULONG CCabinet::WriteDataBlock()
     else
     {
         DataNode->Data.CompSize   = (USHORT)CurrentOBufferSize;
-        DataNode->Data.UncompSize = (USHORT)CurrentIBufferSize;
+        DataNode->Data.UncompSize = (USHORT)UncompSize;
     }
 
     DataNode->Data.Checksum = 0;
@@ -2818,18 +2900,118 @@ ULONG CCabinet::WriteDataBlock()
 
     DiskSize += BytesWritten;
 
-    CurrentFolderNode->TotalFolderSize += (BytesWritten + sizeof(CFDATA));
-    CurrentFolderNode->Folder.DataBlockCount++;
+    FolderNode->TotalFolderSize += (BytesWritten + sizeof(CFDATA));
+    FolderNode->Folder.DataBlockCount++;
 
     CurrentOBuffer = (unsigned char*)CurrentOBuffer + DataNode->Data.CompSize;
     CurrentOBufferSize -= DataNode->Data.CompSize;
 
     LastBlockStart += DataNode->Data.UncompSize;
 
-    if (!BlockIsSplit)
+    return CAB_STATUS_SUCCESS;
+}
+
+
+ULONG CCabinet::QueueDataBlock()
+/*
+ * FUNCTION: Hands the current data block to the compression threads
+ * RETURNS:
+ *     Status of operation
+ */
+{
+    ULONG Status;
+
+    if (!Compressor)
     {
-        CurrentIBufferSize = 0;
-        CurrentIBuffer     = InputBuffer;
+        Compressor = new CCFDATACompressor;
+        if (!Compressor)
+        {
+            DPRINT(MIN_TRACE, ("Insufficient memory.\n"));
+            return CAB_STATUS_NOMEMORY;
+        }
+
+        Status = Compressor->Start(CodecId, CompressionThreads);
+        if (Status != CAB_STATUS_SUCCESS)
+        {
+            delete Compressor;
+            Compressor = NULL;
+            return Status;
+        }
+    }
+
+    /* Store the oldest blocks to bound the memory in use */
+    while (Compressor->IsFull())
+    {
+        Status = RetireDataBlock();
+        if (Status != CAB_STATUS_SUCCESS)
+            return Status;
+    }
+
+    Status = Compressor->Submit(CurrentFolderNode, InputBuffer, CurrentIBufferSize);
+    if (Status != CAB_STATUS_SUCCESS)
+        return Status;
+
+    CurrentIBufferSize = 0;
+    CurrentIBuffer     = InputBuffer;
+
+    return CAB_STATUS_SUCCESS;
+}
+
+
+ULONG CCabinet::RetireDataBlock()
+/*
+ * FUNCTION: Writes the oldest queued data block to the scratch file
+ * RETURNS:
+ *     Status of operation
+ */
+{
+    PCFDATA_JOB Job;
+    ULONG Status;
+
+    Job = Compressor->WaitOldest();
+    if (!Job)
+        return CAB_STATUS_SUCCESS;
+
+    DPRINT(MAX_TRACE, ("Block compressed. UncompSize (%u)  CompSize(%u).\n",
+        (UINT)Job->UncompSize, (UINT)Job->CompSize));
+
+    if (Job->Status != CS_SUCCESS)
+    {
+        DPRINT(MIN_TRACE, ("Cannot compress block (%u).\n", (UINT)Job->Status));
+        Status = (Job->Status == CS_NOMEMORY) ? CAB_STATUS_NOMEMORY : CAB_STATUS_FAILURE;
+        Compressor->Release(Job);
+        return Status;
+    }
+
+    CurrentOBuffer     = Job->OutputBuffer;
+    CurrentOBufferSize = Job->CompSize;
+
+    Status = StoreDataBlock(Job->FolderNode, Job->UncompSize);
+
+    CurrentOBuffer = OutputBuffer;
+    Compressor->Release(Job);
+
+    return Status;
+}
+
+
+ULONG CCabinet::FlushDataBlocks()
+/*
+ * FUNCTION: Writes all queued data blocks to the scratch file
+ * RETURNS:
+ *     Status of operation
+ */
+{
+    ULONG Status;
+
+    if (!Compressor)
+        return CAB_STATUS_SUCCESS;
+
+    while (!Compressor->IsEmpty())
+    {
+        Status = RetireDataBlock();
+        if (Status != CAB_STATUS_SUCCESS)
+            return Status;
     }
 
     return CAB_STATUS_SUCCESS;
@@ -56,7 +56,7 @@ inline LONG GetSizeOfFile(FILE* handle)
         return (LONG)-1;
 
     size = ftell(handle);
-    fseek(handle, 0, SEEK_SET);
+    fseek(handle, currentPos, SEEK_SET);
     return size;
 }
 
@@ -377,6 +377,8 @@ public:
     ULONG AddFile(const std::string& FileName, const std::string& TargetFolder);
     /* Sets the maximum size of the current disk */
     void SetMaxDiskSize(ULONG Size);
+    /* Sets the number of threads used to compress data blocks */
+    void SetCompressionThreads(ULONG Count);
 #endif /* CAB_READ_ONLY */
 
     /* Default event handlers */
@@ -422,6 +424,10 @@ private:
     ULONG WriteFileEntries();
     ULONG CommitDataBlocks(PCFFOLDER_NODE FolderNode);
     ULONG WriteDataBlock();
+    ULONG StoreDataBlock(PCFFOLDER_NODE FolderNode, ULONG UncompSize);
+    ULONG QueueDataBlock();
+    ULONG RetireDataBlock();
+    ULONG FlushDataBlocks();
     ULONG GetAttributesOnFile(PCFFILE_NODE File);
     ULONG SetAttributesOnFile(char* FileName, USHORT FileAttributes);
     ULONG GetFileTimes(FILE* FileHandle, PCFFILE_NODE File);
@@ -484,6 +490,8 @@ private:
     ULONG TotalBytesLeft;
     bool BlockIsSplit;                  // true if current data block is split
     ULONG NextFolderNumber;     // Zero based folder number
+    ULONG CompressionThreads;   // 1 to compress blocks on the calling thread
+    class CCFDATACompressor *Compressor;
 #endif /* CAB_READ_ONLY */
 };
 
@@ -192,8 +192,8 @@ void CCABManager::Usage()
 {
     printf("ReactOS Cabinet Manager\n\n");
     printf("CABMAN [-D | -E] [-A] [-L dir] cabinet [filename ...]\n");
-    printf("CABMAN [-M mode] -C dirfile [-I] [-RC file] [-P dir]\n");
-    printf("CABMAN [-M mode] -S cabinet filename [-F folder] [filename] [...]\n");
+    printf("CABMAN [-M mode] [-J n] -C dirfile [-I] [-RC file] [-P dir]\n");
+    printf("CABMAN [-M mode] [-J n] -S cabinet filename [-F folder] [filename] [...]\n");
     printf("  cabinet   Cabinet file.\n");
     printf("  filename  Name of the file to add to or extract from the cabinet.\n");
     printf("            Wild cards and multiple filenames\n");
@@ -208,6 +208,8 @@ void CCABManager::Usage()
     printf("  -E        Extract files from cabinet.\n");
     printf("  -F        Put the files from the next 'filename' filter in the cab in folder\filename.\n");
     printf("  -I        Don't create the cabinet, only the .inf file.\n");
+    printf("  -J n      Number of threads used for compression\n");
+    printf("            (default is the number of processors).\n");
     printf("  -L dir    Location to place extracted or generated files\n");
     printf("            (default is current directory).\n");
     printf("  -M mode   Specify the compression method to use:\n");
@@ -281,6 +283,18 @@ bool CCABManager::ParseCmdline(int argc, char* argv[])
                     InfFileOnly = true;
                     break;
 
+                case 'j':
+                case 'J':
+                    if (argv[i][2] == 0)
+                    {
+                        i++;
+                        SetCompressionThreads(atoi(&argv[i][0]));
+                    }
+                    else
+                        SetCompressionThreads(atoi(&argv[i][2]));
+
+                    break;
+
                 case 'l':
                 case 'L':
                     if (argv[i][2] == 0)
@@ -41,6 +41,11 @@ CMSZipCodec::CMSZipCodec()
     ZStream.zalloc = MSZipAlloc;
     ZStream.zfree  = MSZipFree;
     ZStream.opaque = (voidpf)0;
+
+    DeflateStream.zalloc = MSZipAlloc;
+    DeflateStream.zfree  = MSZipFree;
+    DeflateStream.opaque = (voidpf)0;
+    DeflateReady = false;
 }
 
 
@@ -49,6 +54,8 @@ CMSZipCodec::~CMSZipCodec()
  * FUNCTION: Default destructor
  */
 {
+    if (DeflateReady)
+        deflateEnd(&DeflateStream);
 }
 
 
@@ -72,41 +79,50 @@ ULONG CMSZipCodec::Compress(void* OutputBuffer,
     Magic  = (PUSHORT)OutputBuffer;
     *Magic = MSZIP_MAGIC;
 
-    ZStream.next_in   = (unsigned char*)InputBuffer;
-    ZStream.avail_in  = InputLength;
-    ZStream.next_out  = ((unsigned char *)OutputBuffer + 2);
-    ZStream.avail_out = CAB_BLOCKSIZE + 12;
-
-    /* WindowBits is passed < 0 to tell that there is no zlib header */
-    Status = deflateInit2(&ZStream,
-                          Z_DEFAULT_COMPRESSION,
-                          Z_DEFLATED,
-                          -MAX_WBITS,
-                          8, /* memLevel */
-                          Z_DEFAULT_STRATEGY);
-    if (Status != Z_OK)
+    /* Every block is compressed on its own. Setting up the deflate state
+       is costly, so it is created once and only reset between blocks,
+       which produces exactly the same output */
+    if (!DeflateReady)
+    {
+        /* WindowBits is passed < 0 to tell that there is no zlib header */
+        Status = deflateInit2(&DeflateStream,
+                              Z_DEFAULT_COMPRESSION,
+                              Z_DEFLATED,
+                              -MAX_WBITS,
+                              8, /* memLevel */
+                              Z_DEFAULT_STRATEGY);
+        if (Status != Z_OK)
+        {
+            DPRINT(MIN_TRACE, ("deflateInit() returned (%d).\n", Status));
+            return CS_NOMEMORY;
+        }
+        DeflateReady = true;
+    }
+    else
     {
-        DPRINT(MIN_TRACE, ("deflateInit() returned (%d).\n", Status));
-        return CS_NOMEMORY;
+        Status = deflateReset(&DeflateStream);
+        if (Status != Z_OK)
+        {
+            DPRINT(MIN_TRACE, ("deflateReset() returned (%d).\n", Status));
+            return CS_BADSTREAM;
+        }
     }
 
-    Status = deflate(&ZStream, Z_FINISH);
+    DeflateStream.next_in   = (unsigned char*)InputBuffer;
+    DeflateStream.avail_in  = InputLength;
+    DeflateStream.next_out  = ((unsigned char *)OutputBuffer + 2);
+    DeflateStream.avail_out = CAB_BLOCKSIZE + 12;
+
+    Status = deflate(&DeflateStream, Z_FINISH);
     if ((Status != Z_OK) && (Status != Z_STREAM_END))
     {
-        DPRINT(MIN_TRACE, ("deflate() returned (%d) (%s).\n", Status, ZStream.msg));
+        DPRINT(MIN_TRACE, ("deflate() returned (%d) (%s).\n", Status, DeflateStream.msg));
         if (Status == Z_MEM_ERROR)
             return CS_NOMEMORY;
         return CS_BADSTREAM;
     }
 
-    *OutputLength = ZStream.total_out + 2;
-
-    Status = deflateEnd(&ZStream);
-    if (Status != Z_OK)
-    {
-        DPRINT(MIN_TRACE, ("deflateEnd() returned (%d).\n", Status));
-        return CS_BADSTREAM;
-    }
+    *OutputLength = DeflateStream.total_out + 2;
 
     return CS_SUCCESS;
 }
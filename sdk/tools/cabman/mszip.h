@@ -35,6 +35,8 @@ public:
 private:
     int Status;
     z_stream ZStream; /* Zlib stream */
+    z_stream DeflateStream; /* Deflate state, reused for every block */
+    bool DeflateReady;
 };
 
 /* EOF */
@@ -132,6 +132,7 @@ ROPINFO, *PROPINFO;
 #define FLAG_BOTTOMUP            0x04
 #define FLAG_FORCENOUSESSOURCE   0x08
 #define FLAG_FORCERAWSOURCEAVAIL 0x10
+#define FLAG_ALIGNEDSOURCE       0x20
 
 static PROPINFO
 FindRopInfo(unsigned RopCode)
@@ -334,7 +335,7 @@ CreateBase(FILE *Out, int Source, int Flags, unsigned Bpp)
     if (Source)
     {
         Output(Out, "             %sBltInfo->SourcePoint.x",
-               16 < Bpp ? "" : "((");
+               16 < Bpp || 0 != (Flags & FLAG_ALIGNEDSOURCE) ? "" : "((");
     }
     else
     {
@@ -348,12 +349,12 @@ CreateBase(FILE *Out, int Source, int Flags, unsigned Bpp)
     {
         Output(Out, " * %u", Bpp / 8);
     }
-    if (Source && Bpp <= 16)
+    if (Source && Bpp <= 16 && 0 == (Flags & FLAG_ALIGNEDSOURCE))
     {
         Output(Out, ") & ~ 0x3)");
     }
     Output(Out, ";\n", Bpp / 8);
-    if (Source && Bpp <= 16)
+    if (Source && Bpp <= 16 && 0 == (Flags & FLAG_ALIGNEDSOURCE))
     {
         Output(Out, "BaseSourcePixels = %u - (BltInfo->SourcePoint.x & 0x%x);\n",
                32 / Bpp, 32 / Bpp - 1);
@@ -676,6 +677,112 @@ CreateBitCase(FILE *Out, unsigned Bpp, PROPINFO RopInfo, int Flags,
     Output(Out, "}\n");
 }
 
+/*
+ * When source and destination have the same depth, no color translation is
+ * needed and the source pixels have the same address within a 32 bit word
+ * as the destination pixels, the rop can be applied to whole words of
+ * source and destination without unpacking the source pixels. Only the
+ * unaligned pixels at the start and end of each line are done one by one.
+ */
+static void
+CreateAlignedSetSinglePixel(FILE *Out, unsigned Bpp, PROPINFO RopInfo)
+{
+    MARK(Out);
+    Output(Out, "Source = *((%s) SourcePtr);\n",
+           16 == Bpp ? "PUSHORT" : "PUCHAR");
+    CreateOperation(Out, Bpp, RopInfo, Bpp, 16);
+    Output(Out, ";\n");
+    Output(Out, "\n");
+    Output(Out, "SourcePtr = (PULONG)((char *) SourcePtr + %u);\n", Bpp / 8);
+    Output(Out, "DestPtr = (PULONG)((char *) DestPtr + %u);\n", Bpp / 8);
+}
+
+static void
+CreateAlignedBitCase(FILE *Out, unsigned Bpp, PROPINFO RopInfo, int Flags)
+{
+    MARK(Out);
+    CreateBase(Out, 1, Flags | FLAG_ALIGNEDSOURCE, Bpp);
+    CreateBase(Out, 0, Flags, Bpp);
+    CreateCounts(Out, Bpp);
+
+    Output(Out, "for (LineIndex = 0; LineIndex < LineCount; LineIndex++)\n");
+    Output(Out, "{\n");
+    Output(Out, "SourcePtr = (PULONG) SourceBase;\n");
+    Output(Out, "DestPtr = (PULONG) DestBase;\n");
+    Output(Out, "\n");
+    if (16 == Bpp)
+    {
+        Output(Out, "if (0 != LeftCount)\n");
+    }
+    else
+    {
+        Output(Out, "for (i = 0; i < LeftCount; i++)\n");
+    }
+    Output(Out, "{\n");
+    CreateAlignedSetSinglePixel(Out, Bpp, RopInfo);
+    Output(Out, "}\n");
+    Output(Out, "\n");
+    Output(Out, "for (i = 0; i < CenterCount; i++)\n");
+    Output(Out, "{\n");
+    Output(Out, "Source = *SourcePtr++;\n");
+    CreateOperation(Out, Bpp, RopInfo, Bpp, 32);
+    Output(Out, ";\n");
+    Output(Out, "DestPtr++;\n");
+    Output(Out, "}\n");
+    Output(Out, "\n");
+    if (16 == Bpp)
+    {
+        Output(Out, "if (0 != RightCount)\n");
+    }
+    else
+    {
+        Output(Out, "for (i = 0; i < RightCount; i++)\n");
+    }
+    Output(Out, "{\n");
+    CreateAlignedSetSinglePixel(Out, Bpp, RopInfo);
+    Output(Out, "}\n");
+    Output(Out, "\n");
+    Output(Out, "SourceBase %c= BltInfo->SourceSurface->lDelta;\n",
+           0 == (Flags & FLAG_BOTTOMUP) ? '+' : '-');
+    Output(Out, "DestBase %c= BltInfo->DestSurface->lDelta;\n",
+           0 == (Flags & FLAG_BOTTOMUP) ? '+' : '-');
+    Output(Out, "}\n");
+}
+
+static void
+CreateTrivialBitCase(FILE *Out, unsigned Bpp, PROPINFO RopInfo, int Flags)
+{
+    MARK(Out);
+    if (32 == Bpp || ROPCODE_SRCCOPY == RopInfo->RopCode ||
+            0 != (Flags & FLAG_PATTERNSURFACE))
+    {
+        CreateBitCase(Out, Bpp, RopInfo, Flags | FLAG_TRIVIALXLATE, Bpp);
+        return;
+    }
+
+    /*
+     * The word loads are only aligned if every source line starts at the same
+     * offset within a 32 bit word as its destination line. That holds when
+     * the surfaces start at the same word offset, both line strides are whole
+     * words and the first pixels are at the same position within a word.
+     */
+    Output(Out, "if (0 == (((ULONG_PTR) BltInfo->SourceSurface->pvScan0 ^\n");
+    Output(Out, "           (ULONG_PTR) BltInfo->DestSurface->pvScan0) & 0x3) &&\n");
+    Output(Out, "    0 == ((BltInfo->SourceSurface->lDelta |\n");
+    Output(Out, "           BltInfo->DestSurface->lDelta) & 0x3) &&\n");
+    Output(Out, "    0 == ((BltInfo->SourcePoint.x ^ BltInfo->DestRect.left) & 0x%x))\n",
+           32 / Bpp - 1);
+    Output(Out, "{\n");
+    CreateAlignedBitCase(Out, Bpp, RopInfo, Flags);
+    MARK(Out);
+    Output(Out, "}\n");
+    Output(Out, "else\n");
+    Output(Out, "{\n");
+    CreateBitCase(Out, Bpp, RopInfo, Flags | FLAG_TRIVIALXLATE, Bpp);
+    MARK(Out);
+    Output(Out, "}\n");
+}
+
 static void
 CreateActionBlock(FILE *Out, unsigned Bpp, PROPINFO RopInfo,
                   int Flags)
@@ -707,16 +814,12 @@ CreateActionBlock(FILE *Out, unsigned Bpp, PROPINFO RopInfo,
                 Output(Out, "{\n");
                 Output(Out, "if (BltInfo->DestRect.top < BltInfo->SourcePoint.y)\n");
                 Output(Out, "{\n");
-                CreateBitCase(Out, Bpp, RopInfo,
-                              Flags | FLAG_TRIVIALXLATE,
-                              SourceBpp[BppIndex]);
+                CreateTrivialBitCase(Out, Bpp, RopInfo, Flags);
                 MARK(Out);
                 Output(Out, "}\n");
                 Output(Out, "else\n");
                 Output(Out, "{\n");
-                CreateBitCase(Out, Bpp, RopInfo,
-                              Flags | FLAG_BOTTOMUP | FLAG_TRIVIALXLATE,
-                              SourceBpp[BppIndex]);
+                CreateTrivialBitCase(Out, Bpp, RopInfo, Flags | FLAG_BOTTOMUP);
                 MARK(Out);
                 Output(Out, "}\n");
                 Output(Out, "}\n");
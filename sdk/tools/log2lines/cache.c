@@ -169,7 +169,7 @@ read_cache(void)
         l2l_dbg(1, "Open %s failed\n", cache_name);
         return 2;
     }
-    cache.phead = cache.ptail = NULL;
+    list_clear(&cache);
 
     while (fgets(Line, LINESIZE, fr) != NULL)
     {
@@ -7,6 +7,13 @@
 
 #include <errno.h>
 #include <string.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 #include <rsym.h>
 
 #include "compat.h"
@@ -14,6 +21,125 @@
 #include "options.h"
 #include "log2lines.h"
 
+#define IMAGE_HASHSIZE  256
+
+typedef struct image_struct
+{
+    char *name;
+    void *data;
+    size_t size;
+    time_t mtime;
+    int mapped;
+    struct image_struct *pnext;
+} IMAGE, *PIMAGE;
+
+/* Images stay loaded until they change on disk or the cache is cleared */
+static PIMAGE images[IMAGE_HASHSIZE];
+
+static void
+image_unload(PIMAGE pimage)
+{
+#if !defined(_WIN32)
+    if (pimage->mapped)
+        munmap(pimage->data, pimage->size);
+    else
+#endif
+        free(pimage->data);
+    pimage->data = NULL;
+}
+
+static int
+image_read(PIMAGE pimage, size_t size)
+{
+#if !defined(_WIN32)
+    int fd;
+
+    fd = open(pimage->name, O_RDONLY);
+    if (fd >= 0)
+    {
+        pimage->data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (pimage->data != MAP_FAILED)
+        {
+            pimage->size = size;
+            pimage->mapped = 1;
+            return 0;
+        }
+        pimage->data = NULL;
+    }
+#endif
+    pimage->mapped = 0;
+    pimage->data = load_file(pimage->name, &pimage->size);
+    return pimage->data ? 0 : 1;
+}
+
+const void *
+image_load(const char *file_name)
+{
+    struct stat st;
+    unsigned int bucket;
+    PIMAGE pimage;
+
+    if (stat(file_name, &st) != 0 || st.st_size == 0)
+        return NULL;
+
+    bucket = name_hash(file_name) % IMAGE_HASHSIZE;
+    for (pimage = images[bucket]; pimage; pimage = pimage->pnext)
+    {
+        if (PATHCMP(file_name, pimage->name) == 0)
+            break;
+    }
+
+    if (pimage)
+    {
+        if (pimage->data && pimage->mtime == st.st_mtime &&
+            pimage->size == (size_t)st.st_size)
+        {
+            return pimage->data;
+        }
+        l2l_dbg(2, "Reloading changed image '%s'\n", file_name);
+        image_unload(pimage);
+    }
+    else
+    {
+        pimage = calloc(1, sizeof(IMAGE));
+        if (!pimage)
+            return NULL;
+        pimage->name = strdup(file_name);
+        if (!pimage->name)
+        {
+            free(pimage);
+            return NULL;
+        }
+        pimage->pnext = images[bucket];
+        images[bucket] = pimage;
+    }
+
+    if (image_read(pimage, (size_t)st.st_size))
+        return NULL;
+    pimage->mtime = st.st_mtime;
+    return pimage->data;
+}
+
+void
+image_cache_clear(void)
+{
+    PIMAGE pimage, pnext;
+    size_t i;
+
+    for (i = 0; i < IMAGE_HASHSIZE; i++)
+    {
+        for (pimage = images[i]; pimage; pimage = pnext)
+        {
+            pnext = pimage->pnext;
+            image_unload(pimage);
+            free(pimage->name);
+            free(pimage);
+        }
+        images[i] = NULL;
+    }
+}
+
 static PIMAGE_SECTION_HEADER
 find_rossym_section(PIMAGE_FILE_HEADER PEFileHeader, PIMAGE_SECTION_HEADER PESectionHeaders)
 {
@@ -40,19 +166,22 @@ find_offset(void *data, size_t offset)
     PSYMBOLFILE_HEADER RosSymHeader = (PSYMBOLFILE_HEADER)data;
     PROSSYM_ENTRY Entries = (PROSSYM_ENTRY)((char *)data + RosSymHeader->SymbolsOffset);
     size_t symbols = RosSymHeader->SymbolsLength / sizeof(ROSSYM_ENTRY);
-    size_t i;
+    size_t low = 0, high = symbols, mid;
 
-    for (i = 0; i < symbols; i++)
+    /* rsym sorts the entries by address, find the first one above offset */
+    while (low < high)
     {
-        if (Entries[i].Address > offset)
-        {
-            if (!i--)
-                return NULL;
-            else
-                return &Entries[i];
-        }
+        mid = low + (high - low) / 2;
+        if (Entries[mid].Address > offset)
+            high = mid;
+        else
+            low = mid + 1;
     }
-    return NULL;
+
+    /* No entry above offset means offset is past the last symbol */
+    if (low == 0 || low == symbols)
+        return NULL;
+    return &Entries[low - 1];
 }
 
 PIMAGE_SECTION_HEADER
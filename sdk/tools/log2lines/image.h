@@ -17,4 +17,7 @@ PIMAGE_SECTION_HEADER get_sectionheader(const void *FileData);
 
 int get_ImageBase(char *fname, size_t *ImageBase);
 
+const void *image_load(const char *file_name);
+void image_cache_clear(void);
+
 /* EOF */
@@ -18,27 +18,17 @@
 PLIST_MEMBER
 entry_lookup(PLIST list, char *name)
 {
-    PLIST_MEMBER pprev = NULL;
     PLIST_MEMBER pnext;
 
     if (!name || !name[0])
         return NULL;
 
-    pnext = list->phead;
+    pnext = list->hash[name_hash(name) % LIST_HASHSIZE];
     while (pnext != NULL)
     {
         if (PATHCMP(name, pnext->name) == 0)
-        {
-            if (pprev)
-            {   // move to head for faster lookup next time
-                pprev->pnext = pnext->pnext;
-                pnext->pnext = list->phead;
-                list->phead = pnext;
-            }
             return pnext;
-        }
-        pprev = pnext;
-        pnext = pnext->pnext;
+        pnext = pnext->phashnext;
     }
     return NULL;
 }
@@ -57,6 +47,8 @@ entry_delete(PLIST_MEMBER pentry)
 PLIST_MEMBER
 entry_insert(PLIST list, PLIST_MEMBER pentry)
 {
+    unsigned int bucket;
+
     if (!pentry)
         return NULL;
 
@@ -64,6 +56,10 @@ entry_insert(PLIST list, PLIST_MEMBER pentry)
     list->phead = pentry;
     if (!list->ptail)
         list->ptail = pentry;
+
+    bucket = name_hash(pentry->name) % LIST_HASHSIZE;
+    pentry->phashnext = list->hash[bucket];
+    list->hash[bucket] = pentry;
     return pentry;
 }
 
@@ -78,6 +74,7 @@ void list_clear(PLIST list)
         pentry = pnext;
     }
     list->phead = list->ptail = NULL;
+    memset(list->hash, 0, sizeof(list->hash));
 }
 
 #if 0
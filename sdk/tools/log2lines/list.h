@@ -1,5 +1,7 @@
 #pragma once
 
+#define LIST_HASHSIZE   1024
+
 typedef struct entry_struct
 {
     char *buf;
@@ -9,12 +11,14 @@ typedef struct entry_struct
     size_t RelBase;
     size_t Size;
     struct entry_struct *pnext;
+    struct entry_struct *phashnext;
 } LIST_MEMBER, *PLIST_MEMBER;
 
 typedef struct list_struct
 {
     PLIST_MEMBER phead;
     PLIST_MEMBER ptail;
+    PLIST_MEMBER hash[LIST_HASHSIZE];   // entries by name
 } LIST, *PLIST;
 
 PLIST_MEMBER entry_lookup(PLIST list, char *name);
@@ -241,11 +241,10 @@ process_data(const void *FileData, size_t offset, char *toString)
 static int
 process_file(const char *file_name, size_t offset, char *toString)
 {
-    void *FileData;
-    size_t FileSize;
+    const void *FileData;
     int res = 1;
 
-    FileData = load_file(file_name, &FileSize);
+    FileData = image_load(file_name);
     if (!FileData)
     {
         l2l_dbg(0, "An error occured loading '%s'\n", file_name);
@@ -253,7 +252,6 @@ process_file(const char *file_name, size_t offset, char *toString)
     else
     {
         res = process_data(FileData, offset, toString);
-        free(FileData);
     }
     return res;
 }
@@ -666,6 +664,7 @@ cleanup:
 
     list_clear(&sources);
     list_clear(&cache);
+    image_cache_clear();
 
     return res;
 }
@@ -5,6 +5,7 @@
  * - Misc utils
  */
 
+#include <ctype.h>
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
@@ -48,6 +49,20 @@ set_LogFile(FILE **plogFile)
     return 0;
 }
 
+/* Case insensitive, like PATHCMP */
+unsigned int
+name_hash(const char *name)
+{
+    unsigned int hash = 2166136261u;
+
+    while (*name)
+    {
+        hash ^= (unsigned char)tolower((unsigned char)*name++);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
 int
 file_exists(char *name)
 {
@@ -46,5 +46,6 @@ long my_atoi(const char *a);
 int isOffset(const char *a);
 int copy_file(char *src, char *dst);
 int set_LogFile(FILE **plogFile);
+unsigned int name_hash(const char *name);
 
 /* EOF */
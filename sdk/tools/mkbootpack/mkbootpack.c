@@ -0,0 +1,280 @@
+/*
+ * PROJECT:     ReactOS mkbootpack
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Packs the files FreeLoader needs to boot into a boot pack
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/stat.h>
+
+#include <typedefs.h>
+#include <bootpack.h>
+
+typedef struct _PACK_FILE
+{
+    char *Name;         /* Normalized name, as stored in the pack */
+    const char *Path;   /* Path on the host */
+    unsigned char *Data;
+    ULONG Size;
+    ULONG Time;
+} PACK_FILE;
+
+static ULONG Crc32Table[256];
+
+static void InitCrc32(void)
+{
+    ULONG i, j, Value;
+
+    for (i = 0; i < 256; i++)
+    {
+        Value = i;
+        for (j = 0; j < 8; j++)
+            Value = (Value >> 1) ^ ((Value & 1) ? 0xEDB88320 : 0);
+        Crc32Table[i] = Value;
+    }
+}
+
+/* Same as RtlComputeCrc32(0, Data, Length) */
+static ULONG ComputeCrc32(const unsigned char *Data, size_t Length)
+{
+    ULONG Crc = 0xFFFFFFFF;
+
+    while (Length--)
+        Crc = Crc32Table[(Crc ^ *Data++) & 0xFF] ^ (Crc >> 8);
+
+    return ~Crc;
+}
+
+/* Upper-case, '\' separators, no leading or repeated separators */
+static char *NormalizeName(const char *Name)
+{
+    char *Result = malloc(strlen(Name) + 1);
+    size_t i = 0;
+    char c;
+
+    if (!Result)
+        return NULL;
+
+    for (; *Name; Name++)
+    {
+        c = (*Name == '/') ? '\\' : *Name;
+        if (c == '\\' && (i == 0 || Result[i - 1] == '\\'))
+            continue;
+        Result[i++] = (char)toupper((unsigned char)c);
+    }
+    Result[i] = '\0';
+
+    return Result;
+}
+
+static int ReadWholeFile(PACK_FILE *File)
+{
+    struct stat Stat;
+    FILE *In;
+    long Size;
+
+    if (stat(File->Path, &Stat) != 0)
+    {
+        fprintf(stderr, "Cannot find '%s'\n", File->Path);
+        return 0;
+    }
+    File->Time = (ULONG)Stat.st_mtime;
+
+    In = fopen(File->Path, "rb");
+    if (!In)
+    {
+        fprintf(stderr, "Cannot open '%s'\n", File->Path);
+        return 0;
+    }
+
+    if (fseek(In, 0, SEEK_END) != 0 || (Size = ftell(In)) < 0 ||
+        fseek(In, 0, SEEK_SET) != 0)
+    {
+        fprintf(stderr, "Cannot get the size of '%s'\n", File->Path);
+        fclose(In);
+        return 0;
+    }
+
+    File->Size = (ULONG)Size;
+    File->Data = malloc(Size ? Size : 1);
+    if (!File->Data || fread(File->Data, 1, Size, In) != (size_t)Size)
+    {
+        fprintf(stderr, "Cannot read '%s'\n", File->Path);
+        fclose(In);
+        return 0;
+    }
+
+    fclose(In);
+    return 1;
+}
+
+static int CompareFiles(const void *a, const void *b)
+{
+    return strcmp(((const PACK_FILE *)a)->Name, ((const PACK_FILE *)b)->Name);
+}
+
+static void Usage(void)
+{
+    printf("Usage: mkbootpack <output> <system root> <file> [<file> ...]\n"
+           "\n"
+           "  <output>       Boot pack to create, to be installed as\n"
+           "                 <system root>\\system32\\" BOOTPACK_FILE_NAME "\n"
+           "  <system root>  Host directory the files are relative to\n"
+           "  <file>         File relative to the system root,\n"
+           "                 e.g. system32/drivers/disk.sys, or\n"
+           "                 <name>=<host path> to take it from elsewhere,\n"
+           "                 e.g. system32/config/SYSTEM=out/system\n");
+}
+
+int main(int argc, char *argv[])
+{
+    BOOTPACK_HEADER Header;
+    BOOTPACK_ENTRY *Entries;
+    PACK_FILE *Files;
+    unsigned char *Pack;
+    size_t RootLength, TotalSize, Offset;
+    ULONG FileCount, i;
+    FILE *Out;
+    char *Name, *Path, *Graft;
+
+    if (argc < 4)
+    {
+        Usage();
+        return 1;
+    }
+
+    FileCount = (ULONG)(argc - 3);
+    Files = calloc(FileCount, sizeof(PACK_FILE));
+    if (!Files)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    /* Read all the files and compute the layout */
+    RootLength = strlen(argv[2]);
+    TotalSize = sizeof(BOOTPACK_HEADER) + FileCount * sizeof(BOOTPACK_ENTRY);
+    for (i = 0; i < FileCount; i++)
+    {
+        Name = strdup(argv[i + 3]);
+        Path = malloc(RootLength + strlen(argv[i + 3]) + 2);
+        if (!Name || !Path)
+        {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+
+        /* Either relative to the system root, or <name>=<host path> */
+        Graft = strchr(Name, '=');
+        if (Graft)
+        {
+            *Graft++ = '\0';
+            strcpy(Path, Graft);
+        }
+        else
+        {
+            sprintf(Path, "%s/%s", argv[2], Name);
+        }
+
+        Files[i].Name = NormalizeName(Name);
+        free(Name);
+        if (!Files[i].Name)
+        {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+        Files[i].Path = Path;
+
+        if (!ReadWholeFile(&Files[i]))
+            return 1;
+
+        TotalSize += strlen(Files[i].Name) + 1;
+    }
+
+    /* FreeLoader looks files up with a binary search */
+    qsort(Files, FileCount, sizeof(PACK_FILE), CompareFiles);
+    for (i = 1; i < FileCount; i++)
+    {
+        if (strcmp(Files[i - 1].Name, Files[i].Name) == 0)
+        {
+            fprintf(stderr, "'%s' is listed more than once\n", Files[i].Name);
+            return 1;
+        }
+    }
+
+    for (i = 0; i < FileCount; i++)
+    {
+        TotalSize = (TotalSize + BOOTPACK_DATA_ALIGNMENT - 1) & ~(size_t)(BOOTPACK_DATA_ALIGNMENT - 1);
+        TotalSize += Files[i].Size;
+    }
+
+    if (TotalSize > 0xFFFFFFFF)
+    {
+        fprintf(stderr, "The boot pack would be larger than 4GB\n");
+        return 1;
+    }
+
+    Pack = calloc(1, TotalSize);
+    if (!Pack)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    /* Index, then names, then data */
+    Entries = (BOOTPACK_ENTRY *)(Pack + sizeof(BOOTPACK_HEADER));
+    Offset = sizeof(BOOTPACK_HEADER) + FileCount * sizeof(BOOTPACK_ENTRY);
+    for (i = 0; i < FileCount; i++)
+    {
+        Entries[i].NameOffset = (ULONG)Offset;
+        strcpy((char *)Pack + Offset, Files[i].Name);
+        Offset += strlen(Files[i].Name) + 1;
+    }
+    for (i = 0; i < FileCount; i++)
+    {
+        Offset = (Offset + BOOTPACK_DATA_ALIGNMENT - 1) & ~(size_t)(BOOTPACK_DATA_ALIGNMENT - 1);
+        Entries[i].DataOffset = (ULONG)Offset;
+        Entries[i].DataSize = Files[i].Size;
+        Entries[i].SourceTime = Files[i].Time;
+        memcpy(Pack + Offset, Files[i].Data, Files[i].Size);
+        Offset += Files[i].Size;
+    }
+
+    InitCrc32();
+    memset(&Header, 0, sizeof(Header));
+    Header.Signature = BOOTPACK_SIGNATURE;
+    Header.Version = BOOTPACK_VERSION;
+    Header.EntryCount = FileCount;
+    Header.TotalSize = (ULONG)TotalSize;
+    Header.Checksum = ComputeCrc32(Pack + sizeof(Header), TotalSize - sizeof(Header));
+    memcpy(Pack, &Header, sizeof(Header));
+
+    Out = fopen(argv[1], "wb");
+    if (!Out)
+    {
+        fprintf(stderr, "Cannot create '%s'\n", argv[1]);
+        return 1;
+    }
+    if (fwrite(Pack, 1, TotalSize, Out) != TotalSize)
+    {
+        fprintf(stderr, "Cannot write '%s'\n", argv[1]);
+        fclose(Out);
+        remove(argv[1]);
+        return 1;
+    }
+    fclose(Out);
+
+    for (i = 0; i < FileCount; i++)
+    {
+        free(Files[i].Name);
+        free((char *)Files[i].Path);
+        free(Files[i].Data);
+    }
+    free(Files);
+    free(Pack);
+
+    return 0;
+}
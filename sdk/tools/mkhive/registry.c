@@ -51,6 +51,25 @@ typedef struct _MEMKEY
 #define HKEY_TO_MEMKEY(hKey) ((PMEMKEY)(hKey))
 #define MEMKEY_TO_HKEY(memKey) ((HKEY)(memKey))
 
+/*
+ * Every INF line resolves its full key path from the root, so the same
+ * parent/name pairs are looked up over and over. Remember where each
+ * subkey lives, instead of searching the subkey index of the parent.
+ */
+typedef struct _SUBKEY_CACHE_ENTRY
+{
+    struct _SUBKEY_CACHE_ENTRY *Next;
+    PCMHIVE RegistryHive;
+    HCELL_INDEX ParentCellOffset;
+    HCELL_INDEX KeyCellOffset;
+    USHORT NameLength; /* In bytes */
+    WCHAR Name[ANYSIZE_ARRAY]; /* Upcased */
+} SUBKEY_CACHE_ENTRY, *PSUBKEY_CACHE_ENTRY;
+
+#define SUBKEY_CACHE_BUCKETS 4096
+
+static PSUBKEY_CACHE_ENTRY SubKeyCache[SUBKEY_CACHE_BUCKETS];
+
 static CMHIVE RootHive;
 static PMEMKEY RootKey;
 
@@ -385,6 +404,143 @@ CreateInMemoryStructure(
 LIST_ENTRY CmiHiveListHead;
 LIST_ENTRY CmiReparsePointsHead;
 
+static ULONG
+RegpHashSubKeyName(
+    IN PCMHIVE RegistryHive,
+    IN HCELL_INDEX ParentCellOffset,
+    IN PCUNICODE_STRING KeyName)
+{
+    ULONG Hash;
+    USHORT i;
+
+    Hash = (ULONG)(ULONG_PTR)RegistryHive ^ (ParentCellOffset * 2654435761U);
+    for (i = 0; i < KeyName->Length / sizeof(WCHAR); i++)
+        Hash = Hash * 37 + RtlUpcaseUnicodeChar(KeyName->Buffer[i]);
+
+    return Hash % SUBKEY_CACHE_BUCKETS;
+}
+
+static BOOL
+RegpIsSubKeyCacheMatch(
+    IN PSUBKEY_CACHE_ENTRY Entry,
+    IN PCMHIVE RegistryHive,
+    IN HCELL_INDEX ParentCellOffset,
+    IN PCUNICODE_STRING KeyName)
+{
+    USHORT i;
+
+    if (Entry->RegistryHive != RegistryHive ||
+        Entry->ParentCellOffset != ParentCellOffset ||
+        Entry->NameLength != KeyName->Length)
+    {
+        return FALSE;
+    }
+
+    for (i = 0; i < KeyName->Length / sizeof(WCHAR); i++)
+    {
+        if (Entry->Name[i] != RtlUpcaseUnicodeChar(KeyName->Buffer[i]))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static VOID
+RegpCacheSubKey(
+    IN PCMHIVE RegistryHive,
+    IN HCELL_INDEX ParentCellOffset,
+    IN PCUNICODE_STRING KeyName,
+    IN HCELL_INDEX KeyCellOffset)
+{
+    PSUBKEY_CACHE_ENTRY Entry;
+    ULONG Bucket;
+    USHORT i;
+
+    Entry = (PSUBKEY_CACHE_ENTRY)malloc(FIELD_OFFSET(SUBKEY_CACHE_ENTRY, Name) +
+                                        KeyName->Length);
+    if (!Entry)
+        return; /* Not fatal, the key is just looked up the slow way */
+
+    Entry->RegistryHive = RegistryHive;
+    Entry->ParentCellOffset = ParentCellOffset;
+    Entry->KeyCellOffset = KeyCellOffset;
+    Entry->NameLength = KeyName->Length;
+    for (i = 0; i < KeyName->Length / sizeof(WCHAR); i++)
+        Entry->Name[i] = RtlUpcaseUnicodeChar(KeyName->Buffer[i]);
+
+    Bucket = RegpHashSubKeyName(RegistryHive, ParentCellOffset, KeyName);
+    Entry->Next = SubKeyCache[Bucket];
+    SubKeyCache[Bucket] = Entry;
+}
+
+static VOID
+RegpUncacheSubKey(
+    IN PCMHIVE RegistryHive,
+    IN HCELL_INDEX KeyCellOffset)
+{
+    PSUBKEY_CACHE_ENTRY *Link, Entry;
+    ULONG Bucket;
+
+    /* Keys are rarely deleted, so just sweep the whole cache */
+    for (Bucket = 0; Bucket < SUBKEY_CACHE_BUCKETS; Bucket++)
+    {
+        Link = &SubKeyCache[Bucket];
+        while ((Entry = *Link) != NULL)
+        {
+            if (Entry->RegistryHive == RegistryHive &&
+                Entry->KeyCellOffset == KeyCellOffset)
+            {
+                *Link = Entry->Next;
+                free(Entry);
+            }
+            else
+            {
+                Link = &Entry->Next;
+            }
+        }
+    }
+}
+
+static HCELL_INDEX
+RegpFindSubKey(
+    IN PCMHIVE RegistryHive,
+    IN HCELL_INDEX ParentCellOffset,
+    IN PCM_KEY_NODE ParentKeyCell,
+    IN PCUNICODE_STRING KeyName)
+{
+    PSUBKEY_CACHE_ENTRY Entry;
+    HCELL_INDEX KeyCellOffset;
+
+    Entry = SubKeyCache[RegpHashSubKeyName(RegistryHive, ParentCellOffset, KeyName)];
+    for (; Entry; Entry = Entry->Next)
+    {
+        if (RegpIsSubKeyCacheMatch(Entry, RegistryHive, ParentCellOffset, KeyName))
+            return Entry->KeyCellOffset;
+    }
+
+    KeyCellOffset = CmpFindSubKeyByName(&RegistryHive->Hive, ParentKeyCell, KeyName);
+    if (KeyCellOffset != HCELL_NIL)
+        RegpCacheSubKey(RegistryHive, ParentCellOffset, KeyName, KeyCellOffset);
+
+    return KeyCellOffset;
+}
+
+static VOID
+RegpFreeSubKeyCache(VOID)
+{
+    PSUBKEY_CACHE_ENTRY Entry;
+    ULONG Bucket;
+
+    for (Bucket = 0; Bucket < SUBKEY_CACHE_BUCKETS; Bucket++)
+    {
+        while ((Entry = SubKeyCache[Bucket]) != NULL)
+        {
+            SubKeyCache[Bucket] = Entry->Next;
+            free(Entry);
+        }
+    }
+}
+
 static LONG
 RegpCreateOrOpenKey(
     IN HKEY hParentKey,
@@ -450,7 +606,7 @@ RegpCreateOrOpenKey(
 
         VERIFY_KEY_CELL(ParentKeyCell);
 
-        BlockOffset = CmpFindSubKeyByName(&ParentRegistryHive->Hive, ParentKeyCell, &KeyString);
+        BlockOffset = RegpFindSubKey(ParentRegistryHive, ParentCellOffset, ParentKeyCell, &KeyString);
         if (BlockOffset != HCELL_NIL)
         {
             Status = STATUS_SUCCESS;
@@ -477,6 +633,8 @@ RegpCreateOrOpenKey(
                                   &KeyString,
                                   Volatile,
                                   &BlockOffset);
+            if (NT_SUCCESS(Status))
+                RegpCacheSubKey(ParentRegistryHive, ParentCellOffset, &KeyString, BlockOffset);
         }
         else // if (BlockOffset == HCELL_NIL)
         {
@@ -605,6 +763,8 @@ RegDeleteKeyW(
         Status = CmpFreeKeyByCell(Hive, Key->KeyCellOffset, TRUE);
         if (NT_SUCCESS(Status))
         {
+            RegpUncacheSubKey(Key->RegistryHive, Key->KeyCellOffset);
+
             /* Get the parent node */
             Parent = (PCM_KEY_NODE)HvGetCell(Hive, ParentCell);
             if (Parent)
@@ -1203,6 +1363,8 @@ RegShutdownRegistry(VOID)
         free(ReparsePoint);
     }
 
+    RegpFreeSubKeyCache();
+
     /* FIXME: clean up the complete hive */
 
     free(RootKey);
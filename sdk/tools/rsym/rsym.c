@@ -27,6 +27,12 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <wchar.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #include "rsym.h"
 
@@ -36,13 +42,15 @@
 struct StringEntry
 {
     struct StringEntry *Next;
+    unsigned int Hash;
     ULONG Offset;
     char *String;
 };
 
 struct StringHashTable
 {
-    ULONG TableSize;
+    ULONG TableSize;    /* Always a power of 2 */
+    ULONG EntryCount;
     struct StringEntry **Table;
 };
 
@@ -61,6 +69,42 @@ ComputeDJBHash(const char *name)
     return val;
 }
 
+static void
+GrowStringHashTable(struct StringHashTable *StringTable)
+{
+    ULONG NewSize = StringTable->TableSize * 2;
+    struct StringEntry **NewTable;
+    struct StringEntry *entry, *next, *reversed;
+    ULONG i;
+
+    NewTable = calloc(NewSize, sizeof(struct StringEntry *));
+    if (!NewTable)
+        return; /* Keep the current table, just with longer chains */
+
+    for (i = 0; i < StringTable->TableSize; i++)
+    {
+        /* Reverse the chain first, so entries keep their order */
+        reversed = NULL;
+        for (entry = StringTable->Table[i]; entry; entry = next)
+        {
+            next = entry->Next;
+            entry->Next = reversed;
+            reversed = entry;
+        }
+
+        for (entry = reversed; entry; entry = next)
+        {
+            next = entry->Next;
+            entry->Next = NewTable[entry->Hash & (NewSize - 1)];
+            NewTable[entry->Hash & (NewSize - 1)] = entry;
+        }
+    }
+
+    free(StringTable->Table);
+    StringTable->Table = NewTable;
+    StringTable->TableSize = NewSize;
+}
+
 static void
 AddStringToHash(struct StringHashTable *StringTable,
                 unsigned int hash,
@@ -68,10 +112,19 @@ AddStringToHash(struct StringHashTable *StringTable,
                 char *StringPtr)
 {
     struct StringEntry *entry = calloc(1, sizeof(struct StringEntry));
+    ULONG bucket;
+
+    /* Keep the chains short, however many strings the module has */
+    if (StringTable->EntryCount >= StringTable->TableSize * 2)
+        GrowStringHashTable(StringTable);
+
+    bucket = hash & (StringTable->TableSize - 1);
+    entry->Hash = hash;
     entry->Offset = Offset;
     entry->String = StringPtr;
-    entry->Next = StringTable->Table[hash];
-    StringTable->Table[hash] = entry;
+    entry->Next = StringTable->Table[bucket];
+    StringTable->Table[bucket] = entry;
+    StringTable->EntryCount++;
 }
 
 static void
@@ -82,11 +135,12 @@ StringHashTableInit(struct StringHashTable *StringTable,
     char *Start = StringsBase;
     char *End = StringsBase + StringsLength;
     StringTable->TableSize = 1024;
+    StringTable->EntryCount = 0;
     StringTable->Table = calloc(1024, sizeof(struct StringEntry *));
     while (Start < End)
     {
         AddStringToHash(StringTable,
-                        ComputeDJBHash(Start) % StringTable->TableSize,
+                        ComputeDJBHash(Start),
                         Start - StringsBase,
                         Start);
         Start += strlen(Start) + 1;
@@ -136,6 +190,71 @@ CompareSymEntry(const PROSSYM_ENTRY SymEntry1, const PROSSYM_ENTRY SymEntry2)
     return 0;
 }
 
+static __inline ULONG
+GetSymEntryDigit(const ROSSYM_ENTRY *SymEntry, ULONG Pass)
+{
+    /* The least significant digit puts entries without a source line last */
+    if (Pass == 0)
+        return SymEntry->SourceLine == 0;
+
+    return (ULONG)(SymEntry->Address >> ((Pass - 1) * 8)) & 0xFF;
+}
+
+/*
+ * Sorts the entries in the order of CompareSymEntry, keeping entries that
+ * compare equal in their original order. This is a radix sort, which is
+ * much faster than qsort for the symbol tables of the big modules.
+ */
+static void
+SortSymEntries(PROSSYM_ENTRY SymEntries, ULONG Count)
+{
+    PROSSYM_ENTRY Temp, Source, Dest, Swap;
+    ULONG Counts[256];
+    ULONG Pass, Sum, Digit, i;
+
+    if (Count < 2)
+        return;
+
+    Temp = malloc(Count * sizeof(ROSSYM_ENTRY));
+    if (Temp == NULL)
+    {
+        qsort(SymEntries, Count, sizeof(ROSSYM_ENTRY), (int (*)(const void *, const void *)) CompareSymEntry);
+        return;
+    }
+
+    Source = SymEntries;
+    Dest = Temp;
+    for (Pass = 0; Pass <= sizeof(SymEntries->Address); Pass++)
+    {
+        memset(Counts, 0, sizeof(Counts));
+        for (i = 0; i < Count; i++)
+            Counts[GetSymEntryDigit(&Source[i], Pass)]++;
+
+        /* Skip the pass if all entries have the same digit */
+        if (Counts[GetSymEntryDigit(&Source[0], Pass)] == Count)
+            continue;
+
+        for (Sum = 0, Digit = 0; Digit < 256; Digit++)
+        {
+            i = Counts[Digit];
+            Counts[Digit] = Sum;
+            Sum += i;
+        }
+
+        for (i = 0; i < Count; i++)
+            Dest[Counts[GetSymEntryDigit(&Source[i], Pass)]++] = Source[i];
+
+        Swap = Source;
+        Source = Dest;
+        Dest = Swap;
+    }
+
+    if (Source != SymEntries)
+        memcpy(SymEntries, Source, Count * sizeof(ROSSYM_ENTRY));
+
+    free(Temp);
+}
+
 static int
 GetStabInfo(void *FileData, PIMAGE_FILE_HEADER PEFileHeader,
             PIMAGE_SECTION_HEADER PESectionHeaders,
@@ -204,10 +323,10 @@ FindOrAddString(struct StringHashTable *StringTable,
                 ULONG *StringsLength,
                 void *StringsBase)
 {
-    unsigned int hash = ComputeDJBHash(StringToFind) % StringTable->TableSize;
-    struct StringEntry *entry = StringTable->Table[hash];
+    unsigned int hash = ComputeDJBHash(StringToFind);
+    struct StringEntry *entry = StringTable->Table[hash & (StringTable->TableSize - 1)];
 
-    while (entry && strcmp(entry->String, StringToFind))
+    while (entry && (entry->Hash != hash || strcmp(entry->String, StringToFind)))
         entry = entry->Next;
 
     if (entry)
@@ -360,7 +479,7 @@ ConvertStabs(ULONG *SymbolsCount, PROSSYM_ENTRY *SymbolsBase,
     }
     *SymbolsCount = (Current - *SymbolsBase + 1);
 
-    qsort(*SymbolsBase, *SymbolsCount, sizeof(ROSSYM_ENTRY), (int (*)(const void *, const void *)) CompareSymEntry);
+    SortSymEntries(*SymbolsBase, *SymbolsCount);
 
     StringHashTableFree(&StringHash);
 
@@ -451,7 +570,7 @@ ConvertCoffs(ULONG *SymbolsCount, PROSSYM_ENTRY *SymbolsBase,
     }
 
     *SymbolsCount = (Current - *SymbolsBase + 1);
-    qsort(*SymbolsBase, *SymbolsCount, sizeof(ROSSYM_ENTRY), (int (*)(const void *, const void *)) CompareSymEntry);
+    SortSymEntries(*SymbolsBase, *SymbolsCount);
 
     StringHashTableFree(&StringHash);
 
@@ -707,7 +826,7 @@ ConvertDbgHelp(void *process, DWORD module_base, char *SourcePath,
     free(strtab.LineEntryData);
     free(strtab.PathChop);
 
-    qsort(*SymbolsBase, *SymbolsCount, sizeof(ROSSYM_ENTRY), (int (*)(const void *, const void *))CompareSymEntry);
+    SortSymEntries(*SymbolsBase, *SymbolsCount);
 
     return 0;
 }
@@ -799,7 +918,7 @@ MergeStabsAndCoffs(ULONG *MergedSymbolCount, PROSSYM_ENTRY *MergedSymbols,
         }
     }
 
-    qsort(*MergedSymbols, *MergedSymbolCount, sizeof(ROSSYM_ENTRY), (int (*)(const void *, const void *)) CompareSymEntry);
+    SortSymEntries(*MergedSymbols, *MergedSymbolCount);
 
     return 0;
 }
@@ -1227,6 +1346,180 @@ CreateOutputFile(FILE *OutFile, void *InData,
     return 0;
 }
 
+/*
+ * The .rossym section only depends on the debug information, the image
+ * base and the section layout. When RSYM_CACHE_DIR is set, the generated
+ * section is kept there under a hash of these, so relinking a module
+ * whose debug information did not change skips the conversion.
+ */
+#define ROSSYM_CACHE_MAGIC   0x43595352 /* "RSYC" */
+#define ROSSYM_CACHE_VERSION 1
+
+typedef struct _ROSSYM_CACHE_HEADER
+{
+    ULONG Magic;
+    ULONG RosSymLength;
+    ULONG HashLow;
+    ULONG HashHigh;
+} ROSSYM_CACHE_HEADER, *PROSSYM_CACHE_HEADER;
+
+/* 64-bit FNV-1a */
+static ULONGLONG
+HashBytes(ULONGLONG Hash, const void *Data, ULONG Length)
+{
+    const unsigned char *Bytes = Data;
+    ULONG i;
+
+    for (i = 0; i < Length; i++)
+    {
+        Hash ^= Bytes[i];
+        Hash *= 0x100000001B3ULL;
+    }
+
+    return Hash;
+}
+
+static ULONGLONG
+HashDebugInfo(ULONG ImageBase,
+              PIMAGE_FILE_HEADER PEFileHeader,
+              PIMAGE_SECTION_HEADER PESectionHeaders,
+              void *StabBase, ULONG StabsLength,
+              void *StabStringBase, ULONG StabStringsLength,
+              void *CoffBase, ULONG CoffsLength,
+              void *CoffStringBase, ULONG CoffStringsLength)
+{
+    ULONGLONG Hash = 0xCBF29CE484222325ULL;
+    ULONG Version = ROSSYM_CACHE_VERSION;
+
+    Hash = HashBytes(Hash, &Version, sizeof(Version));
+    Hash = HashBytes(Hash, &ImageBase, sizeof(ImageBase));
+    Hash = HashBytes(Hash, PESectionHeaders,
+                     PEFileHeader->NumberOfSections * sizeof(IMAGE_SECTION_HEADER));
+    Hash = HashBytes(Hash, &StabsLength, sizeof(StabsLength));
+    Hash = HashBytes(Hash, StabBase, StabsLength);
+    Hash = HashBytes(Hash, &StabStringsLength, sizeof(StabStringsLength));
+    Hash = HashBytes(Hash, StabStringBase, StabStringsLength);
+    Hash = HashBytes(Hash, &CoffsLength, sizeof(CoffsLength));
+    Hash = HashBytes(Hash, CoffBase, CoffsLength);
+    Hash = HashBytes(Hash, &CoffStringsLength, sizeof(CoffStringsLength));
+    Hash = HashBytes(Hash, CoffStringBase, CoffStringsLength);
+
+    return Hash;
+}
+
+static void
+GetCacheFileName(char *FileName, const char *CacheDir, ULONGLONG Hash)
+{
+    snprintf(FileName, MAX_PATH, "%s/%08x%08x.rossym", CacheDir,
+             (unsigned int)(Hash >> 32), (unsigned int)Hash);
+}
+
+static int
+LoadCachedRosSym(const char *CacheDir, ULONGLONG Hash,
+                 void **RosSymSection, ULONG *RosSymLength)
+{
+    char FileName[MAX_PATH];
+    ROSSYM_CACHE_HEADER Header;
+    void *Data = NULL;
+    FILE *CacheFile;
+
+    GetCacheFileName(FileName, CacheDir, Hash);
+    CacheFile = fopen(FileName, "rb");
+    if (CacheFile == NULL)
+        return 1;
+
+    if (fread(&Header, sizeof(Header), 1, CacheFile) != 1 ||
+        Header.Magic != ROSSYM_CACHE_MAGIC ||
+        Header.HashLow != (ULONG)Hash ||
+        Header.HashHigh != (ULONG)(Hash >> 32))
+    {
+        fclose(CacheFile);
+        return 1;
+    }
+
+    if (Header.RosSymLength != 0)
+    {
+        Data = malloc(Header.RosSymLength);
+        if (Data == NULL ||
+            fread(Data, Header.RosSymLength, 1, CacheFile) != 1)
+        {
+            free(Data);
+            fclose(CacheFile);
+            return 1;
+        }
+    }
+
+    fclose(CacheFile);
+    *RosSymSection = Data;
+    *RosSymLength = Header.RosSymLength;
+    return 0;
+}
+
+static void
+SaveCachedRosSym(const char *CacheDir, ULONGLONG Hash, const char *OutputPath,
+                 void *RosSymSection, ULONG RosSymLength)
+{
+    char FileName[MAX_PATH];
+    char TempName[MAX_PATH];
+    ROSSYM_CACHE_HEADER Header;
+    FILE *CacheFile;
+    int Failed;
+#ifndef _WIN32
+    int Fd;
+#endif
+
+    /*
+     * Write to a unique file in the cache directory first, so parallel builds
+     * never see partial files, and the rename stays on the same filesystem
+     */
+    snprintf(TempName, sizeof(TempName), "%s/rossymXXXXXX", CacheDir);
+#ifdef _WIN32
+    CacheFile = NULL;
+    if (_mktemp_s(TempName, strlen(TempName) + 1) == 0)
+        CacheFile = fopen(TempName, "wb");
+#else
+    Fd = mkstemp(TempName);
+    CacheFile = (Fd == -1) ? NULL : fdopen(Fd, "wb");
+    if (CacheFile == NULL && Fd != -1)
+    {
+        close(Fd);
+        remove(TempName);
+    }
+#endif
+    if (CacheFile == NULL)
+    {
+        fprintf(stderr, "Warning: cannot create a temporary file in '%s', not caching %s\n",
+                CacheDir, OutputPath);
+        return;
+    }
+
+    Header.Magic = ROSSYM_CACHE_MAGIC;
+    Header.RosSymLength = RosSymLength;
+    Header.HashLow = (ULONG)Hash;
+    Header.HashHigh = (ULONG)(Hash >> 32);
+
+    Failed = fwrite(&Header, sizeof(Header), 1, CacheFile) != 1 ||
+             (RosSymLength != 0 && fwrite(RosSymSection, RosSymLength, 1, CacheFile) != 1);
+    Failed |= fclose(CacheFile) != 0;
+
+    GetCacheFileName(FileName, CacheDir, Hash);
+    if (Failed)
+    {
+        fprintf(stderr, "Warning: cannot write '%s', not caching %s\n", TempName, OutputPath);
+        remove(TempName);
+    }
+    else if (rename(TempName, FileName) != 0)
+    {
+        /* On Windows, a parallel build may have stored the same entry first */
+        if (errno != EEXIST)
+        {
+            fprintf(stderr, "Warning: cannot rename '%s' to '%s': %s\n",
+                    TempName, FileName, strerror(errno));
+        }
+        remove(TempName);
+    }
+}
+
 int main(int argc, char* argv[])
 {
     PSYMBOLFILE_HEADER SymbolFileHeader;
@@ -1264,6 +1557,9 @@ int main(int argc, char* argv[])
     BOOLEAN UseDbgHelp = FALSE;
     int arg, argstate = 0;
     char *SourcePath = NULL;
+    char *CacheDir;
+    ULONGLONG CacheHash = 0;
+    BOOLEAN UseCache = FALSE;
 
     for (arg = 1; arg < argc; arg++)
     {
@@ -1391,6 +1687,22 @@ int main(int argc, char* argv[])
         exit(1);
     }
 
+    CacheDir = getenv("RSYM_CACHE_DIR");
+    if (CacheDir && *CacheDir && !UseDbgHelp)
+    {
+        CacheHash = HashDebugInfo(ImageBase,
+                                  PEFileHeader,
+                                  PESectionHeaders,
+                                  StabBase, StabsLength,
+                                  StabStringBase, StabStringsLength,
+                                  CoffBase, CoffsLength,
+                                  CoffStringBase, CoffStringsLength);
+        UseCache = TRUE;
+
+        if (!LoadCachedRosSym(CacheDir, CacheHash, &RosSymSection, &RosSymLength))
+            goto WriteOutput;
+    }
+
     if (!UseDbgHelp)
     {
         StringBase = malloc(1 + StringsLength + CoffStringsLength +
@@ -1523,6 +1835,10 @@ int main(int argc, char* argv[])
         free(MergedSymbols);
     }
 
+    if (UseCache)
+        SaveCachedRosSym(CacheDir, CacheHash, path2, RosSymSection, RosSymLength);
+
+WriteOutput:
     free(StringBase);
     out = fopen(path2, "wb");
     if (out == NULL)
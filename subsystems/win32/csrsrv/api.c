@@ -23,6 +23,12 @@ UNICODE_STRING CsrApiPortName;
 volatile ULONG CsrpStaticThreadCount;
 volatile ULONG CsrpDynamicThreadTotal;
 extern ULONG CsrMaxApiRequestThreads;
+CSR_API_QUEUE CsrApiQueues[CSR_SERVER_DLL_MAX];
+LARGE_INTEGER CsrApiPerformanceFrequency;
+
+/* An API whose calls took less than 1/5000 s on average is a short one */
+#define CSR_API_SHORT_CALL_MIN_COUNT    16
+#define CSR_API_SHORT_CALL_DIVISOR      5000
 
 /* FUNCTIONS ******************************************************************/
 
@@ -312,6 +318,398 @@ CsrpCheckRequestThreads(VOID)
     return STATUS_SUCCESS;
 }
 
+/*++
+ * @name CsrInitializeApiQueue
+ *
+ * The CsrInitializeApiQueue routine sets up the API queue and the API
+ * statistics of a Server DLL that is being loaded.
+ *
+ * @param ServerDll
+ *        Pointer to the CSR Server DLL, with its API tables filled in.
+ *
+ * @return STATUS_SUCCESS in case of success, or status code which caused
+ *         the routine to error.
+ *
+ * @remarks None.
+ *
+ *--*/
+NTSTATUS
+NTAPI
+CsrInitializeApiQueue(IN PCSR_SERVER_DLL ServerDll)
+{
+    PCSR_API_QUEUE ApiQueue = &CsrApiQueues[ServerDll->ServerId];
+    LARGE_INTEGER Counter;
+    NTSTATUS Status;
+
+    /* The statistics are kept in performance counter ticks */
+    if (!CsrApiPerformanceFrequency.QuadPart)
+        NtQueryPerformanceCounter(&Counter, &CsrApiPerformanceFrequency);
+
+    Status = RtlInitializeCriticalSection(&ApiQueue->Lock);
+    if (!NT_SUCCESS(Status)) return Status;
+
+    InitializeListHead(&ApiQueue->RequestList);
+    ApiQueue->ActiveThreads = 0;
+    ApiQueue->Statistics = NULL;
+
+    /* HighestApiSupported is an API number, the IDs we index with start at ApiBase */
+    ApiQueue->ApiCount = (ServerDll->HighestApiSupported > ServerDll->ApiBase) ?
+                         ServerDll->HighestApiSupported - ServerDll->ApiBase : 0;
+
+    /* Allocate one statistics entry per API */
+    if (ApiQueue->ApiCount)
+    {
+        ApiQueue->Statistics = RtlAllocateHeap(CsrHeap,
+                                               HEAP_ZERO_MEMORY,
+                                               ApiQueue->ApiCount *
+                                               sizeof(CSR_API_STATISTICS));
+        if (!ApiQueue->Statistics)
+        {
+            RtlDeleteCriticalSection(&ApiQueue->Lock);
+            return STATUS_NO_MEMORY;
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+/*++
+ * @name CsrpIsShortApiCall
+ *
+ * The CsrpIsShortApiCall routine tells whether the calls of an API
+ * have been short so far.
+ *
+ * @param ApiStatistics
+ *        Pointer to the statistics of the API.
+ *
+ * @return TRUE if the API averaged less than 1/5000 s per call over
+ *         enough calls, FALSE otherwise.
+ *
+ * @remarks None.
+ *
+ *--*/
+BOOLEAN
+NTAPI
+CsrpIsShortApiCall(IN PCSR_API_STATISTICS ApiStatistics)
+{
+    /* Only trust the average once there are enough calls */
+    if (ApiStatistics->CallCount < CSR_API_SHORT_CALL_MIN_COUNT)
+        return FALSE;
+
+    return (ApiStatistics->TotalTime <=
+            ApiStatistics->CallCount *
+            (ULONGLONG)(CsrApiPerformanceFrequency.QuadPart / CSR_API_SHORT_CALL_DIVISOR));
+}
+
+/*++
+ * @name CsrpAddApiCallTime
+ *
+ * The CsrpAddApiCallTime routine accounts for a finished API call
+ * in the API statistics.
+ *
+ * @param ApiQueue
+ *        Pointer to the API queue of the Server DLL.
+ *
+ * @param ApiId
+ *        API ID of the call.
+ *
+ * @param Time
+ *        Duration of the call, in performance counter ticks.
+ *
+ * @return None.
+ *
+ * @remarks The caller holds the lock of the API queue.
+ *
+ *--*/
+VOID
+NTAPI
+CsrpAddApiCallTime(IN PCSR_API_QUEUE ApiQueue,
+                   IN ULONG ApiId,
+                   IN LONGLONG Time)
+{
+    PCSR_API_STATISTICS ApiStatistics;
+
+    ASSERT(ApiId < ApiQueue->ApiCount);
+    ApiStatistics = &ApiQueue->Statistics[ApiId];
+
+    ApiStatistics->CallCount++;
+    ApiStatistics->TotalTime += Time;
+    if ((ULONGLONG)Time > ApiStatistics->MaxTime)
+        ApiStatistics->MaxTime = Time;
+}
+
+/*++
+ * @name CsrpBeginApiCall
+ *
+ * The CsrpBeginApiCall routine decides whether an API call is made by the
+ * thread that received it, or queued for the threads already busy with
+ * calls of the same Server DLL.
+ *
+ * @param ApiQueue
+ *        Pointer to the API queue of the Server DLL.
+ *
+ * @param ServerDll
+ *        Pointer to the CSR Server DLL of the call.
+ *
+ * @param ApiId
+ *        API ID of the call, normalized with the Base ID of the Server DLL.
+ *
+ * @param CsrThread
+ *        Pointer to the referenced CSR Thread making the call.
+ *
+ * @param ApiMessage
+ *        Pointer to the received CSR API Message.
+ *
+ * @return TRUE if the current thread must make the call, FALSE if it was
+ *         queued, along with the reference to the CSR Thread.
+ *
+ * @remarks A Server DLL can keep all the API threads busy but
+ *          CSR_API_RESERVED_THREADS, so that one flooded server cannot
+ *          stall the others. Short calls never wait in the queue.
+ *
+ *--*/
+BOOLEAN
+NTAPI
+CsrpBeginApiCall(IN PCSR_API_QUEUE ApiQueue,
+                 IN PCSR_SERVER_DLL ServerDll,
+                 IN ULONG ApiId,
+                 IN PCSR_THREAD CsrThread,
+                 IN PCSR_API_MESSAGE ApiMessage)
+{
+    PCSR_API_STATISTICS ApiStatistics;
+    PCSR_API_REQUEST Request = NULL;
+    ULONG MaxActiveThreads;
+
+    ASSERT(ApiId < ApiQueue->ApiCount);
+    ApiStatistics = &ApiQueue->Statistics[ApiId];
+
+    /* Leave some threads to the other servers, but always allow one */
+    MaxActiveThreads = (CsrMaxApiRequestThreads > CSR_API_RESERVED_THREADS) ?
+                       (CsrMaxApiRequestThreads - CSR_API_RESERVED_THREADS) : 1;
+
+    RtlEnterCriticalSection(&ApiQueue->Lock);
+
+    if ((ApiQueue->ActiveThreads >= MaxActiveThreads) &&
+        !CsrpIsShortApiCall(ApiStatistics))
+    {
+        /* The server has enough threads busy, let one of them make the call */
+        Request = RtlAllocateHeap(CsrHeap, 0, sizeof(CSR_API_REQUEST));
+    }
+
+    if (!Request)
+    {
+        /* Make the call ourselves */
+        ApiQueue->ActiveThreads++;
+        RtlLeaveCriticalSection(&ApiQueue->Lock);
+        return TRUE;
+    }
+
+    Request->CsrThread = CsrThread;
+    Request->ServerDll = ServerDll;
+    Request->ApiId = ApiId;
+    RtlCopyMemory(&Request->ApiMessage, ApiMessage, sizeof(CSR_API_MESSAGE));
+    InsertTailList(&ApiQueue->RequestList, &Request->ListEntry);
+    ApiStatistics->QueuedCount++;
+
+    RtlLeaveCriticalSection(&ApiQueue->Lock);
+    return FALSE;
+}
+
+/*++
+ * @name CsrpCallQueuedApi
+ *
+ * The CsrpCallQueuedApi routine makes a queued API call and replies
+ * to the client, the same way CsrApiRequestThread does for the calls
+ * it makes itself.
+ *
+ * @param Request
+ *        Pointer to the queued call.
+ *
+ * @return None.
+ *
+ * @remarks The reference to the CSR Thread held by the request is released,
+ *          unless the call is left pending.
+ *
+ *--*/
+VOID
+NTAPI
+CsrpCallQueuedApi(IN PCSR_API_REQUEST Request)
+{
+    PTEB Teb = NtCurrentTeb();
+    PCSR_THREAD CurrentThread = Teb->CsrClientThread;
+    PCSR_THREAD CsrThread = Request->CsrThread;
+    PCSR_API_MESSAGE ApiMessage = &Request->ApiMessage;
+    HANDLE ReplyPort = CsrThread->Process->ClientPort;
+    CSR_REPLY_CODE ReplyCode;
+    NTSTATUS Status;
+
+    /* Use the Client ID of the call */
+    Teb->RealClientId = ApiMessage->Header.ClientId;
+
+    /* Assume success */
+    ApiMessage->Status = STATUS_SUCCESS;
+
+    /* Check if there's a capture buffer */
+    if (ApiMessage->CsrCaptureData)
+    {
+        /* Capture the arguments */
+        if (!CsrCaptureArguments(CsrThread, ApiMessage))
+        {
+            /* Reply with the failure status if we failed to get the arguments */
+            NtReplyPort(ReplyPort, &ApiMessage->Header);
+            CsrDereferenceThread(CsrThread);
+            Teb->RealClientId = Teb->ClientId;
+            return;
+        }
+    }
+
+    /* Validation complete, start SEH */
+    _SEH2_TRY
+    {
+        /* Make sure we have enough threads */
+        CsrpCheckRequestThreads();
+
+        Teb->CsrClientThread = CsrThread;
+
+        /* Call the API and get the reply code */
+        ReplyCode = CsrReplyImmediately;
+        ApiMessage->Status = Request->ServerDll->DispatchTable[Request->ApiId](ApiMessage,
+                                                                               &ReplyCode);
+
+        /* Increase the static thread count */
+        InterlockedIncrementUL(&CsrpStaticThreadCount);
+
+        Teb->CsrClientThread = CurrentThread;
+
+        if (ReplyCode == CsrReplyAlreadySent)
+        {
+            if (ApiMessage->CsrCaptureData)
+            {
+                CsrReleaseCapturedArguments(ApiMessage);
+            }
+            CsrDereferenceThread(CsrThread);
+        }
+        else if (ReplyCode == CsrReplyDeadClient)
+        {
+            /* Reply to the death message */
+            Status = NtReplyPort(ReplyPort, &ApiMessage->Header);
+            if (!NT_SUCCESS(Status))
+                DPRINT1("CSRSS: Error while replying to the death message, Status 0x%lx\n", Status);
+
+            CsrDereferenceThread(CsrThread);
+        }
+        else if (ReplyCode == CsrReplyPending)
+        {
+            /* The wait block has its own copy of the message */
+        }
+        else
+        {
+            if (ApiMessage->CsrCaptureData)
+            {
+                CsrReleaseCapturedArguments(ApiMessage);
+            }
+
+            /* Reply to the client */
+            Status = NtReplyPort(ReplyPort, &ApiMessage->Header);
+            if (!NT_SUCCESS(Status))
+                DPRINT1("CSRSS: Error while replying to a queued call, Status 0x%lx\n", Status);
+
+            CsrDereferenceThread(CsrThread);
+        }
+    }
+    _SEH2_EXCEPT(CsrUnhandledExceptionFilter(_SEH2_GetExceptionInformation()))
+    {
+        Teb->CsrClientThread = CurrentThread;
+    }
+    _SEH2_END;
+
+    Teb->RealClientId = Teb->ClientId;
+}
+
+/*++
+ * @name CsrpEndApiCall
+ *
+ * The CsrpEndApiCall routine accounts for a finished API call, then makes
+ * the calls that were queued for the Server DLL in the meantime.
+ *
+ * @param ApiQueue
+ *        Pointer to the API queue of the Server DLL.
+ *
+ * @param ApiId
+ *        API ID of the finished call.
+ *
+ * @param StartTime
+ *        Optional pointer to the performance counter value taken when the
+ *        call started. No time is accounted if the call was not made.
+ *
+ * @param ReplyMsg
+ *        Pointer to the pending reply of the finished call, if any.
+ *
+ * @param ReplyPort
+ *        Pointer to the port of the pending reply.
+ *
+ * @return None.
+ *
+ * @remarks If there are queued calls, the pending reply is sent first
+ *          so that its client doesn't wait for them.
+ *
+ *--*/
+VOID
+NTAPI
+CsrpEndApiCall(IN PCSR_API_QUEUE ApiQueue,
+               IN ULONG ApiId,
+               IN PLARGE_INTEGER StartTime OPTIONAL,
+               IN OUT PCSR_API_MESSAGE *ReplyMsg,
+               IN OUT PHANDLE ReplyPort)
+{
+    PCSR_API_REQUEST Request;
+    LARGE_INTEGER RequestStartTime, EndTime;
+    ULONG RequestApiId;
+    NTSTATUS Status;
+
+    if (StartTime) NtQueryPerformanceCounter(&EndTime, NULL);
+
+    RtlEnterCriticalSection(&ApiQueue->Lock);
+
+    if (StartTime)
+        CsrpAddApiCallTime(ApiQueue, ApiId, EndTime.QuadPart - StartTime->QuadPart);
+
+    while (!IsListEmpty(&ApiQueue->RequestList))
+    {
+        Request = CONTAINING_RECORD(RemoveHeadList(&ApiQueue->RequestList),
+                                    CSR_API_REQUEST,
+                                    ListEntry);
+        RtlLeaveCriticalSection(&ApiQueue->Lock);
+
+        /* Send the reply of the previous call now */
+        if (*ReplyMsg)
+        {
+            Status = NtReplyPort(*ReplyPort, &(*ReplyMsg)->Header);
+            if (!NT_SUCCESS(Status))
+                DPRINT1("CSRSS: Error while replying, Status 0x%lx\n", Status);
+
+            *ReplyMsg = NULL;
+            *ReplyPort = CsrApiPort;
+        }
+
+        /* Make the queued call, it replies by itself */
+        RequestApiId = Request->ApiId;
+        NtQueryPerformanceCounter(&RequestStartTime, NULL);
+        CsrpCallQueuedApi(Request);
+        NtQueryPerformanceCounter(&EndTime, NULL);
+        RtlFreeHeap(CsrHeap, 0, Request);
+
+        RtlEnterCriticalSection(&ApiQueue->Lock);
+        CsrpAddApiCallTime(ApiQueue,
+                           RequestApiId,
+                           EndTime.QuadPart - RequestStartTime.QuadPart);
+    }
+
+    /* Nothing left, this thread is free for any server again */
+    ApiQueue->ActiveThreads--;
+    RtlLeaveCriticalSection(&ApiQueue->Lock);
+}
+
 /*++
  * @name CsrApiRequestThread
  *
@@ -346,6 +744,8 @@ CsrApiRequestThread(IN PVOID Parameter)
     PDBGKM_MSG DebugMessage;
     ULONG ServerId, ApiId, MessageType, i;
     HANDLE ReplyPort;
+    PCSR_API_QUEUE ApiQueue;
+    LARGE_INTEGER StartTime;
 
     /* Setup LPC loop port and message */
     ReplyMsg = NULL;
@@ -763,7 +1163,7 @@ CsrApiRequestThread(IN PVOID Parameter)
         ApiId = CSR_API_NUMBER_TO_API_ID(ReceiveMsg.ApiNumber) - ServerDll->ApiBase;
 
         /* Make sure that the ID is within limits, and the entry exists */
-        if (ApiId >= ServerDll->HighestApiSupported)
+        if (ApiId >= CsrApiQueues[ServerId].ApiCount)
         {
             /* We are beyond the Maximum API ID, or it doesn't exist */
             DPRINT1("CSRSS: %lx is invalid ApiTableIndex for %Z\n",
@@ -791,6 +1191,16 @@ CsrApiRequestThread(IN PVOID Parameter)
         }
 #endif
 
+        /* Queue the call if its server already keeps enough threads busy */
+        ApiQueue = &CsrApiQueues[ServerId];
+        if (!CsrpBeginApiCall(ApiQueue, ServerDll, ApiId, CsrThread, &ReceiveMsg))
+        {
+            /* One of those threads will make the call and reply */
+            ReplyMsg = NULL;
+            ReplyPort = CsrApiPort;
+            continue;
+        }
+
         /* Assume success */
         ReplyMsg = &ReceiveMsg;
         ReceiveMsg.Status = STATUS_SUCCESS;
@@ -806,10 +1216,13 @@ CsrApiRequestThread(IN PVOID Parameter)
             {
                 /* Ignore this message if we failed to get the arguments */
                 CsrDereferenceThread(CsrThread);
+                CsrpEndApiCall(ApiQueue, ApiId, NULL, &ReplyMsg, &ReplyPort);
                 continue;
             }
         }
 
+        NtQueryPerformanceCounter(&StartTime, NULL);
+
         /* Validation complete, start SEH */
         _SEH2_TRY
         {
@@ -870,6 +1283,9 @@ CsrApiRequestThread(IN PVOID Parameter)
             ReplyPort = CsrApiPort;
         }
         _SEH2_END;
+
+        /* Account for the call, and make the ones queued meanwhile */
+        CsrpEndApiCall(ApiQueue, ApiId, &StartTime, &ReplyMsg, &ReplyPort);
     }
 
     /* We're out of the loop for some reason, terminate! */
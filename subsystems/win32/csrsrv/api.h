@@ -33,6 +33,30 @@ extern RTL_CRITICAL_SECTION CsrProcessLock, CsrWaitListsLock;
 
 #define CSR_SERVER_DLL_MAX  4
 
+//
+// A server can keep all the API threads busy but these,
+// so that calls to the other servers still get through.
+//
+#define CSR_API_RESERVED_THREADS    2
+
+typedef struct _CSR_API_REQUEST
+{
+    LIST_ENTRY ListEntry;
+    PCSR_THREAD CsrThread;
+    PCSR_SERVER_DLL ServerDll;
+    ULONG ApiId;
+    CSR_API_MESSAGE ApiMessage;
+} CSR_API_REQUEST, *PCSR_API_REQUEST;
+
+typedef struct _CSR_API_QUEUE
+{
+    RTL_CRITICAL_SECTION Lock;
+    LIST_ENTRY RequestList;         // Calls waiting for one of the active threads
+    ULONG ActiveThreads;            // API threads running calls of this server
+    ULONG ApiCount;                 // APIs of the server, HighestApiSupported - ApiBase
+    PCSR_API_STATISTICS Statistics; // Per-API counters, ApiCount entries
+} CSR_API_QUEUE, *PCSR_API_QUEUE;
+
 
 // Debug Flag
 extern ULONG CsrDebug;
@@ -53,6 +77,8 @@ extern PVOID *CsrSrvSharedStaticServerData;
 extern HANDLE CsrInitializationEvent;
 extern PCSR_SERVER_DLL CsrLoadedServerDll[CSR_SERVER_DLL_MAX];
 extern ULONG CsrMaxApiRequestThreads;
+extern CSR_API_QUEUE CsrApiQueues[CSR_SERVER_DLL_MAX];
+extern LARGE_INTEGER CsrApiPerformanceFrequency;
 
 /****************************************************/
 extern UNICODE_STRING CsrSbApiPortName;
@@ -68,6 +94,7 @@ CSR_API(CsrSrvClientConnect);
 CSR_API(CsrSrvUnusedFunction);
 CSR_API(CsrSrvIdentifyAlertableThread);
 CSR_API(CsrSrvSetPriorityClass);
+CSR_API(CsrSrvQueryApiStatistics);
 
 
 NTSTATUS
@@ -84,6 +111,10 @@ VOID
 NTAPI
 CsrReleaseCapturedArguments(IN PCSR_API_MESSAGE ApiMessage);
 
+NTSTATUS
+NTAPI
+CsrInitializeApiQueue(IN PCSR_SERVER_DLL ServerDll);
+
 NTSTATUS
 NTAPI
 CsrLoadServerDll(IN PCHAR DllString,
@@ -30,7 +30,8 @@ PCSR_API_ROUTINE CsrServerApiDispatchTable[CsrpMaxApiNumber] =
     CsrSrvUnusedFunction,
     CsrSrvUnusedFunction,
     CsrSrvIdentifyAlertableThread,
-    CsrSrvSetPriorityClass
+    CsrSrvSetPriorityClass,
+    CsrSrvQueryApiStatistics
 };
 
 BOOLEAN CsrServerApiServerValidTable[CsrpMaxApiNumber] =
@@ -39,7 +40,8 @@ BOOLEAN CsrServerApiServerValidTable[CsrpMaxApiNumber] =
     FALSE,
     TRUE,
     TRUE,
-    TRUE
+    TRUE,
+    FALSE
 };
 
 /*
@@ -53,7 +55,8 @@ PCHAR CsrServerApiNameTable[CsrpMaxApiNumber] =
     "ThreadConnect",
     "ProfileControl",
     "IdentifyAlertableThread",
-    "SetPriorityClass"
+    "SetPriorityClass",
+    "QueryApiStatistics"
 };
 #endif
 
@@ -230,6 +233,12 @@ CsrLoadServerDll(IN PCHAR DllString,
         }
         _SEH2_END;
 
+        if (NT_SUCCESS(Status))
+        {
+            /* Set up the API queue and statistics of the Server */
+            Status = CsrInitializeApiQueue(ServerDll);
+        }
+
         if (NT_SUCCESS(Status))
         {
             /*
@@ -552,6 +561,68 @@ CSR_API(CsrSrvSetPriorityClass)
     return STATUS_SUCCESS;
 }
 
+/*++
+ * @name CsrSrvQueryApiStatistics
+ *
+ * The CsrSrvQueryApiStatistics CSR API returns the call count and latency
+ * counters of every API of a Server DLL. This is a ReactOS debugging aid.
+ *
+ * @param ApiMessage
+ *        Pointer to the CSR API Message for this request.
+ *
+ * @param ReplyCode
+ *        Pointer to an optional reply to this request.
+ *
+ * @return STATUS_SUCCESS, STATUS_BUFFER_OVERFLOW if the caller's buffer
+ *         cannot hold an entry for every API of the Server DLL, or
+ *         STATUS_INVALID_PARAMETER.
+ *
+ * @remarks On return, ApiCount is the number of APIs of the Server DLL,
+ *          that is HighestApiSupported - ApiBase, and entry i of the
+ *          Statistics buffer is the API numbered ApiBase + i.
+ *
+ *--*/
+CSR_API(CsrSrvQueryApiStatistics)
+{
+    PCSR_QUERY_API_STATISTICS QueryRequest = &ApiMessage->Data.QueryApiStatistics;
+    PCSR_SERVER_DLL ServerDll;
+    PCSR_API_QUEUE ApiQueue;
+    ULONG ApiCount;
+
+    /* Make sure that the ID is within limits, and the Server DLL loaded */
+    if ((QueryRequest->ServerId >= CSR_SERVER_DLL_MAX) ||
+        (!(ServerDll = CsrLoadedServerDll[QueryRequest->ServerId])))
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    if (!CsrValidateMessageBuffer(ApiMessage,
+                                  (PVOID*)&QueryRequest->Statistics,
+                                  QueryRequest->ApiCount,
+                                  sizeof(CSR_API_STATISTICS)))
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    /* Copy as many entries as fit, under the lock so that they are consistent */
+    ApiQueue = &CsrApiQueues[QueryRequest->ServerId];
+    ApiCount = min(QueryRequest->ApiCount, ApiQueue->ApiCount);
+    RtlEnterCriticalSection(&ApiQueue->Lock);
+    if (ApiCount)
+    {
+        RtlCopyMemory(QueryRequest->Statistics,
+                      ApiQueue->Statistics,
+                      ApiCount * sizeof(CSR_API_STATISTICS));
+    }
+    RtlLeaveCriticalSection(&ApiQueue->Lock);
+
+    QueryRequest->ApiCount = ApiQueue->ApiCount;
+    QueryRequest->Frequency = CsrApiPerformanceFrequency;
+
+    return (ApiCount < ApiQueue->ApiCount) ? STATUS_BUFFER_OVERFLOW
+                                           : STATUS_SUCCESS;
+}
+
 /*++
  * @name CsrSrvUnusedFunction
  * @implemented NT4
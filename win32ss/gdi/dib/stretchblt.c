@@ -13,6 +13,137 @@
 #define NDEBUG
 #include <debug.h>
 
+static ULONG DIB_ReadSpanPixel(PBYTE pjLine, ULONG iFormat, LONG x)
+{
+  switch (iFormat)
+  {
+  case BMF_8BPP: return pjLine[x];
+  case BMF_16BPP: return ((PUSHORT)pjLine)[x];
+  case BMF_24BPP: pjLine += x * 3; return pjLine[0] | (pjLine[1] << 8) | (pjLine[2] << 16);
+  default: return ((PULONG)pjLine)[x];
+  }
+}
+
+/*
+ * Fast path for SRCCOPY stretching between 8, 16, 24 and 32 bpp surfaces
+ * without a mask. The source column of every destination pixel is computed
+ * once, each source row is translated into a span of destination colors and
+ * destination rows that map to the same source row are copied. The result
+ * is identical to the per pixel loop below.
+ */
+static BOOLEAN DIB_StretchBltSrcCopySpans(SURFOBJ *DestSurf, SURFOBJ *SourceSurf,
+                                          RECTL *DestRect, RECTL *SourceRect,
+                                          XLATEOBJ *ColorTranslation)
+{
+  LONG DstWidth = DestRect->right - DestRect->left;
+  LONG DstHeight = DestRect->bottom - DestRect->top;
+  LONG SrcWidth = SourceRect->right - SourceRect->left;
+  LONG SrcHeight = SourceRect->bottom - SourceRect->top;
+  ULONG iSrcFormat = SourceSurf->iBitmapFormat;
+  ULONG iDstFormat = DestSurf->iBitmapFormat;
+  ULONG cjDstPixel, SrcPixel, Color = 0, LastSrcPixel = 0;
+  BOOLEAN HaveLastPixel;
+  PFN_XLATE pfnXlate = NULL;
+  PLONG plSrcX;
+  PULONG pulSpan;
+  PBYTE pjSrcLine, pjDstLine, pjPrevDstLine = NULL;
+  LONG x, DesY, sy, PrevSy = -1;
+
+  /* Only handle the common formats */
+  if ((iSrcFormat != BMF_8BPP && iSrcFormat != BMF_16BPP &&
+       iSrcFormat != BMF_24BPP && iSrcFormat != BMF_32BPP) ||
+      (iDstFormat != BMF_8BPP && iDstFormat != BMF_16BPP &&
+       iDstFormat != BMF_24BPP && iDstFormat != BMF_32BPP))
+  {
+    return FALSE;
+  }
+
+  /* The source rectangle must be ordered and lie within the source bitmap */
+  if (DstWidth <= 0 || DstHeight <= 0 || SrcWidth <= 0 || SrcHeight <= 0 ||
+      SourceRect->left < 0 || SourceRect->top < 0 ||
+      SourceRect->right > SourceSurf->sizlBitmap.cx ||
+      SourceRect->bottom > SourceSurf->sizlBitmap.cy)
+  {
+    return FALSE;
+  }
+
+  /* Stretching within one surface relies on the per pixel read/write order */
+  if (SourceSurf->pvScan0 == DestSurf->pvScan0)
+    return FALSE;
+
+  plSrcX = ExAllocatePoolWithTag(PagedPool, DstWidth * (sizeof(LONG) + sizeof(ULONG)), TAG_DIB);
+  if (!plSrcX)
+    return FALSE;
+  pulSpan = (PULONG)(plSrcX + DstWidth);
+
+  for (x = 0; x < DstWidth; x++)
+    plSrcX[x] = SourceRect->left + x * SrcWidth / DstWidth;
+
+  if (ColorTranslation && !(ColorTranslation->flXlate & XO_TRIVIAL))
+    pfnXlate = XLATEOBJ_pfnXlate(ColorTranslation);
+
+  cjDstPixel = BitsPerFormat(iDstFormat) / 8;
+
+  for (DesY = DestRect->top; DesY < DestRect->bottom; DesY++)
+  {
+    sy = SourceRect->top + (DesY - DestRect->top) * SrcHeight / DstHeight;
+    pjDstLine = (PBYTE)DestSurf->pvScan0 + DesY * DestSurf->lDelta +
+                DestRect->left * cjDstPixel;
+
+    /* Same source row as before, reuse the row we just wrote */
+    if (sy == PrevSy)
+    {
+      RtlCopyMemory(pjDstLine, pjPrevDstLine, DstWidth * cjDstPixel);
+      continue;
+    }
+
+    /* Translate the source pixels of this row into a span */
+    pjSrcLine = (PBYTE)SourceSurf->pvScan0 + sy * SourceSurf->lDelta;
+    HaveLastPixel = FALSE;
+    for (x = 0; x < DstWidth; x++)
+    {
+      SrcPixel = DIB_ReadSpanPixel(pjSrcLine, iSrcFormat, plSrcX[x]);
+      if (!HaveLastPixel || SrcPixel != LastSrcPixel)
+      {
+        Color = pfnXlate ? pfnXlate((PEXLATEOBJ)ColorTranslation, SrcPixel) : SrcPixel;
+        LastSrcPixel = SrcPixel;
+        HaveLastPixel = TRUE;
+      }
+      pulSpan[x] = Color;
+    }
+
+    /* Store the span in the destination format */
+    switch (iDstFormat)
+    {
+    case BMF_8BPP:
+      for (x = 0; x < DstWidth; x++)
+        pjDstLine[x] = (BYTE)pulSpan[x];
+      break;
+    case BMF_16BPP:
+      for (x = 0; x < DstWidth; x++)
+        ((PUSHORT)pjDstLine)[x] = (USHORT)pulSpan[x];
+      break;
+    case BMF_24BPP:
+      for (x = 0; x < DstWidth; x++)
+      {
+        pjDstLine[x * 3] = (BYTE)pulSpan[x];
+        pjDstLine[x * 3 + 1] = (BYTE)(pulSpan[x] >> 8);
+        pjDstLine[x * 3 + 2] = (BYTE)(pulSpan[x] >> 16);
+      }
+      break;
+    default:
+      RtlCopyMemory(pjDstLine, pulSpan, DstWidth * sizeof(ULONG));
+      break;
+    }
+
+    PrevSy = sy;
+    pjPrevDstLine = pjDstLine;
+  }
+
+  ExFreePoolWithTag(plSrcX, TAG_DIB);
+  return TRUE;
+}
+
 BOOLEAN DIB_XXBPP_StretchBlt(SURFOBJ *DestSurf, SURFOBJ *SourceSurf, SURFOBJ *MaskSurf,
                             SURFOBJ *PatternSurface,
                             RECTL *DestRect, RECTL *SourceRect,
@@ -50,6 +181,13 @@ BOOLEAN DIB_XXBPP_StretchBlt(SURFOBJ *DestSurf, SURFOBJ *SourceSurf, SURFOBJ *Ma
 
   ASSERT(IS_VALID_ROP4(ROP));
 
+  if (ROP == ROP4_SRCCOPY && !MaskSurf &&
+      DIB_StretchBltSrcCopySpans(DestSurf, SourceSurf, DestRect, SourceRect,
+                                 ColorTranslation))
+  {
+    return TRUE;
+  }
+
   fnDest_GetPixel = DibFunctionsForBitmapFormat[DestSurf->iBitmapFormat].DIB_GetPixel;
   fnDest_PutPixel = DibFunctionsForBitmapFormat[DestSurf->iBitmapFormat].DIB_PutPixel;
 
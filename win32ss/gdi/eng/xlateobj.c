@@ -599,6 +599,15 @@ EXLATEOBJ_vInitialize(
             pexlo->pfnXlate = EXLATEOBJ_iXlateTrivial;
     }
 
+    /* Per pixel lookups into an indexed palette go through its inverse table */
+    if ((pexlo->pfnXlate == EXLATEOBJ_iXlateRGBtoPal) ||
+        (pexlo->pfnXlate == EXLATEOBJ_iXlateBitfieldsToPal) ||
+        (pexlo->pfnXlate == EXLATEOBJ_iXlate555toPal) ||
+        (pexlo->pfnXlate == EXLATEOBJ_iXlate565toPal))
+    {
+        PALETTE_vPrepareInverseTable(ppalDst);
+    }
+
     /* Check for trivial xlate */
     if (pexlo->pfnXlate == EXLATEOBJ_iXlateTrivial)
         pexlo->xlo.flXlate = XO_TRIVIAL;
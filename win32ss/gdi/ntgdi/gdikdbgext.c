@@ -69,6 +69,7 @@ KdbCommand_Gdi_help(VOID)
              "- handle <handle> - Displays information about a handle\n"
              "- entry <entry> - Displays an ENTRY, <entry> can be a pointer or index\n"
              "- baseobject <object> - Displays a BASEOBJECT\n"
+             "- userlock - Displays the USER lock counters\n"
 #if DBG_ENABLE_EVENT_LOGGING
              "- eventlist <object> - Displays the eventlist for an object\n"
 #endif
@@ -278,6 +279,23 @@ KdbCommand_Gdi_baseobject(char *argv)
 {
 }
 
+static
+VOID
+KdbCommand_Gdi_userlock(VOID)
+{
+    /* Times are kept in 100ns units, show them in ms */
+    DbgPrint("USER lock:\n"
+             "  Shared:    %lu acquired, %lu waited, %I64u ms waiting\n"
+             "  Exclusive: %lu acquired, %lu waited, %I64u ms waiting, %I64u ms held\n",
+             gUserLockStats.SharedAcquires,
+             gUserLockStats.SharedContentions,
+             gUserLockStats.SharedWaitTime / 10000,
+             gUserLockStats.ExclusiveAcquires,
+             gUserLockStats.ExclusiveContentions,
+             gUserLockStats.ExclusiveWaitTime / 10000,
+             gUserLockStats.ExclusiveHoldTime / 10000);
+}
+
 #if DBG_ENABLE_EVENT_LOGGING
 static
 VOID
@@ -347,6 +365,10 @@ DbgGdiKdbgCliCallback(
     {
         KdbCommand_Gdi_baseobject(argv[1]);
     }
+    else if (stricmp(argv[0], "!gdi.userlock") == 0)
+    {
+        KdbCommand_Gdi_userlock();
+    }
 #if DBG_ENABLE_EVENT_LOGGING
     else if (stricmp(argv[0], "!gdi.eventlist") == 0)
     {
@@ -15,6 +15,11 @@
 #define PAL_SETPOWNER 0x8000
 #define MAX_PALCOLORS 65536
 
+/* Inverse table entries: valid bit, generation, low 3 bits of each component, index */
+#define INVERSE_TABLE_SIZE 0x8000
+#define INVERSE_ENTRY_VALID 0x80000000
+#define INVERSE_ENTRY_GENERATION(lGeneration) (((ULONG)(lGeneration) & 0x3F) << 25)
+
 static UINT SystemPaletteUse = SYSPAL_NOSTATIC;  /* The program need save the pallete and restore it */
 
 PALETTE gpalRGB, gpalBGR, gpalRGB555, gpalRGB565, *gppalMono, *gppalDefault;
@@ -240,6 +245,10 @@ PALETTE_vCleanup(PVOID ObjectBody)
     {
         ExFreePoolWithTag(pPal->IndexedColors, TAG_PALETTE);
     }
+    if (pPal->pulInverse)
+    {
+        ExFreePoolWithTag(pPal->pulInverse, TAG_PALETTE);
+    }
 }
 
 INT
@@ -256,9 +265,9 @@ PALETTE_GetObject(PPALETTE ppal, INT cbCount, LPLOGBRUSH lpBuffer)
     return sizeof(WORD);
 }
 
+static
 ULONG
-NTAPI
-PALETTE_ulGetNearestPaletteIndex(PALETTE* ppal, ULONG iColor)
+PALETTE_ulSearchNearestPaletteIndex(PALETTE* ppal, ULONG iColor)
 {
     ULONG ulDiff, ulColorDiff, ulMinimalDiff = 0xFFFFFF;
     ULONG i, ulBestIndex = 0;
@@ -289,6 +298,94 @@ PALETTE_ulGetNearestPaletteIndex(PALETTE* ppal, ULONG iColor)
     return ulBestIndex;
 }
 
+ULONG
+NTAPI
+PALETTE_ulGetNearestPaletteIndex(PALETTE* ppal, ULONG iColor)
+{
+    PULONG pulInverse = ppal->pulInverse;
+    ULONG iSlot, ulTag, ulEntry, ulIndex;
+    LONG lGeneration;
+
+    /* Search the palette, if there is no up to date inverse table */
+    lGeneration = InterlockedCompareExchange(&ppal->lInverseGeneration, 0, 0);
+    if (!pulInverse || ppal->lInverseValidGeneration != lGeneration)
+        return PALETTE_ulSearchNearestPaletteIndex(ppal, iColor);
+
+    /* The slot is the 15 bit color, the rest of the color is the tag */
+    iSlot = ((iColor >> 3) & 0x001F) |
+            ((iColor >> 6) & 0x03E0) |
+            ((iColor >> 9) & 0x7C00);
+    ulTag = INVERSE_ENTRY_VALID |
+            INVERSE_ENTRY_GENERATION(lGeneration) |
+            ((iColor & 0x07) << 16) |
+            ((iColor & 0x0700) << 11) |
+            ((iColor & 0x070000) << 6);
+
+    /* Check if we already know the index for this color */
+    ulEntry = pulInverse[iSlot];
+    if ((ulEntry & 0xFFFF0000) == ulTag)
+        return ulEntry & 0xFFFF;
+
+    /* Search it and remember the result */
+    ulIndex = PALETTE_ulSearchNearestPaletteIndex(ppal, iColor);
+    ulEntry = ulTag | ulIndex;
+    InterlockedExchange((PLONG)&pulInverse[iSlot], ulEntry);
+
+    /*
+     * If the colors changed meanwhile, the table may already have been cleared
+     * for the new ones. Take our entry back rather than leave it there stale,
+     * its generation bits keep lookups from using it until then.
+     */
+    if (ppal->lInverseGeneration != lGeneration)
+        InterlockedCompareExchange((PLONG)&pulInverse[iSlot], 0, ulEntry);
+
+    return ulIndex;
+}
+
+VOID
+NTAPI
+PALETTE_vPrepareInverseTable(PPALETTE ppal)
+{
+    PULONG pulInverse;
+    LONG lGeneration;
+
+    ASSERT(ppal->flFlags & PAL_INDEXED);
+
+    /* The generation we clear the table for, later changes make it dirty again */
+    lGeneration = InterlockedCompareExchange(&ppal->lInverseGeneration, 0, 0);
+
+    /* Allocate the table on first use */
+    if (!ppal->pulInverse)
+    {
+        pulInverse = ExAllocatePoolWithTag(PagedPool,
+                                           INVERSE_TABLE_SIZE * sizeof(ULONG),
+                                           TAG_PALETTE);
+        if (!pulInverse) return;
+
+        RtlZeroMemory(pulInverse, INVERSE_TABLE_SIZE * sizeof(ULONG));
+        if (InterlockedCompareExchangePointer((PVOID*)&ppal->pulInverse,
+                                              pulInverse,
+                                              NULL) != NULL)
+        {
+            /* Someone else was faster */
+            ExFreePoolWithTag(pulInverse, TAG_PALETTE);
+        }
+        else
+        {
+            /* Our empty table is good for the colors we started with */
+            InterlockedExchange(&ppal->lInverseValidGeneration, lGeneration);
+            return;
+        }
+    }
+
+    /* Forget all cached indices, if the palette entries changed */
+    if (ppal->lInverseValidGeneration != lGeneration)
+    {
+        RtlZeroMemory(ppal->pulInverse, INVERSE_TABLE_SIZE * sizeof(ULONG));
+        InterlockedExchange(&ppal->lInverseValidGeneration, lGeneration);
+    }
+}
+
 ULONG
 NTAPI
 PALETTE_ulGetNearestBitFieldsIndex(PALETTE* ppal, ULONG ulColor)
@@ -776,6 +873,7 @@ IntGdiRealizePalette(HDC hDC)
     {
         InterlockedExchange((LONG*)&ppalSurf->IndexedColors[i], *(LONG*)&ppalDC->IndexedColors[i]);
     }
+    PALETTE_vInvalidateInverseTable(ppalSurf);
 
 cleanup:
     DC_UnlockDc(pdc);
@@ -818,6 +916,7 @@ IntAnimatePalette(HPALETTE hPal,
                 PALETTE_ValidateFlags(&palPtr->IndexedColors[StartIndex], 1);
             }
         }
+        PALETTE_vInvalidateInverseTable(palPtr);
 
         PALETTE_ShareUnlockPalette(palPtr);
 
@@ -985,6 +1084,7 @@ IntSetPaletteEntries(
         Entries = numEntries - Start;
     }
     memcpy(palGDI->IndexedColors + Start, pe, Entries * sizeof(PALETTEENTRY));
+    PALETTE_vInvalidateInverseTable(palGDI);
     PALETTE_ShareUnlockPalette(palGDI);
 
     return Entries;
@@ -1044,6 +1144,7 @@ GreGetSetColorTable(
                 ppal->IndexedColors[i].peGreen = prgbColors->rgbGreen;
                 ppal->IndexedColors[i].peBlue = prgbColors->rgbBlue;
             }
+            PALETTE_vInvalidateInverseTable(ppal);
 
             /* Mark the dc brushes invalid */
             pdc->pdcattr->ulDirty_ |= DIRTY_FILL|DIRTY_LINE|
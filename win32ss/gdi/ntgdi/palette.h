@@ -47,6 +47,9 @@ typedef struct _PALETTE
     ULONG ulGreenShift;
     ULONG ulBlueShift;
     HDEV  hPDev;
+    PULONG pulInverse; // Lazily built 15 bit RGB to index cache
+    volatile LONG lInverseGeneration; // Bumped whenever the colors change
+    volatile LONG lInverseValidGeneration; // Generation pulInverse was cleared for
     PALETTEENTRY apalColors[0];
 } PALETTE, *PPALETTE;
 
@@ -114,6 +117,11 @@ PALETTE_ulGetNearestBitFieldsIndex(
     PPALETTE ppal,
     ULONG ulColor);
 
+VOID
+NTAPI
+PALETTE_vPrepareInverseTable(
+    PPALETTE ppal);
+
 VOID
 NTAPI
 PALETTE_vGetBitMasks(
@@ -146,6 +154,14 @@ PALETTE_ulGetRGBColorFromIndex(PPALETTE ppal, ULONG ulIndex)
                ppal->IndexedColors[ulIndex].peBlue);
 }
 
+FORCEINLINE
+VOID
+PALETTE_vInvalidateInverseTable(PPALETTE ppal)
+{
+    /* The inverse table is ignored until the next xlate rebuilds it */
+    InterlockedIncrement(&ppal->lInverseGeneration);
+}
+
 FORCEINLINE
 VOID
 PALETTE_vSetRGBColorForIndex(PPALETTE ppal, ULONG ulIndex, COLORREF crColor)
@@ -154,6 +170,7 @@ PALETTE_vSetRGBColorForIndex(PPALETTE ppal, ULONG ulIndex, COLORREF crColor)
     ppal->IndexedColors[ulIndex].peRed = GetRValue(crColor);
     ppal->IndexedColors[ulIndex].peGreen = GetGValue(crColor);
     ppal->IndexedColors[ulIndex].peBlue = GetBValue(crColor);
+    PALETTE_vInvalidateInverseTable(ppal);
 }
 
 HPALETTE
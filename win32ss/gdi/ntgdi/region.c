@@ -517,6 +517,20 @@ REGION_bAddRect(
     return TRUE;
 }
 
+/* Checks if prgnRect is a single rectangle that covers all of prgn */
+FORCEINLINE
+BOOL
+REGION_bRectCoversRgn(
+    _In_ PREGION prgnRect,
+    _In_ PREGION prgn)
+{
+    return (prgnRect->rdh.nCount == 1) &&
+           (prgnRect->rdh.rcBound.left <= prgn->rdh.rcBound.left) &&
+           (prgnRect->rdh.rcBound.top <= prgn->rdh.rcBound.top) &&
+           (prgn->rdh.rcBound.right <= prgnRect->rdh.rcBound.right) &&
+           (prgn->rdh.rcBound.bottom <= prgnRect->rdh.rcBound.bottom);
+}
+
 typedef BOOL (FASTCALL *overlapProcp)(PREGION, PRECT, PRECT, PRECT, PRECT, INT, INT);
 typedef BOOL (FASTCALL *nonOverlapProcp)(PREGION, PRECT, PRECT, INT, INT);
 
@@ -525,6 +539,13 @@ typedef BOOL (FASTCALL *nonOverlapProcp)(PREGION, PRECT, PRECT, INT, INT);
 
 #define RGN_DEFAULT_RECTS    2
 
+// In-place operations on regions up to this size copy the source rects to the
+// stack and write the result into the region's own buffer
+#define RGN_STACK_RECTS      16
+
+// A region buffer is only shrunk when it wastes more than this many rects
+#define RGN_SHRINK_SLACK     64
+
 // Used to allocate buffers for points and link the buffers together
 typedef struct _POINTBLOCK
 {
@@ -979,12 +1000,15 @@ REGION_RegionOp(
     RECTL *r2BandEnd;                  /* End of current band in r2 */
     ULONG top;                         /* Top of non-overlapping band */
     ULONG bot;                         /* Bottom of non-overlapping band */
+    ULONG oldSize;                     /* Size of newReg's old buffer */
+    ULONG usedSize;                    /* Size of the rects in the result */
+    RECTL stackRects[RGN_STACK_RECTS]; /* Copy of newReg's rects, if it is
+                                        * also a source region */
 
     /* Initialization:
      *  set r1, r2, r1End and r2End appropriately, preserve the important
      * parts of the destination region until the end in case it's one of
-     * the two source regions, then mark the "new" region empty, allocating
-     * another array of rectangles for it to use. */
+     * the two source regions, then mark the "new" region empty. */
     r1 = reg1->Buffer;
     r2 = reg2->Buffer;
     r1End = r1 + reg1->rdh.nCount;
@@ -994,22 +1018,56 @@ REGION_RegionOp(
      * note of its rects pointer (so that we can free them later), preserve its
      * extents and simply set numRects to zero. */
     oldRects = newReg->Buffer;
-    newReg->rdh.nCount = 0;
+    oldSize = newReg->rdh.nRgnSize;
+
+    /* A single rect stored in the extents can't be overwritten, the callers
+     * still need the extents. Otherwise try to reuse the buffer. */
+    if ((oldRects != &newReg->rdh.rcBound) &&
+        (newReg != reg1) && (newReg != reg2))
+    {
+        /* newReg is only the destination, its rects can be overwritten.
+         * The overlap functions grow the buffer if needed. */
+        oldRects = NULL;
+    }
+    else if ((oldRects != &newReg->rdh.rcBound) &&
+             (newReg->rdh.nCount <= RGN_STACK_RECTS))
+    {
+        /* In-place operation on a small region: work on a copy of the
+         * source rects and write the result into the existing buffer */
+        COPY_RECTS(stackRects, oldRects, newReg->rdh.nCount);
+        if (newReg == reg1)
+        {
+            r1 = stackRects;
+            r1End = r1 + reg1->rdh.nCount;
+        }
+        if (newReg == reg2)
+        {
+            r2 = stackRects;
+            r2End = r2 + reg2->rdh.nCount;
+        }
+        oldRects = NULL;
+    }
 
-    /* Allocate a reasonable number of rectangles for the new region. The idea
-     * is to allocate enough so the individual functions don't need to
-     * reallocate and copy the array, which is time consuming, yet we don't
-     * have to worry about using too much memory. I hope to be able to
-     * nuke the Xrealloc() at the end of this function eventually. */
-    newReg->rdh.nRgnSize = max(reg1->rdh.nCount + 1, reg2->rdh.nCount) * 2 * sizeof(RECT);
+    newReg->rdh.nCount = 0;
 
-    newReg->Buffer = ExAllocatePoolWithTag(PagedPool,
-                                           newReg->rdh.nRgnSize,
-                                           TAG_REGION);
-    if (newReg->Buffer == NULL)
+    if (oldRects != NULL)
     {
-        newReg->rdh.nRgnSize = 0;
-        return FALSE;
+        /* Allocate a reasonable number of rectangles for the new region. The
+         * idea is to allocate enough so the individual functions don't need
+         * to reallocate and copy the array, which is time consuming, yet we
+         * don't have to worry about using too much memory. */
+        newReg->rdh.nRgnSize = max(reg1->rdh.nCount + 1, reg2->rdh.nCount) * 2 * sizeof(RECT);
+
+        newReg->Buffer = ExAllocatePoolWithTag(PagedPool,
+                                               newReg->rdh.nRgnSize,
+                                               TAG_REGION);
+        if (newReg->Buffer == NULL)
+        {
+            /* Leave an empty region behind */
+            newReg->Buffer = oldRects;
+            newReg->rdh.nRgnSize = oldSize;
+            return FALSE;
+        }
     }
 
     /* Initialize ybot and ytop.
@@ -1181,18 +1239,18 @@ REGION_RegionOp(
 
     /* A bit of cleanup. To keep regions from growing without bound,
      * we shrink the array of rectangles to match the new number of
-     * rectangles in the region. This never goes to 0, however...
-     *
-     * Only do this stuff if the number of rectangles allocated is more than
-     * twice the number of rectangles in the region (a simple optimization...). */
-    if ((newReg->rdh.nRgnSize > (2 * newReg->rdh.nCount * sizeof(RECT))) &&
-        (newReg->rdh.nCount > 2))
+     * rectangles in the region. Buffers are reused by the next operation,
+     * so only do this when a sizeable part of the buffer is wasted. */
+    usedSize = newReg->rdh.nCount * sizeof(RECT);
+    if ((newReg->Buffer != &newReg->rdh.rcBound) &&
+        (newReg->rdh.nRgnSize > 2 * usedSize) &&
+        (newReg->rdh.nRgnSize - usedSize > RGN_SHRINK_SLACK * sizeof(RECT)))
     {
         if (REGION_NOT_EMPTY(newReg))
         {
             RECTL *prev_rects = newReg->Buffer;
             newReg->Buffer = ExAllocatePoolWithTag(PagedPool,
-                                                   newReg->rdh.nCount * sizeof(RECT),
+                                                   usedSize,
                                                    TAG_REGION);
 
             if (newReg->Buffer == NULL)
@@ -1201,30 +1259,23 @@ REGION_RegionOp(
             }
             else
             {
-                newReg->rdh.nRgnSize = newReg->rdh.nCount*sizeof(RECT);
+                newReg->rdh.nRgnSize = usedSize;
                 COPY_RECTS(newReg->Buffer, prev_rects, newReg->rdh.nCount);
-                if (prev_rects != &newReg->rdh.rcBound)
-                    ExFreePoolWithTag(prev_rects, TAG_REGION);
+                ExFreePoolWithTag(prev_rects, TAG_REGION);
             }
         }
         else
         {
-            /* No point in doing the extra work involved in an Xrealloc if
-             * the region is empty */
+            /* An empty region doesn't need a buffer of its own */
+            ExFreePoolWithTag(newReg->Buffer, TAG_REGION);
+            newReg->Buffer = &newReg->rdh.rcBound;
             newReg->rdh.nRgnSize = sizeof(RECT);
-            if (newReg->Buffer != &newReg->rdh.rcBound)
-                ExFreePoolWithTag(newReg->Buffer, TAG_REGION);
-
-            newReg->Buffer = ExAllocatePoolWithTag(PagedPool,
-                                                   sizeof(RECT),
-                                                   TAG_REGION);
-            ASSERT(newReg->Buffer);
         }
     }
 
     newReg->rdh.iType = RDH_RECTANGLES;
 
-    if (oldRects != &newReg->rdh.rcBound)
+    if ((oldRects != NULL) && (oldRects != &newReg->rdh.rcBound))
         ExFreePoolWithTag(oldRects, TAG_REGION);
     return TRUE;
 }
@@ -1308,6 +1359,8 @@ REGION_IntersectRegion(
     PREGION reg1,
     PREGION reg2)
 {
+    RECTL rcl;
+
     /* Check for trivial reject */
     if ((reg1->rdh.nCount == 0) ||
         (reg2->rdh.nCount == 0) ||
@@ -1315,6 +1368,26 @@ REGION_IntersectRegion(
     {
         newReg->rdh.nCount = 0;
     }
+    else if ((reg1->rdh.nCount == 1) && (reg2->rdh.nCount == 1))
+    {
+        /* Two overlapping rects intersect in a single rect */
+        RECTL_bIntersectRect(&rcl, &reg1->rdh.rcBound, &reg2->rdh.rcBound);
+        if (!REGION_bEnsureBufferSize(newReg, 1))
+            return FALSE;
+
+        newReg->Buffer[0] = rcl;
+        newReg->rdh.nCount = 1;
+        newReg->rdh.iType = RDH_RECTANGLES;
+    }
+    else if (REGION_bRectCoversRgn(reg1, reg2))
+    {
+        /* Clipping to a rect that contains the region changes nothing */
+        return REGION_CopyRegion(newReg, reg2);
+    }
+    else if (REGION_bRectCoversRgn(reg2, reg1))
+    {
+        return REGION_CopyRegion(newReg, reg1);
+    }
     else
     {
         if (!REGION_RegionOp(newReg,
@@ -1510,11 +1583,7 @@ REGION_UnionRegion(
     }
 
     /* Region 1 completely subsumes region 2 */
-    if ((reg1->rdh.nCount == 1) &&
-        (reg1->rdh.rcBound.left <= reg2->rdh.rcBound.left) &&
-        (reg1->rdh.rcBound.top <= reg2->rdh.rcBound.top) &&
-        (reg2->rdh.rcBound.right <= reg1->rdh.rcBound.right) &&
-        (reg2->rdh.rcBound.bottom <= reg1->rdh.rcBound.bottom))
+    if (REGION_bRectCoversRgn(reg1, reg2))
     {
         if (newReg != reg1)
         {
@@ -1525,11 +1594,7 @@ REGION_UnionRegion(
     }
 
     /* Region 2 completely subsumes region 1 */
-    if ((reg2->rdh.nCount == 1) &&
-        (reg2->rdh.rcBound.left <= reg1->rdh.rcBound.left) &&
-        (reg2->rdh.rcBound.top <= reg1->rdh.rcBound.top) &&
-        (reg1->rdh.rcBound.right <= reg2->rdh.rcBound.right) &&
-        (reg1->rdh.rcBound.bottom <= reg2->rdh.rcBound.bottom))
+    if (REGION_bRectCoversRgn(reg2, reg1))
     {
         if (newReg != reg2)
         {
@@ -1715,6 +1780,58 @@ REGION_SubtractO(
     return TRUE;
 }
 
+/*!
+ *      Subtract a rect from another, overlapping one. The result has at
+ *      most one band above, one beside and one below the subtrahend, and
+ *      none of them can be coalesced with another, so no banding pass is
+ *      needed.
+ *
+ * Results:
+ *      TRUE if successful.
+ *
+ * \note Side Effects:
+ *      prgnDest is overwritten, it may be the region holding either rect.
+ *
+ */
+static
+BOOL
+FASTCALL
+REGION_bSubtractRectFromRect(
+    _Inout_ PREGION prgnDest,
+    _In_ const RECTL *prclM,
+    _In_ const RECTL *prclS)
+{
+    RECTL rclM = *prclM;
+    RECTL rclS = *prclS;
+    LONG top, bottom;
+
+    NT_ASSERT(EXTENTCHECK(&rclM, &rclS));
+
+    prgnDest->rdh.nCount = 0;
+    if (!REGION_bEnsureBufferSize(prgnDest, 4))
+        return FALSE;
+
+    /* Band above the subtrahend */
+    if (rclS.top > rclM.top)
+        REGION_vAddRect(prgnDest, rclM.left, rclM.top, rclM.right, rclS.top);
+
+    /* Band beside it, left and right parts */
+    top = max(rclM.top, rclS.top);
+    bottom = min(rclM.bottom, rclS.bottom);
+    if (rclS.left > rclM.left)
+        REGION_vAddRect(prgnDest, rclM.left, top, rclS.left, bottom);
+    if (rclS.right < rclM.right)
+        REGION_vAddRect(prgnDest, rclS.right, top, rclM.right, bottom);
+
+    /* Band below it */
+    if (rclS.bottom < rclM.bottom)
+        REGION_vAddRect(prgnDest, rclM.left, rclS.bottom, rclM.right, rclM.bottom);
+
+    prgnDest->rdh.iType = RDH_RECTANGLES;
+    REGION_SetExtents(prgnDest);
+    return TRUE;
+}
+
 /*!
  *      Subtract regS from regM and leave the result in regD.
  *      S stands for subtrahend, M for minuend and D for difference.
@@ -1742,6 +1859,18 @@ REGION_SubtractRegion(
         return REGION_CopyRegion(regD, regM);
     }
 
+    /* Nothing is left when a rect covers the whole minuend */
+    if (REGION_bRectCoversRgn(regS, regM))
+    {
+        EMPTY_REGION(regD);
+        return TRUE;
+    }
+
+    if ((regM->rdh.nCount == 1) && (regS->rdh.nCount == 1))
+    {
+        return REGION_bSubtractRectFromRect(regD, &regM->rdh.rcBound, &regS->rdh.rcBound);
+    }
+
     if (!REGION_RegionOp(regD,
                     regM,
                     regS,
@@ -1770,40 +1899,47 @@ REGION_XorRegion(
     PREGION sra,
     PREGION srb)
 {
-    HRGN htra, htrb;
-    PREGION tra, trb;
+    REGION tra, trb;
     BOOL ret;
 
-    // FIXME: Don't use a handle
-    tra = REGION_AllocRgnWithHandle(sra->rdh.nCount + 1);
-    if (tra == NULL)
-    {
-        return FALSE;
-    }
-    htra = tra->BaseObject.hHmgr;
-
-    // FIXME: Don't use a handle
-    trb = REGION_AllocRgnWithHandle(srb->rdh.nCount + 1);
-    if (trb == NULL)
-    {
-        REGION_UnlockRgn(tra);
-        GreDeleteObject(htra);
-        return FALSE;
-    }
-    htrb = trb->BaseObject.hHmgr;
-
-    ret = REGION_SubtractRegion(tra, sra, srb) &&
-          REGION_SubtractRegion(trb, srb, sra) &&
-          REGION_UnionRegion(dr, tra, trb);
-    REGION_UnlockRgn(tra);
-    REGION_UnlockRgn(trb);
-
-    GreDeleteObject(htra);
-    GreDeleteObject(htrb);
+    /* The temporary regions never need a handle, keep them on the stack */
+    tra.Buffer = &tra.rdh.rcBound;
+    tra.rdh.nRgnSize = sizeof(RECT);
+    EMPTY_REGION(&tra);
+    trb.Buffer = &trb.rdh.rcBound;
+    trb.rdh.nRgnSize = sizeof(RECT);
+    EMPTY_REGION(&trb);
+
+    ret = REGION_SubtractRegion(&tra, sra, srb) &&
+          REGION_SubtractRegion(&trb, srb, sra) &&
+          REGION_UnionRegion(dr, &tra, &trb);
+
+    if (tra.Buffer != &tra.rdh.rcBound)
+        ExFreePoolWithTag(tra.Buffer, TAG_REGION);
+    if (trb.Buffer != &trb.rdh.rcBound)
+        ExFreePoolWithTag(trb.Buffer, TAG_REGION);
     return ret;
 }
 
 
+/*!
+ * Sets up a region on the stack holding a single rect, without a buffer
+ * of its own. Like REGION_SetRectRgn, an empty rect gives an empty region.
+ */
+static
+VOID
+REGION_vInitLocalRectRgn(
+    _Out_ PREGION prgn,
+    _In_ const RECTL *prcl)
+{
+    prgn->Buffer = &prgn->rdh.rcBound;
+    prgn->rdh.nRgnSize = sizeof(RECT);
+    prgn->rdh.iType = RDH_RECTANGLES;
+    prgn->rdh.rcBound = *prcl;
+    RECTL_vMakeWellOrdered(&prgn->rdh.rcBound);
+    prgn->rdh.nCount = RECTL_bIsEmptyRect(&prgn->rdh.rcBound) ? 0 : 1;
+}
+
 /*!
  * Adds a rectangle to a REGION
  */
@@ -1831,14 +1967,25 @@ REGION_SubtractRectFromRgn(
 {
     REGION rgnLocal;
 
-    rgnLocal.Buffer = &rgnLocal.rdh.rcBound;
-    rgnLocal.rdh.nCount = 1;
-    rgnLocal.rdh.nRgnSize = sizeof(RECT);
-    rgnLocal.rdh.rcBound = *prcl;
+    REGION_vInitLocalRectRgn(&rgnLocal, prcl);
     REGION_SubtractRegion(prgnDest, prgnSrc, &rgnLocal);
     return REGION_Complexity(prgnDest);
 }
 
+INT
+FASTCALL
+REGION_IntersectRectWithRgn(
+    PREGION prgnDest,
+    PREGION prgnSrc,
+    const RECTL *prcl)
+{
+    REGION rgnLocal;
+
+    REGION_vInitLocalRectRgn(&rgnLocal, prcl);
+    REGION_IntersectRegion(prgnDest, prgnSrc, &rgnLocal);
+    return REGION_Complexity(prgnDest);
+}
+
 BOOL
 FASTCALL
 REGION_bCopy(
@@ -2897,7 +2897,7 @@ NtUserGetWOWClass(
         return FALSE;
     }
 
-    UserEnterExclusive();
+    UserEnterShared();
 
     pi = GetW32ProcessInfo();
 
@@ -16,6 +16,8 @@ PTHREADINFO gptiCurrent = NULL;
 PPROCESSINFO gppiInputProvider = NULL;
 BOOL g_AlwaysDisplayVersion = FALSE;
 ERESOURCE UserLock;
+USER_LOCK_STATS gUserLockStats;
+static ULONGLONG gUserLockExclusiveSince;
 ATOM AtomMessage;       // Window Message atom.
 ATOM AtomWndObj;        // Window Object atom.
 ATOM AtomLayer;         // Window Layer atom.
@@ -240,15 +242,43 @@ VOID FASTCALL CleanupUserImpl(VOID)
 
 VOID FASTCALL UserEnterShared(VOID)
 {
+    ULONGLONG WaitStart;
+
     KeEnterCriticalRegion();
-    ExAcquireResourceSharedLite(&UserLock, TRUE);
+
+    /* Only time the acquisitions that actually have to wait */
+    if (!ExAcquireResourceSharedLite(&UserLock, FALSE))
+    {
+        WaitStart = KeQueryInterruptTime();
+        ExAcquireResourceSharedLite(&UserLock, TRUE);
+        InterlockedIncrement(&gUserLockStats.SharedContentions);
+        InterlockedExchangeAdd64(&gUserLockStats.SharedWaitTime,
+                                 KeQueryInterruptTime() - WaitStart);
+    }
+    InterlockedIncrement(&gUserLockStats.SharedAcquires);
 }
 
 VOID FASTCALL UserEnterExclusive(VOID)
 {
+    ULONGLONG WaitStart;
+
     ASSERT_NOGDILOCKS();
     KeEnterCriticalRegion();
-    ExAcquireResourceExclusiveLite(&UserLock, TRUE);
+
+    if (!ExAcquireResourceExclusiveLite(&UserLock, FALSE))
+    {
+        WaitStart = KeQueryInterruptTime();
+        ExAcquireResourceExclusiveLite(&UserLock, TRUE);
+        InterlockedIncrement(&gUserLockStats.ExclusiveContentions);
+        InterlockedExchangeAdd64(&gUserLockStats.ExclusiveWaitTime,
+                                 KeQueryInterruptTime() - WaitStart);
+    }
+    InterlockedIncrement(&gUserLockStats.ExclusiveAcquires);
+
+    /* Only the outermost acquisition starts the hold time */
+    if (ExIsResourceAcquiredSharedLite(&UserLock) == 1)
+        gUserLockExclusiveSince = KeQueryInterruptTime();
+
     gptiCurrent = PsGetCurrentThreadWin32Thread();
 }
 
@@ -256,6 +286,14 @@ VOID FASTCALL UserLeave(VOID)
 {
     ASSERT_NOGDILOCKS();
     ASSERT(UserIsEntered());
+
+    /* We still own the lock, nobody else updates the hold time */
+    if (ExIsResourceAcquiredExclusiveLite(&UserLock) &&
+        ExIsResourceAcquiredSharedLite(&UserLock) == 1)
+    {
+        gUserLockStats.ExclusiveHoldTime += KeQueryInterruptTime() - gUserLockExclusiveSince;
+    }
+
     ExReleaseResourceLite(&UserLock);
     KeLeaveCriticalRegion();
 }
@@ -9,6 +9,19 @@
 #define UserEnterCo UserEnterExclusive
 #define UserLeaveCo UserLeave
 
+/* Counters for the USER lock, times are in 100ns units */
+typedef struct _USER_LOCK_STATS
+{
+    LONG SharedAcquires;
+    LONG ExclusiveAcquires;
+    LONG SharedContentions;
+    LONG ExclusiveContentions;
+    LONGLONG SharedWaitTime;
+    LONGLONG ExclusiveWaitTime;
+    LONGLONG ExclusiveHoldTime;
+} USER_LOCK_STATS, *PUSER_LOCK_STATS;
+
+extern USER_LOCK_STATS gUserLockStats;
 extern PSERVERINFO gpsi;
 extern PTHREADINFO gptiCurrent;
 extern PPROCESSINFO gppiList;
@@ -14,7 +14,17 @@ DBG_DEFAULT_CHANNEL(UserTimer);
 /* GLOBALS *******************************************************************/
 
 static LIST_ENTRY TimersListHead;
-static LONG TimeLast = 0;
+
+/* Timers are looked up by (window, id) through a hash table */
+#define TIMER_HASH_SIZE 256
+static LIST_ENTRY TimersHashTable[TIMER_HASH_SIZE];
+
+/* Running timers are kept in a binary min-heap ordered by due time, so the
+   master timer only fires when the earliest timer expires */
+#define TIMER_HEAP_INITIAL_SIZE 64
+static PTIMER *TimerHeap;
+static ULONG TimerHeapCount;
+static ULONG TimerHeapSize;
 
 /* Windows 2000 has room for 32768 window-less timers */
 #define NUM_WINDOW_LESS_TIMERS   32768
@@ -45,7 +55,157 @@ ERESOURCE TimerLock;
 }
 
 
+#define TimerDueBefore(TmrA, TmrB) \
+  ((LONG)((TmrA)->DueTime - (TmrB)->DueTime) < 0)
+
 /* FUNCTIONS *****************************************************************/
+
+static
+PLIST_ENTRY
+FASTCALL
+TimerHashBucket(PWND Window, UINT_PTR nID)
+{
+  ULONG_PTR Hash = ((ULONG_PTR)Window >> 4) ^ (nID * 0x9E3779B1);
+
+  return &TimersHashTable[(Hash ^ (Hash >> 8)) % TIMER_HASH_SIZE];
+}
+
+static
+VOID
+FASTCALL
+TimerHeapSet(ULONG Index, PTIMER pTmr)
+{
+  TimerHeap[Index] = pTmr;
+  pTmr->iHeap = Index;
+}
+
+static
+VOID
+FASTCALL
+TimerHeapSiftUp(ULONG Index)
+{
+  PTIMER pTmr = TimerHeap[Index];
+  ULONG Parent;
+
+  while (Index > 0)
+  {
+     Parent = (Index - 1) / 2;
+     if (!TimerDueBefore(pTmr, TimerHeap[Parent]))
+        break;
+
+     TimerHeapSet(Index, TimerHeap[Parent]);
+     Index = Parent;
+  }
+  TimerHeapSet(Index, pTmr);
+}
+
+static
+VOID
+FASTCALL
+TimerHeapSiftDown(ULONG Index)
+{
+  PTIMER pTmr = TimerHeap[Index];
+  ULONG Child;
+
+  for (;;)
+  {
+     Child = 2 * Index + 1;
+     if (Child >= TimerHeapCount)
+        break;
+     if ((Child + 1 < TimerHeapCount) &&
+         TimerDueBefore(TimerHeap[Child + 1], TimerHeap[Child]))
+        Child++;
+     if (!TimerDueBefore(TimerHeap[Child], pTmr))
+        break;
+
+     TimerHeapSet(Index, TimerHeap[Child]);
+     Index = Child;
+  }
+  TimerHeapSet(Index, pTmr);
+}
+
+static
+BOOL
+FASTCALL
+TimerHeapInsert(PTIMER pTmr)
+{
+  PTIMER *NewHeap;
+  ULONG NewSize;
+
+  ASSERT(pTmr->iHeap == TIMER_NOT_QUEUED);
+
+  if (TimerHeapCount == TimerHeapSize)
+  {
+     NewSize = TimerHeapSize * 2;
+     NewHeap = ExAllocatePoolWithTag(PagedPool, NewSize * sizeof(PTIMER), USERTAG_TIMER);
+     if (!NewHeap)
+     {
+        ERR("Unable to grow the timer heap\n");
+        return FALSE;
+     }
+     RtlCopyMemory(NewHeap, TimerHeap, TimerHeapCount * sizeof(PTIMER));
+     ExFreePoolWithTag(TimerHeap, USERTAG_TIMER);
+     TimerHeap = NewHeap;
+     TimerHeapSize = NewSize;
+  }
+
+  TimerHeap[TimerHeapCount] = pTmr;
+  TimerHeapSiftUp(TimerHeapCount++);
+  return TRUE;
+}
+
+static
+VOID
+FASTCALL
+TimerHeapRemove(PTIMER pTmr)
+{
+  ULONG Index = pTmr->iHeap;
+  PTIMER pLast;
+
+  if (Index == TIMER_NOT_QUEUED)
+     return;
+
+  ASSERT(TimerHeap[Index] == pTmr);
+  pTmr->iHeap = TIMER_NOT_QUEUED;
+
+  pLast = TimerHeap[--TimerHeapCount];
+  if (pLast != pTmr)
+  {
+     /* Move the last timer into the hole, then restore the heap order */
+     TimerHeapSet(Index, pLast);
+     TimerHeapSiftUp(Index);
+     TimerHeapSiftDown(pLast->iHeap);
+  }
+}
+
+//
+// Program the master timer for the earliest due timer.
+//
+static
+VOID
+FASTCALL
+TimerArmMasterTimer(ULONG Time)
+{
+  LARGE_INTEGER DueTime;
+  LONG Delay;
+
+  ASSERT(MasterTimer != NULL);
+
+  if (TimerHeapCount == 0)
+  {
+     /* Nothing to wait for, but KeSetTimer keeps the timer unsignaled */
+     Delay = USER_TIMER_MAXIMUM;
+  }
+  else
+  {
+     Delay = (LONG)(TimerHeap[0]->DueTime - Time);
+     if (Delay < 1) Delay = 1;
+  }
+
+  DueTime.QuadPart = Int32x32To64(Delay, -10000);
+  KeSetTimer(MasterTimer, DueTime, NULL);
+}
+
 static
 PTIMER
 FASTCALL
@@ -58,7 +218,9 @@ CreateTimer(VOID)
   if (Ret)
   {
      Ret->head.h = Handle;
+     Ret->iHeap = TIMER_NOT_QUEUED;
      InsertTailList(&TimersListHead, &Ret->ptmrList);
+     InitializeListHead(&Ret->HashLink);
   }
 
   return Ret;
@@ -74,6 +236,8 @@ RemoveTimer(PTIMER pTmr)
   {
      /* Set the flag, it will be removed when ready */
      RemoveEntryList(&pTmr->ptmrList);
+     RemoveEntryList(&pTmr->HashLink);
+     TimerHeapRemove(pTmr);
      if ((pTmr->pWnd == NULL) && (!(pTmr->flags & TMRF_SYSTEM))) // System timers are reusable.
      {
         UINT_PTR IDEvent;
@@ -97,14 +261,15 @@ FindTimer(PWND Window,
           UINT_PTR nID,
           UINT flags)
 {
-  PLIST_ENTRY pLE;
+  PLIST_ENTRY pLE, pBucket;
   PTIMER pTmr, RetTmr = NULL;
 
   TimerEnterExclusive();
-  pLE = TimersListHead.Flink;
-  while (pLE != &TimersListHead)
+  pBucket = TimerHashBucket(Window, nID);
+  pLE = pBucket->Flink;
+  while (pLE != pBucket)
   {
-    pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrList);
+    pTmr = CONTAINING_RECORD(pLE, TIMER, HashLink);
 
     if ( pTmr->nID == nID &&
          pTmr->pWnd == Window &&
@@ -182,8 +347,6 @@ IntSetTimer( PWND Window,
 {
   PTIMER pTmr;
   UINT Ret = IDEvent;
-  LARGE_INTEGER DueTime;
-  DueTime.QuadPart = (LONGLONG)(-97656); // 1024hz .9765625 ms set to 10.0 ms
 
 #if 0
   /* Windows NT/2k/XP behaviour */
@@ -213,6 +376,7 @@ IntSetTimer( PWND Window,
   if ((Window) && (IDEvent == 0))
      Ret = 1;
 
+  TimerEnterExclusive();
   pTmr = FindTimer(Window, IDEvent, Type);
 
   if ((!pTmr) && (Window == NULL) && (!(Type & TMRF_SYSTEM)))
@@ -224,6 +388,7 @@ IntSetTimer( PWND Window,
       if (IDEvent == (UINT_PTR) -1)
       {
          IntUnlockWindowlessTimerBitmap();
+         TimerLeave();
          ERR("Unable to find a free window-less timer id\n");
          EngSetLastError(ERROR_NO_SYSTEM_RESOURCES);
          ASSERT(FALSE);
@@ -239,7 +404,11 @@ IntSetTimer( PWND Window,
   if (!pTmr)
   {
      pTmr = CreateTimer();
-     if (!pTmr) return 0;
+     if (!pTmr)
+     {
+        TimerLeave();
+        return 0;
+     }
 
      if (Window && (Type & TMRF_TIFROMWND))
         pTmr->pti = Window->head.pti->pEThread->Tcb.Win32Thread;
@@ -252,23 +421,36 @@ IntSetTimer( PWND Window,
      }
 
      pTmr->pWnd    = Window;
-     pTmr->cmsCountdown = Elapse;
+     pTmr->DueTime = EngGetTickCount32() + Elapse;
      pTmr->cmsRate = Elapse;
      pTmr->pfn     = TimerFunc;
      pTmr->nID     = IDEvent;
-     pTmr->flags   = Type|TMRF_INIT;
+     pTmr->flags   = Type;
+     InsertTailList(TimerHashBucket(Window, IDEvent), &pTmr->HashLink);
+
+     if (!TimerHeapInsert(pTmr))
+     {
+        RemoveTimer(pTmr);
+        TimerLeave();
+        EngSetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return 0;
+     }
   }
   else
   {
-     pTmr->cmsCountdown = Elapse;
+     pTmr->DueTime = EngGetTickCount32() + Elapse;
      pTmr->cmsRate = Elapse;
+
+     // The new due time may move the timer either way in the heap
+     TimerHeapSiftUp(pTmr->iHeap);
+     TimerHeapSiftDown(pTmr->iHeap);
   }
 
-  ASSERT(MasterTimer != NULL);
-  // Start the timer thread!
-  if (TimersListHead.Flink == TimersListHead.Blink) // There is only one timer
-     KeSetTimer(MasterTimer, DueTime, NULL);
+  // Wake the timer thread earlier if this is now the first timer to expire
+  if (pTmr->iHeap == 0)
+     TimerArmMasterTimer(EngGetTickCount32());
 
+  TimerLeave();
   return Ret;
 }
 
@@ -445,74 +627,52 @@ VOID
 FASTCALL
 ProcessTimers(VOID)
 {
-  LARGE_INTEGER DueTime;
-  LONG Time;
-  PLIST_ENTRY pLE;
+  ULONG Time;
   PTIMER pTmr;
+  BOOL Fire;
   LONG TimerCount = 0;
 
   TimerEnterExclusive();
-  pLE = TimersListHead.Flink;
   Time = EngGetTickCount32();
 
-  DueTime.QuadPart = (LONGLONG)(-97656); // 1024hz .9765625 ms set to 10.0 ms
-
-  while(pLE != &TimersListHead)
+  /* Only the timers that are due are looked at, earliest first */
+  while (TimerHeapCount > 0)
   {
-    pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrList);
+    pTmr = TimerHeap[0];
+    if ((LONG)(pTmr->DueTime - Time) > 0)
+       break;
+
     TimerCount++;
-    if (pTmr->flags & TMRF_WAITING)
-    {
-       pLE = pTmr->ptmrList.Flink;
-       pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrList);
+    ASSERT(pTmr->pti);
+    Fire = (!(pTmr->flags & TMRF_READY)) && (!(pTmr->pti->TIF_flags & TIF_INCLEANUP));
+
+    /* Requeue the timer before running it, the RIT callback may kill it */
+    pTmr->DueTime = Time + pTmr->cmsRate;
+    TimerHeapSiftDown(0);
+
+    if (!Fire)
        continue;
-    }
 
-    if (pTmr->flags & TMRF_INIT)
+    if (pTmr->flags & TMRF_RIT)
     {
-       pTmr->flags &= ~TMRF_INIT; // Skip this run.
+       // Hard coded call here, inside raw input thread.
+       pTmr->pfn(NULL, WM_SYSTIMER, pTmr->nID, (LPARAM)pTmr);
     }
     else
     {
-       if (pTmr->cmsCountdown < 0)
-       {
-          ASSERT(pTmr->pti);
-          if ((!(pTmr->flags & TMRF_READY)) && (!(pTmr->pti->TIF_flags & TIF_INCLEANUP)))
-          {
-             if (pTmr->flags & TMRF_ONESHOT)
-                pTmr->flags |= TMRF_WAITING;
-
-             if (pTmr->flags & TMRF_RIT)
-             {
-                // Hard coded call here, inside raw input thread.
-                pTmr->pfn(NULL, WM_SYSTIMER, pTmr->nID, (LPARAM)pTmr);
-             }
-             else
-             {
-                pTmr->flags |= TMRF_READY; // Set timer ready to be ran.
-                // Set thread message queue for this timer.
-                if (pTmr->pti)
-                {  // Wakeup thread
-                   pTmr->pti->cTimersReady++;
-                   ASSERT(pTmr->pti->pEventQueueServer != NULL);
-                   MsqWakeQueue(pTmr->pti, QS_TIMER, TRUE);
-                }
-             }
-          }
-          pTmr->cmsCountdown = pTmr->cmsRate;
+       pTmr->flags |= TMRF_READY; // Set timer ready to be ran.
+       // Set thread message queue for this timer.
+       if (pTmr->pti)
+       {  // Wakeup thread
+          pTmr->pti->cTimersReady++;
+          ASSERT(pTmr->pti->pEventQueueServer != NULL);
+          MsqWakeQueue(pTmr->pti, QS_TIMER, TRUE);
        }
-       else
-          pTmr->cmsCountdown -= Time - TimeLast;
     }
-
-    pLE = pLE->Flink;
   }
 
-  // Restart the timer thread!
-  ASSERT(MasterTimer != NULL);
-  KeSetTimer(MasterTimer, DueTime, NULL);
-
-  TimeLast = Time;
+  // Sleep until the next timer expires.
+  TimerArmMasterTimer(Time);
 
   TimerLeave();
   TRACE("TimerCount = %d\n", TimerCount);
@@ -593,7 +753,7 @@ NTSTATUS
 NTAPI
 InitTimerImpl(VOID)
 {
-   ULONG BitmapBytes;
+   ULONG BitmapBytes, i;
 
    /* Allocate FAST_MUTEX from non paged pool */
    Mutex = ExAllocatePoolWithTag(NonPagedPool, sizeof(FAST_MUTEX), TAG_INTERNAL_SYNC);
@@ -618,8 +778,22 @@ InitTimerImpl(VOID)
    /* Yes we need this, since ExAllocatePoolWithTag isn't supposed to zero out allocated memory */
    RtlClearAllBits(&WindowLessTimersBitMap);
 
+   TimerHeap = ExAllocatePoolWithTag(PagedPool,
+                                     TIMER_HEAP_INITIAL_SIZE * sizeof(PTIMER),
+                                     USERTAG_TIMER);
+   if (TimerHeap == NULL)
+   {
+      return STATUS_INSUFFICIENT_RESOURCES;
+   }
+   TimerHeapSize = TIMER_HEAP_INITIAL_SIZE;
+   TimerHeapCount = 0;
+
    ExInitializeResourceLite(&TimerLock);
    InitializeListHead(&TimersListHead);
+   for (i = 0; i < TIMER_HASH_SIZE; i++)
+   {
+      InitializeListHead(&TimersHashTable[i]);
+   }
 
    return STATUS_SUCCESS;
 }
@@ -4,10 +4,12 @@ typedef struct _TIMER
 {
   HEAD           head;
   LIST_ENTRY     ptmrList;
+  LIST_ENTRY     HashLink;     // (pWnd, nID) hash bucket
   PTHREADINFO    pti;
   PWND           pWnd;         // hWnd
   UINT_PTR       nID;          // Specifies a nonzero timer identifier.
-  INT            cmsCountdown; // uElapse
+  ULONG          DueTime;      // Tick count at which the timer expires
+  ULONG          iHeap;        // Index in the deadline heap, TIMER_NOT_QUEUED if not in it
   INT            cmsRate;      // uElapse
   FLONG          flags;
   TIMERPROC      pfn;          // lpTimerFunc
@@ -19,11 +21,10 @@ typedef struct _TIMER
 #define TMRF_READY   0x0001
 #define TMRF_SYSTEM  0x0002
 #define TMRF_RIT     0x0004
-#define TMRF_INIT    0x0008
-#define TMRF_ONESHOT 0x0010
-#define TMRF_WAITING 0x0020
 #define TMRF_TIFROMWND 0x0040
 
+#define TIMER_NOT_QUEUED ((ULONG)-1)
+
 #define ID_EVENT_SYSTIMER_MOUSEHOVER     ID_TME_TIMER
 #define ID_EVENT_SYSTIMER_FLASHWIN       (0xFFF8)
 #define ID_EVENT_SYSTIMER_TRACKWIN       (0xFFF7)
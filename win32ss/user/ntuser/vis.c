@@ -35,6 +35,11 @@ VIS_ComputeVisibleRegion(
       VisRgn = IntSysCreateRectpRgnIndirect(&Wnd->rcWindow);
    }
 
+   if (!VisRgn)
+   {
+      return NULL;
+   }
+
    /*
     * Walk through all parent windows and for each clip the visble region
     * to the parent's client area and exclude all siblings that are over
@@ -60,9 +65,7 @@ VIS_ComputeVisibleRegion(
          return NULL;
       }
 
-      ClipRgn = IntSysCreateRectpRgnIndirect(&CurrentWindow->rcClient);
-      IntGdiCombineRgn(VisRgn, VisRgn, ClipRgn, RGN_AND);
-      REGION_Delete(ClipRgn);
+      REGION_IntersectRectWithRgn(VisRgn, VisRgn, &CurrentWindow->rcClient);
 
       if ((PreviousWindow->style & WS_CLIPSIBLINGS) ||
           (PreviousWindow == Wnd && ClipSiblings))
@@ -74,11 +77,11 @@ VIS_ComputeVisibleRegion(
             if ((CurrentSibling->style & WS_VISIBLE) &&
                 !(CurrentSibling->ExStyle & WS_EX_TRANSPARENT))
             {
-               ClipRgn = IntSysCreateRectpRgnIndirect(&CurrentSibling->rcWindow);
                /* Combine it with the window region if available */
                if (CurrentSibling->hrgnClip && !(CurrentSibling->style & WS_MINIMIZE))
                {
                   PREGION SiblingClipRgn = REGION_LockRgn(CurrentSibling->hrgnClip);
+                  ClipRgn = IntSysCreateRectpRgnIndirect(&CurrentSibling->rcWindow);
                   if (SiblingClipRgn)
                   {
                       REGION_bOffsetRgn(ClipRgn, -CurrentSibling->rcWindow.left, -CurrentSibling->rcWindow.top);
@@ -86,9 +89,14 @@ VIS_ComputeVisibleRegion(
                       REGION_bOffsetRgn(ClipRgn, CurrentSibling->rcWindow.left, CurrentSibling->rcWindow.top);
                       REGION_UnlockRgn(SiblingClipRgn);
                   }
+                  IntGdiCombineRgn(VisRgn, VisRgn, ClipRgn, RGN_DIFF);
+                  REGION_Delete(ClipRgn);
+               }
+               else
+               {
+                  /* A plain rectangle needs no temporary region */
+                  REGION_SubtractRectFromRgn(VisRgn, VisRgn, &CurrentSibling->rcWindow);
                }
-               IntGdiCombineRgn(VisRgn, VisRgn, ClipRgn, RGN_DIFF);
-               REGION_Delete(ClipRgn);
             }
             CurrentSibling = CurrentSibling->spwndNext;
          }
@@ -106,11 +114,11 @@ VIS_ComputeVisibleRegion(
          if ((CurrentWindow->style & WS_VISIBLE) &&
              !(CurrentWindow->ExStyle & WS_EX_TRANSPARENT))
          {
-            ClipRgn = IntSysCreateRectpRgnIndirect(&CurrentWindow->rcWindow);
             /* Combine it with the window region if available */
             if (CurrentWindow->hrgnClip && !(CurrentWindow->style & WS_MINIMIZE))
             {
                PREGION CurrentRgnClip = REGION_LockRgn(CurrentWindow->hrgnClip);
+               ClipRgn = IntSysCreateRectpRgnIndirect(&CurrentWindow->rcWindow);
                if (CurrentRgnClip)
                {
                    REGION_bOffsetRgn(ClipRgn, -CurrentWindow->rcWindow.left, -CurrentWindow->rcWindow.top);
@@ -118,9 +126,14 @@ VIS_ComputeVisibleRegion(
                    REGION_bOffsetRgn(ClipRgn, CurrentWindow->rcWindow.left, CurrentWindow->rcWindow.top);
                    REGION_UnlockRgn(CurrentRgnClip);
                }
+               IntGdiCombineRgn(VisRgn, VisRgn, ClipRgn, RGN_DIFF);
+               REGION_Delete(ClipRgn);
+            }
+            else
+            {
+               /* A plain rectangle needs no temporary region */
+               REGION_SubtractRectFromRgn(VisRgn, VisRgn, &CurrentWindow->rcWindow);
             }
-            IntGdiCombineRgn(VisRgn, VisRgn, ClipRgn, RGN_DIFF);
-            REGION_Delete(ClipRgn);
          }
          CurrentWindow = CurrentWindow->spwndNext;
       }
@@ -70,6 +70,9 @@
         if (!NT_SUCCESS(Status))                \
             return Status;                      \
                                                 \
+        /* Keep the order with what was written in the rings */    \
+        ConSrvDrainOutputRings(Console);                            \
+                                                \
         Status = Name##Impl(ProcessData, Console,                   \
                             ApiMessage, RequestName, ReplyCode);    \
                                                 \
@@ -120,6 +123,7 @@ CSR_API(SrvSetConsoleActiveScreenBuffer);
 CSR_API(SrvSetConsoleScreenBufferSize);
 CSR_API(SrvScrollConsoleScreenBuffer);
 CSR_API(SrvSetConsoleWindowInfo);
+CSR_API(SrvMapConsoleOutputRing);
 
 /* console.c */
 CSR_API(SrvAllocConsole);
@@ -39,6 +39,9 @@ do { \
 /*static*/ VOID
 ClearLineBuffer(PTEXTMODE_SCREEN_BUFFER Buff);
 
+static VOID
+ConioResetDirtySpans(PTEXTMODE_SCREEN_BUFFER Buff);
+
 NTSTATUS
 CONSOLE_SCREEN_BUFFER_Initialize(
     OUT PCONSOLE_SCREEN_BUFFER* Buffer,
@@ -88,6 +91,16 @@ TEXTMODE_BUFFER_Initialize(OUT PCONSOLE_SCREEN_BUFFER* Buffer,
         return STATUS_INSUFFICIENT_RESOURCES;
     }
 
+    NewBuffer->DirtySpans = ConsoleAllocHeap(0,
+                                             TextModeInfo->ScreenBufferSize.Y *
+                                                sizeof(CONSOLE_DIRTY_SPAN));
+    if (NewBuffer->DirtySpans == NULL)
+    {
+        ConsoleFreeHeap(NewBuffer->Buffer);
+        CONSOLE_SCREEN_BUFFER_Destroy((PCONSOLE_SCREEN_BUFFER)NewBuffer);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
     NewBuffer->ScreenBufferSize = TextModeInfo->ScreenBufferSize;
     NewBuffer->OldScreenBufferSize = NewBuffer->ScreenBufferSize;
 
@@ -116,6 +129,9 @@ TEXTMODE_BUFFER_Initialize(OUT PCONSOLE_SCREEN_BUFFER* Buffer,
     }
     NewBuffer->CursorPosition.X = NewBuffer->CursorPosition.Y = 0;
 
+    /* The front-end paints a new buffer entirely when it becomes active */
+    ConioResetDirtySpans(NewBuffer);
+
     NewBuffer->Mode = ENABLE_PROCESSED_OUTPUT | ENABLE_WRAP_AT_EOL_OUTPUT;
 
     *Buffer = (PCONSOLE_SCREEN_BUFFER)NewBuffer;
@@ -133,6 +149,7 @@ TEXTMODE_BUFFER_Destroy(IN OUT PCONSOLE_SCREEN_BUFFER Buffer)
      */
     Buffer->Header.Type = SCREEN_BUFFER;
 
+    ConsoleFreeHeap(Buff->DirtySpans);
     ConsoleFreeHeap(Buff->Buffer);
 
     CONSOLE_SCREEN_BUFFER_Destroy(Buffer);
@@ -161,6 +178,93 @@ ClearLineBuffer(PTEXTMODE_SCREEN_BUFFER Buff)
     }
 }
 
+static VOID
+ConioResetDirtySpans(PTEXTMODE_SCREEN_BUFFER Buff)
+{
+    SHORT Line;
+
+    for (Line = 0; Line < Buff->ScreenBufferSize.Y; Line++)
+    {
+        Buff->DirtySpans[Line].Left  = Buff->ScreenBufferSize.X;
+        Buff->DirtySpans[Line].Right = -1;
+    }
+    Buff->DirtyScroll = 0;
+}
+
+/*
+ * Records that the cells [Left, Right] of the given line changed, so that
+ * the front-end only repaints what was written since its last repaint
+ * instead of whole lines on every write.
+ */
+VOID
+ConioMarkDirty(PTEXTMODE_SCREEN_BUFFER Buff, SHORT Line, SHORT Left, SHORT Right)
+{
+    PCONSOLE_DIRTY_SPAN Span;
+
+    Left  = max(Left, 0);
+    Right = min(Right, Buff->ScreenBufferSize.X - 1);
+    if (Left > Right || Line < 0 || Line >= Buff->ScreenBufferSize.Y)
+        return;
+
+    Span = &Buff->DirtySpans[(Line + Buff->VirtualY) % Buff->ScreenBufferSize.Y];
+    if (Span->Left > Span->Right)
+    {
+        Span->Left  = Left;
+        Span->Right = Right;
+    }
+    else
+    {
+        Span->Left  = min(Span->Left , Left);
+        Span->Right = max(Span->Right, Right);
+    }
+}
+
+VOID
+ConioMarkDirtyRegion(PTEXTMODE_SCREEN_BUFFER Buff, PSMALL_RECT Region)
+{
+    SHORT Line;
+
+    for (Line = max(Region->Top, 0);
+         Line <= Region->Bottom && Line < Buff->ScreenBufferSize.Y;
+         Line++)
+    {
+        ConioMarkDirty(Buff, Line, Region->Left, Region->Right);
+    }
+}
+
+/*
+ * Called when the buffer scrolled up by one line. The spans follow the
+ * rows they describe, the front-end moves what it already painted by
+ * DirtyScroll lines before repainting the dirty spans.
+ */
+VOID
+ConioScrollDirty(PTEXTMODE_SCREEN_BUFFER Buff)
+{
+    if (Buff->DirtyScroll < Buff->ScreenBufferSize.Y)
+        Buff->DirtyScroll++;
+
+    /* The row that wrapped around to the bottom has been cleared */
+    ConioMarkDirty(Buff, Buff->ScreenBufferSize.Y - 1, 0, Buff->ScreenBufferSize.X - 1);
+}
+
+BOOLEAN
+ConioTakeDirtySpan(PTEXTMODE_SCREEN_BUFFER Buff, SHORT Line, PSHORT Left, PSHORT Right)
+{
+    PCONSOLE_DIRTY_SPAN Span;
+
+    ASSERT(0 <= Line && Line < Buff->ScreenBufferSize.Y);
+
+    Span = &Buff->DirtySpans[(Line + Buff->VirtualY) % Buff->ScreenBufferSize.Y];
+    if (Span->Left > Span->Right)
+        return FALSE;
+
+    *Left  = Span->Left;
+    *Right = Span->Right;
+    Span->Left  = Buff->ScreenBufferSize.X;
+    Span->Right = -1;
+    return TRUE;
+}
+
 static VOID
 ConioComputeUpdateRect(IN PTEXTMODE_SCREEN_BUFFER Buff,
                        IN OUT PSMALL_RECT UpdateRect,
@@ -366,6 +470,7 @@ ConioResizeBuffer(PCONSOLE Console,
     WORD CurrentAttribute;
     USHORT CurrentY;
     PCHAR_INFO OldBuffer;
+    PCONSOLE_DIRTY_SPAN DirtySpans;
     DWORD i;
     DWORD diff;
 
@@ -397,6 +502,13 @@ ConioResizeBuffer(PCONSOLE Console,
     Buffer = ConsoleAllocHeap(HEAP_ZERO_MEMORY, Size.X * Size.Y * sizeof(CHAR_INFO));
     if (!Buffer) return STATUS_NO_MEMORY;
 
+    DirtySpans = ConsoleAllocHeap(0, Size.Y * sizeof(CONSOLE_DIRTY_SPAN));
+    if (!DirtySpans)
+    {
+        ConsoleFreeHeap(Buffer);
+        return STATUS_NO_MEMORY;
+    }
+
     DPRINT("Resizing (%d,%d) to (%d,%d)\n", ScreenBuffer->ScreenBufferSize.X, ScreenBuffer->ScreenBufferSize.Y, Size.X, Size.Y);
 
     OldBuffer = ScreenBuffer->Buffer;
@@ -464,6 +576,11 @@ ConioResizeBuffer(PCONSOLE Console,
     ScreenBuffer->ScreenBufferSize = ScreenBuffer->OldScreenBufferSize = Size;
     ScreenBuffer->VirtualY = 0;
 
+    /* The terminal is redrawn entirely after a resize */
+    ConsoleFreeHeap(ScreenBuffer->DirtySpans);
+    ScreenBuffer->DirtySpans = DirtySpans;
+    ConioResetDirtySpans(ScreenBuffer);
+
     /* Ensure the cursor and the view are within the buffer */
     ScreenBuffer->CursorPosition.X = min(ScreenBuffer->CursorPosition.X, Size.X - 1);
     ScreenBuffer->CursorPosition.Y = min(ScreenBuffer->CursorPosition.Y, Size.Y - 1);
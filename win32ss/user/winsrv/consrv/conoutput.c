@@ -700,6 +700,526 @@ CON_API(SrvWriteConsole,
     return Status;
 }
 
+/* SHARED OUTPUT RING *********************************************************/
+
+/*
+ * A console process can write text through a ring shared with us instead
+ * of one ConsolepWriteConsole message per write. The clients stamp each
+ * entry from a sequence counter in a page shared by the whole console, and
+ * the entries of all the rings of the console are written out in that
+ * order: before any console API is processed, when a process joins or
+ * leaves the console, on unpause, and otherwise by the ring thread when a
+ * client rings the doorbell.
+ */
+
+static RTL_CRITICAL_SECTION OutputRingListLock;
+static LIST_ENTRY OutputRingList;
+static HANDLE OutputRingDoorbell = NULL;
+static HANDLE OutputRingThread = NULL;
+
+/* How many consoles the ring thread writes out per look at the ring list */
+#define OUTPUT_RING_DRAIN_BATCH 16
+
+VOID
+ConSrvInitOutputRings(VOID)
+{
+    RtlInitializeCriticalSection(&OutputRingListLock);
+    InitializeListHead(&OutputRingList);
+}
+
+static BOOLEAN
+ConSrvPeekOutputRing(IN PCONSOLE_PROCESS_DATA ProcessData,
+                     OUT PCONSOLE_OUTPUT_RING_ENTRY Entry)
+{
+    PCONSOLE_OUTPUT_RING Ring = ProcessData->OutputRing;
+    ULONG ReadOffset, WriteOffset, Offset;
+
+    if (Ring == NULL) return FALSE;
+
+    /* Only we advance the read offset, and the console lock serializes us */
+    ReadOffset = Ring->ReadOffset;
+
+    for (;;)
+    {
+        WriteOffset = Ring->WriteOffset;
+        MemoryBarrier();
+
+        if (WriteOffset == ReadOffset) return FALSE;
+
+        /*
+         * Everything in the ring is under the control of the client,
+         * so only trust what we validated and have in a local copy.
+         */
+        Offset = ReadOffset & (CONSOLE_OUTPUT_RING_SIZE - 1);
+        *Entry = *(PCONSOLE_OUTPUT_RING_ENTRY)&Ring->Data[Offset];
+
+        if (WriteOffset - ReadOffset > CONSOLE_OUTPUT_RING_SIZE ||
+            Entry->Size == 0 || (Entry->Size % CONSOLE_OUTPUT_RING_ALIGNMENT) != 0 ||
+            Entry->Size > CONSOLE_OUTPUT_RING_SIZE - Offset ||
+            Entry->Size > WriteOffset - ReadOffset ||
+            (Entry->NumBytes != 0 && (Entry->Size < sizeof(*Entry) ||
+                                      Entry->NumBytes > Entry->Size - sizeof(*Entry) ||
+                                      Entry->NumBytes > CONSOLE_OUTPUT_RING_MAX_WRITE)))
+        {
+            DPRINT1("Invalid output ring entry at 0x%lx, discarding the ring\n", ReadOffset);
+            InterlockedExchange((PLONG)&Ring->ReadOffset, (LONG)WriteOffset);
+            return FALSE;
+        }
+
+        if (Entry->NumBytes != 0) return TRUE;
+
+        /* Padding entries only skip to the start of the ring */
+        ReadOffset += Entry->Size;
+        InterlockedExchange((PLONG)&Ring->ReadOffset, (LONG)ReadOffset);
+    }
+}
+
+static BOOLEAN
+ConSrvWriteOutputRingEntry(IN PCONSRV_CONSOLE Console,
+                           IN PCONSOLE_PROCESS_DATA ProcessData,
+                           IN PCONSOLE_OUTPUT_RING_ENTRY Entry)
+{
+    NTSTATUS Status;
+    PCONSOLE_OUTPUT_RING Ring = ProcessData->OutputRing;
+    PTEXTMODE_SCREEN_BUFFER ScreenBuffer;
+    ULONG ReadOffset = Ring->ReadOffset;
+    ULONG NumCharsWritten;
+    UCHAR Buffer[CONSOLE_OUTPUT_RING_MAX_WRITE];
+
+    /*
+     * The client can still change the text while we write it out,
+     * so work on a copy of it (the peek checked its size).
+     */
+    RtlCopyMemory(Buffer,
+                  (PCONSOLE_OUTPUT_RING_ENTRY)&Ring->Data[ReadOffset & (CONSOLE_OUTPUT_RING_SIZE - 1)] + 1,
+                  Entry->NumBytes);
+
+    Status = ConSrvGetTextModeBuffer(ProcessData,
+                                     Entry->OutputHandle,
+                                     &ScreenBuffer, GENERIC_WRITE, FALSE);
+    if (NT_SUCCESS(Status))
+    {
+        Status = ConDrvWriteConsole((PCONSOLE)Console,
+                                    ScreenBuffer,
+                                    Entry->Unicode,
+                                    Buffer,
+                                    Entry->NumBytes / (Entry->Unicode ? sizeof(WCHAR) : sizeof(CHAR)),
+                                    &NumCharsWritten);
+        ConSrvReleaseScreenBuffer(ScreenBuffer, FALSE);
+
+        /* The console is paused, keep the entry until it resumes */
+        if (Status == STATUS_PENDING) return FALSE;
+    }
+
+    if (!NT_SUCCESS(Status))
+    {
+        /*
+         * The client returned from WriteConsole long ago. Keep the first
+         * failure for its next write, which reports it instead of writing.
+         */
+        DPRINT1("Dropping output ring entry for handle 0x%p, Status 0x%08lx\n",
+                Entry->OutputHandle, Status);
+        InterlockedCompareExchange(&Ring->ErrorStatus, Status, STATUS_SUCCESS);
+    }
+
+    /*
+     * Publish the progress. The client only rings the doorbell when it
+     * sees that we caught up, and we look at its write offset again
+     * after this, so no entry can be left behind unnoticed.
+     */
+    InterlockedExchange((PLONG)&Ring->ReadOffset, (LONG)(ReadOffset + Entry->Size));
+    return TRUE;
+}
+
+VOID
+ConSrvDrainOutputRings(IN PCONSRV_CONSOLE Console)
+{
+    PLIST_ENTRY ListEntry;
+    PCONSOLE_PROCESS_DATA ProcessData, OldestProcessData;
+    CONSOLE_OUTPUT_RING_ENTRY Entry, OldestEntry;
+
+    /* No process of the console has a ring yet */
+    if (Console->OutputRingControl == NULL) return;
+
+    for (;;)
+    {
+        /* Find the oldest entry that any process of the console has left */
+        OldestProcessData = NULL;
+        for (ListEntry = Console->ProcessList.Flink;
+             ListEntry != &Console->ProcessList;
+             ListEntry = ListEntry->Flink)
+        {
+            ProcessData = CONTAINING_RECORD(ListEntry, CONSOLE_PROCESS_DATA, ConsoleLink);
+            if (!ConSrvPeekOutputRing(ProcessData, &Entry)) continue;
+
+            if (OldestProcessData == NULL ||
+                (LONG)(Entry.Sequence - OldestEntry.Sequence) < 0)
+            {
+                OldestProcessData = ProcessData;
+                OldestEntry = Entry;
+            }
+        }
+
+        if (OldestProcessData == NULL) break;
+
+        /* Nothing can be written out past an entry held back by a pause */
+        if (!ConSrvWriteOutputRingEntry(Console, OldestProcessData, &OldestEntry))
+            break;
+    }
+}
+
+static ULONG NTAPI
+ConSrvOutputRingThread(PVOID Param)
+{
+    PLIST_ENTRY ListEntry;
+    PCONSOLE_PROCESS_DATA ProcessData;
+    PCONSRV_CONSOLE Console;
+    PCONSRV_CONSOLE Consoles[OUTPUT_RING_DRAIN_BATCH];
+    ULONG Count, i;
+
+    for (;;)
+    {
+        NtWaitForSingleObject(OutputRingDoorbell, FALSE, NULL);
+
+        /*
+         * The doorbell is shared, look at all the rings with something in
+         * them and reference their consoles. Mapping and closing rings
+         * must not wait for the text to be written out, so this is all
+         * we do under the ring list lock.
+         */
+        Count = 0;
+        RtlEnterCriticalSection(&OutputRingListLock);
+        for (ListEntry = OutputRingList.Flink;
+             ListEntry != &OutputRingList;
+             ListEntry = ListEntry->Flink)
+        {
+            ProcessData = CONTAINING_RECORD(ListEntry, CONSOLE_PROCESS_DATA, OutputRingLink);
+
+            if (ProcessData->OutputRing->ReadOffset == ProcessData->OutputRing->WriteOffset)
+                continue;
+
+            if (!NT_SUCCESS(ConSrvGetConsole(ProcessData, &Console, FALSE)))
+                continue;
+
+            /* Paused consoles are written out when they resume */
+            for (i = 0; i < Count; i++)
+            {
+                if (Consoles[i] == Console) break;
+            }
+            if (i < Count || Console->OutputRingControl->Paused)
+            {
+                ConSrvReleaseConsole(Console, FALSE);
+                continue;
+            }
+
+            Consoles[Count++] = Console;
+            if (Count == OUTPUT_RING_DRAIN_BATCH)
+            {
+                /* Come back for the others */
+                NtSetEvent(OutputRingDoorbell, NULL);
+                break;
+            }
+        }
+        RtlLeaveCriticalSection(&OutputRingListLock);
+
+        for (i = 0; i < Count; i++)
+        {
+            Console = Consoles[i];
+            if (ConDrvValidateConsoleUnsafe((PCONSOLE)Console, CONSOLE_RUNNING, TRUE))
+            {
+                ConSrvDrainOutputRings(Console);
+                ConSrvReleaseConsole(Console, TRUE);
+            }
+            else
+            {
+                ConSrvReleaseConsole(Console, FALSE);
+            }
+        }
+    }
+
+    return 0;
+}
+
+static NTSTATUS
+ConSrvStartOutputRingThread(VOID)
+{
+    NTSTATUS Status;
+    CLIENT_ID ClientId;
+
+    /* Called with the ring list lock held */
+    if (OutputRingThread) return STATUS_SUCCESS;
+
+    Status = NtCreateEvent(&OutputRingDoorbell, EVENT_ALL_ACCESS,
+                           NULL, SynchronizationEvent, FALSE);
+    if (!NT_SUCCESS(Status)) return Status;
+
+    Status = RtlCreateUserThread(NtCurrentProcess(),
+                                 NULL,
+                                 TRUE, // Start the thread in suspended state
+                                 0,
+                                 0,
+                                 0,
+                                 (PVOID)ConSrvOutputRingThread,
+                                 NULL,
+                                 &OutputRingThread,
+                                 &ClientId);
+    if (!NT_SUCCESS(Status))
+    {
+        NtClose(OutputRingDoorbell);
+        OutputRingDoorbell = NULL;
+        OutputRingThread = NULL;
+        return Status;
+    }
+
+    /* Add it as a static server thread and resume it */
+    CsrAddStaticServerThread(OutputRingThread, &ClientId, 0);
+    return NtResumeThread(OutputRingThread, NULL);
+}
+
+static NTSTATUS
+ConSrvCreateOutputRingControl(IN PCONSRV_CONSOLE Console)
+{
+    NTSTATUS Status;
+    LARGE_INTEGER SectionSize;
+    SIZE_T ViewSize = 0;
+
+    /* Called with the console locked */
+    SectionSize.QuadPart = sizeof(CONSOLE_OUTPUT_RING_CONTROL);
+    Status = NtCreateSection(&Console->OutputRingControlSection,
+                             SECTION_ALL_ACCESS,
+                             NULL,
+                             &SectionSize,
+                             PAGE_READWRITE,
+                             SEC_COMMIT,
+                             NULL);
+    if (!NT_SUCCESS(Status))
+    {
+        Console->OutputRingControlSection = NULL;
+        return Status;
+    }
+
+    Status = NtMapViewOfSection(Console->OutputRingControlSection,
+                                NtCurrentProcess(),
+                                (PVOID*)&Console->OutputRingControl,
+                                0,
+                                0,
+                                NULL,
+                                &ViewSize,
+                                ViewUnmap,
+                                0,
+                                PAGE_READWRITE);
+    if (!NT_SUCCESS(Status))
+    {
+        NtClose(Console->OutputRingControlSection);
+        Console->OutputRingControlSection = NULL;
+        Console->OutputRingControl = NULL;
+        return Status;
+    }
+
+    Console->OutputRingControl->Paused = (Console->PauseFlags != 0);
+    return STATUS_SUCCESS;
+}
+
+VOID
+ConSrvDeleteOutputRingControl(IN PCONSRV_CONSOLE Console)
+{
+    if (Console->OutputRingControl == NULL) return;
+
+    NtUnmapViewOfSection(NtCurrentProcess(), Console->OutputRingControl);
+    NtClose(Console->OutputRingControlSection);
+
+    Console->OutputRingControl = NULL;
+    Console->OutputRingControlSection = NULL;
+}
+
+VOID
+ConSrvCloseOutputRing(IN PCONSOLE_PROCESS_DATA ProcessData)
+{
+    PCONSRV_CONSOLE Console;
+    HANDLE ProcessHandle = ProcessData->Process->ProcessHandle;
+
+    if (ProcessData->OutputRing == NULL) return;
+
+    /*
+     * Take the process off the list first so that the ring thread does not
+     * touch it anymore. Then, while the process is still on the console,
+     * write out what it and the others left in their rings.
+     * The ring list lock is always taken before the console lock.
+     */
+    RtlEnterCriticalSection(&OutputRingListLock);
+    RemoveEntryList(&ProcessData->OutputRingLink);
+    if (NT_SUCCESS(ConSrvGetConsole(ProcessData, &Console, TRUE)))
+    {
+        ConSrvDrainOutputRings(Console);
+        NtUnmapViewOfSection(NtCurrentProcess(), ProcessData->OutputRing);
+        ProcessData->OutputRing = NULL;
+        ConSrvReleaseConsole(Console, TRUE);
+    }
+    else
+    {
+        NtUnmapViewOfSection(NtCurrentProcess(), ProcessData->OutputRing);
+        ProcessData->OutputRing = NULL;
+    }
+    RtlLeaveCriticalSection(&OutputRingListLock);
+
+    /* This fails harmlessly if the process is going away */
+    NtUnmapViewOfSection(ProcessHandle, ProcessData->ClientOutputRing);
+    NtUnmapViewOfSection(ProcessHandle, ProcessData->ClientOutputRingControl);
+    NtClose(ProcessData->OutputRingSection);
+
+    ProcessData->OutputRingSection = NULL;
+    ProcessData->ClientOutputRing = NULL;
+    ProcessData->ClientOutputRingControl = NULL;
+}
+
+/* API_NUMBER: ConsolepMapOutputRing */
+CON_API_NOCONSOLE(SrvMapConsoleOutputRing,
+                  CONSOLE_MAPOUTPUTRING, MapOutputRingRequest)
+{
+    NTSTATUS Status;
+    HANDLE ProcessHandle = ProcessData->Process->ProcessHandle;
+    PCONSRV_CONSOLE Console;
+    PCONSOLE_OUTPUT_RING OutputRing = NULL;
+    LARGE_INTEGER SectionSize;
+    SIZE_T ViewSize;
+
+    /*
+     * Not a CON_API: the ring list lock must be taken before the console
+     * lock. The client serializes this call with FreeConsole.
+     */
+    if ((MapOutputRingRequest->ConsoleHandle == NULL) ||
+        (MapOutputRingRequest->ConsoleHandle != ProcessData->ConsoleHandle))
+    {
+        return STATUS_INVALID_HANDLE;
+    }
+
+    RtlEnterCriticalSection(&OutputRingListLock);
+
+    if (ProcessData->OutputRing != NULL)
+    {
+        Status = STATUS_ALREADY_COMMITTED;
+        goto Quit;
+    }
+
+    Status = ConSrvStartOutputRingThread();
+    if (!NT_SUCCESS(Status)) goto Quit;
+
+    Status = ConSrvGetConsole(ProcessData, &Console, TRUE);
+    if (!NT_SUCCESS(Status)) goto Quit;
+
+    /* The sequence counter and the pause flag are shared by the whole console */
+    if (Console->OutputRingControl == NULL)
+    {
+        Status = ConSrvCreateOutputRingControl(Console);
+        if (!NT_SUCCESS(Status))
+        {
+            DPRINT1("Error: Impossible to create the output ring control page, Status = 0x%08lx\n", Status);
+            goto Release;
+        }
+    }
+
+    SectionSize.QuadPart = sizeof(CONSOLE_OUTPUT_RING);
+    Status = NtCreateSection(&ProcessData->OutputRingSection,
+                             SECTION_ALL_ACCESS,
+                             NULL,
+                             &SectionSize,
+                             PAGE_READWRITE,
+                             SEC_COMMIT,
+                             NULL);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("Error: Impossible to create the output ring section, Status = 0x%08lx\n", Status);
+        ProcessData->OutputRingSection = NULL;
+        goto Release;
+    }
+
+    ViewSize = 0;
+    Status = NtMapViewOfSection(ProcessData->OutputRingSection,
+                                NtCurrentProcess(),
+                                (PVOID*)&OutputRing,
+                                0,
+                                0,
+                                NULL,
+                                &ViewSize,
+                                ViewUnmap,
+                                0,
+                                PAGE_READWRITE);
+    if (!NT_SUCCESS(Status))
+    {
+        OutputRing = NULL;
+        goto Fail;
+    }
+
+    ViewSize = 0;
+    Status = NtMapViewOfSection(ProcessData->OutputRingSection,
+                                ProcessHandle,
+                                (PVOID*)&ProcessData->ClientOutputRing,
+                                0,
+                                0,
+                                NULL,
+                                &ViewSize,
+                                ViewUnmap,
+                                0,
+                                PAGE_READWRITE);
+    if (!NT_SUCCESS(Status))
+    {
+        ProcessData->ClientOutputRing = NULL;
+        goto Fail;
+    }
+
+    ViewSize = 0;
+    Status = NtMapViewOfSection(Console->OutputRingControlSection,
+                                ProcessHandle,
+                                (PVOID*)&ProcessData->ClientOutputRingControl,
+                                0,
+                                0,
+                                NULL,
+                                &ViewSize,
+                                ViewUnmap,
+                                0,
+                                PAGE_READWRITE);
+    if (!NT_SUCCESS(Status))
+    {
+        ProcessData->ClientOutputRingControl = NULL;
+        goto Fail;
+    }
+
+    /* The client only needs to ring the doorbell */
+    Status = NtDuplicateObject(NtCurrentProcess(),
+                               OutputRingDoorbell,
+                               ProcessHandle,
+                               &MapOutputRingRequest->DoorbellEvent,
+                               EVENT_MODIFY_STATE, 0, 0);
+    if (!NT_SUCCESS(Status)) goto Fail;
+
+    /* Other processes drain the rings of the console under its lock */
+    MapOutputRingRequest->OutputRing = ProcessData->ClientOutputRing;
+    MapOutputRingRequest->Control = ProcessData->ClientOutputRingControl;
+    ProcessData->OutputRing = OutputRing;
+    InsertTailList(&OutputRingList, &ProcessData->OutputRingLink);
+    goto Release;
+
+Fail:
+    DPRINT1("Error: Impossible to map the output ring, Status = 0x%08lx\n", Status);
+    if (ProcessData->ClientOutputRingControl)
+        NtUnmapViewOfSection(ProcessHandle, ProcessData->ClientOutputRingControl);
+    if (ProcessData->ClientOutputRing)
+        NtUnmapViewOfSection(ProcessHandle, ProcessData->ClientOutputRing);
+    if (OutputRing)
+        NtUnmapViewOfSection(NtCurrentProcess(), OutputRing);
+    NtClose(ProcessData->OutputRingSection);
+    ProcessData->OutputRingSection = NULL;
+    ProcessData->ClientOutputRing = NULL;
+    ProcessData->ClientOutputRingControl = NULL;
+
+Release:
+    ConSrvReleaseConsole(Console, TRUE);
+
+Quit:
+    RtlLeaveCriticalSection(&OutputRingListLock);
+    return Status;
+}
+
 NTSTATUS NTAPI
 ConDrvReadConsoleOutputString(IN PCONSOLE Console,
                               IN PTEXTMODE_SCREEN_BUFFER Buffer,
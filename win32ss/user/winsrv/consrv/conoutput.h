@@ -44,4 +44,9 @@ VOID NTAPI ConDrvDeleteScreenBuffer(PCONSOLE_SCREEN_BUFFER Buffer);
 PCONSOLE_SCREEN_BUFFER
 ConDrvGetActiveScreenBuffer(IN PCONSOLE Console);
 
+VOID ConSrvInitOutputRings(VOID);
+VOID ConSrvDrainOutputRings(IN PCONSRV_CONSOLE Console);
+VOID ConSrvDeleteOutputRingControl(IN PCONSRV_CONSOLE Console);
+VOID ConSrvCloseOutputRing(IN PCONSOLE_PROCESS_DATA ProcessData);
+
 /* EOF */
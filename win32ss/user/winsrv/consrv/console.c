@@ -835,6 +835,9 @@ ConSrvDeleteConsole(PCONSRV_CONSOLE Console)
     NtClose(Console->InitEvents[INIT_FAILURE]);
     NtClose(Console->InitEvents[INIT_SUCCESS]);
 
+    /* Release the page shared by the output rings */
+    ConSrvDeleteOutputRingControl(Console);
+
     /* Clean the Input Line Discipline */
     if (Console->LineBuffer) ConsoleFreeHeap(Console->LineBuffer);
 
@@ -860,6 +863,10 @@ ConioPause(PCONSRV_CONSOLE Console, UCHAR Flags)
 {
     Console->PauseFlags |= Flags;
     ConDrvPause((PCONSOLE)Console);
+
+    /* Make the clients block in WriteConsole instead of filling their rings */
+    if (Console->OutputRingControl)
+        InterlockedExchange(&Console->OutputRingControl->Paused, TRUE);
 }
 
 VOID
@@ -872,6 +879,11 @@ ConioUnpause(PCONSRV_CONSOLE Console, UCHAR Flags)
     {
         ConDrvUnpause((PCONSOLE)Console);
 
+        /* The output rings were written before the waiting WriteConsole calls */
+        if (Console->OutputRingControl)
+            InterlockedExchange(&Console->OutputRingControl->Paused, FALSE);
+        ConSrvDrainOutputRings(Console);
+
         CsrNotifyWait(&Console->WriteWaitQueue,
                       TRUE,
                       NULL,
@@ -1202,6 +1214,12 @@ ConSrvInheritConsole(
     /* Return the console handle to the caller */
     ConsoleStartInfo->ConsoleHandle = ProcessData->ConsoleHandle;
 
+    /*
+     * What the other processes still have in their rings was written before
+     * this one was started, so it must come out before anything it writes.
+     */
+    ConSrvDrainOutputRings(Console);
+
     /*
      * Insert the process into the processes list of the console,
      * and set its foreground priority.
@@ -1236,6 +1254,12 @@ ConSrvRemoveConsole(
     ProcessData->ConsoleApp = FALSE;
     ProcessData->Process->Flags &= ~CsrProcessIsConsoleApp;
 
+    /*
+     * Write out the output rings and release the one of the process while
+     * it is still on the console. This is done before locking the console.
+     */
+    ConSrvCloseOutputRing(ProcessData);
+
     /* Validate and lock the console */
     if (!ConSrvValidateConsole(&Console,
                                ProcessData->ConsoleHandle,
@@ -52,6 +52,13 @@ typedef struct _CONSOLE_PROCESS_DATA
     LPTHREAD_START_ROUTINE CtrlRoutine;
     LPTHREAD_START_ROUTINE PropRoutine; // We hold the property dialog handler there, till all the GUI thingie moves out from CSRSS.
     // LPTHREAD_START_ROUTINE ImeRoutine;
+
+    /* Shared-memory output ring, see conoutput.c */
+    LIST_ENTRY OutputRingLink;
+    HANDLE OutputRingSection;
+    PCONSOLE_OUTPUT_RING OutputRing;        // Our view of the ring
+    PCONSOLE_OUTPUT_RING ClientOutputRing;  // The client's view of the ring
+    PCONSOLE_OUTPUT_RING_CONTROL ClientOutputRingControl; // The client's view of the console's control page
 } CONSOLE_PROCESS_DATA, *PCONSOLE_PROCESS_DATA;
 
 #include "include/conio.h"
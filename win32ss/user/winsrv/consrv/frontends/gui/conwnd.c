@@ -1347,6 +1347,20 @@ OnTimer(PGUI_CONSOLE_DATA GuiData)
     LeaveCriticalSection(&Console->Lock);
 }
 
+static VOID
+OnRepaintTimer(PGUI_CONSOLE_DATA GuiData)
+{
+    PCONSRV_CONSOLE Console = GuiData->Console;
+
+    KillTimer(GuiData->hWindow, CONGUI_REPAINT_TIMER);
+
+    if (!ConDrvValidateConsoleUnsafe((PCONSOLE)Console, CONSOLE_RUNNING, TRUE)) return;
+
+    GuiRepaintDirtyCells(GuiData);
+
+    LeaveCriticalSection(&Console->Lock);
+}
+
 static BOOL
 OnClose(PGUI_CONSOLE_DATA GuiData)
 {
@@ -1382,7 +1396,10 @@ OnNcDestroy(HWND hWnd)
     if (GuiData)
     {
         if (GuiData->IsWindowVisible)
+        {
             KillTimer(hWnd, CONGUI_UPDATE_TIMER);
+            KillTimer(hWnd, CONGUI_REPAINT_TIMER);
+        }
 
         /* Free the terminal framebuffer */
         if (GuiData->hMemDC ) DeleteDC(GuiData->hMemDC);
@@ -2237,7 +2254,10 @@ ConWndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
             break;
 
         case WM_TIMER:
-            OnTimer(GuiData);
+            if (wParam == CONGUI_REPAINT_TIMER)
+                OnRepaintTimer(GuiData);
+            else
+                OnTimer(GuiData);
             break;
 
         case WM_PALETTECHANGED:
@@ -21,6 +21,10 @@
 #define PM_CONSOLE_BEEP         (WM_APP + 4)
 #define PM_CONSOLE_SET_TITLE    (WM_APP + 5)
 
+/* Timer coalescing the repaints of the cells written during output bursts */
+#define CONGUI_REPAINT_TIMER    2
+#define CONGUI_REPAINT_TIME     16  // At most about 60 repaints per second
+
 /* Flags for GetKeyState */
 #define KEY_TOGGLED 0x0001
 #define KEY_PRESSED 0x8000
@@ -53,6 +57,9 @@ typedef struct _GUI_CONSOLE_DATA
 
     POINT OldCursor;
 
+    DWORD LastRepaintTime;      /* Tick count of the last repaint of the dirty cells */
+    BOOLEAN RepaintPending;     /* The repaint timer is armed */
+
     LONG_PTR WndStyle;
     LONG_PTR WndStyleEx;
     BOOL IsWndMax;
@@ -92,6 +92,61 @@ InvalidateCell(PGUI_CONSOLE_DATA GuiData,
     DrawRegion(GuiData, &CellRect);
 }
 
+/*
+ * Invalidates the cells of the view written since the last call.
+ * The console lock must be held.
+ */
+VOID
+GuiRepaintDirtyCells(PGUI_CONSOLE_DATA GuiData)
+{
+    PTEXTMODE_SCREEN_BUFFER Buff;
+    SMALL_RECT Region;
+    SHORT Line, LastLine;
+    BOOLEAN Scrolled;
+
+    GuiData->RepaintPending = FALSE;
+    GuiData->LastRepaintTime = GetTickCount();
+
+    if (GetType(GuiData->ActiveBuffer) != TEXTMODE_BUFFER) return;
+    Buff = (PTEXTMODE_SCREEN_BUFFER)GuiData->ActiveBuffer;
+
+    /* Once the text has scrolled, repainting the whole view is simplest and cheap enough */
+    Scrolled = (Buff->DirtyScroll != 0);
+    Buff->DirtyScroll = 0;
+    if (Scrolled)
+        InvalidateRect(GuiData->hWindow, NULL, FALSE);
+
+    LastLine = min(Buff->ViewOrigin.Y + Buff->ViewSize.Y, Buff->ScreenBufferSize.Y) - 1;
+    for (Line = Buff->ViewOrigin.Y; Line <= LastLine; Line++)
+    {
+        if (!ConioTakeDirtySpan(Buff, Line, &Region.Left, &Region.Right) || Scrolled)
+            continue;
+
+        Region.Top = Region.Bottom = Line;
+        DrawRegion(GuiData, &Region);
+    }
+}
+
+/*
+ * The first write after a pause is repainted right away so that interactive
+ * output stays responsive, the following ones are coalesced by the timer.
+ */
+static VOID
+ScheduleRepaint(PGUI_CONSOLE_DATA GuiData)
+{
+    if (GuiData->RepaintPending) return;
+
+    if (GetTickCount() - GuiData->LastRepaintTime >= CONGUI_REPAINT_TIME)
+    {
+        GuiRepaintDirtyCells(GuiData);
+    }
+    else
+    {
+        GuiData->RepaintPending = TRUE;
+        SetTimer(GuiData->hWindow, CONGUI_REPAINT_TIMER, CONGUI_REPAINT_TIME, NULL);
+    }
+}
+
 
 /******************************************************************************
  *                        GUI Terminal Initialization                         *
@@ -634,7 +689,15 @@ GuiDrawRegion(IN OUT PFRONTEND This,
     /* Do nothing if the window is hidden */
     if (!GuiData->IsWindowVisible) return;
 
-    DrawRegion(GuiData, Region);
+    if (GetType(GuiData->ActiveBuffer) == TEXTMODE_BUFFER)
+    {
+        ConioMarkDirtyRegion((PTEXTMODE_SCREEN_BUFFER)GuiData->ActiveBuffer, Region);
+        ScheduleRepaint(GuiData);
+    }
+    else
+    {
+        DrawRegion(GuiData, Region);
+    }
 }
 
 static VOID NTAPI
@@ -648,8 +711,9 @@ GuiWriteStream(IN OUT PFRONTEND This,
 {
     PGUI_CONSOLE_DATA GuiData = This->Context;
     PCONSOLE_SCREEN_BUFFER Buff;
-    SHORT CursorEndX, CursorEndY;
-    RECT ScrollRect;
+
+    UNREFERENCED_PARAMETER(Region);
+    UNREFERENCED_PARAMETER(ScrolledLines);
 
     if (NULL == GuiData || NULL == GuiData->hWindow) return;
 
@@ -659,39 +723,14 @@ GuiWriteStream(IN OUT PFRONTEND This,
     Buff = GuiData->ActiveBuffer;
     if (GetType(Buff) != TEXTMODE_BUFFER) return;
 
-    if (0 != ScrolledLines)
-    {
-        ScrollRect.left = 0;
-        ScrollRect.top = 0;
-        ScrollRect.right = Buff->ViewSize.X * GuiData->CharWidth;
-        ScrollRect.bottom = Region->Top * GuiData->CharHeight;
-
-        ScrollWindowEx(GuiData->hWindow,
-                       0,
-                       -(int)(ScrolledLines * GuiData->CharHeight),
-                       &ScrollRect,
-                       NULL,
-                       NULL,
-                       NULL,
-                       SW_INVALIDATE);
-    }
-
-    DrawRegion(GuiData, Region);
-
-    if (CursorStartX < Region->Left || Region->Right < CursorStartX
-            || CursorStartY < Region->Top || Region->Bottom < CursorStartY)
-    {
-        InvalidateCell(GuiData, CursorStartX, CursorStartY);
-    }
-
-    CursorEndX = Buff->CursorPosition.X;
-    CursorEndY = Buff->CursorPosition.Y;
-    if ((CursorEndX < Region->Left || Region->Right < CursorEndX
-            || CursorEndY < Region->Top || Region->Bottom < CursorEndY)
-            && (CursorEndX != CursorStartX || CursorEndY != CursorStartY))
-    {
-        InvalidateCell(GuiData, CursorEndX, CursorEndY);
-    }
+    /*
+     * The written cells and the scrolling were recorded in the buffer while
+     * writing, only the caret cells are left to be repainted.
+     */
+    ConioMarkDirty((PTEXTMODE_SCREEN_BUFFER)Buff, CursorStartY, CursorStartX, CursorStartX);
+    ConioMarkDirty((PTEXTMODE_SCREEN_BUFFER)Buff,
+                   Buff->CursorPosition.Y, Buff->CursorPosition.X, Buff->CursorPosition.X);
+    ScheduleRepaint(GuiData);
 
     // HACK!!
     // Set up the update timer (very short interval) - this is a "hack" for getting the OS to
@@ -22,6 +22,9 @@
 
 #define IS_WHITESPACE(c)    ((c) == L'\0' || (c) == L' ' || (c) == L'\t')
 
+/* Longest run of cells drawn with a single ExtTextOutW call */
+#define PAINT_RUN_LENGTH    256
+
 /* FUNCTIONS ******************************************************************/
 
 static COLORREF
@@ -429,6 +432,27 @@ GuiPaintCaret(
     }
 }
 
+static VOID
+PaintRun(
+    PGUI_CONSOLE_DATA GuiData,
+    ULONG Column,
+    ULONG Line,
+    ULONG Width,
+    PCWSTR Text,
+    const INT *Dx,
+    ULONG Length)
+{
+    RECT rcRun;
+
+    rcRun.left   = Column * GuiData->CharWidth;
+    rcRun.top    = Line * GuiData->CharHeight;
+    rcRun.right  = rcRun.left + Width;
+    rcRun.bottom = rcRun.top + GuiData->CharHeight;
+
+    ExtTextOutW(GuiData->hMemDC, rcRun.left, rcRun.top, ETO_OPAQUE,
+                &rcRun, Text, Length, Dx);
+}
+
 VOID
 GuiPaintTextModeBuffer(PTEXTMODE_SCREEN_BUFFER Buffer,
                        PGUI_CONSOLE_DATA GuiData,
@@ -437,9 +461,10 @@ GuiPaintTextModeBuffer(PTEXTMODE_SCREEN_BUFFER Buffer,
 {
     PCONSRV_CONSOLE Console = (PCONSRV_CONSOLE)Buffer->Header.Console;
     ULONG TopLine, BottomLine, LeftColumn, RightColumn;
-    ULONG Line, Char, Start;
+    ULONG Line, Char, Start, Length, RunWidth;
     PCHAR_INFO From;
-    PWCHAR To;
+    WCHAR RunText[PAINT_RUN_LENGTH];
+    INT RunDx[PAINT_RUN_LENGTH];
     WORD LastAttribute, Attribute;
     HFONT OldFont, NewFont;
     BOOLEAN IsUnderline;
@@ -470,7 +495,7 @@ GuiPaintTextModeBuffer(PTEXTMODE_SCREEN_BUFFER Buffer,
     if (BottomLine >= (ULONG)Buffer->ScreenBufferSize.Y)
         BottomLine  = Buffer->ScreenBufferSize.Y - 1;
 
-    LastAttribute = ConioCoordToPointer(Buffer, LeftColumn, TopLine)->Attributes;
+    LastAttribute = ConioCoordToPointer(Buffer, LeftColumn, TopLine)->Attributes & ~COMMON_LVB_SBCSDBCS;
 
     SetTextColor(GuiData->hMemDC, PaletteRGBFromAttrib(Console, TextAttribFromAttrib(LastAttribute)));
     SetBkColor(GuiData->hMemDC, PaletteRGBFromAttrib(Console, BkgdAttribFromAttrib(LastAttribute)));
@@ -481,88 +506,62 @@ GuiPaintTextModeBuffer(PTEXTMODE_SCREEN_BUFFER Buffer,
     NewFont = GuiData->Font[IsUnderline ? FONT_BOLD : FONT_NORMAL];
     OldFont = SelectObject(GuiData->hMemDC, NewFont);
 
-    if (Console->IsCJK)
+    /*
+     * Draw each run of cells sharing the same attributes with a single
+     * ExtTextOutW call. The explicit advances keep the text on the cell
+     * grid, full-width characters taking two cells.
+     */
+    for (Line = TopLine; Line <= BottomLine; Line++)
     {
-        for (Line = TopLine; Line <= BottomLine; Line++)
+        From   = ConioCoordToPointer(Buffer, LeftColumn, Line);
+        Start  = LeftColumn;
+        Length = 0;
+        RunWidth = 0;
+
+        for (Char = LeftColumn; Char <= RightColumn; Char++, From++)
         {
-            for (Char = LeftColumn; Char <= RightColumn; Char++)
+            Attribute = From->Attributes & ~COMMON_LVB_SBCSDBCS;
+
+            if (Length > 0 && (Attribute != LastAttribute || Length == ARRAYSIZE(RunText)))
+            {
+                PaintRun(GuiData, Start, Line, RunWidth, RunText, RunDx, Length);
+                Length = 0;
+                RunWidth = 0;
+            }
+
+            if (Attribute != LastAttribute)
             {
-                From = ConioCoordToPointer(Buffer, Char, Line);
-                Attribute = From->Attributes;
-                SetTextColor(GuiData->hMemDC, PaletteRGBFromAttrib(Console, TextAttribFromAttrib(Attribute)));
-                SetBkColor(GuiData->hMemDC, PaletteRGBFromAttrib(Console, BkgdAttribFromAttrib(Attribute)));
+                LastAttribute = Attribute;
+                SetTextColor(GuiData->hMemDC, PaletteRGBFromAttrib(Console, TextAttribFromAttrib(LastAttribute)));
+                SetBkColor(GuiData->hMemDC, PaletteRGBFromAttrib(Console, BkgdAttribFromAttrib(LastAttribute)));
 
                 /* Change underline state if needed */
-                if (!!(Attribute & COMMON_LVB_UNDERSCORE) != IsUnderline)
+                if (!!(LastAttribute & COMMON_LVB_UNDERSCORE) != IsUnderline)
                 {
-                    IsUnderline = !!(Attribute & COMMON_LVB_UNDERSCORE);
-
+                    IsUnderline = !!(LastAttribute & COMMON_LVB_UNDERSCORE);
                     /* Select the new font */
                     NewFont = GuiData->Font[IsUnderline ? FONT_BOLD : FONT_NORMAL];
                     SelectObject(GuiData->hMemDC, NewFont);
                 }
-
-                if (Attribute & COMMON_LVB_TRAILING_BYTE)
-                    continue;
-
-                TextOutW(GuiData->hMemDC,
-                         Char * GuiData->CharWidth,
-                         Line * GuiData->CharHeight,
-                         &From->Char.UnicodeChar, 1);
             }
-        }
-    }
-    else
-    {
-        for (Line = TopLine; Line <= BottomLine; Line++)
-        {
-            WCHAR LineBuffer[80];   // Buffer containing a part or all the line to be displayed
-            From  = ConioCoordToPointer(Buffer, LeftColumn, Line);  // Get the first code of the line
-            Start = LeftColumn;
-            To    = LineBuffer;
 
-            for (Char = LeftColumn; Char <= RightColumn; Char++)
-            {
-                /*
-                 * We flush the buffer if the new attribute is different
-                 * from the current one, or if the buffer is full.
-                 */
-                if (From->Attributes != LastAttribute || (Char - Start == sizeof(LineBuffer) / sizeof(WCHAR)))
-                {
-                    TextOutW(GuiData->hMemDC,
-                             Start * GuiData->CharWidth,
-                             Line  * GuiData->CharHeight,
-                             LineBuffer,
-                             Char - Start);
-                    Start = Char;
-                    To    = LineBuffer;
-                    Attribute = From->Attributes;
-                    if (Attribute != LastAttribute)
-                    {
-                        LastAttribute = Attribute;
-                        SetTextColor(GuiData->hMemDC, PaletteRGBFromAttrib(Console, TextAttribFromAttrib(LastAttribute)));
-                        SetBkColor(GuiData->hMemDC, PaletteRGBFromAttrib(Console, BkgdAttribFromAttrib(LastAttribute)));
-
-                        /* Change underline state if needed */
-                        if (!!(LastAttribute & COMMON_LVB_UNDERSCORE) != IsUnderline)
-                        {
-                            IsUnderline = !!(LastAttribute & COMMON_LVB_UNDERSCORE);
-                            /* Select the new font */
-                            NewFont = GuiData->Font[IsUnderline ? FONT_BOLD : FONT_NORMAL];
-                            SelectObject(GuiData->hMemDC, NewFont);
-                        }
-                    }
-                }
+            /* The trailing byte is drawn together with its leading byte */
+            if (Console->IsCJK && (From->Attributes & COMMON_LVB_TRAILING_BYTE))
+                continue;
 
-                *(To++) = (From++)->Char.UnicodeChar;
-            }
+            if (Length == 0)
+                Start = Char;
 
-            TextOutW(GuiData->hMemDC,
-                     Start * GuiData->CharWidth,
-                     Line  * GuiData->CharHeight,
-                     LineBuffer,
-                     RightColumn - Start + 1);
+            RunText[Length] = From->Char.UnicodeChar;
+            RunDx[Length] = GuiData->CharWidth;
+            if (Console->IsCJK && (From->Attributes & COMMON_LVB_LEADING_BYTE))
+                RunDx[Length] *= 2;
+            RunWidth += RunDx[Length];
+            Length++;
         }
+
+        if (Length > 0)
+            PaintRun(GuiData, Start, Line, RunWidth, RunText, RunDx, Length);
     }
 
     /* Restore the old font */
@@ -489,6 +489,7 @@ ConioNextLine(PTEXTMODE_SCREEN_BUFFER Buff, PSMALL_RECT UpdateRect, PUINT Scroll
         }
         (*ScrolledLines)++;
         ClearLineBuffer(Buff);
+        ConioScrollDirty(Buff);
         if (UpdateRect->Top != 0)
         {
             UpdateRect->Top--;
@@ -512,6 +513,7 @@ ConioWriteConsole(PFRONTEND FrontEnd,
     PCHAR_INFO Ptr;
     SMALL_RECT UpdateRect;
     SHORT CursorStartX, CursorStartY;
+    SHORT DirtyLeft;
     UINT ScrolledLines;
     BOOLEAN bFullwidth;
     BOOLEAN bCJK = Console->IsCJK;
@@ -622,6 +624,10 @@ ConioWriteConsole(PFRONTEND FrontEnd,
                     Ptr->Attributes = Buff->ScreenDefaultAttrib;
                 Ptr->Attributes &= ~COMMON_LVB_SBCSDBCS;
 
+                /* The trailing byte of a full-width character may have been erased as well */
+                ConioMarkDirty(Buff, Buff->CursorPosition.Y,
+                               Buff->CursorPosition.X, Buff->CursorPosition.X + 1);
+
                 UpdateRect.Left  = min(UpdateRect.Left , Buff->CursorPosition.X);
                 UpdateRect.Right = max(UpdateRect.Right, Buff->CursorPosition.X);
                 continue;
@@ -649,6 +655,9 @@ ConioWriteConsole(PFRONTEND FrontEnd,
                 EndX = (Buff->CursorPosition.X + TAB_WIDTH) & ~(TAB_WIDTH - 1);
                 EndX = min(EndX, (UINT)Buff->ScreenBufferSize.X);
 
+                /* Including the cell after the tab, it may be a reset trailing byte */
+                ConioMarkDirty(Buff, Buff->CursorPosition.Y, Buff->CursorPosition.X, (SHORT)EndX);
+
                 while ((UINT)Buff->CursorPosition.X < EndX)
                 {
                     Ptr->Char.UnicodeChar = L' ';
@@ -736,6 +745,7 @@ ConioWriteConsole(PFRONTEND FrontEnd,
         }
 
         Ptr = ConioCoordToPointer(Buff, Buff->CursorPosition.X, Buff->CursorPosition.Y);
+        DirtyLeft = Buff->CursorPosition.X;
 
         /*
          * Check whether we are overwriting part of a full-width character,
@@ -743,6 +753,7 @@ ConioWriteConsole(PFRONTEND FrontEnd,
          */
         if (Ptr->Attributes & COMMON_LVB_TRAILING_BYTE)
         {
+            DirtyLeft--;
             /*
              * The cursor is on the trailing byte of a full-width character.
              * Go back one position to kill the previous leading byte.
@@ -802,6 +813,9 @@ ConioWriteConsole(PFRONTEND FrontEnd,
             }
         }
 
+        /* From the killed leading byte to the reset trailing byte, if any */
+        ConioMarkDirty(Buff, Buff->CursorPosition.Y, DirtyLeft, Buff->CursorPosition.X);
+
         if (Buff->CursorPosition.X >= Buff->ScreenBufferSize.X)
         {
             if (Buff->Mode & ENABLE_WRAP_AT_EOL_OUTPUT)
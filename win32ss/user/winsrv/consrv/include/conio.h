@@ -121,6 +121,16 @@ typedef struct _TEXTMODE_BUFFER_INFO
     BOOLEAN IsCursorVisible;
 } TEXTMODE_BUFFER_INFO, *PTEXTMODE_BUFFER_INFO;
 
+/*
+ * Cells of a buffer row that changed since the front-end last repainted it.
+ * The row is clean when Left > Right.
+ */
+typedef struct _CONSOLE_DIRTY_SPAN
+{
+    SHORT Left;
+    SHORT Right;
+} CONSOLE_DIRTY_SPAN, *PCONSOLE_DIRTY_SPAN;
+
 typedef struct _TEXTMODE_SCREEN_BUFFER
 {
     CONSOLE_SCREEN_BUFFER;      /* Screen buffer base class - MUST BE IN FIRST PLACE */
@@ -130,6 +140,9 @@ typedef struct _TEXTMODE_SCREEN_BUFFER
 
     USHORT ScreenDefaultAttrib; /* Default screen char attribute */
     USHORT PopupDefaultAttrib;  /* Default popup char attribute */
+
+    PCONSOLE_DIRTY_SPAN DirtySpans; /* One per row of Buffer, indexed like Buffer so that scrolling does not move them */
+    USHORT DirtyScroll;             /* Lines scrolled since the last repaint */
 } TEXTMODE_SCREEN_BUFFER, *PTEXTMODE_SCREEN_BUFFER;
 
 
@@ -325,6 +338,12 @@ NTSTATUS ConioResizeBuffer(PCONSOLE Console,
                            PTEXTMODE_SCREEN_BUFFER ScreenBuffer,
                            COORD Size);
 
+/* text.c */
+VOID ConioMarkDirty(PTEXTMODE_SCREEN_BUFFER Buff, SHORT Line, SHORT Left, SHORT Right);
+VOID ConioMarkDirtyRegion(PTEXTMODE_SCREEN_BUFFER Buff, PSMALL_RECT Region);
+VOID ConioScrollDirty(PTEXTMODE_SCREEN_BUFFER Buff);
+BOOLEAN ConioTakeDirtySpan(PTEXTMODE_SCREEN_BUFFER Buff, SHORT Line, PSHORT Left, PSHORT Right);
+
 /* wcwidth.c */
 int mk_wcwidth_cjk(wchar_t ucs);
 
@@ -138,6 +138,10 @@ typedef struct _CONSRV_CONSOLE
     LIST_ENTRY  ReadWaitQueue;      /* List head for the queue of unique input buffer read wait blocks */
     LIST_ENTRY WriteWaitQueue;      /* List head for the queue of current screen-buffer write wait blocks */
 
+/**************************** Shared output rings *****************************/
+    HANDLE OutputRingControlSection;                  /* Section of the page shared by the output rings of all the processes */
+    PCONSOLE_OUTPUT_RING_CONTROL OutputRingControl;   /* Our view of it */
+
 /**************************** Aliases and Histories ***************************/
     struct _ALIAS_HEADER *Aliases;
     LIST_ENTRY HistoryBuffers;
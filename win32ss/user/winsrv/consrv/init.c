@@ -118,6 +118,8 @@ PCSR_API_ROUTINE ConsoleServerApiDispatchTable[ConsolepMaxApiNumber - CONSRV_FIR
     // SrvSetConsoleCurrentFont,               // Added in Vista+
     // SrvSetScreenBufferInfo,                 // Added in Vista+
     // SrvConsoleClientConnect,                // Added in Win7
+
+    SrvMapConsoleOutputRing,                // ReactOS-specific
 };
 
 BOOLEAN ConsoleServerApiServerValidTable[ConsolepMaxApiNumber - CONSRV_FIRST_API_NUMBER] =
@@ -214,6 +216,8 @@ BOOLEAN ConsoleServerApiServerValidTable[ConsolepMaxApiNumber - CONSRV_FIRST_API
     // FALSE,   // SrvSetConsoleCurrentFont,
     // FALSE,   // SrvSetScreenBufferInfo,
     // FALSE,   // SrvConsoleClientConnect,
+
+    FALSE,   // SrvMapConsoleOutputRing,
 };
 
 /*
@@ -315,6 +319,8 @@ PCHAR ConsoleServerApiNameTable[ConsolepMaxApiNumber - CONSRV_FIRST_API_NUMBER]
     // "SetConsoleCurrentFont",
     // "SetScreenBufferInfo",
     // "ConsoleClientConnect",
+
+    "MapConsoleOutputRing",
 };
 #endif
 
@@ -565,6 +571,7 @@ CSR_SERVER_DLL_INIT(ConServerDllInitialization)
 */
 
     ConSrvInitConsoleSupport();
+    ConSrvInitOutputRings();
 
     /* Setup the DLL Object */
     LoadedServerDll->ApiBase = CONSRV_FIRST_API_NUMBER;